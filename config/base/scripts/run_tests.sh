@@ -14,5 +14,6 @@ cd "$SCRIPT_DIR"
 export LD_LIBRARY_PATH=../lib:../lib/DriverPlugins:$LD_LIBRARY_PATH
 
 # Run all tests except those marked to require a display. That means, this script can be executed on
-# a machine without a GPU and without a screen.
-./cosmoscout --run-tests --test-case-exclude="*[graphical]*"
+# a machine without a GPU and without a screen. Benchmarks are excluded as well, as they take quite
+# some time.
+./cosmoscout --run-tests --test-case-exclude="*[graphical]*,*[benchmark]*"
@@ -225,8 +225,8 @@ vec3 VP_getVertexPositionInterpolated(ivec2 iPosition)
     vec2 alpha = vec2(iPosition) / VP_demOffsetScale.z;
 
     // calculate normal direction by slerping
-    vec3 normalSW = mix(VP_normals[2], VP_normals[1], alpha.y);
-    vec3 normalNE = mix(VP_normals[3], VP_normals[0], alpha.y);
+    vec3 normalSW = mix(VP_getNormal(2), VP_getNormal(1), alpha.y);
+    vec3 normalNE = mix(VP_getNormal(3), VP_getNormal(0), alpha.y);
     vec3 normal   = mix(normalSW, normalNE, alpha.x);
 
     // calculate height above surface
@@ -240,14 +240,14 @@ vec3 VP_getVertexPositionInterpolated(ivec2 iPosition)
     if (alpha.x + alpha.y < 1.0)
     {
         // southern triangle
-        result += VP_corners[2] + (VP_corners[3] - VP_corners[2]) * alpha.x
-                                + (VP_corners[1] - VP_corners[2]) * alpha.y;
+        result += VP_getCorner(2) + (VP_getCorner(3) - VP_getCorner(2)) * alpha.x
+                                  + (VP_getCorner(1) - VP_getCorner(2)) * alpha.y;
     }
     else
     {
         // northern triangle
-        result += VP_corners[0] + (VP_corners[1] - VP_corners[0]) * (1-alpha.x)
-                                + (VP_corners[3] - VP_corners[0]) * (1-alpha.y);
+        result += VP_getCorner(0) + (VP_getCorner(1) - VP_getCorner(0)) * (1-alpha.x)
+                                  + (VP_getCorner(3) - VP_getCorner(0)) * (1-alpha.y);
     }
 
     return result;
@@ -258,6 +258,11 @@ vec3 VP_getVertexPositionInterpolated(ivec2 iPosition)
 // VP_texDEM.
 vec3 VP_getVertexPosition(ivec2 iPosition, int mode)
 {
+#ifdef VP_MULTI_DRAW
+    // every terrain vertex shader calls this, so the tile index is forwarded here
+    VP_tileIndex = VP_iTileIndex;
+#endif
+
     if (mode == 0) {
         return VP_getVertexPositionHEALPix(iPosition);
     } else if (mode == 1) {
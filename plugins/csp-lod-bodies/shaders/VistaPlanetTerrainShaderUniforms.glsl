@@ -32,6 +32,61 @@ uniform sampler2DArray VP_texIMG;
 
 // uniforms - current tile -----------------------------------------------------
 
+#ifdef VP_MULTI_DRAW
+
+// When all tiles of a planet are drawn with a single call, the per-tile parameters are read from a
+// shader storage buffer. The layout must match TileRenderer::TileData. The index of the current
+// tile is passed in as instanced vertex attribute and forwarded to the fragment shader.
+struct VP_TileData
+{
+    ivec4 tileOffsetScale; // w: VP_layerDEM
+    ivec4 demOffsetScale;  // w: VP_layerIMG
+    ivec4 imgOffsetScale;
+    ivec4 f1f2;
+    ivec4 edgeDelta;
+    ivec4 edgeLayerDEM;
+    ivec4 edgeOffset;
+    vec4  corners[4];      // corners[0].w: VP_demAverageHeight
+    vec4  normals[4];
+};
+
+layout(std430, binding = 0) readonly buffer VP_TileBuffer
+{
+    VP_TileData VP_tiles[];
+};
+
+#ifdef VP_VERTEX_SHADER
+layout(location = 1) in int VP_iTileIndex;
+flat out int VP_tileIndex;
+#define VP_TILE VP_tiles[VP_iTileIndex]
+#else
+flat in int VP_tileIndex;
+#define VP_TILE VP_tiles[VP_tileIndex]
+#endif
+
+#define VP_demAverageHeight VP_TILE.corners[0].w
+#define VP_tileOffsetScale  VP_TILE.tileOffsetScale.xyz
+#define VP_demOffsetScale   VP_TILE.demOffsetScale.xyz
+#define VP_imgOffsetScale   VP_TILE.imgOffsetScale.xyz
+#define VP_edgeDelta        VP_TILE.edgeDelta
+#define VP_edgeLayerDEM     VP_TILE.edgeLayerDEM
+#define VP_edgeOffset       VP_TILE.edgeOffset
+#define VP_f1f2             VP_TILE.f1f2.xy
+#define VP_layerDEM         VP_TILE.tileOffsetScale.w
+#define VP_layerIMG         VP_TILE.demOffsetScale.w
+
+vec3 VP_getCorner(int i)
+{
+    return VP_TILE.corners[i].xyz;
+}
+
+vec3 VP_getNormal(int i)
+{
+    return VP_TILE.normals[i].xyz;
+}
+
+#else
+
 uniform float VP_demAverageHeight;
 
 // offset (xy) and total number of patches (z) (relative to base patch)
@@ -66,6 +121,18 @@ uniform int VP_layerIMG;
 uniform vec3 VP_corners[4];
 uniform vec3 VP_normals[4];
 
+vec3 VP_getCorner(int i)
+{
+    return VP_corners[i];
+}
+
+vec3 VP_getNormal(int i)
+{
+    return VP_normals[i];
+}
+
+#endif
+
 // uniforms - shadow stuff -----------------------------------------------------
 uniform bool            VP_shadowMapMode;
 uniform sampler2DShadow VP_shadowMaps[5];
@@ -0,0 +1,248 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "AsyncHeightSampler.hpp"
+
+#include "HEALPix.hpp"
+#include "TileSource.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <memory>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// The number of consecutive positions which are refined together. The tiles of a batch are loaded
+// in parallel, so this should not be too small. Tiles which are not needed anymore are dropped
+// between the batches.
+std::size_t const batchSize = 256;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncHeightSampler::AsyncHeightSampler(std::size_t maxTileCount)
+    : mMaxTileCount(maxTileCount)
+    , mToken(std::make_shared<cs::utils::CancellationToken>())
+    , mThreadPool(1) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncHeightSampler::~AsyncHeightSampler() {
+  // The remaining queries are still executed by the ThreadPool, but they return as soon as the
+  // tiles which are currently loading are finished.
+  mToken->cancel();
+
+  std::lock_guard<std::mutex> lock(mSourceMutex);
+  if (mRunningToken) {
+    mRunningToken->cancel();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AsyncHeightSampler::setSource(std::shared_ptr<TileSource> source) {
+  std::lock_guard<std::mutex> lock(mSourceMutex);
+  mSource        = std::move(source);
+  mSourceChanged = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<TileSource> AsyncHeightSampler::getSource() const {
+  std::lock_guard<std::mutex> lock(mSourceMutex);
+  return mSource;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::future<std::vector<double>> AsyncHeightSampler::getHeights(
+    std::vector<glm::dvec2> lngLats, std::shared_ptr<cs::utils::CancellationToken> token) {
+  if (!token) {
+    token = std::make_shared<cs::utils::CancellationToken>();
+  }
+
+  return mThreadPool.enqueue([this, lngLats = std::move(lngLats), token = std::move(token)]() {
+    return sample(lngLats, token);
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<double> AsyncHeightSampler::sample(std::vector<glm::dvec2> const& lngLats,
+    std::shared_ptr<cs::utils::CancellationToken> const& token) {
+  std::shared_ptr<TileSource> source;
+
+  {
+    std::lock_guard<std::mutex> lock(mSourceMutex);
+    source        = mSource;
+    mRunningToken = token;
+
+    if (mToken->isCancelled()) {
+      token->cancel();
+    }
+
+    if (mSourceChanged) {
+      for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+        mTree.setRoot(i, nullptr);
+      }
+
+      mTileCount     = 0;
+      mSourceChanged = false;
+    }
+  }
+
+  std::vector<double> heights(lngLats.size(), 0.0);
+
+  if (source) {
+    // Tiles which could not be loaded are not requested again during this query.
+    std::unordered_set<TileId> failedTiles;
+    std::vector<glm::dvec2>    batch;
+    std::vector<double>        batchHeights;
+
+    for (std::size_t begin = 0; begin < lngLats.size(); begin += batchSize) {
+      std::size_t end = std::min(begin + batchSize, lngLats.size());
+      batch.assign(lngLats.begin() + static_cast<std::ptrdiff_t>(begin),
+          lngLats.begin() + static_cast<std::ptrdiff_t>(end));
+
+      sampleBatch(*source, batch, batchHeights, failedTiles, token);
+      std::copy(batchHeights.begin(), batchHeights.end(),
+          heights.begin() + static_cast<std::ptrdiff_t>(begin));
+
+      prune();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mSourceMutex);
+  mRunningToken.reset();
+
+  return heights;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AsyncHeightSampler::sampleBatch(TileSource& source, std::vector<glm::dvec2> const& lngLats,
+    std::vector<double>& heights, std::unordered_set<TileId>& failedTiles,
+    std::shared_ptr<cs::utils::CancellationToken> const& token) {
+
+  // First, the root tiles of all positions are loaded.
+  std::vector<TileId>                       missingTiles;
+  std::array<bool, TileQuadTree::sNumRoots> isMissing{};
+
+  for (auto const& lngLat : lngLats) {
+    int rootIdx = HEALPix::convertLngLat2Base(lngLat);
+
+    if (mTree.getRoot(rootIdx) == nullptr && !isMissing.at(rootIdx) &&
+        failedTiles.count(TileId(0, rootIdx)) == 0) {
+      isMissing.at(rootIdx) = true;
+      missingTiles.emplace_back(0, rootIdx);
+    }
+  }
+
+  // Then the tree is refined level by level until the finest level of the source is reached for
+  // each position. If the query is cancelled, the heights are sampled from the tiles which are
+  // already loaded.
+  while (true) {
+    if (!missingTiles.empty() && !token->isCancelled()) {
+      for (auto const& tileId : loadTiles(source, missingTiles, token)) {
+        failedTiles.insert(tileId);
+      }
+    }
+
+    missingTiles.clear();
+    utils::getHeights(&mTree, HeightSamplePrecision::eFine, lngLats, heights, missingTiles);
+
+    missingTiles.erase(std::remove_if(missingTiles.begin(), missingTiles.end(),
+                           [&](TileId const& tileId) { return failedTiles.count(tileId) > 0; }),
+        missingTiles.end());
+
+    if (missingTiles.empty() || token->isCancelled()) {
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TileId> AsyncHeightSampler::loadTiles(TileSource& source,
+    std::vector<TileId> const& tileIds,
+    std::shared_ptr<cs::utils::CancellationToken> const& token) {
+  std::mutex                             mutex;
+  std::condition_variable                finished;
+  std::vector<std::unique_ptr<TileNode>> nodes;
+  std::size_t                            remaining = tileIds.size();
+
+  for (auto const& tileId : tileIds) {
+    source.loadTileAsync(
+        tileId.level(), tileId.patchIdx(),
+        [&](TileSource* /*source*/, int /*level*/, glm::int64 /*patchIdx*/, TileNode* node) {
+          std::lock_guard<std::mutex> lock(mutex);
+
+          if (node) {
+            nodes.emplace_back(node);
+          }
+
+          // Notify while holding the lock, as the waiting thread destroys the condition variable
+          // as soon as it returns.
+          --remaining;
+          finished.notify_one();
+        },
+        token);
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]() { return remaining == 0; });
+  }
+
+  std::vector<TileId> failedTiles = tileIds;
+
+  for (auto& node : nodes) {
+    failedTiles.erase(std::remove(failedTiles.begin(), failedTiles.end(), node->getTileId()),
+        failedTiles.end());
+
+    // Nodes which cannot be inserted are deleted when nodes goes out of scope.
+    if (insertNode(&mTree, node.get())) {
+      node.release();
+      ++mTileCount;
+    }
+  }
+
+  return failedTiles;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AsyncHeightSampler::prune() {
+  if (mTileCount <= mMaxTileCount) {
+    return;
+  }
+
+  mTileCount = 0;
+
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    TileNode* root = mTree.getRoot(i);
+
+    if (root) {
+      for (int j = 0; j < 4; ++j) {
+        root->setChild(j, nullptr);
+      }
+
+      ++mTileCount;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
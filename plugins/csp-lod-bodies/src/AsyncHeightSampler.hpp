@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_ASYNCHEIGHTSAMPLER_HPP
+#define CSP_LOD_BODIES_ASYNCHEIGHTSAMPLER_HPP
+
+#include "TileId.hpp"
+#include "TileQuadTree.hpp"
+
+#include "../../../src/cs-utils/CancellationToken.hpp"
+#include "../../../src/cs-utils/ThreadPool.hpp"
+
+#include <future>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace csp::lodbodies {
+
+class TileSource;
+
+/// Samples heights with the highest precision which is available from an elevation TileSource
+/// without blocking the caller. The required tiles are loaded in the background and stored in a
+/// private TileQuadTree, the tree of the TileRenderer is never touched. Hence the results do not
+/// depend on the current view and no GPU resources are involved.
+///
+/// Queries are processed one after another by a single worker thread; the tiles of each level are
+/// loaded in parallel by the TileSource. Large queries are split into batches of consecutive
+/// positions, so that a long path does not require all of its tiles at the same time. Tiles are
+/// kept for subsequent batches and queries until more than the given number of tiles is stored,
+/// then all but the root tiles are dropped.
+///
+/// A typical user shows the result of utils::getHeights() with HeightSamplePrecision::eActual
+/// immediately and replaces it once the future returned by getHeights() is ready.
+class AsyncHeightSampler {
+ public:
+  explicit AsyncHeightSampler(std::size_t maxTileCount = 256);
+
+  AsyncHeightSampler(AsyncHeightSampler const& other) = delete;
+  AsyncHeightSampler(AsyncHeightSampler&& other)      = delete;
+
+  AsyncHeightSampler& operator=(AsyncHeightSampler const& other) = delete;
+  AsyncHeightSampler& operator=(AsyncHeightSampler&& other) = delete;
+
+  /// Cancels all pending queries. Their futures will contain the heights of the tiles which have
+  /// been loaded so far.
+  ~AsyncHeightSampler();
+
+  /// Sets the source of the elevation tiles. All tiles loaded from the previous source are dropped
+  /// before the next query is processed. The source has to be initialized already.
+  void                        setSource(std::shared_ptr<TileSource> source);
+  std::shared_ptr<TileSource> getSource() const;
+
+  /// Samples the heights at the given positions (see utils::getHeight()) once all required tiles
+  /// are loaded. Positions for which a tile could not be loaded are sampled from the next coarser
+  /// tile. If no source is set, all heights are zero.
+  ///
+  /// If the given token is cancelled, no further tiles are loaded for this query and the future
+  /// contains the heights of the tiles which have been loaded so far. Queries which are waiting
+  /// for the worker thread then return almost immediately.
+  std::future<std::vector<double>> getHeights(std::vector<glm::dvec2> lngLats,
+      std::shared_ptr<cs::utils::CancellationToken> token = nullptr);
+
+ private:
+  /// Runs on the worker thread.
+  std::vector<double> sample(std::vector<glm::dvec2> const& lngLats,
+      std::shared_ptr<cs::utils::CancellationToken> const& token);
+
+  /// Refines mTree until the heights at the given positions are sampled from the finest available
+  /// tiles or the query is cancelled. Runs on the worker thread.
+  void sampleBatch(TileSource& source, std::vector<glm::dvec2> const& lngLats,
+      std::vector<double>& heights, std::unordered_set<TileId>& failedTiles,
+      std::shared_ptr<cs::utils::CancellationToken> const& token);
+
+  /// Loads the given tiles in parallel, inserts them into mTree and returns the ids of those which
+  /// could not be loaded. Runs on the worker thread.
+  std::vector<TileId> loadTiles(TileSource& source, std::vector<TileId> const& tileIds,
+      std::shared_ptr<cs::utils::CancellationToken> const& token);
+
+  /// Drops all but the root tiles if more than mMaxTileCount tiles are stored.
+  void prune();
+
+  // This also protects mRunningToken.
+  mutable std::mutex          mSourceMutex;
+  std::shared_ptr<TileSource> mSource;
+  bool                        mSourceChanged = false;
+
+  // These are only accessed by the worker thread.
+  TileQuadTree mTree;
+  std::size_t  mTileCount = 0;
+  std::size_t  mMaxTileCount;
+
+  // mToken is cancelled when the sampler is destroyed. mRunningToken belongs to the query which is
+  // currently processed by the worker thread, it is cancelled as well then.
+  std::shared_ptr<cs::utils::CancellationToken> mToken;
+  std::shared_ptr<cs::utils::CancellationToken> mRunningToken;
+
+  // The pool is declared last, so that its workers are joined before any other member is destroyed.
+  cs::utils::ThreadPool mThreadPool;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_ASYNCHEIGHTSAMPLER_HPP
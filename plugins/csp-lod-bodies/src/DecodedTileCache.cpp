@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DecodedTileCache.hpp"
+
+#include "TilePackCache.hpp"
+
+#include <cstring>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Each record starts with this header, followed by the raw tile data and the serialized
+// MinMaxPyramid (if mHasPyramid is set).
+struct Header {
+  uint32_t mMagic;
+  uint32_t mDataType;
+  uint32_t mHasPyramid;
+  uint32_t mReserved;
+};
+
+uint32_t const headerMagic = 0x31434544; // "DEC1"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The TilePackCache uses 32 bit coordinates as key, therefore the 64 bit patch index is split into
+// two halves.
+int32_t getKeyX(TileId const& tileId) {
+  return static_cast<int32_t>(static_cast<uint64_t>(tileId.patchIdx()) & 0xffffffffU);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32_t getKeyY(TileId const& tileId) {
+  return static_cast<int32_t>(static_cast<uint64_t>(tileId.patchIdx()) >> 32U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DecodedTileCache::DecodedTileCache(std::shared_ptr<TilePackCache> pack, std::string layer)
+    : mPack(std::move(pack))
+    , mLayer(std::move(layer)) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+bool DecodedTileCache::read(Tile<T>& tile) const {
+  auto const& tileId = tile.getTileId();
+
+  return mPack->read(mLayer, tileId.level(), getKeyX(tileId), getKeyY(tileId),
+      [&tile](char const* data, size_t size) {
+        Header header{};
+
+        if (size < sizeof(Header)) {
+          return false;
+        }
+
+        std::memcpy(&header, data, sizeof(Header));
+
+        size_t tileSize    = sizeof(typename Tile<T>::Storage);
+        size_t pyramidSize = header.mHasPyramid ? MinMaxPyramid::getSerializedSize() : 0;
+
+        if (header.mMagic != headerMagic ||
+            header.mDataType != static_cast<uint32_t>(Tile<T>::getStaticDataType()) ||
+            size != sizeof(Header) + tileSize + pyramidSize) {
+          return false;
+        }
+
+        // A corrupt pyramid must not be used, the tile is decoded again instead. It is validated
+        // before anything is copied, so that the tile is not modified in this case.
+        std::unique_ptr<MinMaxPyramid> pyramid;
+
+        if (header.mHasPyramid) {
+          pyramid = std::make_unique<MinMaxPyramid>();
+          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+          if (!pyramid->deserialize(data + sizeof(Header) + tileSize, pyramidSize)) {
+            return false;
+          }
+        }
+
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        std::memcpy(tile.data().data(), data + sizeof(Header), tileSize);
+
+        if (pyramid) {
+          tile.setMinMaxPyramid(std::move(pyramid));
+        }
+
+        return true;
+      });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+void DecodedTileCache::write(Tile<T> const& tile) {
+  auto const& tileId  = tile.getTileId();
+  auto*       pyramid = tile.getMinMaxPyramid();
+
+  Header header{};
+  header.mMagic      = headerMagic;
+  header.mDataType   = static_cast<uint32_t>(Tile<T>::getStaticDataType());
+  header.mHasPyramid = pyramid ? 1 : 0;
+
+  std::string data(sizeof(Header) + sizeof(typename Tile<T>::Storage), '\0');
+  std::memcpy(&data[0], &header, sizeof(Header));
+  std::memcpy(&data[sizeof(Header)], tile.data().data(), sizeof(typename Tile<T>::Storage));
+
+  if (pyramid) {
+    pyramid->serialize(data);
+  }
+
+  mPack->write(mLayer, tileId.level(), getKeyX(tileId), getKeyY(tileId), data);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string const& DecodedTileCache::getLayer() const {
+  return mLayer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template bool DecodedTileCache::read(Tile<float>& tile) const;
+template bool DecodedTileCache::read(Tile<glm::uint8>& tile) const;
+template bool DecodedTileCache::read(Tile<glm::u8vec3>& tile) const;
+
+template void DecodedTileCache::write(Tile<float> const& tile);
+template void DecodedTileCache::write(Tile<glm::uint8> const& tile);
+template void DecodedTileCache::write(Tile<glm::u8vec3> const& tile);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_DECODEDTILECACHE_HPP
+#define CSP_LOD_BODIES_DECODEDTILECACHE_HPP
+
+#include "Tile.hpp"
+
+#include <memory>
+#include <string>
+
+namespace csp::lodbodies {
+
+class TilePackCache;
+
+/// The DecodedTileCache stores tiles after they have been completely processed by a TileSource:
+/// The final sample data and, for elevation tiles, the MinMaxPyramid. Loading a tile from this
+/// cache only requires copying the raw data into the tile, no image decoding or post-processing is
+/// required. The tiles are stored uncompressed in a TilePackCache, so this requires considerably
+/// more disc space than the original image files.
+class DecodedTileCache {
+ public:
+  /// The layer is used to distinguish tiles of different data sets which are stored in the same
+  /// pack.
+  DecodedTileCache(std::shared_ptr<TilePackCache> pack, std::string layer);
+
+  /// Fills the given tile with the cached data of the tile with the same TileId. Returns false if
+  /// the tile is not in the cache, the tile is not modified in this case.
+  template <typename T>
+  bool read(Tile<T>& tile) const;
+
+  /// Stores the data and the MinMaxPyramid (if any) of the given tile. Throws a std::runtime_error
+  /// if writing fails.
+  template <typename T>
+  void write(Tile<T> const& tile);
+
+  std::string const& getLayer() const;
+
+ private:
+  std::shared_ptr<TilePackCache> mPack;
+  std::string                    mLayer;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_DECODEDTILECACHE_HPP
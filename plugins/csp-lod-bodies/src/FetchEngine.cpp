@@ -0,0 +1,276 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FetchEngine.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// curl_multi_poll() and curl_multi_wakeup() are available since libcurl 7.68.0. With these, the
+// worker is woken up as soon as a request is queued. Older versions poll for queued requests, they
+// are started after maxWaitTime milliseconds at the latest.
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define CSP_LOD_BODIES_CURL_WAKEUP
+int const maxWaitTime = 1000;
+#else
+int const maxWaitTime = 5;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t writeCallback(char* data, size_t size, size_t count, void* userData) {
+  static_cast<std::string*>(userData)->append(data, size * count);
+  return size * count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FetchEngine::FetchEngine(uint32_t maxRequests)
+    : mMultiHandle(curl_multi_init())
+    , mMaxRequests(maxRequests) {
+
+  if (!mMultiHandle) {
+    throw std::runtime_error("Failed to create curl multi handle!");
+  }
+
+  // Use HTTP/2 multiplexing whenever possible.
+  curl_multi_setopt(mMultiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+  mWorker = std::thread([this] { work(); });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FetchEngine::~FetchEngine() {
+  {
+    std::unique_lock<std::mutex> lock(mQueueMutex);
+    mStop = true;
+  }
+
+  mQueueCondition.notify_one();
+  wakeup();
+  mWorker.join();
+
+  for (auto& transfer : mQueuedTransfers) {
+    Response response;
+    response.mError = "FetchEngine has been destroyed";
+    transfer->mPromise.set_value(std::move(response));
+  }
+
+  for (auto& transfer : mRunningTransfers) {
+    curl_multi_remove_handle(mMultiHandle, transfer.first);
+    curl_easy_cleanup(transfer.first);
+
+    Response response;
+    response.mError = "FetchEngine has been destroyed";
+    transfer.second->mPromise.set_value(std::move(response));
+  }
+
+  for (auto* handle : mIdleHandles) {
+    curl_easy_cleanup(handle);
+  }
+
+  curl_multi_cleanup(mMultiHandle);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::future<FetchEngine::Response> FetchEngine::fetch(std::string const& url) {
+  auto transfer  = std::make_unique<Transfer>();
+  transfer->mUrl = url;
+
+  auto result = transfer->mPromise.get_future();
+
+  {
+    std::unique_lock<std::mutex> lock(mQueueMutex);
+    mQueuedTransfers.push_back(std::move(transfer));
+    ++mPendingRequests;
+  }
+
+  mQueueCondition.notify_one();
+  wakeup();
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FetchEngine::setMaxRequests(uint32_t maxRequests) {
+  mMaxRequests = maxRequests;
+
+  // If the limit has been raised, queued requests can be started right away.
+  wakeup();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t FetchEngine::getMaxRequests() const {
+  return mMaxRequests;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t FetchEngine::getPendingRequests() const {
+  return mPendingRequests;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FetchEngine::work() {
+  uint32_t maxConnects = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mQueueMutex);
+
+      // Sleep until there is something to do.
+      mQueueCondition.wait(lock, [this] {
+        return mStop || !mQueuedTransfers.empty() || !mRunningTransfers.empty();
+      });
+
+      if (mStop) {
+        return;
+      }
+
+      // Start as many queued requests as allowed.
+      uint32_t maxRequests = std::max(mMaxRequests.load(), 1U);
+
+      while (!mQueuedTransfers.empty() && mRunningTransfers.size() < maxRequests) {
+        startTransfer(std::move(mQueuedTransfers.front()));
+        mQueuedTransfers.pop_front();
+      }
+
+      // Keep enough connections open so that no connection has to be closed and reopened when all
+      // request slots are in use.
+      if (maxConnects != maxRequests) {
+        maxConnects = maxRequests;
+        curl_multi_setopt(mMultiHandle, CURLMOPT_MAXCONNECTS, static_cast<long>(maxConnects));
+      }
+    }
+
+    int running = 0;
+    curl_multi_perform(mMultiHandle, &running);
+
+    int      remaining = 0;
+    CURLMsg* message   = nullptr;
+
+    while ((message = curl_multi_info_read(mMultiHandle, &remaining))) {
+      if (message->msg == CURLMSG_DONE) {
+        finishTransfer(message->easy_handle, message->data.result);
+      }
+    }
+
+    if (running > 0) {
+#ifdef CSP_LOD_BODIES_CURL_WAKEUP
+      curl_multi_poll(mMultiHandle, nullptr, 0, maxWaitTime, nullptr);
+#else
+      curl_multi_wait(mMultiHandle, nullptr, 0, maxWaitTime, nullptr);
+#endif
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FetchEngine::wakeup() {
+#ifdef CSP_LOD_BODIES_CURL_WAKEUP
+  // If the worker is not inside curl_multi_poll(), the next call to it returns immediately.
+  curl_multi_wakeup(mMultiHandle);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FetchEngine::startTransfer(std::unique_ptr<Transfer>&& transfer) {
+  CURL* handle = nullptr;
+
+  // Easy handles are reused, this keeps their DNS cache and TLS session ids.
+  if (!mIdleHandles.empty()) {
+    handle = mIdleHandles.back();
+    mIdleHandles.pop_back();
+  } else {
+    handle = curl_easy_init();
+
+    if (!handle) {
+      Response response;
+      response.mError = "Failed to create curl easy handle";
+      transfer->mPromise.set_value(std::move(response));
+      --mPendingRequests;
+      return;
+    }
+
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &writeCallback);
+
+    // Negotiate HTTP/2 for https URLs. If the server supports it, prefer waiting for a
+    // multiplexed stream on an existing connection over opening a new connection. This fails
+    // silently if libcurl has been built without HTTP/2 support.
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+  }
+
+  curl_easy_setopt(handle, CURLOPT_URL, transfer->mUrl.c_str());
+  curl_easy_setopt(handle, CURLOPT_WRITEDATA, &transfer->mBody);
+  curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, transfer->mErrorBuffer.data());
+
+  curl_multi_add_handle(mMultiHandle, handle);
+  mRunningTransfers.emplace(handle, std::move(transfer));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FetchEngine::finishTransfer(CURL* handle, CURLcode result) {
+  auto it = mRunningTransfers.find(handle);
+
+  if (it == mRunningTransfers.end()) {
+    return;
+  }
+
+  auto transfer = std::move(it->second);
+  mRunningTransfers.erase(it);
+
+  curl_multi_remove_handle(mMultiHandle, handle);
+
+  Response response;
+
+  if (result == CURLE_OK) {
+    char* contentType = nullptr;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.mStatus);
+    curl_easy_getinfo(handle, CURLINFO_CONTENT_TYPE, &contentType);
+
+    if (contentType) {
+      response.mContentType = contentType;
+    }
+
+    response.mBody = std::move(transfer->mBody);
+  } else if (transfer->mErrorBuffer[0] != '\0') {
+    response.mError = transfer->mErrorBuffer.data();
+  } else {
+    response.mError = curl_easy_strerror(result);
+  }
+
+  // The error buffer is owned by the transfer, so it must not be used anymore.
+  curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, nullptr);
+  mIdleHandles.push_back(handle);
+
+  --mPendingRequests;
+  transfer->mPromise.set_value(std::move(response));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
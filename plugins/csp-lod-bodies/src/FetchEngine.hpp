@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_FETCHENGINE_HPP
+#define CSP_LOD_BODIES_FETCHENGINE_HPP
+
+#include <curl/curl.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// The FetchEngine downloads data via HTTP(S). All transfers are driven by a single curl multi
+/// handle on a background thread. This way, connections to the server are kept open and reused for
+/// subsequent requests. If both, libcurl and the server, support HTTP/2, many requests are
+/// multiplexed over a single connection.
+///
+/// The number of transfers which are in flight at the same time is limited. All other requests are
+/// queued and started in first-in-first-out order.
+class FetchEngine {
+ public:
+  /// The result of a single request.
+  struct Response {
+    long        mStatus = 0; ///< The HTTP status code, 0 if no response was received.
+    std::string mContentType;
+    std::string mBody;
+    std::string mError; ///< Empty if the transfer succeeded, else a description of the problem.
+  };
+
+  /// Creates a FetchEngine which runs at most maxRequests transfers at the same time.
+  explicit FetchEngine(uint32_t maxRequests);
+
+  FetchEngine(FetchEngine const& other) = delete;
+  FetchEngine(FetchEngine&& other)      = delete;
+
+  FetchEngine& operator=(FetchEngine const& other) = delete;
+  FetchEngine& operator=(FetchEngine&& other) = delete;
+
+  /// Queued and running requests are aborted, their responses will contain an error.
+  ~FetchEngine();
+
+  /// Queues a GET request for the given URL. This method returns immediately. Transfer errors are
+  /// reported via Response::mError, the returned future never throws.
+  std::future<Response> fetch(std::string const& url);
+
+  /// Changes the maximum number of transfers which are in flight at the same time. This can be
+  /// called at any time, running transfers are not affected.
+  void     setMaxRequests(uint32_t maxRequests);
+  uint32_t getMaxRequests() const;
+
+  /// Returns the number of requests which are either queued or in flight.
+  uint32_t getPendingRequests() const;
+
+ private:
+  struct Transfer {
+    std::string                       mUrl;
+    std::string                       mBody;
+    std::promise<Response>            mPromise;
+    std::array<char, CURL_ERROR_SIZE> mErrorBuffer{};
+  };
+
+  void work();
+
+  /// Interrupts the worker if it is waiting for network activity, so that it checks the queue. This
+  /// is thread-safe.
+  void wakeup();
+
+  /// These are only called from the worker thread.
+  void startTransfer(std::unique_ptr<Transfer>&& transfer);
+  void finishTransfer(CURL* handle, CURLcode result);
+
+  CURLM*                                               mMultiHandle;
+  std::vector<CURL*>                                   mIdleHandles;
+  std::unordered_map<CURL*, std::unique_ptr<Transfer>> mRunningTransfers;
+
+  mutable std::mutex                    mQueueMutex;
+  std::condition_variable               mQueueCondition;
+  std::deque<std::unique_ptr<Transfer>> mQueuedTransfers;
+  bool                                  mStop = false;
+
+  std::atomic<uint32_t> mMaxRequests;
+  std::atomic<uint32_t> mPendingRequests{0};
+
+  std::thread mWorker;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_FETCHENGINE_HPP
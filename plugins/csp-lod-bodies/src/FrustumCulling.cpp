@@ -0,0 +1,475 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrustumCulling.hpp"
+
+#include <algorithm>
+#include <limits>
+
+// SSE2 is always available on x86-64. The AVX2 functions are compiled for AVX2 using a function
+// attribute and are only called if the CPU supports AVX2, so that the plugin still runs on older
+// CPUs. MSVC allows AVX2 intrinsics without any attribute.
+#if defined(__x86_64__) || defined(_M_X64)
+#define CSP_LOD_BODIES_SIMD_AVX2
+#define CSP_LOD_BODIES_SIMD_SSE2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <array>
+#include <intrin.h>
+#define CSP_LOD_BODIES_TARGET_AVX2
+#else
+#define CSP_LOD_BODIES_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CSP_LOD_BODIES_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// The batched functions are implemented once per instruction set. Thin wrappers around the
+// intrinsics keep both versions as close as possible to each other. All operations are performed
+// in the same order as in the scalar versions, which makes the results bit-identical.
+#if defined(CSP_LOD_BODIES_SIMD_SSE2)
+
+namespace sse2 {
+
+using Vec = __m128d;
+
+std::size_t const Lanes = 2;
+
+Vec set1(double v) {
+  return _mm_set1_pd(v);
+}
+
+Vec add(Vec a, Vec b) {
+  return _mm_add_pd(a, b);
+}
+
+Vec sub(Vec a, Vec b) {
+  return _mm_sub_pd(a, b);
+}
+
+Vec mul(Vec a, Vec b) {
+  return _mm_mul_pd(a, b);
+}
+
+Vec div(Vec a, Vec b) {
+  return _mm_div_pd(a, b);
+}
+
+Vec min(Vec a, Vec b) {
+  return _mm_min_pd(a, b);
+}
+
+Vec sqrt(Vec a) {
+  return _mm_sqrt_pd(a);
+}
+
+void store(double* dst, Vec v) {
+  _mm_storeu_pd(dst, v);
+}
+
+// Loads component i of the minimum (or maximum) corners of the next boxes.
+Vec load(BoundingBox<double> const* boxes, bool max, int i) {
+  if (max) {
+    return _mm_set_pd(boxes[1].getMax()[i], boxes[0].getMax()[i]);
+  }
+
+  return _mm_set_pd(boxes[1].getMin()[i], boxes[0].getMin()[i]);
+}
+
+// A vector with the x, y and z components of several boxes. Vec is not used
+// as a template argument, as GCC would warn about ignored attributes.
+struct Vec3 {
+  Vec x;
+  Vec y;
+  Vec z;
+};
+
+Vec3 loadMin(BoundingBox<double> const* boxes) {
+  return {load(boxes, false, 0), load(boxes, false, 1), load(boxes, false, 2)};
+}
+
+Vec3 loadMax(BoundingBox<double> const* boxes) {
+  return {load(boxes, true, 0), load(boxes, true, 1), load(boxes, true, 2)};
+}
+
+Vec3 sub(Vec3 const& a, Vec3 const& b) {
+  return {sub(a.x, b.x), sub(a.y, b.y), sub(a.z, b.z)};
+}
+
+Vec3 mul(Vec3 const& a, Vec b) {
+  return {mul(a.x, b), mul(a.y, b), mul(a.z, b)};
+}
+
+// Same order of operations as glm::dot().
+Vec dot(Vec3 const& a, Vec3 const& b) {
+  return add(add(mul(a.x, b.x), mul(a.y, b.y)), mul(a.z, b.z));
+}
+
+// Same order of operations as glm::normalize().
+Vec3 normalize(Vec3 const& a) {
+  return mul(a, div(set1(1.0), sqrt(dot(a, a))));
+}
+
+// Returns the number of boxes processed, the remaining ones have to be handled by the caller.
+std::size_t getFrustumDistances(Frustum const& frustum, BoundingBox<double> const* boxes,
+    std::size_t count, double* distances) {
+  std::size_t i = 0;
+
+  for (; i + Lanes <= count; i += Lanes) {
+    Vec3 const tbMin  = loadMin(boxes + i);
+    Vec3 const tbMax  = loadMax(boxes + i);
+    Vec        result = set1(std::numeric_limits<double>::max());
+
+    // The normal is the same for all boxes, so the corner can be selected
+    // without any blending.
+    for (auto const& plane : frustum.getPlanes()) {
+      Vec3 const corner = {plane.x >= 0.0 ? tbMax.x : tbMin.x, plane.y >= 0.0 ? tbMax.y : tbMin.y,
+          plane.z >= 0.0 ? tbMax.z : tbMin.z};
+      Vec3 const normal = {set1(plane.x), set1(plane.y), set1(plane.z)};
+
+      result = min(result, add(dot(normal, corner), set1(plane.w)));
+    }
+
+    store(distances + i, result);
+  }
+
+  return i;
+}
+
+// Returns the number of boxes processed, the remaining ones have to be handled by the caller.
+std::size_t getMinCornerCosines(glm::dvec3 const& eye, BoundingBox<double> const* boxes,
+    std::size_t count, double* cosines) {
+  std::size_t i = 0;
+
+  Vec3 const eyes = {set1(eye.x), set1(eye.y), set1(eye.z)};
+  Vec const  half = set1(0.5);
+
+  for (; i + Lanes <= count; i += Lanes) {
+    Vec3 const tbMin = loadMin(boxes + i);
+    Vec3 const tbMax = loadMax(boxes + i);
+    Vec3 const center{mul(half, add(tbMin.x, tbMax.x)), mul(half, add(tbMin.y, tbMax.y)),
+        mul(half, add(tbMin.z, tbMax.z))};
+    Vec3 const centerDir = normalize(sub(center, eyes));
+
+    Vec result = set1(std::numeric_limits<double>::max());
+
+    for (int j = 0; j < 8; ++j) {
+      Vec3 const corner = {(j & 1) ? tbMax.x : tbMin.x, (j & 2) ? tbMax.y : tbMin.y,
+          (j & 4) ? tbMax.z : tbMin.z};
+
+      result = min(result, dot(normalize(sub(corner, eyes)), centerDir));
+    }
+
+    store(cosines + i, result);
+  }
+
+  return i;
+}
+
+} // namespace sse2
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Same as above, but every function has to be compiled for AVX2 explicitly.
+#if defined(CSP_LOD_BODIES_SIMD_AVX2)
+
+namespace avx2 {
+
+using Vec = __m256d;
+
+std::size_t const Lanes = 4;
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec set1(double v) {
+  return _mm256_set1_pd(v);
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec add(Vec a, Vec b) {
+  return _mm256_add_pd(a, b);
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec sub(Vec a, Vec b) {
+  return _mm256_sub_pd(a, b);
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec mul(Vec a, Vec b) {
+  return _mm256_mul_pd(a, b);
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec div(Vec a, Vec b) {
+  return _mm256_div_pd(a, b);
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec min(Vec a, Vec b) {
+  return _mm256_min_pd(a, b);
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec sqrt(Vec a) {
+  return _mm256_sqrt_pd(a);
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 void store(double* dst, Vec v) {
+  _mm256_storeu_pd(dst, v);
+}
+
+// Loads component i of the minimum (or maximum) corners of the next boxes.
+CSP_LOD_BODIES_TARGET_AVX2 Vec load(BoundingBox<double> const* boxes, bool max, int i) {
+  if (max) {
+    return _mm256_set_pd(boxes[3].getMax()[i], boxes[2].getMax()[i], boxes[1].getMax()[i],
+        boxes[0].getMax()[i]);
+  }
+
+  return _mm256_set_pd(
+      boxes[3].getMin()[i], boxes[2].getMin()[i], boxes[1].getMin()[i], boxes[0].getMin()[i]);
+}
+
+struct Vec3 {
+  Vec x;
+  Vec y;
+  Vec z;
+};
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec3 loadMin(BoundingBox<double> const* boxes) {
+  return {load(boxes, false, 0), load(boxes, false, 1), load(boxes, false, 2)};
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec3 loadMax(BoundingBox<double> const* boxes) {
+  return {load(boxes, true, 0), load(boxes, true, 1), load(boxes, true, 2)};
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec3 sub(Vec3 const& a, Vec3 const& b) {
+  return {sub(a.x, b.x), sub(a.y, b.y), sub(a.z, b.z)};
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec3 mul(Vec3 const& a, Vec b) {
+  return {mul(a.x, b), mul(a.y, b), mul(a.z, b)};
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec dot(Vec3 const& a, Vec3 const& b) {
+  return add(add(mul(a.x, b.x), mul(a.y, b.y)), mul(a.z, b.z));
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 Vec3 normalize(Vec3 const& a) {
+  return mul(a, div(set1(1.0), sqrt(dot(a, a))));
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 std::size_t getFrustumDistances(Frustum const& frustum,
+    BoundingBox<double> const* boxes, std::size_t count, double* distances) {
+  std::size_t i = 0;
+
+  for (; i + Lanes <= count; i += Lanes) {
+    Vec3 const tbMin  = loadMin(boxes + i);
+    Vec3 const tbMax  = loadMax(boxes + i);
+    Vec        result = set1(std::numeric_limits<double>::max());
+
+    for (auto const& plane : frustum.getPlanes()) {
+      Vec3 const corner = {plane.x >= 0.0 ? tbMax.x : tbMin.x, plane.y >= 0.0 ? tbMax.y : tbMin.y,
+          plane.z >= 0.0 ? tbMax.z : tbMin.z};
+      Vec3 const normal = {set1(plane.x), set1(plane.y), set1(plane.z)};
+
+      result = min(result, add(dot(normal, corner), set1(plane.w)));
+    }
+
+    store(distances + i, result);
+  }
+
+  return i;
+}
+
+CSP_LOD_BODIES_TARGET_AVX2 std::size_t getMinCornerCosines(glm::dvec3 const& eye,
+    BoundingBox<double> const* boxes, std::size_t count, double* cosines) {
+  std::size_t i = 0;
+
+  Vec3 const eyes = {set1(eye.x), set1(eye.y), set1(eye.z)};
+  Vec const  half = set1(0.5);
+
+  for (; i + Lanes <= count; i += Lanes) {
+    Vec3 const tbMin = loadMin(boxes + i);
+    Vec3 const tbMax = loadMax(boxes + i);
+    Vec3 const center{mul(half, add(tbMin.x, tbMax.x)), mul(half, add(tbMin.y, tbMax.y)),
+        mul(half, add(tbMin.z, tbMax.z))};
+    Vec3 const centerDir = normalize(sub(center, eyes));
+
+    Vec result = set1(std::numeric_limits<double>::max());
+
+    for (int j = 0; j < 8; ++j) {
+      Vec3 const corner = {(j & 1) ? tbMax.x : tbMin.x, (j & 2) ? tbMax.y : tbMin.y,
+          (j & 4) ? tbMax.z : tbMin.z};
+
+      result = min(result, dot(normalize(sub(corner, eyes)), centerDir));
+    }
+
+    store(cosines + i, result);
+  }
+
+  return i;
+}
+
+} // namespace avx2
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool detectAVX2() {
+#if defined(CSP_LOD_BODIES_SIMD_AVX2) && defined(_MSC_VER)
+  // AVX2 is reported in bit 5 of EBX of leaf 7. Additionally, the operating system has to save the
+  // AVX registers (OSXSAVE and AVX in ECX of leaf 1, SSE and AVX state enabled in XCR0).
+  std::array<int, 4> info{};
+  __cpuid(info.data(), 0);
+  if (info[0] < 7) {
+    return false;
+  }
+
+  __cpuid(info.data(), 1);
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+
+  __cpuidex(info.data(), 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#elif defined(CSP_LOD_BODIES_SIMD_AVX2)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+// Whether the AVX2 versions are used, see setUseCullingAVX2().
+bool useAVX2 = isCullingAVX2Supported();
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double getFrustumDistance(Frustum const& frustum, BoundingBox<double> const& box) {
+  double result = std::numeric_limits<double>::max();
+
+  glm::dvec3 const& tbMin = box.getMin();
+  glm::dvec3 const& tbMax = box.getMax();
+
+  // Instead of testing all eight corners, only the one furthest along the
+  // plane's normal is considered. It is selected component-wise based on the
+  // sign of the normal.
+  for (auto const& plane : frustum.getPlanes()) {
+    glm::dvec3 const normal(plane);
+    glm::dvec3 const corner(normal.x >= 0.0 ? tbMax.x : tbMin.x,
+        normal.y >= 0.0 ? tbMax.y : tbMin.y, normal.z >= 0.0 ? tbMax.z : tbMin.z);
+
+    result = std::min(result, glm::dot(normal, corner) + plane.w);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void getFrustumDistances(Frustum const& frustum, BoundingBox<double> const* boxes,
+    std::size_t count, double* distances) {
+  std::size_t i = 0;
+
+#if defined(CSP_LOD_BODIES_SIMD_AVX2)
+  if (useAVX2) {
+    i = avx2::getFrustumDistances(frustum, boxes, count, distances);
+  }
+#endif
+
+#if defined(CSP_LOD_BODIES_SIMD_SSE2)
+  i += sse2::getFrustumDistances(frustum, boxes + i, count - i, distances + i);
+#endif
+
+  for (; i < count; ++i) {
+    distances[i] = getFrustumDistance(frustum, boxes[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double getMinCornerCosine(glm::dvec3 const& eye, BoundingBox<double> const& box) {
+  glm::dvec3 const& tbMin     = box.getMin();
+  glm::dvec3 const& tbMax     = box.getMax();
+  glm::dvec3        centerDir = glm::normalize(0.5 * (tbMin + tbMax) - eye);
+
+  double result = std::numeric_limits<double>::max();
+
+  for (int i = 0; i < 8; ++i) {
+    glm::dvec3 const corner((i & 1) ? tbMax.x : tbMin.x, (i & 2) ? tbMax.y : tbMin.y,
+        (i & 4) ? tbMax.z : tbMin.z);
+
+    result = std::min(result, glm::dot(glm::normalize(corner - eye), centerDir));
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void getMinCornerCosines(glm::dvec3 const& eye, BoundingBox<double> const* boxes,
+    std::size_t count, double* cosines) {
+  std::size_t i = 0;
+
+#if defined(CSP_LOD_BODIES_SIMD_AVX2)
+  if (useAVX2) {
+    i = avx2::getMinCornerCosines(eye, boxes, count, cosines);
+  }
+#endif
+
+#if defined(CSP_LOD_BODIES_SIMD_SSE2)
+  i += sse2::getMinCornerCosines(eye, boxes + i, count - i, cosines + i);
+#endif
+
+  for (; i < count; ++i) {
+    cosines[i] = getMinCornerCosine(eye, boxes[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool isCullingAVX2Supported() {
+  static bool const supported = detectAVX2();
+  return supported;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void setUseCullingAVX2(bool enable) {
+  useAVX2 = enable && isCullingAVX2Supported();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool getUseCullingAVX2() {
+  return useAVX2;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+char const* getCullingInstructionSet() {
+  if (useAVX2) {
+    return "AVX2";
+  }
+
+#if defined(CSP_LOD_BODIES_SIMD_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
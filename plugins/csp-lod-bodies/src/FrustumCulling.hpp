@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_FRUSTUMCULLING_HPP
+#define CSP_LOD_BODIES_FRUSTUMCULLING_HPP
+
+#include "BoundingBox.hpp"
+#include "Frustum.hpp"
+
+#include <cstddef>
+
+namespace csp::lodbodies {
+
+/// Returns the signed distance of the bounding box to the frustum. For each plane, the distance of
+/// the corner which lies furthest inside the plane's halfspace is computed and the minimum of
+/// these is returned. Hence, the box potentially intersects the frustum if the result is not
+/// negative, and this does not change unless the box moves by more than the absolute value of the
+/// result relative to the planes.
+double getFrustumDistance(Frustum const& frustum, BoundingBox<double> const& box);
+
+/// Computes getFrustumDistance() for count boxes at once. Four boxes are processed in parallel if
+/// the CPU supports AVX2 (see setUseCullingAVX2()), otherwise two (SSE2) on x86-64. The results
+/// are identical to those of getFrustumDistance().
+void getFrustumDistances(Frustum const& frustum, BoundingBox<double> const* boxes,
+    std::size_t count, double* distances);
+
+/// Returns the cosine of the largest angle between the direction from the eye to the center of the
+/// box and the directions from the eye to the eight corners of the box. As the cosine decreases
+/// monotonically, comparing this value to the cosine of a threshold angle is equivalent to
+/// comparing the angle itself, but avoids eight calls to std::acos.
+double getMinCornerCosine(glm::dvec3 const& eye, BoundingBox<double> const& box);
+
+/// Computes getMinCornerCosine() for count boxes at once. Four boxes are processed in parallel if
+/// the CPU supports AVX2 (see setUseCullingAVX2()), otherwise two (SSE2) on x86-64. The results
+/// are identical to those of getMinCornerCosine().
+void getMinCornerCosines(glm::dvec3 const& eye, BoundingBox<double> const* boxes,
+    std::size_t count, double* cosines);
+
+/// Returns true if the CPU supports AVX2 instructions. The result is detected at runtime, the
+/// plugin itself is not compiled for AVX2.
+bool isCullingAVX2Supported();
+
+/// The batched functions above use AVX2 by default if it is supported. This can be disabled, for
+/// example to compare the performance of both versions, and must not be called while other threads
+/// use the batched functions. AVX2 can only be enabled if isCullingAVX2Supported() returns true.
+void setUseCullingAVX2(bool enable);
+bool getUseCullingAVX2();
+
+/// Returns the name of the instruction set currently used by the batched functions above, this is
+/// either "AVX2", "SSE2" or "scalar".
+char const* getCullingInstructionSet();
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_FRUSTUMCULLING_HPP
@@ -0,0 +1,553 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "GeoTIFFReader.hpp"
+
+#include "logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <tiffio.h>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The tags of the GeoTIFF specification which are required for locating the raster.
+uint32_t const ModelPixelScaleTag = 33550;
+uint32_t const ModelTiepointTag   = 33922;
+
+// The tag which is used by GDAL to store the value of pixels without valid data as text.
+uint32_t const GDALNoDataTag = 42113;
+
+// Images without overviews which are larger than this in any dimension cause a warning.
+uint32_t const maxSizeWithoutOverviews = 8192;
+
+// The previous tag extender of libtiff, it is called by ours.
+TIFFExtendProc sParentExtender = nullptr;
+
+void extendTags(TIFF* tif) {
+  // libtiff wants non-const names.
+  static std::string pixelScaleName = "ModelPixelScaleTag";
+  static std::string tiepointName   = "ModelTiepointTag";
+  static std::string noDataName     = "GDALNoDataTag";
+
+  static std::array<TIFFFieldInfo, 3> fields = {{
+      {ModelPixelScaleTag, -1, -1, TIFF_DOUBLE, FIELD_CUSTOM, 1, 1, pixelScaleName.data()},
+      {ModelTiepointTag, -1, -1, TIFF_DOUBLE, FIELD_CUSTOM, 1, 1, tiepointName.data()},
+      {GDALNoDataTag, -1, -1, TIFF_ASCII, FIELD_CUSTOM, 1, 0, noDataName.data()},
+  }};
+
+  TIFFMergeFieldInfo(tif, fields.data(), static_cast<uint32_t>(fields.size()));
+
+  if (sParentExtender) {
+    sParentExtender(tif);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the double values of the given tag of the current directory, or an empty vector if the
+// tag is not set.
+std::vector<double> getDoubles(TIFF* tif, uint32_t tag) {
+  uint16_t count  = 0;
+  double*  values = nullptr;
+
+  if (TIFFGetField(tif, tag, &count, &values) != 1 || values == nullptr) {
+    return {};
+  }
+
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  return std::vector<double>(values, values + count);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Converts the sample with the given index to a double.
+double getSample(uint8_t const* data, std::size_t index, uint16_t bits, uint16_t format) {
+  if (bits == 8) {
+    return data[index]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+
+  if (bits == 16) {
+    uint16_t value{};
+    std::memcpy(&value, &data[2 * index], sizeof(value));
+
+    if (format == SAMPLEFORMAT_INT) {
+      int16_t signedValue{};
+      std::memcpy(&signedValue, &value, sizeof(value));
+      return signedValue;
+    }
+
+    return value;
+  }
+
+  float value{};
+  std::memcpy(&value, &data[4 * index], sizeof(value));
+  return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The position of one sample of the grid along one axis of the image. It is interpolated between
+// the pixels mPixels[mIndex0] and mPixels[mIndex1] of the AxisSamples.
+struct AxisSample {
+  bool        mValid = false; ///< False if the sample is outside of the image.
+  std::size_t mIndex0{};
+  std::size_t mIndex1{};
+  double      mWeight{}; ///< The weight of the second pixel.
+};
+
+struct AxisSamples {
+  std::vector<int64_t>        mPixels; ///< The used pixels in ascending order.
+  std::array<AxisSample, 257> mSamples;
+};
+
+// Computes the pixels which are required for interpolating the samples at first + i * spacing /
+// pixelSize along an axis of the given size. Pixel centers are at integer positions.
+AxisSamples getAxisSamples(double first, double spacing, double pixelSize, uint32_t size) {
+  AxisSamples              result;
+  std::array<int64_t, 257> firstPixels{};
+  auto const               last = static_cast<int64_t>(size) - 1;
+
+  for (std::size_t i = 0; i < result.mSamples.size(); ++i) {
+    double const p = first + static_cast<double>(i) * spacing / pixelSize;
+
+    if (p < -0.5 || p > static_cast<double>(size) - 0.5) {
+      continue;
+    }
+
+    double const clamped = std::clamp(p, 0.0, static_cast<double>(last));
+    firstPixels.at(i)    = static_cast<int64_t>(std::floor(clamped));
+
+    result.mSamples.at(i).mValid  = true;
+    result.mSamples.at(i).mWeight = clamped - static_cast<double>(firstPixels.at(i));
+
+    result.mPixels.push_back(firstPixels.at(i));
+    result.mPixels.push_back(std::min(firstPixels.at(i) + 1, last));
+  }
+
+  std::sort(result.mPixels.begin(), result.mPixels.end());
+  result.mPixels.erase(
+      std::unique(result.mPixels.begin(), result.mPixels.end()), result.mPixels.end());
+
+  // The second pixel directly follows the first one, unless both are the last pixel.
+  for (std::size_t i = 0; i < result.mSamples.size(); ++i) {
+    AxisSample& sample = result.mSamples.at(i);
+
+    if (sample.mValid) {
+      auto const pixel = std::lower_bound(
+          result.mPixels.begin(), result.mPixels.end(), firstPixels.at(i));
+
+      sample.mIndex0 = static_cast<std::size_t>(pixel - result.mPixels.begin());
+      sample.mIndex1 = firstPixels.at(i) < last ? sample.mIndex0 + 1 : sample.mIndex0;
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GeoTIFFReader::GeoTIFFReader(std::string file, TileDataType type, uint32_t maxOpenFiles)
+    : mFile(std::move(file))
+    , mType(type)
+    , mMaxOpenFiles(maxOpenFiles) {
+
+  registerTags();
+
+  TIFF* tif = acquire();
+
+  // The handle is returned to the pool when leaving the constructor, even if it throws.
+  std::unique_ptr<TIFF, std::function<void(TIFF*)>> handle(
+      tif, [this](TIFF* t) { release(t); });
+
+  uint16_t planarConfig{};
+  TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &mBitsPerSample);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLEFORMAT, &mSampleFormat);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &mSamplesPerPixel);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_PLANARCONFIG, &planarConfig);
+
+  bool supported = (mBitsPerSample == 8 && mSampleFormat == SAMPLEFORMAT_UINT) ||
+                   (mBitsPerSample == 16 &&
+                       (mSampleFormat == SAMPLEFORMAT_UINT || mSampleFormat == SAMPLEFORMAT_INT)) ||
+                   (mBitsPerSample == 32 && mSampleFormat == SAMPLEFORMAT_IEEEFP);
+
+  if (!supported) {
+    throw std::runtime_error("Failed to open '" + mFile + "': Unsupported sample format!");
+  }
+
+  if (mSamplesPerPixel > 1 && planarConfig != PLANARCONFIG_CONTIG) {
+    throw std::runtime_error(
+        "Failed to open '" + mFile + "': Only contiguous samples are supported!");
+  }
+
+  if (mType == TileDataType::eU8Vec3 && mSamplesPerPixel < 3) {
+    throw std::runtime_error("Failed to open '" + mFile + "': Image data requires RGB samples!");
+  }
+
+  auto scale    = getDoubles(tif, ModelPixelScaleTag);
+  auto tiepoint = getDoubles(tif, ModelTiepointTag);
+
+  if (scale.size() < 2 || tiepoint.size() < 6 || scale[0] <= 0.0 || scale[1] <= 0.0) {
+    throw std::runtime_error("Failed to open '" + mFile + "': The raster is not georeferenced!");
+  }
+
+  // The value is compared to the samples after converting them to double, so it has to be rounded
+  // to the precision of the samples first.
+  char* noData = nullptr;
+  if (TIFFGetField(tif, GDALNoDataTag, &noData) == 1 && noData != nullptr) {
+    char*  end   = nullptr;
+    double value = std::strtod(noData, &end);
+
+    if (end != noData) {
+      mNoData = mBitsPerSample == 32 ? static_cast<float>(value) : value;
+    }
+  }
+
+  // Collect the full resolution image and all reduced resolution images. Transparency masks are
+  // ignored.
+  for (uint32_t i = 0; i < TIFFNumberOfDirectories(tif); ++i) {
+    if (TIFFSetDirectory(tif, static_cast<tdir_t>(i)) != 1) {
+      break;
+    }
+
+    uint32_t subfileType{};
+    TIFFGetFieldDefaulted(tif, TIFFTAG_SUBFILETYPE, &subfileType);
+
+    if ((subfileType & FILETYPE_MASK) != 0) {
+      continue;
+    }
+
+    Image image;
+    image.mDirectory = i;
+    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &image.mWidth);
+    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &image.mHeight);
+
+    if (image.mWidth == 0 || image.mHeight == 0) {
+      continue;
+    }
+
+    if (mImages.empty()) {
+      image.mPixelSize = glm::dvec2(scale[0], scale[1]);
+    } else {
+      image.mPixelSize = mImages.front().mPixelSize *
+                         glm::dvec2(static_cast<double>(mImages.front().mWidth) / image.mWidth,
+                             static_cast<double>(mImages.front().mHeight) / image.mHeight);
+    }
+
+    mImages.push_back(image);
+  }
+
+  if (mImages.empty()) {
+    throw std::runtime_error("Failed to open '" + mFile + "': There is no image in the file!");
+  }
+
+  // Coarse grids still only read the pixels they need, but these are spread over the entire image.
+  if (mImages.size() == 1 && std::max(mImages.front().mWidth, mImages.front().mHeight) >
+                                 maxSizeWithoutOverviews) {
+    logger().warn("'{}' has no overviews, loading coarse tiles will be slow! Consider adding "
+                  "overviews, e.g. with gdaladdo.",
+        mFile);
+  }
+
+  // The tie point maps the raster position (I, J) to the model position (X, Y).
+  glm::dvec2 const& size = mImages.front().mPixelSize;
+  mMin.x = tiepoint[3] - tiepoint[0] * size.x;
+  mMax.y = tiepoint[4] + tiepoint[1] * size.y;
+  mMax.x = mMin.x + mImages.front().mWidth * size.x;
+  mMin.y = mMax.y - mImages.front().mHeight * size.y;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GeoTIFFReader::~GeoTIFFReader() {
+  for (auto* handle : mHandles) {
+    TIFFClose(handle);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GeoTIFFReader::read(glm::dvec2 const& min, glm::dvec2 const& max, void* pixels) const {
+  int const         channels = mType == TileDataType::eU8Vec3 ? 3 : 1;
+  std::size_t const count    = 257 * 257 * channels;
+
+  if (mType == TileDataType::eFloat32) {
+    std::fill_n(static_cast<float*>(pixels), count, 0.F);
+  } else {
+    std::fill_n(static_cast<uint8_t*>(pixels), count, uint8_t(0));
+  }
+
+  glm::dvec2 spacing = (max - min) / 256.0;
+
+  // Use the coarsest image which is still detailed enough. If there is none, the full resolution
+  // image is used.
+  Image const* image = &mImages.front();
+  for (auto const& candidate : mImages) {
+    if (candidate.mPixelSize.x <= spacing.x * 1.001 &&
+        candidate.mPixelSize.x > image->mPixelSize.x) {
+      image = &candidate;
+    }
+  }
+
+  // Continuous pixel coordinates of the first sample, pixel centers are at integer positions.
+  glm::dvec2 const first((min.x - mMin.x) / image->mPixelSize.x - 0.5,
+      (mMax.y - max.y) / image->mPixelSize.y - 0.5);
+
+  // Only the pixels which are actually used by the interpolation are read. If the image is much
+  // finer than the grid, e.g. because there are no overviews, these are a small fraction of the
+  // pixels in the requested area.
+  auto const cols = getAxisSamples(first.x, spacing.x, image->mPixelSize.x, image->mWidth);
+  auto const rows = getAxisSamples(first.y, spacing.y, image->mPixelSize.y, image->mHeight);
+
+  if (cols.mPixels.empty() || rows.mPixels.empty()) {
+    return;
+  }
+
+  // The used pixels, NaN marks pixels without valid data.
+  std::size_t const  windowWidth = cols.mPixels.size();
+  std::vector<float> window(windowWidth * rows.mPixels.size() * channels);
+
+  {
+    std::unique_ptr<TIFF, std::function<void(TIFF*)>> handle(
+        acquire(), [this](TIFF* t) { release(t); });
+    TIFF* tif = handle.get();
+
+    if (TIFFCurrentDirectory(tif) != image->mDirectory &&
+        TIFFSetDirectory(tif, static_cast<tdir_t>(image->mDirectory)) != 1) {
+      throw std::runtime_error("Failed to read '" + mFile + "': Cannot select image!");
+    }
+
+    // Strips are handled like tiles which span the entire width of the image.
+    bool     tiled = TIFFIsTiled(tif) != 0;
+    uint32_t blockWidth{};
+    uint32_t blockHeight{};
+
+    if (tiled) {
+      TIFFGetField(tif, TIFFTAG_TILEWIDTH, &blockWidth);
+      TIFFGetField(tif, TIFFTAG_TILELENGTH, &blockHeight);
+    } else {
+      blockWidth = image->mWidth;
+      TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &blockHeight);
+      blockHeight = std::min(blockHeight, image->mHeight);
+    }
+
+    tmsize_t             blockSize = tiled ? TIFFTileSize(tif) : TIFFStripSize(tif);
+    std::vector<uint8_t> block(static_cast<std::size_t>(blockSize));
+
+    // Visits the blocks which contain at least one used row and one used column. The used pixels
+    // are sorted, so each block is visited only once.
+    for (std::size_t r = 0; r < rows.mPixels.size();) {
+      auto const y       = static_cast<uint32_t>(rows.mPixels[r] / blockHeight * blockHeight);
+      auto const rowsEnd = std::upper_bound(rows.mPixels.begin() + r, rows.mPixels.end(),
+                               int64_t(y) + blockHeight - 1) -
+                           rows.mPixels.begin();
+
+      for (std::size_t c = 0; c < cols.mPixels.size();) {
+        auto const x       = static_cast<uint32_t>(cols.mPixels[c] / blockWidth * blockWidth);
+        auto const colsEnd = std::upper_bound(cols.mPixels.begin() + c, cols.mPixels.end(),
+                                 int64_t(x) + blockWidth - 1) -
+                             cols.mPixels.begin();
+
+        uint32_t index = tiled ? TIFFComputeTile(tif, x, y, 0, 0) : TIFFComputeStrip(tif, y, 0);
+        tmsize_t read  = tiled ? TIFFReadEncodedTile(tif, index, block.data(), blockSize)
+                               : TIFFReadEncodedStrip(tif, index, block.data(), blockSize);
+
+        if (read < 0) {
+          throw std::runtime_error("Failed to read '" + mFile + "': Cannot decode data!");
+        }
+
+        for (auto row = static_cast<std::ptrdiff_t>(r); row < rowsEnd; ++row) {
+          for (auto col = static_cast<std::ptrdiff_t>(c); col < colsEnd; ++col) {
+            std::size_t source = ((rows.mPixels[row] - y) * blockWidth + (cols.mPixels[col] - x)) *
+                                 mSamplesPerPixel;
+            std::size_t target = (row * windowWidth + col) * channels;
+
+            for (int ch = 0; ch < channels; ++ch) {
+              double value = getSample(block.data(), source + ch, mBitsPerSample, mSampleFormat);
+
+              window[target + ch] = isNoData(value) ? std::numeric_limits<float>::quiet_NaN()
+                                                    : static_cast<float>(value);
+            }
+          }
+        }
+
+        c = static_cast<std::size_t>(colsEnd);
+      }
+
+      r = static_cast<std::size_t>(rowsEnd);
+    }
+  }
+
+  // Interpolate the samples. Pixels without valid data are ignored, if none of the four pixels is
+  // valid, the sample stays zero.
+  for (int row = 0; row < 257; ++row) {
+    AxisSample const& v = rows.mSamples.at(row);
+
+    if (!v.mValid) {
+      continue;
+    }
+
+    for (int col = 0; col < 257; ++col) {
+      AxisSample const& u = cols.mSamples.at(col);
+
+      if (!u.mValid) {
+        continue;
+      }
+
+      for (int c = 0; c < channels; ++c) {
+        auto sample = [&](std::size_t x, std::size_t y) {
+          return static_cast<double>(window[(y * windowWidth + x) * channels + c]);
+        };
+
+        std::array<double, 4> const values = {sample(u.mIndex0, v.mIndex0),
+            sample(u.mIndex1, v.mIndex0), sample(u.mIndex0, v.mIndex1),
+            sample(u.mIndex1, v.mIndex1)};
+        std::array<double, 4> const weights = {(1.0 - u.mWeight) * (1.0 - v.mWeight),
+            u.mWeight * (1.0 - v.mWeight), (1.0 - u.mWeight) * v.mWeight, u.mWeight * v.mWeight};
+
+        double value{};
+
+        if (std::none_of(values.begin(), values.end(), [](double x) { return std::isnan(x); })) {
+          value = (1.0 - v.mWeight) * ((1.0 - u.mWeight) * values[0] + u.mWeight * values[1]) +
+                  v.mWeight * ((1.0 - u.mWeight) * values[2] + u.mWeight * values[3]);
+        } else {
+          double weightSum = 0.0;
+
+          for (std::size_t i = 0; i < values.size(); ++i) {
+            if (!std::isnan(values.at(i))) {
+              value += weights.at(i) * values.at(i);
+              weightSum += weights.at(i);
+            }
+          }
+
+          if (weightSum <= 0.0) {
+            continue;
+          }
+
+          value /= weightSum;
+        }
+
+        std::size_t index = (row * 257 + col) * channels + c;
+
+        if (mType == TileDataType::eFloat32) {
+          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+          static_cast<float*>(pixels)[index] = static_cast<float>(value);
+        } else {
+          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+          static_cast<uint8_t*>(pixels)[index] =
+              static_cast<uint8_t>(std::clamp(std::round(value), 0.0, 255.0));
+        }
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<double> const& GeoTIFFReader::getNoData() const {
+  return mNoData;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GeoTIFFReader::isNoData(double value) const {
+  return std::isnan(value) || (mNoData && value == *mNoData);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string const& GeoTIFFReader::getFile() const {
+  return mFile;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileDataType GeoTIFFReader::getDataType() const {
+  return mType;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::dvec2 const& GeoTIFFReader::getMin() const {
+  return mMin;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::dvec2 const& GeoTIFFReader::getMax() const {
+  return mMax;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t GeoTIFFReader::getImageCount() const {
+  return mImages.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* static */ void GeoTIFFReader::registerTags() {
+  static std::once_flag flag;
+  std::call_once(flag, []() { sParentExtender = TIFFSetTagExtender(&extendTags); });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TIFF* GeoTIFFReader::acquire() const {
+  {
+    std::lock_guard<std::mutex> lock(mHandleMutex);
+
+    if (!mHandles.empty()) {
+      TIFF* handle = mHandles.back();
+      mHandles.pop_back();
+      return handle;
+    }
+  }
+
+  TIFF* handle = TIFFOpen(mFile.c_str(), "r");
+
+  if (!handle) {
+    throw std::runtime_error("Failed to open '" + mFile + "'!");
+  }
+
+  return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GeoTIFFReader::release(TIFF* handle) const {
+  {
+    std::lock_guard<std::mutex> lock(mHandleMutex);
+
+    if (mHandles.size() < mMaxOpenFiles) {
+      mHandles.push_back(handle);
+      return;
+    }
+  }
+
+  TIFFClose(handle);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_GEOTIFFREADER_HPP
+#define CSP_LOD_BODIES_GEOTIFFREADER_HPP
+
+#include "TileDataType.hpp"
+
+#include <glm/glm.hpp>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// This is the TIFF handle type of libtiff.
+struct tiff;
+
+namespace csp::lodbodies {
+
+/// Samples regular grids from a local GeoTIFF raster. The raster has to be georeferenced with the
+/// ModelPixelScale and ModelTiepoint tags, which are interpreted as pixel-is-area. Reduced
+/// resolution images in the same file, like the overviews of a Cloud Optimized GeoTIFF, are used
+/// for coarse grids. Only the pixels which are used by the interpolation are kept in memory and
+/// only the strips or tiles containing them are decoded. Still, files without overviews are slow
+/// for coarse grids, a warning is printed when such a file is large.
+///
+/// Supported are rasters with 8 bit unsigned integer, 16 bit integer and 32 bit floating point
+/// samples in contiguous planar configuration. Image tiles require at least three samples per
+/// pixel, while for gray and elevation tiles the first sample is used. Samples which equal the
+/// NoData value stored by GDAL, as well as NaN samples, are not used for the interpolation.
+///
+/// Each concurrent read uses its own handle of the file. Idle handles are kept open for later
+/// reads. This class is thread-safe.
+class GeoTIFFReader {
+ public:
+  /// Opens the given file and reads the georeference and the sizes of all reduced resolution
+  /// images. The data is converted to the given type. At most maxOpenFiles idle handles of the file
+  /// are kept open. Throws a std::runtime_error if the file cannot be opened or is not supported.
+  GeoTIFFReader(std::string file, TileDataType type, uint32_t maxOpenFiles = 8);
+
+  GeoTIFFReader(GeoTIFFReader const& other) = delete;
+  GeoTIFFReader(GeoTIFFReader&& other)      = delete;
+
+  GeoTIFFReader& operator=(GeoTIFFReader const& other) = delete;
+  GeoTIFFReader& operator=(GeoTIFFReader&& other) = delete;
+
+  ~GeoTIFFReader();
+
+  /// Samples 257 x 257 values at regular distances between min and max, which are given in the
+  /// model coordinates of the raster. The first row corresponds to max.y, the last one to min.y.
+  /// The values are interpolated bilinearly from the coarsest image which still has a resolution at
+  /// least as high as the requested one. Pixels without valid data are ignored, samples outside of
+  /// the raster or without any valid pixel nearby are zero. pixels has to point to 257 x 257 values
+  /// of the data type. Throws a std::runtime_error if reading fails.
+  void read(glm::dvec2 const& min, glm::dvec2 const& max, void* pixels) const;
+
+  std::string const& getFile() const;
+  TileDataType       getDataType() const;
+
+  /// The area covered by the raster in model coordinates.
+  glm::dvec2 const& getMin() const;
+  glm::dvec2 const& getMax() const;
+
+  /// The number of images in the file, including the full resolution one.
+  std::size_t getImageCount() const;
+
+  /// The value of pixels without valid data, if the file defines one.
+  std::optional<double> const& getNoData() const;
+
+  /// Adds the GeoTIFF tags to the tags known by libtiff. This is done automatically when the first
+  /// GeoTIFFReader is created, but it is also required for writing GeoTIFF files with libtiff.
+  static void registerTags();
+
+ private:
+  struct Image {
+    uint32_t   mDirectory = 0;
+    uint32_t   mWidth     = 0;
+    uint32_t   mHeight    = 0;
+    glm::dvec2 mPixelSize{0.0}; ///< The size of one pixel in model coordinates.
+  };
+
+  /// Returns true if the given sample is NaN or equals the NoData value.
+  bool isNoData(double value) const;
+
+  /// Returns an idle handle of the file or opens a new one.
+  tiff* acquire() const;
+  void  release(tiff* handle) const;
+
+  std::string  mFile;
+  TileDataType mType;
+  uint32_t     mMaxOpenFiles;
+
+  uint16_t mBitsPerSample   = 0;
+  uint16_t mSampleFormat    = 0;
+  uint16_t mSamplesPerPixel = 0;
+
+  glm::dvec2 mMin{0.0};
+  glm::dvec2 mMax{0.0};
+
+  std::optional<double> mNoData;
+
+  /// The full resolution image followed by the reduced resolution images.
+  std::vector<Image> mImages;
+
+  mutable std::mutex         mHandleMutex;
+  mutable std::vector<tiff*> mHandles;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_GEOTIFFREADER_HPP
@@ -8,10 +8,119 @@
 
 #include "../../../src/cs-utils/convert.hpp"
 
+// On x86-64, the bits of patch indices can be (de-)interleaved with the pdep and pext instructions
+// of the BMI2 extension. As not every CPU supports them, they are only used if they are available
+// at runtime and fast. Otherwise, the look-up-tables are used.
+#if defined(__x86_64__) || defined(_M_X64)
+#define CSP_LOD_BODIES_BMI2
+#include <array>
+#include <cstring>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CSP_LOD_BODIES_TARGET_BMI2
+#else
+#include <cpuid.h>
+#define CSP_LOD_BODIES_TARGET_BMI2 __attribute__((target("bmi2")))
+#endif
+#endif
+
 namespace csp::lodbodies {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+#if defined(CSP_LOD_BODIES_BMI2)
+
+uint64_t const EvenBitMask = 0x5555555555555555ULL;
+uint64_t const OddBitMask  = 0xAAAAAAAAAAAAAAAAULL;
+
+bool detectBMI2() {
+#if defined(_MSC_VER)
+  // The BMI2 flag is bit 8 of EBX of the extended features (leaf 7).
+  std::array<int, 4> info{};
+  __cpuid(info.data(), 0);
+
+  if (info[0] < 7) {
+    return false;
+  }
+
+  __cpuidex(info.data(), 7, 0);
+  return (info[1] & (1 << 8)) != 0;
+#else
+  // The CPU model data may not be initialized yet, as this is called during static
+  // initialization of the plugin.
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+#endif
+}
+
+// AMD CPUs before Zen 3 (family 19h) and the Hygon CPUs based on Zen 1 implement pdep and pext in
+// microcode. Depending on the number of bits set in the mask, they take up to several hundred
+// cycles there, which is much slower than the look-up-tables.
+bool detectSlowBMI2() {
+  // EAX, EBX, ECX and EDX of the given leaf.
+  auto cpuid = [](unsigned leaf) {
+    std::array<unsigned, 4> info{};
+#if defined(_MSC_VER)
+    std::array<int, 4> registers{};
+    __cpuid(registers.data(), static_cast<int>(leaf));
+    std::memcpy(info.data(), registers.data(), sizeof(info));
+#else
+    __cpuid(leaf, info[0], info[1], info[2], info[3]);
+#endif
+    return info;
+  };
+
+  // The vendor string is stored in EBX, EDX and ECX of leaf 0.
+  auto                 info = cpuid(0);
+  std::array<char, 12> vendor{};
+  std::memcpy(vendor.data(), &info[1], 4);
+  std::memcpy(vendor.data() + 4, &info[3], 4);
+  std::memcpy(vendor.data() + 8, &info[2], 4);
+
+  if (std::memcmp(vendor.data(), "AuthenticAMD", 12) != 0 &&
+      std::memcmp(vendor.data(), "HygonGenuine", 12) != 0) {
+    return false;
+  }
+
+  // The extended family is only used if the base family is 0xf.
+  info            = cpuid(1);
+  unsigned family = (info[0] >> 8U) & 0xfU;
+
+  if (family == 0xfU) {
+    family += (info[0] >> 20U) & 0xffU;
+  }
+
+  return family < 0x19U;
+}
+
+CSP_LOD_BODIES_TARGET_BMI2 glm::int64 extractEvenBitsBMI2(glm::int64 value) {
+  return static_cast<glm::int64>(_pext_u64(static_cast<uint64_t>(value), EvenBitMask));
+}
+
+CSP_LOD_BODIES_TARGET_BMI2 void extractBitsBMI2(
+    glm::int64 value, glm::int64& evenBits, glm::int64& oddBits) {
+  evenBits = static_cast<glm::int64>(_pext_u64(static_cast<uint64_t>(value), EvenBitMask));
+  oddBits  = static_cast<glm::int64>(_pext_u64(static_cast<uint64_t>(value), OddBitMask));
+}
+
+CSP_LOD_BODIES_TARGET_BMI2 glm::int64 replaceEvenBitsBMI2(glm::int64 value) {
+  return static_cast<glm::int64>(_pdep_u64(static_cast<uint64_t>(value), EvenBitMask));
+}
+
+CSP_LOD_BODIES_TARGET_BMI2 glm::int64 replaceBitsBMI2(glm::int64 evenBits, glm::int64 oddBits) {
+  return static_cast<glm::int64>(_pdep_u64(static_cast<uint64_t>(evenBits), EvenBitMask) |
+                                 _pdep_u64(static_cast<uint64_t>(oddBits), OddBitMask));
+}
+
+#endif
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 std::ostream& operator<<(std::ostream& os, EdgeDirection ed) {
   switch (ed) {
   case EdgeDirection::eNorthEast:
@@ -126,14 +235,19 @@ std::ostream& operator<<(std::ostream& os, EdgeDirection ed) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/* static */ bool HEALPixLevel::sUseBMI2 = HEALPixLevel::isBMI2Fast();
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 glm::i64vec3 HEALPixLevel::getBaseXY(glm::int64 patchIdx) const {
   // find index of patch relative to base patch (patchIdx mod Nside^2)
   // Nside is a power of 2 so we can just apply a mask
   glm::int64 patchCount  = getPatchCount();
   glm::int64 relPatchIdx = patchIdx & (patchCount - 1);
 
-  glm::int64 x = extractEvenBits(relPatchIdx);
-  glm::int64 y = extractOddBits(relPatchIdx);
+  glm::int64 x{};
+  glm::int64 y{};
+  extractBits(relPatchIdx, x, y);
 
   return glm::i64vec3(getBasePatch(patchIdx), x, y);
 }
@@ -158,6 +272,17 @@ glm::dvec2 HEALPixLevel::getCenterLngLat(glm::int64 patchIdx) const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void HEALPixLevel::getCentersLngLat(
+    std::vector<glm::int64> const& patchIdxs, std::vector<glm::dvec2>& lngLats) const {
+  lngLats.resize(patchIdxs.size());
+
+  for (std::size_t i = 0; i < patchIdxs.size(); ++i) {
+    lngLats[i] = bxy2geo(getBaseXY(patchIdxs[i]));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 glm::dvec3 HEALPixLevel::getCenterCartesian(glm::int64 patchIdx, glm::dvec3 const& radii) const {
   return cs::utils::convert::toCartesian(getCenterLngLat(patchIdx), radii);
 }
@@ -197,6 +322,31 @@ std::array<glm::dvec3, 4> HEALPixLevel::getCornersCartesian(
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void HEALPixLevel::getCornersCartesian(std::vector<glm::int64> const& patchIdxs,
+    glm::dvec3 const& radii, std::vector<glm::dvec3>& corners) const {
+  corners.resize(4 * patchIdxs.size());
+
+  double const d = 0.5 / mNSide;
+
+  for (std::size_t i = 0; i < patchIdxs.size(); ++i) {
+    glm::i64vec3 bxy  = getBaseXY(patchIdxs[i]);
+    int          base = static_cast<int>(bxy[0]);
+    double       cx   = (bxy[1] + 0.5) / mNSide;
+    double       cy   = (bxy[2] + 0.5) / mNSide;
+
+    corners[4 * i + 0] = cs::utils::convert::toCartesian(
+        HEALPix::convertBaseXY2LngLat(base, cx + d, cy + d), radii);
+    corners[4 * i + 1] = cs::utils::convert::toCartesian(
+        HEALPix::convertBaseXY2LngLat(base, cx - d, cy + d), radii);
+    corners[4 * i + 2] = cs::utils::convert::toCartesian(
+        HEALPix::convertBaseXY2LngLat(base, cx - d, cy - d), radii);
+    corners[4 * i + 3] = cs::utils::convert::toCartesian(
+        HEALPix::convertBaseXY2LngLat(base, cx + d, cy - d), radii);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 std::array<glm::dvec2, 4> HEALPixLevel::getEdgeCentersLngLat(glm::int64 patchIdx) const {
   std::array<glm::dvec2, 4> result{};
 
@@ -323,6 +473,40 @@ glm::dvec3 HEALPixLevel::getPatchOffsetScale(glm::int64 patchIdx) const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/* static */ bool HEALPixLevel::isBMI2Supported() {
+#if defined(CSP_LOD_BODIES_BMI2)
+  static bool const supported = detectBMI2();
+  return supported;
+#else
+  return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* static */ bool HEALPixLevel::isBMI2Fast() {
+#if defined(CSP_LOD_BODIES_BMI2)
+  static bool const fast = isBMI2Supported() && !detectSlowBMI2();
+  return fast;
+#else
+  return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* static */ void HEALPixLevel::setUseBMI2(bool enable) {
+  sUseBMI2 = enable && isBMI2Supported();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* static */ bool HEALPixLevel::getUseBMI2() {
+  return sUseBMI2;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /* explicit */
 HEALPixLevel::HEALPixLevel(int level)
     : mLevel(level)
@@ -378,6 +562,12 @@ int HEALPixLevel::getBasePatch(glm::int64 patchIdx) const {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 glm::int64 HEALPixLevel::extractEvenBits(glm::int64 value) {
+#if defined(CSP_LOD_BODIES_BMI2)
+  if (sUseBMI2) {
+    return extractEvenBitsBMI2(value);
+  }
+#endif
+
   // Value has binary representation: xwvu tsrq ponm lkji hgfe dcba
   // where each letter is a binary digit (i.e. either 0 or 1).
   // We want the even bits:           .... .... .... wusq omki geca
@@ -411,6 +601,13 @@ glm::int64 HEALPixLevel::extractOddBits(glm::int64 value) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void HEALPixLevel::extractBits(glm::int64 value, glm::int64& evenBits, glm::int64& oddBits) {
+#if defined(CSP_LOD_BODIES_BMI2)
+  if (sUseBMI2) {
+    extractBitsBMI2(value, evenBits, oddBits);
+    return;
+  }
+#endif
+
   evenBits = extractEvenBits(value);
   oddBits  = extractOddBits(value);
 }
@@ -418,6 +615,12 @@ void HEALPixLevel::extractBits(glm::int64 value, glm::int64& evenBits, glm::int6
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 glm::int64 HEALPixLevel::replaceEvenBits(glm::int64 value) {
+#if defined(CSP_LOD_BODIES_BMI2)
+  if (sUseBMI2) {
+    return replaceEvenBitsBMI2(value);
+  }
+#endif
+
   return sExpandLUT.at(value & 0xFF) | sExpandLUT.at((value >> 8) & 0xFF) << 16 |
          sExpandLUT.at((value >> 16) & 0xFF) << 32 | sExpandLUT.at((value >> 24) & 0xFF) << 48;
 }
@@ -431,6 +634,12 @@ glm::int64 HEALPixLevel::replaceOddBits(glm::int64 value) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 glm::int64 HEALPixLevel::replaceBits(glm::int64 evenBits, glm::int64 oddBits) {
+#if defined(CSP_LOD_BODIES_BMI2)
+  if (sUseBMI2) {
+    return replaceBitsBMI2(evenBits, oddBits);
+  }
+#endif
+
   return replaceEvenBits(evenBits) | replaceOddBits(oddBits);
 }
 
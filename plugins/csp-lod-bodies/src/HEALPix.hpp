@@ -9,6 +9,8 @@
 
 #include "TileId.hpp"
 
+#include <vector>
+
 /// @file
 /// Implementation of the HEALPix sphere tesselation scheme. Based on the paper: "HEALPix: A
 /// Framework for High-Resolution Discretization and fast Analysis of Data Distributed on the
@@ -62,6 +64,11 @@ class HEALPixLevel {
   /// Returns center of patch patchIdx in geodetic coordinates (lng, lat) in radians.
   glm::dvec2 getCenterLngLat(glm::int64 patchIdx) const;
 
+  /// Same as getCenterLngLat(), but for many patches at once. lngLats is resized to the number of
+  /// patches.
+  void getCentersLngLat(
+      std::vector<glm::int64> const& patchIdxs, std::vector<glm::dvec2>& lngLats) const;
+
   /// Returns center of patch patchIdx in cartesian coordinates (x, y, z).
   glm::dvec3 getCenterCartesian(glm::int64 patchIdx, glm::dvec3 const& radii) const;
 
@@ -74,6 +81,11 @@ class HEALPixLevel {
   /// The vectors have unit length.
   std::array<glm::dvec3, 4> getCornersCartesian(glm::int64 patchIdx, glm::dvec3 const& radii) const;
 
+  /// Same as above, but for many patches at once. The four corners of each patch are stored
+  /// consecutively in corners, which is resized to four times the number of patches.
+  void getCornersCartesian(std::vector<glm::int64> const& patchIdxs, glm::dvec3 const& radii,
+      std::vector<glm::dvec3>& corners) const;
+
   /// Returns the center points of the edges of patch patchIdx in the order NE, NW, SW, SE in
   /// geodetic coordinates (lng, lat) in radians.
   std::array<glm::dvec2, 4> getEdgeCentersLngLat(glm::int64 patchIdx) const;
@@ -91,6 +103,22 @@ class HEALPixLevel {
   int        getF2(glm::int64 patchIdx) const;
   glm::dvec3 getPatchOffsetScale(glm::int64 patchIdx) const;
 
+  /// Returns true if the CPU supports the pdep and pext instructions of the BMI2 extension.
+  static bool isBMI2Supported();
+
+  /// Returns true if the BMI2 instructions are supported and faster than the look-up-tables. This
+  /// is not the case on AMD CPUs before Zen 3, where they are microcoded. If this returns true,
+  /// the BMI2 instructions are used for the conversion between patch indices and (x, y)
+  /// coordinates by default.
+  static bool isBMI2Fast();
+
+  /// Selects whether the BMI2 instructions or the look-up-tables are used for the conversion
+  /// between patch indices and (x, y) coordinates. Both give the same results; this is meant for
+  /// tests and benchmarks and must not be called while other threads use HEALPix. BMI2 can only
+  /// be enabled if isBMI2Supported() returns true.
+  static void setUseBMI2(bool enable);
+  static bool getUseBMI2();
+
  private:
   explicit HEALPixLevel(int level);
 
@@ -125,6 +153,9 @@ class HEALPixLevel {
   static std::array<glm::uint16, 12> const sF1LUT;
   static std::array<glm::uint16, 12> const sF2LUT;
 
+  /// Whether the BMI2 instructions are used instead of sCompressLUT and sExpandLUT.
+  static bool sUseBMI2;
+
   /// Subdivision level. Level 0 is the root (i.e. the 12 base patches), on each successive level a
   /// patch is split into four sub patches.
   int mLevel;
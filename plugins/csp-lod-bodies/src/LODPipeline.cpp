@@ -0,0 +1,330 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "LODPipeline.hpp"
+
+#include "TileSource.hpp"
+#include "UpdateBoundsVisitor.hpp"
+
+#include <algorithm>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Puts the requests for the predicted view in front of the requests for the current view. The
+// priorities of the predicted requests are mapped to negative values while keeping their order, so
+// that they are started after all requests for the current view. If a tile is requested by both,
+// the priority of the current view is used, as TreeManagerBase::request() keeps the last one.
+void combineRequests(std::vector<TileRequest> const& current,
+    std::vector<TileRequest> const& predicted, std::vector<TileRequest>& result) {
+  result.clear();
+  result.reserve(current.size() + predicted.size());
+
+  for (auto const& request : predicted) {
+    result.push_back({request.mTileId, -1.0 / (1.0 + std::max(request.mPriority, 0.0))});
+  }
+
+  result.insert(result.end(), current.begin(), current.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* explicit */
+LODPipeline::LODPipeline(std::shared_ptr<GLResources> const& glResources)
+    : mLodVisitor(mParams)
+    , mPrefetchVisitor(mParams)
+    , mTreeMgrDEM(mParams, glResources)
+    , mTreeMgrIMG(mParams, glResources) {
+  mTreeMgrDEM.setName("DEM");
+  mTreeMgrIMG.setName("IMG");
+
+  mPrefetchVisitor.setLoadOnly(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+LODPipeline::~LODPipeline() {
+  // clear tree managers
+  mTreeMgrDEM.clear();
+  mTreeMgrIMG.clear();
+
+  if (mSrcDEM) {
+    mSrcDEM->fini();
+  }
+
+  if (mSrcIMG) {
+    mSrcIMG->fini();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::updateTileBounds() {
+  if (mTileBoundsInvalid) {
+    // rebuild bounding boxes
+    UpdateBoundsVisitor ubVisitor(&mTreeMgrDEM, mParams);
+    ubVisitor.visit();
+
+    mTileBoundsInvalid = false;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::updateTileTrees(int frameCount) {
+  // update DEM tree
+  if (mSrcDEM) {
+    mTreeMgrDEM.setFrameCount(frameCount);
+    mTreeMgrDEM.update();
+  }
+
+  // update IMG tree
+  if (mSrcIMG) {
+    mTreeMgrIMG.setFrameCount(frameCount);
+    mTreeMgrIMG.update();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::traverseTileTrees(
+    int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP, glm::ivec4 const& viewport) {
+  // update per-frame information of LODVisitor
+  mLodVisitor.setFrameCount(frameCount);
+  mLodVisitor.setModelview(matVM);
+  mLodVisitor.setProjection(matP);
+  mLodVisitor.setViewport(viewport);
+
+  // traverse quad trees and determine nodes to render and load
+  // respectively
+  mLodVisitor.visit();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::prefetchTileTrees(
+    int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP, glm::ivec4 const& viewport) {
+  mPrefetchVisitor.setFrameCount(frameCount);
+  mPrefetchVisitor.setModelview(matVM);
+  mPrefetchVisitor.setProjection(matP);
+  mPrefetchVisitor.setViewport(viewport);
+
+  mPrefetchVisitor.visit();
+
+  mPrefetched = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::processLoadRequests() {
+  if (mSrcDEM) {
+    if (mPrefetched) {
+      combineRequests(mLodVisitor.getLoadDEM(), mPrefetchVisitor.getLoadDEM(), mRequestsDEM);
+      mTreeMgrDEM.request(mRequestsDEM);
+    } else {
+      mTreeMgrDEM.request(mLodVisitor.getLoadDEM());
+    }
+  }
+
+  if (mSrcIMG) {
+    if (mPrefetched) {
+      combineRequests(mLodVisitor.getLoadIMG(), mPrefetchVisitor.getLoadIMG(), mRequestsIMG);
+      mTreeMgrIMG.request(mRequestsIMG);
+    } else {
+      mTreeMgrIMG.request(mLodVisitor.getLoadIMG());
+    }
+  }
+
+  // The prefetched requests are only valid for the frame they have been determined in.
+  mPrefetched = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::setDEMSource(TileSource* srcDEM) {
+  // Don't do anything if nothing changed.
+  if (mSrcDEM == srcDEM) {
+    return;
+  }
+
+  // shut down old source
+  if (mSrcDEM) {
+    mSrcDEM->fini();
+
+    mLodVisitor.setTreeManagerDEM(nullptr);
+    mPrefetchVisitor.setTreeManagerDEM(nullptr);
+    mTreeMgrDEM.setSource(nullptr);
+  }
+
+  mSrcDEM = srcDEM;
+
+  // init new source
+  if (mSrcDEM) {
+    mSrcDEM->init();
+
+    mTreeMgrDEM.setSource(mSrcDEM);
+    mLodVisitor.setTreeManagerDEM(&mTreeMgrDEM);
+    mPrefetchVisitor.setTreeManagerDEM(&mTreeMgrDEM);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileSource* LODPipeline::getDEMSource() const {
+  return mSrcDEM;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::setIMGSource(TileSource* srcIMG) {
+  // Don't do anything if nothing changed.
+  if (mSrcIMG == srcIMG) {
+    return;
+  }
+
+  // shut down old source
+  if (mSrcIMG) {
+    mSrcIMG->fini();
+
+    mLodVisitor.setTreeManagerIMG(nullptr);
+    mPrefetchVisitor.setTreeManagerIMG(nullptr);
+    mTreeMgrIMG.setSource(nullptr);
+  }
+
+  mSrcIMG = srcIMG;
+
+  // init new source
+  if (mSrcIMG) {
+    mSrcIMG->init();
+
+    mTreeMgrIMG.setSource(mSrcIMG);
+    mLodVisitor.setTreeManagerIMG(&mTreeMgrIMG);
+    mPrefetchVisitor.setTreeManagerIMG(&mTreeMgrIMG);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileSource* LODPipeline::getIMGSource() const {
+  return mSrcIMG;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::setRadii(glm::dvec3 const& radii) {
+  mParams.mRadii     = radii;
+  mTileBoundsInvalid = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::dvec3 const& LODPipeline::getRadii() const {
+  return mParams.mRadii;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::setHeightScale(float scale) {
+  mParams.mHeightScale = scale;
+  mTileBoundsInvalid   = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double LODPipeline::getHeightScale() const {
+  return mParams.mHeightScale;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::setLODFactor(float lodFactor) {
+  mParams.mLodFactor = lodFactor;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double LODPipeline::getLODFactor() const {
+  return mParams.mLodFactor;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::setMinLevel(int minLevel) {
+  mParams.mMinLevel = minLevel;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int LODPipeline::getMinLevel() const {
+  return mParams.mMinLevel;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::setTileCacheSize(std::size_t bytes) {
+  mTreeMgrDEM.setTileCacheSize(bytes);
+  mTreeMgrIMG.setTileCacheSize(bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODPipeline::setTileUploadBudget(double milliseconds) {
+  mTreeMgrDEM.setUploadBudget(milliseconds);
+  mTreeMgrIMG.setUploadBudget(milliseconds);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PlanetParameters const& LODPipeline::getParameters() const {
+  return mParams;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+LODVisitor& LODPipeline::getLODVisitor() {
+  return mLodVisitor;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+LODVisitor const& LODPipeline::getLODVisitor() const {
+  return mLodVisitor;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TreeManager<RenderDataDEM>& LODPipeline::getTreeManagerDEM() {
+  return mTreeMgrDEM;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TreeManager<RenderDataDEM> const& LODPipeline::getTreeManagerDEM() const {
+  return mTreeMgrDEM;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TreeManager<RenderDataImg>& LODPipeline::getTreeManagerIMG() {
+  return mTreeMgrIMG;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TreeManager<RenderDataImg> const& LODPipeline::getTreeManagerIMG() const {
+  return mTreeMgrIMG;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,126 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_LODPIPELINE_HPP
+#define CSP_LOD_BODIES_LODPIPELINE_HPP
+
+#include "LODVisitor.hpp"
+#include "PlanetParameters.hpp"
+#include "RenderDataDEM.hpp"
+#include "RenderDataImg.hpp"
+#include "TreeManager.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace csp::lodbodies {
+
+class GLResources;
+class TileSource;
+
+/// Does everything VistaPlanet does each frame, except for the rendering: Loaded tiles are merged
+/// into the tile trees, the trees are traversed to select the tiles to draw and to load, and the
+/// resulting requests are passed to the TreeManagers. The steps are executed by calling the
+/// functions below in the order in which they are declared.
+///
+/// This class does not depend on ViSTA. If it is created without GLResources, it does not use
+/// OpenGL either, so it can be driven by benchmarks which run without a window.
+class LODPipeline {
+ public:
+  /// If glResources is a nullptr, tiles are not uploaded to the GPU, see TreeManagerBase.
+  explicit LODPipeline(std::shared_ptr<GLResources> const& glResources);
+
+  LODPipeline(LODPipeline const& other) = delete;
+  LODPipeline(LODPipeline&& other)      = delete;
+
+  LODPipeline& operator=(LODPipeline const& other) = delete;
+  LODPipeline& operator=(LODPipeline&& other) = delete;
+
+  ~LODPipeline();
+
+  /// Recomputes the bounding boxes of all tiles if the radii or the height scale have changed.
+  void updateTileBounds();
+
+  /// Merges newly loaded tiles into the trees and removes tiles which have not been used for a
+  /// while.
+  void updateTileTrees(int frameCount);
+
+  /// Determines the tiles to draw and to load for the given view. The results are available from
+  /// the LODVisitor.
+  void traverseTileTrees(int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP,
+      glm::ivec4 const& viewport);
+
+  /// Determines the tiles to load for a view which is expected shortly. These are requested by the
+  /// next call to processLoadRequests(), after all tiles needed for the current view.
+  void prefetchTileTrees(int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP,
+      glm::ivec4 const& viewport);
+
+  /// Passes the tiles selected for loading by the last traversals to the TreeManagers.
+  void processLoadRequests();
+
+  /// Sets the tile source for elevation data. This class does not take ownership of the passed in
+  /// object.
+  void        setDEMSource(TileSource* srcDEM);
+  TileSource* getDEMSource() const;
+
+  /// Sets the tile source for image data. This class does not take ownership of the passed in
+  /// object.
+  void        setIMGSource(TileSource* srcIMG);
+  TileSource* getIMGSource() const;
+
+  /// Setting the radii or the height scale invalidates the bounding boxes of all tiles, they are
+  /// recomputed by the next call to updateTileBounds().
+  void              setRadii(glm::dvec3 const& radii);
+  glm::dvec3 const& getRadii() const;
+
+  void   setHeightScale(float scale);
+  double getHeightScale() const;
+
+  void   setLODFactor(float lodFactor);
+  double getLODFactor() const;
+
+  void setMinLevel(int minLevel);
+  int  getMinLevel() const;
+
+  /// See TreeManagerBase::setTileCacheSize.
+  void setTileCacheSize(std::size_t bytes);
+
+  /// See TreeManagerBase::setUploadBudget.
+  void setTileUploadBudget(double milliseconds);
+
+  PlanetParameters const& getParameters() const;
+
+  LODVisitor&       getLODVisitor();
+  LODVisitor const& getLODVisitor() const;
+
+  TreeManager<RenderDataDEM>&       getTreeManagerDEM();
+  TreeManager<RenderDataDEM> const& getTreeManagerDEM() const;
+
+  TreeManager<RenderDataImg>&       getTreeManagerIMG();
+  TreeManager<RenderDataImg> const& getTreeManagerIMG() const;
+
+ private:
+  PlanetParameters mParams;
+  LODVisitor       mLodVisitor;
+  LODVisitor       mPrefetchVisitor;
+
+  // The requests of both visitors, see processLoadRequests().
+  std::vector<TileRequest> mRequestsDEM;
+  std::vector<TileRequest> mRequestsIMG;
+  bool                     mPrefetched = false;
+
+  TileSource*                mSrcDEM = nullptr;
+  TreeManager<RenderDataDEM> mTreeMgrDEM;
+
+  TileSource*                mSrcIMG = nullptr;
+  TreeManager<RenderDataImg> mTreeMgrIMG;
+
+  bool mTileBoundsInvalid = false;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_LODPIPELINE_HPP
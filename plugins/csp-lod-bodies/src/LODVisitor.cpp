@@ -6,6 +6,7 @@
 
 #include "LODVisitor.hpp"
 
+#include "FrustumCulling.hpp"
 #include "PlanetParameters.hpp"
 #include "RenderDataDEM.hpp"
 #include "RenderDataImg.hpp"
@@ -13,8 +14,14 @@
 #include "TreeManagerBase.hpp"
 #include "logger.hpp"
 
+#include "../../../src/cs-utils/ThreadPool.hpp"
+
 #include <VistaBase/VistaStreamUtils.h>
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
+#include <limits>
 
 namespace csp::lodbodies {
 
@@ -27,60 +34,13 @@ namespace {
 // re-allocations.
 std::size_t const PreAllocSize = 200;
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-// Returns if the tile bounds @a tb intersect the @a frustum.
-// For each plane of the @a frustum determine if any corner of the
-// bounding box is inside the plane's halfspace. If all corners are
-// outside one halfspace the bounding box is outside the frustum
-// and the algorithm stops early.
-// TODO There is potential for optimization here, the paper
-// "Optimized View Frustum Culling - Algorithms for Bounding Boxes"
-// http://www.cse.chalmers.se/~uffe/vfc_bbox.pdf
-// contains ideas (for example how to avoid testing all 8 corners).
-bool testInFrustum(Frustum const& frustum, BoundingBox<double> const& tb) {
-  bool result = true;
-
-  glm::dvec3 const& tbMin = tb.getMin();
-  glm::dvec3 const& tbMax = tb.getMax();
-
-  // 8 corners of tile's bounding box
-  std::array<glm::dvec3, 8> tbPnts = {
-      {glm::dvec3(tbMin[0], tbMin[1], tbMin[2]), glm::dvec3(tbMax[0], tbMin[1], tbMin[2]),
-          glm::dvec3(tbMax[0], tbMin[1], tbMax[2]), glm::dvec3(tbMin[0], tbMin[1], tbMax[2]),
-
-          glm::dvec3(tbMin[0], tbMax[1], tbMin[2]), glm::dvec3(tbMax[0], tbMax[1], tbMin[2]),
-          glm::dvec3(tbMax[0], tbMax[1], tbMax[2]), glm::dvec3(tbMin[0], tbMax[1], tbMax[2])}};
-
-  // loop over planes of frustum
-  auto pIt  = frustum.getPlanes().begin();
-  auto pEnd = frustum.getPlanes().end();
-
-  for (std::size_t i = 0; pIt != pEnd; ++pIt, ++i) {
-    glm::dvec3 const normal(*pIt);
-    double const     d       = -(*pIt)[3];
-    bool             outside = true;
-
-    // test if any BB corner is inside the halfspace defined
-    // by the current plane
-    for (auto const& tbPnt : tbPnts) {
-      if (glm::dot(normal, tbPnt) >= d) {
-        // corner j is inside - stop testing
-        outside = false;
-        break;
-      }
-    }
-
-    // if all corners are outside the halfspace, the bounding box
-    // is outside - stop testing
-    if (outside) {
-      result = false;
-      break;
-    }
-  }
+// Root tiles are required before anything can be drawn, they are always
+// requested with this priority.
+double const RootPriority = std::numeric_limits<double>::max();
 
-  return result;
-}
+// A tile is refined if its angular size relative to the field of view
+// times the LOD factor exceeds this value.
+double const RefineRatio = 10.0;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -216,7 +176,18 @@ LODVisitor::LODVisitor(
     , mStackTop(-1)
     , mFrameCount(0)
     , mUpdateLOD(true)
-    , mUpdateCulling(true) {
+    , mUpdateCulling(true)
+    , mIncremental(false)
+    , mSkipDecisions(false)
+    , mNumTestedNodes(0)
+    , mLoadOnly(false)
+    , mDeferMarkUsed(false)
+    , mDecisionParams(params)
+    , mDecisionSlots()
+    , mDecisionSlot(0)
+    , mGeneration(0)
+    , mTraversalCount(0)
+    , mThreadCount(1) {
   setTreeManagerDEM(treeMgrDEM);
   setTreeManagerIMG(treeMgrIMG);
 
@@ -225,6 +196,10 @@ LODVisitor::LODVisitor(
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+LODVisitor::~LODVisitor() = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void LODVisitor::setTreeManagerDEM(TreeManagerBase* treeMgr) {
   // unset tree from OLD tree manager
   if (mTreeMgrDEM) {
@@ -273,15 +248,36 @@ bool LODVisitor::preTraverse() {
     mLodData.mMatP  = mMatP;
     mLodData.mFrustumES.setFromMatrix(mMatP);
     mLodData.mViewport = mViewport;
+    mLodData.mFov      = std::max(
+        mLodData.mFrustumES.getHorizontalFOV(), mLodData.mFrustumES.getVerticalFOV());
   }
 
+  // A tile is refined if the angle between the directions to its center and
+  // to any of its corners exceeds this angle. Comparing the cosines is
+  // equivalent and avoids calls to std::acos during the traversal.
+  double const refineAngle = RefineRatio * mLodData.mFov / mParams->mLodFactor;
+  mLodData.mRefineCosine   = refineAngle < glm::pi<double>()
+                               ? std::cos(refineAngle)
+                               : -std::numeric_limits<double>::infinity();
+
   if (mUpdateCulling) {
     mCullData.mFrustumMS.setFromMatrix(mMatP * mMatVM);
-    mCullData.mMatN   = glm::inverseTranspose(glm::f64mat3x3(mMatVM));
-    auto v4CamPos     = glm::inverse(mMatVM)[3];
-    mCullData.mCamPos = glm::dvec3(v4CamPos[0], v4CamPos[1], v4CamPos[2]);
+    mCullData.mMatN    = glm::inverseTranspose(glm::f64mat3x3(mMatVM));
+    auto matInvVM      = glm::inverse(mMatVM);
+    auto v4CamPos      = matInvVM[3];
+    mCullData.mCamPos  = glm::dvec3(v4CamPos[0], v4CamPos[1], v4CamPos[2]);
+    auto v4ViewDir     = matInvVM * glm::dvec4(0.0, 0.0, -1.0, 0.0);
+    mCullData.mViewDir = glm::normalize(glm::dvec3(v4ViewDir[0], v4ViewDir[1], v4ViewDir[2]));
+    auto v4UpDir       = matInvVM * glm::dvec4(0.0, 1.0, 0.0, 0.0);
+    mCullData.mUpDir   = glm::normalize(glm::dvec3(v4UpDir[0], v4UpDir[1], v4UpDir[2]));
+  }
+
+  if (mIncremental && !mSkipDecisions) {
+    selectDecisionSlot();
   }
 
+  mNumTestedNodes = 0;
+
   // clear load/render lists
   mLoadDEM.clear();
   mLoadIMG.clear();
@@ -293,14 +289,14 @@ bool LODVisitor::preTraverse() {
   for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
     if (mTreeDEM) {
       if (!mTreeDEM->getRoot(i)) {
-        mLoadDEM.emplace_back(0, i);
+        mLoadDEM.push_back({TileId(0, i), RootPriority});
         result = false;
       }
     }
 
     if (mTreeIMG) {
       if (!mTreeIMG->getRoot(i)) {
-        mLoadIMG.emplace_back(0, i);
+        mLoadIMG.push_back({TileId(0, i), RootPriority});
         result = false;
       }
     }
@@ -366,20 +362,102 @@ void LODVisitor::postTraverse() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void LODVisitor::visitRoots() {
+  if (mThreadCount <= 1) {
+    TileVisitor<LODVisitor>::visitRoots();
+    return;
+  }
+
+  prepareRootVisitors();
+
+  // The subtrees of the root patches do not share any nodes, so each can be visited by a separate
+  // LODVisitor on a separate thread. postTraverse() accesses neighbouring tiles across root patches
+  // and hence runs only after all of them have finished.
+  std::array<std::future<void>, TileQuadTree::sNumRoots> results;
+
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    results.at(i) = mThreadPool->enqueue([this, i]() {
+      TileNode* rootDEM = mTreeDEM->getRoot(i);
+      TileNode* rootIMG = mTreeIMG ? mTreeIMG->getRoot(i) : nullptr;
+
+      mRootVisitors.at(i)->visitRoot(rootDEM, rootIMG, TileId(0, i));
+    });
+  }
+
+  // Merge the lists in the order of the root patches, this gives exactly the same result as a
+  // traversal on a single thread. This includes the order of the render data in the TileAgeLists,
+  // as the used render data is marked in the same order.
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    results.at(i).get();
+
+    LODVisitor const& visitor = *mRootVisitors.at(i);
+
+    for (RenderData* rdata : visitor.mUsed) {
+      rdata->setLastFrame(mFrameCount);
+    }
+
+    mLoadDEM.insert(mLoadDEM.end(), visitor.mLoadDEM.begin(), visitor.mLoadDEM.end());
+    mLoadIMG.insert(mLoadIMG.end(), visitor.mLoadIMG.begin(), visitor.mLoadIMG.end());
+    mRenderDEM.insert(mRenderDEM.end(), visitor.mRenderDEM.begin(), visitor.mRenderDEM.end());
+    mRenderIMG.insert(mRenderIMG.end(), visitor.mRenderIMG.begin(), visitor.mRenderIMG.end());
+    mNumTestedNodes += visitor.mNumTestedNodes;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::prepareRootVisitors() {
+  if (!mThreadPool) {
+    mThreadPool = std::make_unique<cs::utils::ThreadPool>(mThreadCount);
+  }
+
+  for (auto& visitor : mRootVisitors) {
+    if (!visitor) {
+      visitor = std::make_unique<LODVisitor>(*mParams, mTreeMgrDEM, mTreeMgrIMG);
+    }
+
+    visitor->mTreeDEM        = mTreeDEM;
+    visitor->mTreeIMG        = mTreeIMG;
+    visitor->mTreeMgrDEM     = mTreeMgrDEM;
+    visitor->mTreeMgrIMG     = mTreeMgrIMG;
+    visitor->mLodData        = mLodData;
+    visitor->mCullData       = mCullData;
+    visitor->mFrameCount     = mFrameCount;
+    visitor->mIncremental    = mIncremental;
+    visitor->mSkipDecisions  = mSkipDecisions;
+    visitor->mDecisionSlots  = mDecisionSlots;
+    visitor->mDecisionSlot   = mDecisionSlot;
+    visitor->mNumTestedNodes = 0;
+    visitor->mLoadOnly       = mLoadOnly;
+    visitor->mDeferMarkUsed  = true;
+    visitor->mStackTop       = -1;
+
+    visitor->mLoadDEM.clear();
+    visitor->mLoadIMG.clear();
+    visitor->mRenderDEM.clear();
+    visitor->mRenderIMG.clear();
+    visitor->mUsed.clear();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 bool LODVisitor::preVisitRoot(TileId const& tileId) {
   LODState& state = getLODState();
 
   // track highest resolution nodes in this sub tree (in case there is
   // higher resolution image data than DEM data).
-  state.mLastDEM  = nullptr;
-  state.mLastIMG  = nullptr;
-  state.mMaxLevel = 0;
+  state.mLastDEM        = nullptr;
+  state.mLastIMG        = nullptr;
+  state.mPriority       = 0.0;
+  state.mTested         = false;
+  state.mChildrenTested = false;
 
   // fetch RenderDataDEM for visited node and mark as used in this frame
   if (mTreeMgrDEM && state.mNodeDEM) {
     auto* rd     = mTreeMgrDEM->find<RenderDataDEM>(state.mNodeDEM);
     state.mRdDEM = rd;
-    state.mRdDEM->setLastFrame(mFrameCount);
+    markUsed(state.mRdDEM);
   } else {
     state.mRdDEM = nullptr;
   }
@@ -388,7 +466,7 @@ bool LODVisitor::preVisitRoot(TileId const& tileId) {
   if (mTreeMgrIMG && state.mNodeIMG) {
     auto* rd     = mTreeMgrIMG->find<RenderDataImg>(state.mNodeIMG);
     state.mRdIMG = rd;
-    state.mRdIMG->setLastFrame(mFrameCount);
+    markUsed(state.mRdIMG);
   } else {
     state.mRdIMG = nullptr;
   }
@@ -412,15 +490,25 @@ bool LODVisitor::preVisit(TileId const& tileId) {
   // track highest resolution nodes that can not be refined further (e.g.
   // because not all 4 children are loaded) - these are NULL if parent nodes
   // so far can all be refined
-  state.mLastDEM  = stateP.mLastDEM;
-  state.mLastIMG  = stateP.mLastIMG;
-  state.mMaxLevel = stateP.mMaxLevel;
+  state.mLastDEM        = stateP.mLastDEM;
+  state.mLastIMG        = stateP.mLastIMG;
+  state.mPriority       = stateP.mPriority;
+  state.mChildrenTested = false;
+
+  // use the results of the batched tests made by the parent, if available
+  state.mTested = stateP.mChildrenTested;
+
+  if (state.mTested) {
+    int childIdx           = HEALPix::getChildIdx(tileId);
+    state.mFrustumDistance = stateP.mChildFrustumDistances.at(childIdx);
+    state.mMinCosine       = stateP.mChildMinCosines.at(childIdx);
+  }
 
   // fetch RenderDataDEM for visited node and mark as used in this frame
   if (mTreeMgrDEM && !state.mLastDEM && state.mNodeDEM) {
     auto* rd     = mTreeMgrDEM->find<RenderDataDEM>(state.mNodeDEM);
     state.mRdDEM = rd;
-    state.mRdDEM->setLastFrame(mFrameCount);
+    markUsed(state.mRdDEM);
   } else {
     // copy value from parent state to ensure this matches state.mLastDEM
     state.mRdDEM = stateP.mRdDEM;
@@ -430,7 +518,7 @@ bool LODVisitor::preVisit(TileId const& tileId) {
   if (mTreeMgrIMG && !state.mLastIMG && state.mNodeIMG) {
     auto* rd     = mTreeMgrIMG->find<RenderDataImg>(state.mNodeIMG);
     state.mRdIMG = rd;
-    state.mRdIMG->setLastFrame(mFrameCount);
+    markUsed(state.mRdIMG);
   } else {
     // copy value from parent state to ensure this matches state.mLastIMG
     state.mRdIMG = stateP.mRdIMG;
@@ -461,16 +549,63 @@ bool LODVisitor::visitNode(TileId const& tileId) {
   //          handleRefine() for details.
   //      Else:
   //          draw this level
+  //
+  // In incremental mode, the results of both tests are stored in the
+  // node's render data and reused in later frames as long as the observer
+  // stays within their tolerances.
+
+  bool      result     = false;
+  bool      visible    = false;
+  bool      needRefine = false;
+  LODState& state      = getLODState();
+
+  bool const  useDecisions = mIncremental && !mSkipDecisions;
+  RenderData* owner        = useDecisions ? getDecisionOwner() : nullptr;
+  int         boundsLevel =
+      state.mNodeDEM ? tileId.level() : (state.mLastDEM ? state.mLastDEM->getLevel() : -1);
+
+  if (owner && testDecisionValid(owner->getLODDecision(mDecisionSlot), boundsLevel)) {
+    RenderData::LODDecision const& decision = owner->getLODDecision(mDecisionSlot);
+
+    visible         = decision.mVisible;
+    needRefine      = decision.mNeedRefine;
+    state.mPriority = decision.mPriority;
+  } else {
+    RenderData::LODDecision  decision;
+    RenderData::LODDecision* decisionPtr = owner ? &decision : nullptr;
 
-  bool result  = false;
-  bool visible = testVisible(tileId, mTreeMgrDEM);
+    visible = testVisible(tileId, mTreeMgrDEM, decisionPtr);
 
-  if (visible) {
     // should this node be refined to achieve desired resolution?
-    bool needRefine = testNeedRefine(tileId);
+    if (visible) {
+      needRefine = testNeedRefine(tileId, decisionPtr);
+    } else {
+      decision.mDistanceTolerance = std::numeric_limits<double>::infinity();
+    }
 
+    ++mNumTestedNodes;
+
+    if (owner) {
+      decision.mGeneration  = mDecisionSlots.at(mDecisionSlot).mGeneration;
+      decision.mBoundsLevel = boundsLevel;
+      decision.mVisible     = visible;
+      decision.mNeedRefine  = needRefine;
+      decision.mPriority    = state.mPriority;
+      decision.mCamPos      = mCullData.mCamPos;
+      decision.mViewDir     = mCullData.mViewDir;
+      decision.mUpDir       = mCullData.mUpDir;
+      owner->setLODDecision(mDecisionSlot, decision);
+    }
+  }
+
+  if (visible) {
     if (needRefine) {
       result = handleRefine(tileId);
+
+      // In incremental mode, most children will reuse previous decisions.
+      if (result && !useDecisions) {
+        testChildren();
+      }
     } else {
       // resolution is sufficient
       drawLevel();
@@ -540,12 +675,11 @@ void LODVisitor::addLoadChildrenDEM(TileNode* node) {
 
     for (int i = 0; i < 4; ++i) {
       if (!node->getChild(i)) {
-        mLoadDEM.push_back(HEALPix::getChildTileId(tileId, i));
+        mLoadDEM.push_back({HEALPix::getChildTileId(tileId, i), getLODState().mPriority});
       } else {
         // mark child as used to avoid it being removed while waiting
         // for its siblings to be loaded
-        RenderData* rd = mTreeMgrDEM->findRData(node->getChild(i));
-        rd->setLastFrame(mFrameCount);
+        markUsed(mTreeMgrDEM->findRData(node->getChild(i)));
       }
     }
   }
@@ -559,12 +693,11 @@ void LODVisitor::addLoadChildrenIMG(TileNode* node) {
 
     for (int i = 0; i < 4; ++i) {
       if (!node->getChild(i)) {
-        mLoadIMG.push_back(HEALPix::getChildTileId(tileId, i));
+        mLoadIMG.push_back({HEALPix::getChildTileId(tileId, i), getLODState().mPriority});
       } else {
         // mark child as used to avoid it being removed while waiting
         // for its siblings to be loaded
-        RenderData* rd = mTreeMgrIMG->findRData(node->getChild(i));
-        rd->setLastFrame(mFrameCount);
+        markUsed(mTreeMgrIMG->findRData(node->getChild(i)));
       }
     }
   }
@@ -572,7 +705,61 @@ void LODVisitor::addLoadChildrenIMG(TileNode* node) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool LODVisitor::testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM) {
+void LODVisitor::markUsed(RenderData* rdata) {
+  if (mDeferMarkUsed) {
+    mUsed.push_back(rdata);
+  } else {
+    rdata->setLastFrame(mFrameCount);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RenderData* LODVisitor::getDecisionOwner() const {
+  LODState const& state = getLODState();
+
+  // If a tree could not be refined, the state holds the render data of the
+  // last refinable parent, which must not be used.
+  if (state.mNodeDEM) {
+    return state.mLastDEM ? nullptr : state.mRdDEM;
+  }
+
+  if (state.mNodeIMG && !state.mLastIMG) {
+    return state.mRdIMG;
+  }
+
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::testDecisionValid(
+    RenderData::LODDecision const& decision, int boundsLevel) const {
+  if (decision.mGeneration != mDecisionSlots.at(mDecisionSlot).mGeneration ||
+      decision.mBoundsLevel != boundsLevel) {
+    return false;
+  }
+
+  double const moved = glm::length(mCullData.mCamPos - decision.mCamPos);
+
+  if (moved >= decision.mDistanceTolerance) {
+    return false;
+  }
+
+  // A rotation of the observer moves a point relative to the frustum planes
+  // by at most its distance times the chord length of the rotation. This
+  // chord length is bounded by twice the sum of the chord lengths of the
+  // view and up directions.
+  double const turned = 2.0 * (glm::length(mCullData.mViewDir - decision.mViewDir) +
+                                  glm::length(mCullData.mUpDir - decision.mUpDir));
+
+  return moved + turned * (decision.mFarDistance + moved) < decision.mFrustumTolerance;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::testVisible(
+    TileId const& tileId, TreeManagerBase* treeMgrDEM, RenderData::LODDecision* decision) {
   bool      result = false;
   LODState& state  = getLODState();
 
@@ -583,11 +770,10 @@ bool LODVisitor::testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM)
 
     BoundingBox<double> const& tb = state.mRdDEM->getBounds();
 
-    result = testInFrustum(mCullData.mFrustumMS, tb);
+    double const distance =
+        state.mTested ? state.mFrustumDistance : getFrustumDistance(mCullData.mFrustumMS, tb);
 
-    if (result) {
-      result = testFrontFacing(mCullData.mCamPos, mParams, tb, treeMgrDEM);
-    }
+    result = testBoundsVisible(tb, distance, treeMgrDEM, decision);
 
     if (state.mRdIMG && state.mRdIMG->hasBounds()) {
       state.mRdIMG->removeBounds();
@@ -601,25 +787,21 @@ bool LODVisitor::testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM)
       auto* tileDEM = dynamic_cast<Tile<float>*>(tileBaseDEM);
       if (auto* pyr = tileDEM->getMinMaxPyramid()) {
 
-        auto  lvl = tileId.level();
-        float minHeight(0);
-        float maxHeight(0);
-        // Level difference to the last DEM tile:
-        auto levelDiff = std::min(7, lvl - state.mLastDEM->getLevel());
-
-        // Collect child indices of all (parent) IMG nodes without DEM
-        // They define the location of the IMG tile in the last DEM tile
-        std::vector<int> quadrants;
-        auto             cur_tileId = tileId;
-        for (int i(0); i < levelDiff; ++i) {
-          quadrants.insert(
-              quadrants.begin(), HEALPix::getChildIdxAtLevel(cur_tileId, cur_tileId.level()));
-          cur_tileId = HEALPix::getParentTileId(cur_tileId);
-        }
+        auto lvl = tileId.level();
+
+        // Level difference to the last DEM tile. For tiles which are more than seven levels
+        // below, the cell of their ancestor on the finest pyramid level is used.
+        int const levelDiff = lvl - state.mLastDEM->getLevel();
+        int const depth     = std::min(MinMaxPyramid::sNumLevels, levelDiff);
+
+        // The child indices of all (parent) IMG nodes without DEM define the location of the IMG
+        // tile in the last DEM tile. These are stored in the lowest bits of the patch index.
+        auto const quadrants = static_cast<uint32_t>(
+            (tileId.patchIdx() >> (2 * (levelDiff - depth))) & ((1 << (2 * depth)) - 1));
 
         // Get min and max height value from the coarser DEM tile
-        minHeight = pyr->getMin(quadrants);
-        maxHeight = pyr->getMax(quadrants);
+        float minHeight = pyr->getMin(depth, quadrants);
+        float maxHeight = pyr->getMax(depth, quadrants);
 
         // Calculate an optimistic bounding box from the the height values in range of the
         // IMG tile
@@ -633,11 +815,8 @@ bool LODVisitor::testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM)
       logger().error("Failed to test visibility of Tile: Unknown tile template type!");
     }
 
-    result = testInFrustum(mCullData.mFrustumMS, tb);
-
-    if (result) {
-      result = testFrontFacing(mCullData.mCamPos, mParams, tb, treeMgrDEM);
-    }
+    result = testBoundsVisible(
+        tb, getFrustumDistance(mCullData.mFrustumMS, tb), treeMgrDEM, decision);
     // result = true;
   }
 
@@ -646,7 +825,61 @@ bool LODVisitor::testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool LODVisitor::testNeedRefine(TileId const& tileId) {
+bool LODVisitor::testBoundsVisible(BoundingBox<double> const& tb, double frustumDistance,
+    TreeManagerBase* treeMgrDEM, RenderData::LODDecision* decision) const {
+  if (decision) {
+    glm::dvec3 tbCenter = 0.5 * (tb.getMin() + tb.getMax());
+
+    decision->mFrustumTolerance = std::abs(frustumDistance);
+    decision->mFarDistance      = glm::length(tbCenter - mCullData.mCamPos) +
+                                  0.5 * glm::length(tb.getMax() - tb.getMin());
+  }
+
+  if (frustumDistance < 0.0) {
+    return false;
+  }
+
+  // There is no cheap estimate for how far the observer may move until a
+  // tile emerges from behind the horizon, so these are tested every frame.
+  if (!testFrontFacing(mCullData.mCamPos, mParams, tb, treeMgrDEM)) {
+    if (decision) {
+      decision->mFrustumTolerance = 0.0;
+    }
+
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::testChildren() {
+  LODState& state = getLODState();
+
+  // The children are only tested in advance if all of them have their own
+  // DEM node, otherwise their bounds are derived from the parent's heights.
+  if (!state.mNodeDEM || state.mLastDEM) {
+    return;
+  }
+
+  std::array<BoundingBox<double>, 4> bounds;
+
+  for (int i = 0; i < 4; ++i) {
+    bounds.at(i) = mTreeMgrDEM->find<RenderDataDEM>(state.mNodeDEM->getChild(i))->getBounds();
+  }
+
+  getFrustumDistances(
+      mCullData.mFrustumMS, bounds.data(), bounds.size(), state.mChildFrustumDistances.data());
+  getMinCornerCosines(
+      mCullData.mCamPos, bounds.data(), bounds.size(), state.mChildMinCosines.data());
+
+  state.mChildrenTested = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::testNeedRefine(TileId const& tileId, RenderData::LODDecision* decision) {
   bool      result = false;
   LODState& state  = getLODState();
 
@@ -662,59 +895,88 @@ bool LODVisitor::testNeedRefine(TileId const& tileId) {
       tb = state.mRdIMG->getBounds();
     }
 
-    glm::dvec3 const& tbMin    = tb.getMin();
-    glm::dvec3 const& tbMax    = tb.getMax();
-    glm::dvec3        tbCenter = 0.5 * (tbMin + tbMax);
-
     // A tile is refined if the solid angle it occupies when seen from the
     // camera is above a given threshold. To estimate the solid angle, the
     // angles between the vector from the camera to the bounding box center
     // and all vectors from the camera to all eight corners of the bounding
-    // box are calculated and the maximum of those is taken.
-
-    // 8 corners of tile's bounding box
-    std::array<glm::dvec3, 8> tbDirs = {
-        {glm::normalize(glm::dvec3(tbMin.x, tbMin.y, tbMin.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMax.x, tbMin.y, tbMin.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMax.x, tbMin.y, tbMax.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMin.x, tbMin.y, tbMax.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMin.x, tbMax.y, tbMin.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMax.x, tbMax.y, tbMin.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMax.x, tbMax.y, tbMax.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMin.x, tbMax.y, tbMax.z) - mCullData.mCamPos)}};
-
-    glm::dvec3 centerDir = glm::normalize(tbCenter - mCullData.mCamPos);
+    // box are calculated and the maximum of those is taken. The cosine of
+    // this angle is compared to the cosine of the threshold instead.
+    double const minCosine =
+        state.mTested ? state.mMinCosine : getMinCornerCosine(mCullData.mCamPos, tb);
+
+    result = minCosine < mLodData.mRefineCosine || mParams->mMinLevel > tileId.level();
+
+    // The angle itself is only required for the load priority of the
+    // children and for the tolerance of the decision.
+    if (result || decision) {
+      glm::dvec3 tbCenter  = 0.5 * (tb.getMin() + tb.getMax());
+      glm::dvec3 centerDir = glm::normalize(tbCenter - mCullData.mCamPos);
+
+      double maxAngle = std::acos(std::min(1.0, minCosine));
+      double ratio    = maxAngle / mLodData.mFov * mParams->mLodFactor;
+
+      // Children of tiles which are large on screen and close to the center
+      // of the view are loaded first. The angle to the view center is
+      // measured in multiples of the field of view.
+      double centerAngle = std::acos(std::min(1.0, glm::dot(centerDir, mCullData.mViewDir)));
+      state.mPriority    = ratio / (1.0 + centerAngle / mLodData.mFov);
+
+      // The angle is roughly inversely proportional to the distance of the
+      // tile, so the ratio does not cross the threshold before the observer
+      // moved by this distance. The factor of one half accounts for the
+      // coarseness of this estimate close to the tile.
+      if (decision) {
+        decision->mDistanceTolerance = 0.5 * glm::length(tbCenter - mCullData.mCamPos) *
+                                       std::abs(ratio / RefineRatio - 1.0);
+
+        if (mParams->mMinLevel > tileId.level()) {
+          decision->mDistanceTolerance = std::numeric_limits<double>::infinity();
+        }
+      }
+    }
+  }
 
-    double maxAngle(0.0);
+  return result;
+}
 
-    for (auto& tbDir : tbDirs) {
-      maxAngle = std::max(std::acos(std::min(1.0, glm::dot(tbDir, centerDir))), maxAngle);
-    }
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    // calculate field of view
-    double fov =
-        std::max(mLodData.mFrustumES.getHorizontalFOV(), mLodData.mFrustumES.getVerticalFOV());
+void LODVisitor::selectDecisionSlot() {
+  // decisions of previous frames are only valid for the same planet parameters
+  bool changed = mDecisionParams.mRadii != mParams->mRadii ||
+                 mDecisionParams.mHeightScale != mParams->mHeightScale ||
+                 mDecisionParams.mLodFactor != mParams->mLodFactor ||
+                 mDecisionParams.mMinLevel != mParams->mMinLevel;
 
-    double ratio = maxAngle / fov * mParams->mLodFactor;
+  if (changed) {
+    mDecisionParams = *mParams;
+    mDecisionSlots.fill(DecisionSlot());
+  }
 
-    result = ratio > 10.0;
+  // ... and the same projection, reuse the slot of the current projection if there is one
+  auto slot = std::find_if(mDecisionSlots.begin(), mDecisionSlots.end(),
+      [this](DecisionSlot const& s) { return s.mGeneration >= 0 && s.mMatP == mLodData.mMatP; });
 
-    if (mParams->mMinLevel > tileId.level()) {
-      result = true;
-    }
+  // otherwise the decisions of the least recently used projection are replaced
+  if (slot == mDecisionSlots.end()) {
+    slot = std::min_element(mDecisionSlots.begin(), mDecisionSlots.end(),
+        [](DecisionSlot const& a, DecisionSlot const& b) { return a.mLastUse < b.mLastUse; });
 
-    // estimate how many more levels are necessary to achieve desired
-    // lod factor - used for the case below (no DEM node for level)
-    double const deltaLvl = std::max(0.0, std::ceil(std::log(ratio) / std::log(4.0)));
-    state.mMaxLevel       = static_cast<int>(tileId.level() + deltaLvl);
+    slot->mMatP       = mLodData.mMatP;
+    slot->mGeneration = ++mGeneration;
   }
 
-  return result;
+  slot->mLastUse = ++mTraversalCount;
+  mDecisionSlot  = static_cast<std::size_t>(slot - mDecisionSlots.begin());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void LODVisitor::drawLevel() {
+  if (mLoadOnly) {
+    return;
+  }
+
   LODState& state = getLODState();
 
   if (mTreeMgrDEM) {
@@ -823,13 +1085,77 @@ bool LODVisitor::getUpdateCulling() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<TileId> const& LODVisitor::getLoadDEM() const {
+void LODVisitor::setThreadCount(std::size_t count) {
+  count = std::clamp(count, std::size_t(1), static_cast<std::size_t>(TileQuadTree::sNumRoots));
+
+  if (count != mThreadCount) {
+    mThreadCount = count;
+    mThreadPool.reset();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t LODVisitor::getThreadCount() const {
+  return mThreadCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::setIncremental(bool enable) {
+  // decisions stored before are outdated
+  if (enable && !mIncremental) {
+    mDecisionSlots.fill(DecisionSlot());
+  }
+
+  mIncremental = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::getIncremental() const {
+  return mIncremental;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::setSkipDecisions(bool enable) {
+  mSkipDecisions = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::getSkipDecisions() const {
+  return mSkipDecisions;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::setLoadOnly(bool enable) {
+  mLoadOnly = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::getLoadOnly() const {
+  return mLoadOnly;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t LODVisitor::getNumTestedNodes() const {
+  return mNumTestedNodes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TileRequest> const& LODVisitor::getLoadDEM() const {
   return mLoadDEM;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<TileId> const& LODVisitor::getLoadIMG() const {
+std::vector<TileRequest> const& LODVisitor::getLoadIMG() const {
   return mLoadIMG;
 }
 
@@ -8,27 +8,42 @@
 #define CSP_LOD_BODIES_LODVISITOR_HPP
 
 #include "Frustum.hpp"
+#include "PlanetParameters.hpp"
 #include "RenderData.hpp"
 #include "TileBounds.hpp"
 #include "TileId.hpp"
+#include "TileRequest.hpp"
 #include "TileVisitor.hpp"
 
+#include <array>
+#include <memory>
 #include <vector>
 
+namespace cs::utils {
+class ThreadPool;
+} // namespace cs::utils
+
 namespace csp::lodbodies {
 
-struct PlanetParameters;
 class RenderDataDEM;
 class RenderDataImg;
 class TreeManagerBase;
 
 /// Specialization of TileVisitor that determines the necessary level of detail for tiles and
 /// produces lists of tiles to load and draw respectively.
-class LODVisitor : public TileVisitor<LODVisitor> {
+class LODVisitor final : public TileVisitor<LODVisitor> {
  public:
   explicit LODVisitor(PlanetParameters const& params, TreeManagerBase* treeMgrDEM = nullptr,
       TreeManagerBase* treeMgrIMG = nullptr);
 
+  LODVisitor(LODVisitor const& other) = delete;
+  LODVisitor(LODVisitor&& other)      = delete;
+
+  LODVisitor& operator=(LODVisitor const& other) = delete;
+  LODVisitor& operator=(LODVisitor&& other) = delete;
+
+  ~LODVisitor();
+
   TreeManagerBase* getTreeManagerDEM() const;
   void             setTreeManagerDEM(TreeManagerBase* treeMgr);
 
@@ -63,13 +78,54 @@ class LODVisitor : public TileVisitor<LODVisitor> {
   void setUpdateCulling(bool enable);
   bool getUpdateCulling() const;
 
+  /// Sets the number of threads used for the traversal. If larger than one, the trees of the 12
+  /// root patches are visited in parallel and the resulting lists are merged in the order of the
+  /// root patches. Hence, the results are identical to a traversal on a single thread. More than
+  /// 12 threads have no effect. With a single thread (the default), everything happens on the
+  /// calling thread. In any case, the used nodes are marked in the TileAgeLists on the calling
+  /// thread.
+  void        setThreadCount(std::size_t count);
+  std::size_t getThreadCount() const;
+
+  /// Controls whether the visibility and refinement decisions of previous frames are reused. For
+  /// each tile, the decision is stored together with the distance the observer may move (or the
+  /// angle it may turn) before it could change. Only tiles whose tolerance has been exceeded are
+  /// tested again, for a slowly moving observer these are the tiles close to the current
+  /// level-of-detail cut. Newly loaded tiles are always tested. Changes to the planet parameters
+  /// invalidate all decisions. The decisions are stored separately for the last
+  /// RenderData::sNumLODDecisionSlots projections, a new projection replaces the decisions of the
+  /// one which has not been used for the longest time.
+  ///
+  /// The priorities of the load requests are only updated when the parent tile is tested again.
+  void setIncremental(bool enable);
+  bool getIncremental() const;
+
+  /// If enabled, the following traversals neither use nor update the decisions of incremental
+  /// mode. This is meant for views which change in every frame, like those of shadow maps, so
+  /// that they do not displace the decisions of the camera views.
+  void setSkipDecisions(bool enable);
+  bool getSkipDecisions() const;
+
+  /// Controls whether the visitor only determines the tiles to load. If enabled, no tiles are
+  /// marked for rendering and the render lists stay empty, so that the visitor can be used for an
+  /// additional traversal with a different view (e.g. a predicted one) without affecting what is
+  /// drawn. Tiles visited by such a traversal are still marked as used in the current frame.
+  void setLoadOnly(bool enable);
+  bool getLoadOnly() const;
+
+  /// Returns the number of tiles whose visibility and resolution were tested during the last
+  /// traversal. Without incremental mode, this is the number of visited tiles.
+  std::size_t getNumTestedNodes() const;
+
   /// Returns the elevation tiles that should be loaded. The parent tiles of these have been
-  /// determined to not provide sufficient resolution.
-  std::vector<TileId> const& getLoadDEM() const;
+  /// determined to not provide sufficient resolution. The priority of each request is derived from
+  /// the projected screen space size of the parent tile and its distance to the view center.
+  std::vector<TileRequest> const& getLoadDEM() const;
 
   /// Returns the image tile that should be loaded. The parent tiles of these have been determined
-  /// to not provide sufficient resolution.
-  std::vector<TileId> const& getLoadIMG() const;
+  /// to not provide sufficient resolution. The priority of each request is derived from the
+  /// projected screen space size of the parent tile and its distance to the view center.
+  std::vector<TileRequest> const& getLoadIMG() const;
 
   /// Returns the elevation tiles that should be rendered.
   std::vector<RenderData*> const& getRenderDEM() const;
@@ -84,6 +140,8 @@ class LODVisitor : public TileVisitor<LODVisitor> {
     glm::dmat4 mMatP;
     Frustum    mFrustumES; // frustum in eye space
     glm::ivec4 mViewport;
+    double     mFov;          // the larger one of the horizontal and vertical field of view
+    double     mRefineCosine; // tiles with a smaller corner cosine are refined
   };
 
   /// Struct storing information relevant for frustum culling.
@@ -91,6 +149,8 @@ class LODVisitor : public TileVisitor<LODVisitor> {
     Frustum        mFrustumMS; // frustum in model space
     glm::f64mat3x3 mMatN;
     glm::dvec3     mCamPos;
+    glm::dvec3     mViewDir; // viewing direction in model space
+    glm::dvec3     mUpDir;   // up direction in model space
   };
 
   /// State tracked during traversal of the tile quad trees.
@@ -102,12 +162,29 @@ class LODVisitor : public TileVisitor<LODVisitor> {
     RenderDataDEM* mRdDEM{};
     RenderDataImg* mRdIMG{};
 
-    int mMaxLevel{};
+    double mPriority{}; ///< Priority for loading the children of this node.
+
+    /// Results of getFrustumDistances() and getMinCornerCosines() for the four children, these
+    /// are computed at once before the children are visited.
+    bool                  mChildrenTested{};
+    std::array<double, 4> mChildFrustumDistances{};
+    std::array<double, 4> mChildMinCosines{};
+
+    /// The results for this node, taken from the parent state if it has mChildrenTested set.
+    bool   mTested{};
+    double mFrustumDistance{};
+    double mMinCosine{};
   };
 
   bool preTraverse() override;
   void postTraverse() override;
 
+  void visitRoots() override;
+
+  /// Copies the per-frame state of this to the visitors which are used for the root patches when
+  /// traversing in parallel.
+  void prepareRootVisitors();
+
   bool preVisitRoot(TileId const& tileId) override;
   void postVisitRoot(TileId const& tileId) override;
 
@@ -132,14 +209,44 @@ class LODVisitor : public TileVisitor<LODVisitor> {
   void addLoadChildrenDEM(TileNode* node);
   void addLoadChildrenIMG(TileNode* node);
 
+  /// Marks the given render data as used in the current frame. The visitors of the root patches
+  /// only record it in mUsed, as this moves the render data in the TileAgeList of its
+  /// TreeManagerBase, which is not thread-safe. visitRoots() marks them after all root visitors
+  /// have finished.
+  void markUsed(RenderData* rdata);
+
+  /// Returns the render data in which the decisions for the currently visited node are stored in
+  /// incremental mode. This is nullptr if the node's bounds are taken from a parent tile.
+  RenderData* getDecisionOwner() const;
+
+  /// Returns whether a decision stored in a previous frame is still valid for the current view.
+  /// boundsLevel is the level of the DEM tile whose heights currently define the node's bounds.
+  bool testDecisionValid(RenderData::LODDecision const& decision, int boundsLevel) const;
+
   /// Returns whether the currently visited node is potentially visible. Tests if the node's
-  /// bounding box intersects the camera frustum.
-  bool testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM_);
+  /// bounding box intersects the camera frustum. If decision is not nullptr, the tolerance of the
+  /// result is stored in it.
+  bool testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM_,
+      RenderData::LODDecision* decision = nullptr);
+
+  /// Returns whether the given bounding box with the given distance to the camera frustum (see
+  /// getFrustumDistance()) intersects the frustum and is not hidden behind the horizon.
+  bool testBoundsVisible(BoundingBox<double> const& tb, double frustumDistance,
+      TreeManagerBase* treeMgrDEM, RenderData::LODDecision* decision) const;
+
+  /// Tests the bounds of the four children of the currently visited node at once. This is only
+  /// done if all children have their own DEM node, see LODState::mChildrenTested.
+  void testChildren();
 
   /// Returns whether the currently visited node should be refined, i.e. if it's children should be
   /// used to achieve desired resolution. Estimates the screen space size (in pixels) of the node
-  /// and compares that with the desired LOD factor.
-  bool testNeedRefine(TileId const& tileId);
+  /// and compares that with the desired LOD factor. This also computes the priority with which the
+  /// children of the node will be requested. If decision is not nullptr, the tolerance of the
+  /// result is stored in it.
+  bool testNeedRefine(TileId const& tileId, RenderData::LODDecision* decision = nullptr);
+
+  /// Selects the slot of the stored decisions for the current projection, see setIncremental().
+  void selectDecisionSlot();
 
   void drawLevel();
 
@@ -147,6 +254,13 @@ class LODVisitor : public TileVisitor<LODVisitor> {
 
   static std::size_t const sMaxStackDepth = 32;
 
+  /// The projection for which the decisions in one slot of the RenderData have been made.
+  struct DecisionSlot {
+    glm::dmat4 mMatP{0.0};
+    int        mGeneration = -1; ///< -1 if the slot is unused.
+    int        mLastUse    = -1; ///< The traversal in which the slot has been used last.
+  };
+
   PlanetParameters const* mParams;
   TreeManagerBase*        mTreeMgrDEM;
   TreeManagerBase*        mTreeMgrIMG;
@@ -160,14 +274,34 @@ class LODVisitor : public TileVisitor<LODVisitor> {
   std::vector<LODState> mStack;
   int                   mStackTop;
 
-  std::vector<TileId>      mLoadDEM;
-  std::vector<TileId>      mLoadIMG;
+  std::vector<TileRequest> mLoadDEM;
+  std::vector<TileRequest> mLoadIMG;
   std::vector<RenderData*> mRenderDEM;
   std::vector<RenderData*> mRenderIMG;
+  std::vector<RenderData*> mUsed;
 
   int  mFrameCount;
   bool mUpdateLOD;
   bool mUpdateCulling;
+
+  bool        mIncremental;
+  bool        mSkipDecisions;
+  std::size_t mNumTestedNodes;
+  bool        mLoadOnly;
+  bool        mDeferMarkUsed; // whether markUsed() only records the render data in mUsed
+
+  // The stored decisions of incremental mode. mDecisionSlot is used by the current traversal,
+  // mGeneration is the generation which has been assigned to a slot last and mTraversalCount is
+  // the number of traversals which used the stored decisions.
+  PlanetParameters                                           mDecisionParams;
+  std::array<DecisionSlot, RenderData::sNumLODDecisionSlots> mDecisionSlots;
+  std::size_t                                                mDecisionSlot;
+  int                                                        mGeneration;
+  int                                                        mTraversalCount;
+
+  std::size_t                                                     mThreadCount;
+  std::unique_ptr<cs::utils::ThreadPool>                          mThreadPool;
+  std::array<std::unique_ptr<LODVisitor>, TileQuadTree::sNumRoots> mRootVisitors;
 };
 
 } // namespace csp::lodbodies
@@ -38,7 +38,9 @@ LodBody::LodBody(std::shared_ptr<cs::core::Settings> const& settings,
     , mGuiManager(pGuiManager)
     , mPlanet(glResources)
     , mShader(settings, pluginSettings, pGuiManager)
-    , mRadii(cs::core::SolarSystem::getRadii(sCenterName)) {
+    , mRadii(cs::core::SolarSystem::getRadii(sCenterName))
+    , mPredictor(mRadii[0])
+    , mHeightSampler(std::make_unique<AsyncHeightSampler>()) {
 
   pVisible.connect([this](bool val) {
     if (val) {
@@ -60,6 +62,22 @@ LodBody::LodBody(std::shared_ptr<cs::core::Settings> const& settings,
 
   mPluginSettings->mLODFactor.connectAndTouch([this](float val) { mPlanet.setLODFactor(val); });
 
+  mLODThreadCountConnection = mPluginSettings->mLODThreadCount.connectAndTouch(
+      [this](uint32_t val) { mPlanet.getLODVisitor().setThreadCount(val); });
+
+  mIncrementalLODConnection = mPluginSettings->mEnableIncrementalLOD.connectAndTouch(
+      [this](bool val) { mPlanet.getLODVisitor().setIncremental(val); });
+
+  mTileCacheSizeConnection = mPluginSettings->mTileCacheSize.connectAndTouch([this](uint32_t val) {
+    mPlanet.setTileCacheSize(static_cast<std::size_t>(val) * 1024 * 1024);
+  });
+
+  mTileUploadBudgetConnection = mPluginSettings->mTileUploadBudget.connectAndTouch(
+      [this](float val) { mPlanet.setTileUploadBudget(val); });
+
+  mEnableMultiDrawConnection = mPluginSettings->mEnableMultiDraw.connectAndTouch(
+      [this](bool val) { mPlanet.getTileRenderer().setMultiDraw(val); });
+
   mPluginSettings->mEnableWireframe.connectAndTouch(
       [this](bool val) { mPlanet.getTileRenderer().setWireframe(val); });
 
@@ -83,6 +101,11 @@ LodBody::LodBody(std::shared_ptr<cs::core::Settings> const& settings,
 LodBody::~LodBody() {
   mGraphicsEngine->unregisterCaster(&mPlanet);
   mSettings->mGraphics.pHeightScale.disconnect(mHeightScaleConnection);
+  mPluginSettings->mTileCacheSize.disconnect(mTileCacheSizeConnection);
+  mPluginSettings->mTileUploadBudget.disconnect(mTileUploadBudgetConnection);
+  mPluginSettings->mEnableMultiDraw.disconnect(mEnableMultiDrawConnection);
+  mPluginSettings->mLODThreadCount.disconnect(mLODThreadCountConnection);
+  mPluginSettings->mEnableIncrementalLOD.disconnect(mIncrementalLODConnection);
 
   VistaSceneGraph* pSG = GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
   pSG->GetRoot()->DisconnectChild(mGLNode.get());
@@ -115,6 +138,22 @@ double LodBody::getHeight(glm::dvec2 lngLat) const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+std::vector<double> LodBody::getHeights(std::vector<glm::dvec2> const& lngLats) const {
+  std::vector<double> heights;
+  utils::getHeights(&mPlanet, HeightSamplePrecision::eActual, lngLats, heights);
+  return heights;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::future<std::vector<double>> LodBody::getPreciseHeights(
+    std::vector<glm::dvec2> const& lngLats,
+    std::shared_ptr<cs::utils::CancellationToken> token) const {
+  return mHeightSampler->getHeights(lngLats, std::move(token));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 glm::dvec3 LodBody::getRadii() const {
   return mRadii;
 }
@@ -124,6 +163,7 @@ glm::dvec3 LodBody::getRadii() const {
 void LodBody::setDEMtileSource(std::shared_ptr<TileSource> source) {
   if (!source->isSame(mDEMtileSource.get())) {
     mPlanet.setDEMSource(source.get());
+    mHeightSampler->setSource(source);
     mDEMtileSource = std::move(source);
   }
 }
@@ -166,6 +206,7 @@ void LodBody::update(double tTime, cs::scene::CelestialObserver const& oObs) {
 
   if (getIsInExistence() && pVisible.get()) {
     mPlanet.setWorldTransform(getWorldTransform());
+    updatePrediction(tTime, oObs);
 
     if (mSun) {
       double sunIlluminance = 1.0;
@@ -184,6 +225,39 @@ void LodBody::update(double tTime, cs::scene::CelestialObserver const& oObs) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void LodBody::updatePrediction(double tTime, cs::scene::CelestialObserver const& oObs) {
+  if (!mPluginSettings->mEnablePrefetching.get()) {
+    mPlanet.setPredictedWorldTransform(std::nullopt);
+    return;
+  }
+
+  // The motion recorded in another reference frame of the observer can not be extrapolated.
+  if (oObs.getCenterName() != mObserverCenter || oObs.getFrameName() != mObserverFrame) {
+    mPredictor.reset();
+    mObserverCenter = oObs.getCenterName();
+    mObserverFrame  = oObs.getFrameName();
+  }
+
+  // The velocity is measured in real time, the simulation may be paused or run faster.
+  mPredictor.update(getWorldTransform(), GetVistaSystem()->GetFrameClock());
+
+  // During observer animations, the tiles at the destination are loaded while flying there.
+  std::optional<glm::dmat4> target;
+
+  if (oObs.isAnimationInProgress()) {
+    try {
+      target = oObs.getAnimationTarget().getRelativeTransform(tTime, *this);
+    } catch (...) {
+      // data might be unavailable
+    }
+  }
+
+  mPredictor.setTarget(target);
+  mPlanet.setPredictedWorldTransform(mPredictor.getPrediction());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 bool LodBody::Do() {
   if (getIsInExistence() && pVisible.get()) {
     cs::utils::FrameTimings::ScopedTimer timer("LoD-Body " + getCenterName());
@@ -10,6 +10,8 @@
 #include "../../../src/cs-graphics/Shadows.hpp"
 #include "../../../src/cs-scene/CelestialBody.hpp"
 
+#include "AsyncHeightSampler.hpp"
+#include "ObserverPredictor.hpp"
 #include "PlanetShader.hpp"
 #include "TileSource.hpp"
 #include "TileTextureArray.hpp"
@@ -17,6 +19,7 @@
 #include <VistaKernel/GraphicsManager/VistaOpenGLDraw.h>
 
 #include <memory>
+#include <string>
 
 namespace cs::scene {
 class CelestialAnchorNode;
@@ -75,12 +78,23 @@ class LodBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
   double     getHeight(glm::dvec2 lngLat) const override;
   glm::dvec3 getRadii() const override;
 
+  /// Samples all heights in one pass over the elevation tiles, see utils::getHeights().
+  std::vector<double> getHeights(std::vector<glm::dvec2> const& lngLats) const override;
+
+  /// Loads the finest elevation tiles in the background, see AsyncHeightSampler.
+  std::future<std::vector<double>> getPreciseHeights(std::vector<glm::dvec2> const& lngLats,
+      std::shared_ptr<cs::utils::CancellationToken> token) const override;
+
   void update(double tTime, cs::scene::CelestialObserver const& oObs) override;
 
   bool Do() override;
   bool GetBoundingBox(VistaBoundingBox& bb) override;
 
  private:
+  /// Passes the predicted world transform to the VistaPlanet, so that it can request the tiles for
+  /// the predicted view.
+  void updatePrediction(double tTime, cs::scene::CelestialObserver const& oObs);
+
   std::shared_ptr<cs::core::Settings>               mSettings;
   std::shared_ptr<cs::core::GraphicsEngine>         mGraphicsEngine;
   std::shared_ptr<cs::core::SolarSystem>            mSolarSystem;
@@ -92,10 +106,21 @@ class LodBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
   std::shared_ptr<TileSource>      mDEMtileSource;
   std::shared_ptr<TileSource>      mIMGtileSource;
 
-  VistaPlanet  mPlanet;
-  PlanetShader mShader;
-  glm::dvec3   mRadii;
-  int          mHeightScaleConnection = -1;
+  VistaPlanet       mPlanet;
+  PlanetShader      mShader;
+  glm::dvec3        mRadii;
+  ObserverPredictor mPredictor;
+  std::string       mObserverCenter; ///< The reference frame of the observer for mPredictor.
+  std::string       mObserverFrame;
+  int               mHeightScaleConnection      = -1;
+  int               mTileCacheSizeConnection    = -1;
+  int               mTileUploadBudgetConnection = -1;
+  int               mEnableMultiDrawConnection  = -1;
+  int               mLODThreadCountConnection   = -1;
+  int               mIncrementalLODConnection   = -1;
+
+  // Declared after mPlanet, so that pending height queries are finished before it is destroyed.
+  std::unique_ptr<AsyncHeightSampler> mHeightSampler;
 };
 
 } // namespace csp::lodbodies
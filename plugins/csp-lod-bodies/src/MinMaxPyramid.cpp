@@ -7,172 +7,293 @@
 #include "MinMaxPyramid.hpp"
 #include "Tile.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+// SSE is always available on x86-64, on other platforms the scalar loops are used.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CSP_LOD_BODIES_SIMD_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace csp::lodbodies {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-MinMaxPyramid::MinMaxPyramid()
-    : mMinPyramid(7, std::vector<float>())
-    , mMaxPyramid(7, std::vector<float>()) {
-  mMinPyramid[0] = std::vector<float>(128 * 128, std::numeric_limits<float>::max());
-  mMinPyramid[1] = std::vector<float>(64 * 64, std::numeric_limits<float>::max());
-  mMinPyramid[2] = std::vector<float>(32 * 32, std::numeric_limits<float>::max());
-  mMinPyramid[3] = std::vector<float>(16 * 16, std::numeric_limits<float>::max());
-  mMinPyramid[4] = std::vector<float>(8 * 8, std::numeric_limits<float>::max());
-  mMinPyramid[5] = std::vector<float>(4 * 4, std::numeric_limits<float>::max());
-  mMinPyramid[6] = std::vector<float>(2 * 2, std::numeric_limits<float>::max());
-
-  mMaxPyramid[0] = std::vector<float>(128 * 128, -std::numeric_limits<float>::max());
-  mMaxPyramid[1] = std::vector<float>(64 * 64, -std::numeric_limits<float>::max());
-  mMaxPyramid[2] = std::vector<float>(32 * 32, -std::numeric_limits<float>::max());
-  mMaxPyramid[3] = std::vector<float>(16 * 16, -std::numeric_limits<float>::max());
-  mMaxPyramid[4] = std::vector<float>(8 * 8, -std::numeric_limits<float>::max());
-  mMaxPyramid[5] = std::vector<float>(4 * 4, -std::numeric_limits<float>::max());
-  mMaxPyramid[6] = std::vector<float>(2 * 2, -std::numeric_limits<float>::max());
+namespace {
+
+// The offsets of the levels in the buffer of a pyramid, indexed by level. The finest level comes
+// first, this is also the order in which the levels are serialized. There is no level zero.
+std::array<size_t, MinMaxPyramid::sNumLevels + 1> const LevelOffsets = {
+    0, 21840, 21824, 21760, 21504, 20480, 16384, 0};
+
+// The number of minimum values (and of maximum values) of a pyramid.
+size_t const NumValues = 21844;
+
+// The number of cells of the finest level in one direction.
+int const FinestSize = 1 << MinMaxPyramid::sNumLevels;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Min {
+  static float apply(float a, float b) {
+    return std::min(a, b);
+  }
+
+#if defined(CSP_LOD_BODIES_SIMD_SSE)
+  static __m128 apply(__m128 a, __m128 b) {
+    return _mm_min_ps(a, b);
+  }
+#endif
+};
+
+struct Max {
+  static float apply(float a, float b) {
+    return std::max(a, b);
+  }
+
+#if defined(CSP_LOD_BODIES_SIMD_SSE)
+  static __m128 apply(__m128 a, __m128 b) {
+    return _mm_max_ps(a, b);
+  }
+#endif
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Combines each 2x2 block of the two given rows with Op. The width has to be even, width / 2
+// values are written to result. With SSE, eight input columns are processed at once.
+template <typename Op>
+void reduceRows(float const* row0, float const* row1, int width, float* result) {
+  int x = 0;
+
+#if defined(CSP_LOD_BODIES_SIMD_SSE)
+  for (; x + 8 <= width; x += 8) {
+    __m128 a = Op::apply(_mm_loadu_ps(row0 + x), _mm_loadu_ps(row1 + x));
+    __m128 b = Op::apply(_mm_loadu_ps(row0 + x + 4), _mm_loadu_ps(row1 + x + 4));
+
+    _mm_storeu_ps(result + x / 2, Op::apply(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                                      _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+  }
+#endif
+
+  for (; x < width; x += 2) {
+    result[x / 2] = Op::apply(Op::apply(row0[x], row1[x]), Op::apply(row0[x + 1], row1[x + 1]));
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-MinMaxPyramid::MinMaxPyramid(Tile<float>* tile)
-    : mMinPyramid(7, std::vector<float>())
-    , mMaxPyramid(7, std::vector<float>()) {
-  mMinPyramid[0] = std::vector<float>(128 * 128, std::numeric_limits<float>::max());
-  mMinPyramid[1] = std::vector<float>(64 * 64, std::numeric_limits<float>::max());
-  mMinPyramid[2] = std::vector<float>(32 * 32, std::numeric_limits<float>::max());
-  mMinPyramid[3] = std::vector<float>(16 * 16, std::numeric_limits<float>::max());
-  mMinPyramid[4] = std::vector<float>(8 * 8, std::numeric_limits<float>::max());
-  mMinPyramid[5] = std::vector<float>(4 * 4, std::numeric_limits<float>::max());
-  mMinPyramid[6] = std::vector<float>(2 * 2, std::numeric_limits<float>::max());
-
-  mMaxPyramid[0] = std::vector<float>(128 * 128, -std::numeric_limits<float>::max());
-  mMaxPyramid[1] = std::vector<float>(64 * 64, -std::numeric_limits<float>::max());
-  mMaxPyramid[2] = std::vector<float>(32 * 32, -std::numeric_limits<float>::max());
-  mMaxPyramid[3] = std::vector<float>(16 * 16, -std::numeric_limits<float>::max());
-  mMaxPyramid[4] = std::vector<float>(8 * 8, -std::numeric_limits<float>::max());
-  mMaxPyramid[5] = std::vector<float>(4 * 4, -std::numeric_limits<float>::max());
-  mMaxPyramid[6] = std::vector<float>(2 * 2, -std::numeric_limits<float>::max());
-
-  int HalfSizeX = static_cast<int32_t>((TileBase::SizeX - 1) * 0.5); // 128
-  int x2        = 0;                                                 // 0..128
-  int y2        = 0;                                                 // 0..128
+// Returns the sum of the given values. With SSE, four partial sums are accumulated in parallel.
+float getSum(float const* values, int count) {
+  float result = 0.F;
+  int   i      = 0;
 
-  for (int y = 0; y < TileBase::SizeY; ++y) {
-    x2 = 0;
-    for (int x = 0; x < TileBase::SizeX; ++x) {
-      float const v = tile->data()[y * TileBase::SizeX + x];
-
-      mMinValue = std::min(mMinValue, v);
-      mMaxValue = std::max(mMaxValue, v);
-      mAvgValue += v / (TileBase::SizeY * TileBase::SizeY);
-
-      // Construct first 128x128 MinMaxPyramid layer by sampling 256x256 values
-      x2                                  = std::min(x2, 127);
-      y2                                  = std::min(y2, 127);
-      mMinPyramid[0][y2 * HalfSizeX + x2] = std::min(mMinPyramid[0][y2 * HalfSizeX + x2], v);
-      mMaxPyramid[0][y2 * HalfSizeX + x2] = std::max(mMaxPyramid[0][y2 * HalfSizeX + x2], v);
-
-      // 256 -> 128
-      if (x % 2 == 1) {
-        x2 += 1;
+#if defined(CSP_LOD_BODIES_SIMD_SSE)
+  __m128 sums = _mm_setzero_ps();
+  for (; i + 4 <= count; i += 4) {
+    sums = _mm_add_ps(sums, _mm_loadu_ps(values + i));
+  }
+
+  std::array<float, 4> partial{};
+  _mm_storeu_ps(partial.data(), sums);
+  result = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+#endif
+
+  for (; i < count; ++i) {
+    result += values[i];
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Builds all levels of one pyramid from the samples of a tile. The finest level is computed from
+// pairs of rows; the last row and column of the tile are added to the last row and column of
+// cells.
+template <typename Op>
+void buildPyramid(float const* samples, float* pyramid) {
+  int const sizeX = TileBase::SizeX;
+  int const last  = FinestSize - 1;
+
+  std::array<float, FinestSize> lastRow{};
+  reduceRows<Op>(samples + (sizeX - 1) * sizeX, samples + (sizeX - 1) * sizeX, sizeX - 1,
+      lastRow.data());
+
+  for (int y = 0; y < FinestSize; ++y) {
+    float const* row0   = samples + (2 * y) * sizeX;
+    float const* row1   = samples + (2 * y + 1) * sizeX;
+    float*       result = pyramid + y * FinestSize;
+
+    reduceRows<Op>(row0, row1, sizeX - 1, result);
+    result[last] = Op::apply(result[last], Op::apply(row0[sizeX - 1], row1[sizeX - 1]));
+
+    if (y == last) {
+      for (int x = 0; x < FinestSize; ++x) {
+        result[x] = Op::apply(result[x], lastRow[x]);
       }
+      result[last] = Op::apply(result[last], samples[sizeX * sizeX - 1]);
     }
+  }
+
+  for (int level = MinMaxPyramid::sNumLevels - 1; level > 0; --level) {
+    int const    size   = 1 << level;
+    float const* source = pyramid + LevelOffsets[level + 1];
+    float*       target = pyramid + LevelOffsets[level];
 
-    // 256 -> 128
-    if (y % 2 == 1) {
-      y2 += 1;
+    for (int y = 0; y < size; ++y) {
+      reduceRows<Op>(source + 2 * y * 2 * size, source + (2 * y + 1) * 2 * size, 2 * size,
+          target + y * size);
     }
   }
+}
 
-  // Build remaining MinMaxPyramid layers 64x62-2x2
-  for (int i(1); i < 7; ++i) {
-    y2 = 0;
-    for (int y = 0; y < (TileBase::SizeY - 1) * std::pow(0.5, i); ++y) {
-      x2 = 0;
-      for (int x = 0; x < (TileBase::SizeX - 1) * std::pow(0.5, i); ++x) {
-        mMinPyramid[i][static_cast<uint64_t>(y2 * HalfSizeX * std::pow(0.5, i) + x2)] = std::min(
-            mMinPyramid[i - 1]
-                       [static_cast<uint64_t>(y * (TileBase::SizeX - 1) * std::pow(0.5, i) + x)],
-            mMinPyramid[i][static_cast<uint64_t>(y2 * HalfSizeX * std::pow(0.5, i) + x2)]);
-        mMaxPyramid[i][static_cast<uint64_t>(y2 * HalfSizeX * std::pow(0.5, i) + x2)] = std::max(
-            mMaxPyramid[i - 1]
-                       [static_cast<uint64_t>(y * (TileBase::SizeX - 1) * std::pow(0.5, i) + x)],
-            mMaxPyramid[i][static_cast<uint64_t>(y2 * HalfSizeX * std::pow(0.5, i) + x2)]);
-        if (x % 2 == 1) {
-          x2 += 1;
-        }
-      }
-      if (y % 2 == 1) {
-        y2 += 1;
-      }
-    }
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Splits the packed quadrants into the cell coordinates of the given level.
+void decodeQuadrants(int level, uint32_t quadrants, int& x, int& y) {
+  x = 0;
+  y = 0;
+
+  for (int i = 0; i < level; ++i) {
+    x |= static_cast<int>((quadrants >> (2 * i)) & 1U) << i;
+    y |= static_cast<int>((quadrants >> (2 * i + 1)) & 1U) << i;
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-MinMaxPyramid::~MinMaxPyramid() {
-  for (int layer(0); layer < 7; ++layer) {
-    mMinPyramid[layer].clear();
-    mMaxPyramid[layer].clear();
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MinMaxPyramid::MinMaxPyramid()
+    : mValues(2 * NumValues) {
+  std::fill(mValues.begin(), mValues.begin() + NumValues, std::numeric_limits<float>::max());
+  std::fill(mValues.begin() + NumValues, mValues.end(), -std::numeric_limits<float>::max());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MinMaxPyramid::MinMaxPyramid(Tile<float>* tile)
+    : mValues(2 * NumValues) {
+  float const* samples = tile->data().data();
+
+  buildPyramid<Min>(samples, mValues.data());
+  buildPyramid<Max>(samples, mValues.data() + NumValues);
+
+  // The coarsest level contains the extrema of all samples.
+  float const* minLevel = mValues.data() + LevelOffsets[1];
+  float const* maxLevel = mValues.data() + NumValues + LevelOffsets[1];
+
+  mMinValue = *std::min_element(minLevel, minLevel + 4);
+  mMaxValue = *std::max_element(maxLevel, maxLevel + 4);
+
+  // The rows are summed up individually to limit the rounding errors.
+  double sum = 0.0;
+  for (int y = 0; y < TileBase::SizeY; ++y) {
+    sum += getSum(samples + y * TileBase::SizeX, TileBase::SizeX);
   }
 
-  mMinPyramid.clear();
-  mMaxPyramid.clear();
+  mAvgValue = static_cast<float>(sum / (TileBase::SizeX * TileBase::SizeY));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<std::vector<float>>& MinMaxPyramid::getMinPyramid() {
-  return mMinPyramid;
+MinMaxPyramid::~MinMaxPyramid() = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<float> const& MinMaxPyramid::getValues() const {
+  return mValues;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<std::vector<float>>& MinMaxPyramid::getMaxPyramid() {
-  return mMaxPyramid;
+void MinMaxPyramid::serialize(std::string& data) const {
+  size_t offset = data.size();
+  data.resize(offset + getSerializedSize());
+
+  auto write = [&data, &offset](void const* source, size_t bytes) {
+    std::memcpy(&data[offset], source, bytes);
+    offset += bytes;
+  };
+
+  write(&mMinValue, sizeof(float));
+  write(&mMaxValue, sizeof(float));
+  write(&mAvgValue, sizeof(float));
+  write(mValues.data(), mValues.size() * sizeof(float));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float MinMaxPyramid::getMin(std::vector<int> const& quadrants) {
-  return getData(mMinPyramid, quadrants);
+bool MinMaxPyramid::deserialize(char const* data, size_t size) {
+  if (size != getSerializedSize()) {
+    return false;
+  }
+
+  auto read = [&data](void* target, size_t bytes) {
+    std::memcpy(target, data, bytes);
+    data += bytes; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  };
+
+  float minValue{};
+  float maxValue{};
+  float avgValue{};
+  read(&minValue, sizeof(float));
+  read(&maxValue, sizeof(float));
+  read(&avgValue, sizeof(float));
+
+  // This also rejects NaNs, which are a likely result of corrupt data.
+  if (!(minValue <= avgValue && avgValue <= maxValue)) {
+    return false;
+  }
+
+  mMinValue = minValue;
+  mMaxValue = maxValue;
+  mAvgValue = avgValue;
+  read(mValues.data(), mValues.size() * sizeof(float));
+
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float MinMaxPyramid::getMax(std::vector<int> const& quadrants) {
-  return getData(mMaxPyramid, quadrants);
+size_t MinMaxPyramid::getSerializedSize() {
+  // The average, minimum and maximum value followed by both pyramids with 128x128 to 2x2 values.
+  return (3 + 2 * NumValues) * sizeof(float);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float MinMaxPyramid::getData(
-    std::vector<std::vector<float>>& pyramid, std::vector<int> const& quadrants) {
-  // number of pyramid levels:
-  auto qSize = quadrants.size();
-  // particular pyramid layer,
-  // where min max information of the corresponding tile resolution is stored
-  auto layerId = 7 - qSize;
-  // pyramid layer address of searched value
-  int x(0);
-  int y(0);
-  for (size_t i(0); i < qSize; ++i) {
-    int step = int(std::pow(2, qSize - (i + 1)));
-    switch (quadrants[i]) {
-    case 1:
-      x += step;
-      break;
-    case 2:
-      y += step;
-      break;
-    case 3:
-      x += step;
-      y += step;
-      break;
-    }
-  }
+float MinMaxPyramid::getMin(int level, int x, int y) const {
+  return mValues[LevelOffsets[level] + y * (1 << level) + x];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float MinMaxPyramid::getMax(int level, int x, int y) const {
+  return mValues[NumValues + LevelOffsets[level] + y * (1 << level) + x];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float MinMaxPyramid::getMin(int level, uint32_t quadrants) const {
+  int x = 0;
+  int y = 0;
+  decodeQuadrants(level, quadrants, x, y);
+  return getMin(level, x, y);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  return pyramid[layerId][int(y * std::pow(2, qSize) + x)];
+float MinMaxPyramid::getMax(int level, uint32_t quadrants) const {
+  int x = 0;
+  int y = 0;
+  decodeQuadrants(level, quadrants, x, y);
+  return getMax(level, x, y);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,10 @@
 #ifndef CSP_LOD_BODIES_MINMAXPYRAMID_HPP
 #define CSP_LOD_BODIES_MINMAXPYRAMID_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <string>
 #include <vector>
 
 namespace csp::lodbodies {
@@ -17,9 +20,15 @@ class Tile;
 
 /// The MinMaxPyramid is a data structure for finding lod data in constant time. It's similar
 /// to a quad tree but it contains precomputed min and max values at each level.
+///
+/// Level 1 of the pyramid consists of 2x2 cells, level 7 of 128x128 cells. All values are stored
+/// in one contiguous buffer, hence no query allocates any memory.
 class MinMaxPyramid {
 
  public:
+  /// The number of levels of the pyramid.
+  static int const sNumLevels = 7;
+
   MinMaxPyramid();
   explicit MinMaxPyramid(Tile<float>* tile);
 
@@ -31,19 +40,34 @@ class MinMaxPyramid {
 
   virtual ~MinMaxPyramid();
 
-  std::vector<std::vector<float>>& getMinPyramid();
-  std::vector<std::vector<float>>& getMaxPyramid();
+  /// The minimum values of all levels, from the finest to the coarsest level, followed by the
+  /// maximum values in the same order.
+  std::vector<float> const& getValues() const;
+
+  /// Returns the minimum value of the cell (x, y) of the given level. The level has to be in
+  /// [1..sNumLevels], x and y in [0..2^level).
+  float getMin(int level, int x, int y) const;
+  float getMin() const {
+    return mMinValue;
+  }
+
+  /// Returns the maximum value of the cell (x, y) of the given level.
+  float getMax(int level, int x, int y) const;
+  float getMax() const {
+    return mMaxValue;
+  }
 
   /// Returns the minimum value in the given quadrant.
   ///
-  /// Requires a list of quadrant indices {[0..3], [0..3], [0..3], ...}
-  /// The number of given quadrants (q == 3 -> q0: 4x4, q1: 2x2, q2: 1x1)
-  /// determines the MinMaxPyramid level and the address for the data access.
+  /// The quadrants are packed into two bits per level, the most significant pair selects the
+  /// quadrant of the coarsest level. Each pair is one of 0 (left, top), 1 (right, top), 2 (left,
+  /// bottom) and 3 (right, bottom). This is the same encoding as used by the lowest 2 * level
+  /// bits of the patch index of a tile which is level levels below the tile of this pyramid.
   /// @code
-  ///  e.g. [1, 1, 1] = 8
-  ///  e.g. [1, 1, 2] = 15
-  ///  e.g. [0, 1, 1] = 4
-  ///  e.g. [0, 1, 2] = 11
+  ///  e.g. level 3, [1, 1, 1] = 0b010101 -> 8
+  ///  e.g. level 3, [1, 1, 2] = 0b010110 -> 15
+  ///  e.g. level 3, [0, 1, 1] = 0b000101 -> 4
+  ///  e.g. level 3, [0, 1, 2] = 0b000110 -> 11
   ///
   ///  1   2   3  |4|  5   6   7  |8|
   ///  9  10 |11| 12  13  14 |15| 16
@@ -54,28 +78,30 @@ class MinMaxPyramid {
   /// 49  50  51  52  53  54  55  56
   /// 57  58  59  60  61  62  63  64
   /// @endcode
-  float getMin(std::vector<int> const& quadrants);
-  float getMin() const {
-    return mMinValue;
-  }
+  float getMin(int level, uint32_t quadrants) const;
 
-  /// Returns the maximum value in the given quadrant.
-  float getMax(std::vector<int> const& quadrants);
-  float getMax() const {
-    return mMaxValue;
-  }
+  /// Returns the maximum value in the given quadrant, see getMin() above.
+  float getMax(int level, uint32_t quadrants) const;
 
   /// The average value of the whole pyramid.
   float getAverage() const {
     return mAvgValue;
   }
 
- protected:
-  static float getData(std::vector<std::vector<float>>& pyramid, std::vector<int> const& quadrants);
+  /// Appends the contents of the pyramid in a raw binary format to the given string. This can be
+  /// restored with deserialize(), which is much faster than computing the pyramid from the tile.
+  void serialize(std::string& data) const;
+
+  /// Restores a pyramid which has been written with serialize(). Returns false if the given data
+  /// has the wrong size or if its minimum, average and maximum are not in order, the pyramid is not
+  /// modified in this case.
+  bool deserialize(char const* data, size_t size);
+
+  /// Returns the number of bytes written by serialize().
+  static size_t getSerializedSize();
 
  private:
-  std::vector<std::vector<float>> mMinPyramid;
-  std::vector<std::vector<float>> mMaxPyramid;
+  std::vector<float> mValues;
 
   float mMinValue = std::numeric_limits<float>::max();
   float mMaxValue = std::numeric_limits<float>::lowest();
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ObserverPredictor.hpp"
+
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The velocity is smoothed over a few frames, this is the weight of the newest measurement.
+double const VelocitySmoothing = 0.5;
+
+// Predicted positions below the surface are moved up to this fraction of the current altitude.
+double const MinAltitudeRatio = 0.1;
+
+// If the observer moves this many times further in one frame than its velocity suggests, it is
+// considered to have jumped.
+double const JumpFactor = 10.0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* explicit */
+ObserverPredictor::ObserverPredictor(double radius, double lookAhead, double minRelativeMotion)
+    : mRadius(radius)
+    , mLookAhead(lookAhead)
+    , mMinRelativeMotion(minRelativeMotion) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ObserverPredictor::update(glm::dmat4 const& worldTransform, double time) {
+  glm::dvec3 position(glm::inverse(worldTransform) * glm::dvec4(0.0, 0.0, 0.0, 1.0));
+
+  if (mHasTransform && time > mTime) {
+    double const elapsed  = time - mTime;
+    double const altitude = std::max(glm::length(mPosition) - mRadius, 0.0);
+    double const maxMotion =
+        JumpFactor * glm::length(mVelocity) * elapsed + mMinRelativeMotion * altitude;
+
+    // Extrapolating a jump would predict a view far away from anything the observer will see, so
+    // the velocity is measured anew from here on.
+    if (mHasVelocity && glm::length(position - mPosition) > maxMotion) {
+      mHasVelocity = false;
+      mVelocity    = glm::dvec3(0.0);
+    } else {
+      glm::dvec3 velocity = (position - mPosition) / elapsed;
+
+      mVelocity    = mHasVelocity ? glm::mix(mVelocity, velocity, VelocitySmoothing) : velocity;
+      mHasVelocity = true;
+    }
+  }
+
+  mTransform    = worldTransform;
+  mPosition     = position;
+  mTime         = time;
+  mHasTransform = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ObserverPredictor::setTarget(std::optional<glm::dmat4> const& worldTransform) {
+  mTarget = worldTransform;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ObserverPredictor::reset() {
+  mTarget.reset();
+  mHasTransform = false;
+  mHasVelocity  = false;
+  mVelocity     = glm::dvec3(0.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<glm::dmat4> ObserverPredictor::getPrediction() const {
+  if (mTarget) {
+    return mTarget;
+  }
+
+  double distance = glm::length(mPosition);
+
+  if (!mHasVelocity || distance <= 0.0) {
+    return std::nullopt;
+  }
+
+  glm::dvec3 shift    = mVelocity * mLookAhead;
+  double     altitude = std::max(distance - mRadius, 0.0);
+
+  if (glm::length(shift) <= mMinRelativeMotion * altitude) {
+    return std::nullopt;
+  }
+
+  // When the observer approaches the surface quickly, the extrapolation would end up inside the
+  // body. The tiles below the predicted position are still the interesting ones.
+  glm::dvec3 predicted    = mPosition + shift;
+  double     minDistance  = mRadius + MinAltitudeRatio * altitude;
+  double     predDistance = glm::length(predicted);
+
+  if (predDistance < minDistance) {
+    glm::dvec3 direction = predDistance > 0.0 ? predicted / predDistance : mPosition / distance;
+    predicted            = direction * minDistance;
+  }
+
+  // Moving the observer by some offset is the same as moving the body by the inverse offset.
+  return mTransform * glm::translate(glm::dmat4(1.0), mPosition - predicted);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::dvec3 const& ObserverPredictor::getVelocity() const {
+  return mVelocity;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_OBSERVERPREDICTOR_HPP
+#define CSP_LOD_BODIES_OBSERVERPREDICTOR_HPP
+
+#include <glm/glm.hpp>
+#include <optional>
+
+namespace csp::lodbodies {
+
+/// Predicts the world transform of a body a short time ahead, so that the tiles needed for the
+/// predicted view can be requested before the observer gets there. The observer is always located
+/// at the origin of world space, hence only the transform of the body has to be predicted.
+///
+/// If the observer is animated towards a known target (e.g. by SolarSystem::flyObserverTo), the
+/// transform at the end of the animation is used as prediction. Otherwise, the velocity of the
+/// observer relative to the body is extrapolated. Motion which is small compared to the altitude of
+/// the observer does not result in a prediction, as the current view already contains the required
+/// tiles.
+///
+/// This class is not thread-safe.
+class ObserverPredictor {
+ public:
+  /// lookAhead is the time in seconds for which the velocity is extrapolated. minRelativeMotion is
+  /// the smallest distance the observer has to move in this time, relative to its altitude above
+  /// the given radius, for a prediction to be made.
+  explicit ObserverPredictor(
+      double radius, double lookAhead = 1.0, double minRelativeMotion = 0.1);
+
+  /// Records the world transform of the body in the current frame. The time is in seconds and must
+  /// increase with each call, it should be real time rather than simulation time. If the observer
+  /// has moved much further than its recent velocity suggests, it is assumed to have jumped and the
+  /// recorded velocity is discarded.
+  void update(glm::dmat4 const& worldTransform, double time);
+
+  /// Sets the world transform the body will have at the end of the current observer animation.
+  /// While set, this is returned as prediction. Pass std::nullopt once the animation is finished.
+  void setTarget(std::optional<glm::dmat4> const& worldTransform);
+
+  /// Forgets the recorded motion and the target, e.g. when the observer has changed its reference
+  /// frame.
+  void reset();
+
+  /// Returns the predicted world transform of the body, or std::nullopt if the observer is not
+  /// moving fast enough.
+  std::optional<glm::dmat4> getPrediction() const;
+
+  /// The velocity of the observer in the body's coordinate system in units per second.
+  glm::dvec3 const& getVelocity() const;
+
+ private:
+  double mRadius;
+  double mLookAhead;
+  double mMinRelativeMotion;
+
+  std::optional<glm::dmat4> mTarget;
+
+  bool       mHasTransform = false;
+  bool       mHasVelocity  = false;
+  glm::dmat4 mTransform{1.0};
+  glm::dvec3 mPosition{0.0}; ///< Position of the observer in the body's coordinate system.
+  glm::dvec3 mVelocity{0.0};
+  double     mTime = 0.0;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_OBSERVERPREDICTOR_HPP
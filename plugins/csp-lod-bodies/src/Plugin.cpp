@@ -101,6 +101,9 @@ void from_json(nlohmann::json const& j, Plugin::Settings& o) {
   cs::core::Settings::deserialize(j, "terrainProjectionType", o.mTerrainProjectionType);
   cs::core::Settings::deserialize(j, "lodFactor", o.mLODFactor);
   cs::core::Settings::deserialize(j, "autoLod", o.mAutoLOD);
+  cs::core::Settings::deserialize(j, "lodThreadCount", o.mLODThreadCount);
+  cs::core::Settings::deserialize(j, "enableIncrementalLod", o.mEnableIncrementalLOD);
+  cs::core::Settings::deserialize(j, "enablePrefetching", o.mEnablePrefetching);
   cs::core::Settings::deserialize(j, "textureGamma", o.mTextureGamma);
   cs::core::Settings::deserialize(j, "enableHeightlines", o.mEnableHeightlines);
   cs::core::Settings::deserialize(j, "enableLatLongGrid", o.mEnableLatLongGrid);
@@ -116,7 +119,14 @@ void from_json(nlohmann::json const& j, Plugin::Settings& o) {
   cs::core::Settings::deserialize(j, "maxGPUTilesColor", o.mMaxGPUTilesColor);
   cs::core::Settings::deserialize(j, "maxGPUTilesGray", o.mMaxGPUTilesGray);
   cs::core::Settings::deserialize(j, "maxGPUTilesDEM", o.mMaxGPUTilesDEM);
+  cs::core::Settings::deserialize(j, "maxGPUTileMemory", o.mMaxGPUTileMemory);
   cs::core::Settings::deserialize(j, "mapCache", o.mMapCache);
+  cs::core::Settings::deserialize(j, "packMapCache", o.mPackMapCache);
+  cs::core::Settings::deserialize(j, "decodedTileCache", o.mDecodedTileCache);
+  cs::core::Settings::deserialize(j, "tileCacheSize", o.mTileCacheSize);
+  cs::core::Settings::deserialize(j, "tileUploadBudget", o.mTileUploadBudget);
+  cs::core::Settings::deserialize(j, "enableMultiDraw", o.mEnableMultiDraw);
+  cs::core::Settings::deserialize(j, "maxConcurrentRequests", o.mMaxConcurrentRequests);
   cs::core::Settings::deserialize(j, "bodies", o.mBodies);
 }
 
@@ -124,6 +134,9 @@ void to_json(nlohmann::json& j, Plugin::Settings const& o) {
   cs::core::Settings::serialize(j, "terrainProjectionType", o.mTerrainProjectionType);
   cs::core::Settings::serialize(j, "lodFactor", o.mLODFactor);
   cs::core::Settings::serialize(j, "autoLod", o.mAutoLOD);
+  cs::core::Settings::serialize(j, "lodThreadCount", o.mLODThreadCount);
+  cs::core::Settings::serialize(j, "enableIncrementalLod", o.mEnableIncrementalLOD);
+  cs::core::Settings::serialize(j, "enablePrefetching", o.mEnablePrefetching);
   cs::core::Settings::serialize(j, "textureGamma", o.mTextureGamma);
   cs::core::Settings::serialize(j, "enableHeightlines", o.mEnableHeightlines);
   cs::core::Settings::serialize(j, "enableLatLongGrid", o.mEnableLatLongGrid);
@@ -139,7 +152,14 @@ void to_json(nlohmann::json& j, Plugin::Settings const& o) {
   cs::core::Settings::serialize(j, "maxGPUTilesColor", o.mMaxGPUTilesColor);
   cs::core::Settings::serialize(j, "maxGPUTilesGray", o.mMaxGPUTilesGray);
   cs::core::Settings::serialize(j, "maxGPUTilesDEM", o.mMaxGPUTilesDEM);
+  cs::core::Settings::serialize(j, "maxGPUTileMemory", o.mMaxGPUTileMemory);
   cs::core::Settings::serialize(j, "mapCache", o.mMapCache);
+  cs::core::Settings::serialize(j, "packMapCache", o.mPackMapCache);
+  cs::core::Settings::serialize(j, "decodedTileCache", o.mDecodedTileCache);
+  cs::core::Settings::serialize(j, "tileCacheSize", o.mTileCacheSize);
+  cs::core::Settings::serialize(j, "tileUploadBudget", o.mTileUploadBudget);
+  cs::core::Settings::serialize(j, "enableMultiDraw", o.mEnableMultiDraw);
+  cs::core::Settings::serialize(j, "maxConcurrentRequests", o.mMaxConcurrentRequests);
   cs::core::Settings::serialize(j, "bodies", o.mBodies);
 }
 
@@ -388,6 +408,48 @@ void Plugin::init() {
     }
   });
 
+  mPluginSettings->mPackMapCache.connect([this](bool val) {
+    for (auto&& body : mLodBodies) {
+      auto src =
+          std::dynamic_pointer_cast<TileSourceWebMapService>(body.second->getDEMtileSource());
+      if (src) {
+        src->setUseCachePack(val);
+      }
+      src = std::dynamic_pointer_cast<TileSourceWebMapService>(body.second->getIMGtileSource());
+      if (src) {
+        src->setUseCachePack(val);
+      }
+    }
+  });
+
+  mPluginSettings->mDecodedTileCache.connect([this](bool val) {
+    for (auto&& body : mLodBodies) {
+      auto src =
+          std::dynamic_pointer_cast<TileSourceWebMapService>(body.second->getDEMtileSource());
+      if (src) {
+        src->setUseDecodedCache(val);
+      }
+      src = std::dynamic_pointer_cast<TileSourceWebMapService>(body.second->getIMGtileSource());
+      if (src) {
+        src->setUseDecodedCache(val);
+      }
+    }
+  });
+
+  mPluginSettings->mMaxConcurrentRequests.connect([this](uint32_t val) {
+    for (auto&& body : mLodBodies) {
+      auto src =
+          std::dynamic_pointer_cast<TileSourceWebMapService>(body.second->getDEMtileSource());
+      if (src) {
+        src->setMaxConcurrentRequests(val);
+      }
+      src = std::dynamic_pointer_cast<TileSourceWebMapService>(body.second->getIMGtileSource());
+      if (src) {
+        src->setMaxConcurrentRequests(val);
+      }
+    }
+  });
+
   onLoad();
 
   logger().info("Loading done.");
@@ -464,9 +526,10 @@ void Plugin::onLoad() {
 
   // For now, we cannot re-create the GLResources.
   if (!mGLResources) {
-    mGLResources =
-        std::make_shared<csp::lodbodies::GLResources>(mPluginSettings->mMaxGPUTilesDEM.get(),
-            mPluginSettings->mMaxGPUTilesGray.get(), mPluginSettings->mMaxGPUTilesColor.get());
+    mGLResources = std::make_shared<csp::lodbodies::GLResources>(
+        mPluginSettings->mMaxGPUTilesDEM.get(), mPluginSettings->mMaxGPUTilesGray.get(),
+        mPluginSettings->mMaxGPUTilesColor.get(),
+        static_cast<std::size_t>(mPluginSettings->mMaxGPUTileMemory.get()) * 1024 * 1024);
 
     mPluginSettings->mMaxGPUTilesColor.connect([](uint32_t /*val*/) {
       logger().warn("Changing the maximum number of allocated color tiles at run-time is not "
@@ -482,6 +545,11 @@ void Plugin::onLoad() {
       logger().warn("Changing the maximum number of allocated elevation tiles at run-time is not "
                     "supported. Please restart CosmoScout VR!");
     });
+
+    mPluginSettings->mMaxGPUTileMemory.connect([](uint32_t /*val*/) {
+      logger().warn("Changing the maximum GPU memory for tiles at run-time is not supported. "
+                    "Please restart CosmoScout VR!");
+    });
   }
 
   // First try to re-configure existing lodBodies. We assume that they are similar if they have
@@ -555,6 +623,32 @@ Plugin::Settings::Body& Plugin::getBodySettings(std::shared_ptr<LodBody> const&
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+std::shared_ptr<TileSource> Plugin::createTileSource(Settings::Dataset const& dataset) const {
+  // Local files are read directly, without a map server.
+  std::string const fileScheme = "file://";
+
+  if (dataset.mURL.rfind(fileScheme, 0) == 0) {
+    auto source = std::make_shared<TileSourceGeoTIFF>();
+    source->setFile(dataset.mURL.substr(fileScheme.size()));
+    source->setMaxLevel(dataset.mMaxLevel);
+    source->setDataType(dataset.mFormat);
+    return source;
+  }
+
+  auto source =
+      std::make_shared<TileSourceWebMapService>(mPluginSettings->mMaxConcurrentRequests.get());
+  source->setCacheDirectory(mPluginSettings->mMapCache.get());
+  source->setUseCachePack(mPluginSettings->mPackMapCache.get());
+  source->setUseDecodedCache(mPluginSettings->mDecodedTileCache.get());
+  source->setMaxLevel(dataset.mMaxLevel);
+  source->setLayers(dataset.mLayers);
+  source->setUrl(dataset.mURL);
+  source->setDataType(dataset.mFormat);
+  return source;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Plugin::setImageSource(std::shared_ptr<LodBody> const& body, std::string const& name) const {
   auto& settings = getBodySettings(body);
 
@@ -573,14 +667,7 @@ void Plugin::setImageSource(std::shared_ptr<LodBody> const& body, std::string co
 
     settings.mActiveImgDataset = dataset->first;
 
-    auto source = std::make_shared<TileSourceWebMapService>();
-    source->setCacheDirectory(mPluginSettings->mMapCache.get());
-    source->setMaxLevel(dataset->second.mMaxLevel);
-    source->setLayers(dataset->second.mLayers);
-    source->setUrl(dataset->second.mURL);
-    source->setDataType(dataset->second.mFormat);
-
-    body->setIMGtileSource(source);
+    body->setIMGtileSource(createTileSource(dataset->second));
 
     mGuiManager->getGui()->callJavascript(
         "CosmoScout.lodBodies.setMapDataCopyright", dataset->second.mCopyright);
@@ -603,14 +690,7 @@ void Plugin::setElevationSource(
 
   settings.mActiveDemDataset = dataset->first;
 
-  auto source = std::make_shared<TileSourceWebMapService>();
-  source->setCacheDirectory(mPluginSettings->mMapCache.get());
-  source->setMaxLevel(dataset->second.mMaxLevel);
-  source->setLayers(dataset->second.mLayers);
-  source->setUrl(dataset->second.mURL);
-  source->setDataType(dataset->second.mFormat);
-
-  body->setDEMtileSource(source);
+  body->setDEMtileSource(createTileSource(dataset->second));
 
   mGuiManager->getGui()->callJavascript(
       "CosmoScout.lodBodies.setElevationDataCopyright", dataset->second.mCopyright);
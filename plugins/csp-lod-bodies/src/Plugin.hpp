@@ -11,6 +11,7 @@
 #include "../../../src/cs-utils/DefaultProperty.hpp"
 
 #include "TileDataType.hpp"
+#include "TileSourceGeoTIFF.hpp"
 #include "TileSourceWebMapService.hpp"
 
 #include <glm/gtc/constants.hpp>
@@ -45,6 +46,20 @@ class Plugin : public cs::core::PluginBase {
     /// rendering performance.
     cs::utils::DefaultProperty<bool> mAutoLOD{true};
 
+    /// The number of threads each body uses for selecting the tiles to load and to draw. The tile
+    /// trees of the 12 HEALPix base patches are processed in parallel, so more than 12 threads
+    /// have no effect.
+    cs::utils::DefaultProperty<uint32_t> mLODThreadCount{4};
+
+    /// If enabled, the visibility and refinement decisions of previous frames are reused while the
+    /// observer moves only slightly. Then only tiles close to the current level-of-detail cut have
+    /// to be tested again.
+    cs::utils::DefaultProperty<bool> mEnableIncrementalLOD{true};
+
+    /// If enabled, the tiles for the view at the end of observer animations or a short time ahead
+    /// of fast observer movements are requested in addition to the currently visible ones.
+    cs::utils::DefaultProperty<bool> mEnablePrefetching{true};
+
     /// A multiplier for the brightness of the image channel.
     cs::utils::DefaultProperty<float> mTextureGamma{1.F};
 
@@ -86,21 +101,54 @@ class Plugin : public cs::core::PluginBase {
     /// be updated anymore.
     cs::utils::DefaultProperty<bool> mEnableTilesFreeze{false};
 
-    /// The maximum allowed colored tiles.
+    /// The number of colored tiles for which GPU memory is allocated initially. More memory is
+    /// allocated on demand in chunks of the same size, up to mMaxGPUTileMemory.
     cs::utils::DefaultProperty<uint32_t> mMaxGPUTilesColor{512};
 
-    /// The maximum allowed gray tiles.
+    /// The number of gray tiles for which GPU memory is allocated initially.
     cs::utils::DefaultProperty<uint32_t> mMaxGPUTilesGray{512};
 
-    /// The maximum allowed elevation tiles.
+    /// The number of elevation tiles for which GPU memory is allocated initially.
     cs::utils::DefaultProperty<uint32_t> mMaxGPUTilesDEM{512};
 
+    /// The maximum amount of GPU memory in MB used for each of the three tile types. Once this is
+    /// reached, the least recently used tiles are removed from the GPU to make room for new ones.
+    cs::utils::DefaultProperty<uint32_t> mMaxGPUTileMemory{1024};
+
     /// Path to the map cache folder, can be absolute or relative to the cosmoscout executable.
     cs::utils::DefaultProperty<std::string> mMapCache{"map-cache"};
 
+    /// If set to true, all tiles are stored in a single file in the map cache folder instead of one
+    /// file per tile. Use the csp-lod-bodies-pack-cache tool to convert an existing cache.
+    cs::utils::DefaultProperty<bool> mPackMapCache{false};
+
+    /// If set to true, processed tiles are additionally stored uncompressed in the map cache
+    /// folder. This makes loading previously visited tiles much faster but requires about ten times
+    /// more disc space.
+    cs::utils::DefaultProperty<bool> mDecodedTileCache{false};
+
+    /// The amount of memory in MB which each body may use per data set for keeping tiles which
+    /// have been removed from the tile tree recently. When the observer returns to such an area,
+    /// the tiles do not have to be loaded again.
+    cs::utils::DefaultProperty<uint32_t> mTileCacheSize{256};
+
+    /// The time in milliseconds each body may spend per frame and data set on uploading tiles to
+    /// the GPU. At least one tile is uploaded per frame, regardless of this value.
+    cs::utils::DefaultProperty<float> mTileUploadBudget{1.F};
+
+    /// If set to true, all tiles of a body are drawn with a single indirect draw call. This
+    /// requires OpenGL 4.3, on older hardware the tiles are drawn one by one.
+    cs::utils::DefaultProperty<bool> mEnableMultiDraw{true};
+
+    /// The maximum number of HTTP requests which are sent to the map server at the same time for
+    /// each data set. Connections to the server are reused for subsequent requests. This is also
+    /// the number of threads loading the tiles of a data set, so raising it only takes effect for
+    /// data sets which are selected afterwards.
+    cs::utils::DefaultProperty<uint32_t> mMaxConcurrentRequests{32};
+
     /// A single data set containing either elevation or image data.
     struct Dataset {
-      std::string  mURL;        ///< The URL of the mapserver including the "SERVICE=wms" parameter.
+      std::string  mURL;        ///< The URL of the mapserver or "file://" and a GeoTIFF file.
       TileDataType mFormat;     ///< In the config either "Float32", "UInt8" or "U8Vec3".
       std::string  mCopyright;  ///< The copyright holder of the data set (also shown in the UI).
       std::string  mLayers;     ///< A comma,seperated list of WMS layers.
@@ -127,6 +175,9 @@ class Plugin : public cs::core::PluginBase {
   void onLoad();
 
   Settings::Body& getBodySettings(std::shared_ptr<LodBody> const& body) const;
+
+  /// Creates a TileSourceGeoTIFF for "file://" URLs and a TileSourceWebMapService otherwise.
+  std::shared_ptr<TileSource> createTileSource(Settings::Dataset const& dataset) const;
   void setImageSource(std::shared_ptr<LodBody> const& body, std::string const& name) const;
   void setElevationSource(std::shared_ptr<LodBody> const& body, std::string const& name) const;
 
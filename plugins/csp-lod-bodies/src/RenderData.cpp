@@ -6,6 +6,7 @@
 
 #include "RenderData.hpp"
 
+#include "TileAgeList.hpp"
 #include "TileNode.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -15,7 +16,11 @@ namespace csp::lodbodies {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /* virtual */
-RenderData::~RenderData() = default;
+RenderData::~RenderData() {
+  if (mAgeList) {
+    mAgeList->remove(this);
+  }
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -105,6 +110,10 @@ int RenderData::getLastFrame() const {
 
 void RenderData::setLastFrame(int frame) {
   mLastFrame = frame;
+
+  if (mAgeList) {
+    mAgeList->touch(this);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -115,4 +124,16 @@ int RenderData::getAge(int frame) const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+RenderData::LODDecision const& RenderData::getLODDecision(std::size_t slot) const {
+  return mLODDecisions.at(slot);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderData::setLODDecision(std::size_t slot, LODDecision const& decision) {
+  mLODDecisions.at(slot) = decision;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace csp::lodbodies
@@ -11,10 +11,14 @@
 #include "TileId.hpp"
 #include "TileNode.hpp"
 
+#include <array>
 #include <boost/noncopyable.hpp>
+#include <cstddef>
 
 namespace csp::lodbodies {
 
+class TileAgeList;
+
 /// The base class for all render data of a single TileNode.
 class RenderData : private boost::noncopyable {
  public:
@@ -35,6 +39,9 @@ class RenderData : private boost::noncopyable {
   int  getTexLayer() const;
   void setTexLayer(int layer);
 
+  /// The frame in which the node has been used last. If the RenderData is stored in a TileAgeList,
+  /// setting the frame updates its position there. As TileAgeList is not thread-safe, this must
+  /// not be called concurrently for RenderData of the same TreeManagerBase.
   int  getLastFrame() const;
   void setLastFrame(int frame);
   int  getAge(int frame) const;
@@ -44,15 +51,56 @@ class RenderData : private boost::noncopyable {
   void                       removeBounds();
   bool                       hasBounds() const;
 
+  /// Results of the visibility and refinement tests the LODVisitor made for this tile. In
+  /// incremental mode, these are reused in later frames as long as the observer does not move or
+  /// turn further than the stored tolerances allow. One decision is stored for each of the last
+  /// sNumLODDecisionSlots projections, so that views which alternate in every frame (e.g. the two
+  /// eyes of a stereo setup) do not invalidate each other's decisions.
+  static std::size_t const sNumLODDecisionSlots = 2;
+
+  struct LODDecision {
+    int mGeneration = -1; ///< Incremented by the LODVisitor whenever all decisions become invalid.
+    int mBoundsLevel{};   ///< Level of the DEM tile whose heights were used for the bounds.
+
+    bool   mVisible{};
+    bool   mNeedRefine{};
+    double mPriority{};
+
+    glm::dvec3 mCamPos{}; ///< Observer position and orientation at the time of the tests.
+    glm::dvec3 mViewDir{};
+    glm::dvec3 mUpDir{};
+
+    /// The distance the observer may move before the refinement test has to be repeated.
+    double mDistanceTolerance{};
+
+    /// The distance the bounding box may move relative to the frustum planes before the
+    /// visibility test has to be repeated. mFarDistance is the distance to the farthest corner of
+    /// the bounding box, it is used to estimate this movement for rotations of the observer.
+    double mFrustumTolerance{};
+    double mFarDistance{};
+  };
+
+  LODDecision const& getLODDecision(std::size_t slot) const;
+  void               setLODDecision(std::size_t slot, LODDecision const& decision);
+
  protected:
   explicit RenderData(TileNode* node = nullptr);
   BoundingBox<double> mTb;
   bool                mHasBounds{};
 
  private:
-  TileNode* mNode{};
-  int       mTexLayer{};
-  int       mLastFrame{};
+  TileNode*                                     mNode{};
+  int                                           mTexLayer{};
+  int                                           mLastFrame{};
+  std::array<LODDecision, sNumLODDecisionSlots> mLODDecisions;
+
+  // The links of the TileAgeList which contains this.
+  TileAgeList* mAgeList{};
+  RenderData*  mOlder{};
+  RenderData*  mNewer{};
+  int          mAgeLevel{};
+
+  friend class TileAgeList;
 };
 
 } // namespace csp::lodbodies
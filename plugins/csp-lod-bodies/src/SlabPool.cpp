@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SlabPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The number of completely empty slabs which are kept instead of being returned to the system.
+std::size_t const MaxEmptySlabs = 1;
+
+// Each free block stores the pointer to the next free block of its slab in its first bytes.
+void* getNext(void* block) {
+  void* next = nullptr;
+  std::memcpy(&next, block, sizeof(void*));
+  return next;
+}
+
+void setNext(void* block, void* next) {
+  std::memcpy(block, &next, sizeof(void*));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t SlabPool::Stats::getReservedBytes() const {
+  return mCapacity * mBlockSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* explicit */
+SlabPool::SlabPool(std::size_t blockSize, std::size_t slabSize)
+    : mBlockSize(((std::max(blockSize, sizeof(void*)) + alignof(std::max_align_t) - 1) /
+                     alignof(std::max_align_t)) *
+                 alignof(std::max_align_t))
+    , mBlocksPerSlab(std::max<std::size_t>(1, slabSize / mBlockSize)) {
+  mStats.mBlockSize = mBlockSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SlabPool::~SlabPool() {
+  assert(mStats.mUsed == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void* SlabPool::allocate() {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  Slab* slab = mAvailable.empty() ? createSlab() : mAvailable.back();
+
+  void* block = nullptr;
+
+  if (slab->mFree) {
+    block       = slab->mFree;
+    slab->mFree = getNext(block);
+  } else {
+    block = &slab->mMemory[slab->mUntouched * mBlockSize];
+    ++slab->mUntouched;
+  }
+
+  if (slab->mUsed == 0) {
+    --mEmptySlabs;
+  }
+
+  ++slab->mUsed;
+
+  if (slab->mUsed == mBlocksPerSlab) {
+    mAvailable.pop_back();
+  }
+
+  ++mStats.mUsed;
+  ++mStats.mAllocations;
+  mStats.mPeakUsed = std::max(mStats.mPeakUsed, mStats.mUsed);
+
+  return block;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SlabPool::deallocate(void* block) {
+  if (block == nullptr) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // The slab of the block is the one with the largest start address not above the block.
+  auto it = mSlabs.upper_bound(static_cast<std::byte const*>(block));
+  assert(it != mSlabs.begin());
+  --it;
+
+  Slab* slab = it->second.get();
+  assert(slab->mUsed > 0);
+
+  if (slab->mUsed == mBlocksPerSlab) {
+    mAvailable.push_back(slab);
+  }
+
+  setNext(block, slab->mFree);
+  slab->mFree = block;
+
+  --slab->mUsed;
+  --mStats.mUsed;
+
+  if (slab->mUsed == 0 && ++mEmptySlabs > MaxEmptySlabs) {
+    releaseSlab(slab);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t SlabPool::getBlockSize() const {
+  return mBlockSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t SlabPool::getBlocksPerSlab() const {
+  return mBlocksPerSlab;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SlabPool::Stats SlabPool::getStats() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mStats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SlabPool::Slab* SlabPool::createSlab() {
+  // The memory is not initialized and the blocks are not linked to the free list before they are
+  // used, so that the operating system only maps the pages which are actually needed.
+  auto slab = std::make_unique<Slab>();
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+  slab->mMemory.reset(new std::byte[mBlockSize * mBlocksPerSlab]);
+
+  Slab* result = slab.get();
+  mSlabs.emplace(result->mMemory.get(), std::move(slab));
+  mAvailable.push_back(result);
+
+  ++mEmptySlabs;
+  ++mStats.mSlabCount;
+  mStats.mCapacity += mBlocksPerSlab;
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SlabPool::releaseSlab(Slab* slab) {
+  assert(slab->mUsed == 0);
+
+  mAvailable.erase(std::find(mAvailable.begin(), mAvailable.end(), slab));
+
+  --mEmptySlabs;
+  --mStats.mSlabCount;
+  mStats.mCapacity -= mBlocksPerSlab;
+
+  mSlabs.erase(slab->mMemory.get());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_SLABPOOL_HPP
+#define CSP_LOD_BODIES_SLABPOOL_HPP
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// A pool allocator for blocks of one fixed size. Memory is requested from the system in slabs of
+/// several blocks, freed blocks are kept in a free list of their slab and handed out again.
+///
+/// Tiles are all of the same few sizes and are created and destroyed all the time while the
+/// observer moves. Allocating them from a pool keeps them from fragmenting the heap, so that the
+/// memory usage of the application stays flat over long sessions. Slabs which become completely
+/// empty are returned to the system, except for a single spare one which avoids allocating and
+/// freeing a slab over and over again when the number of tiles oscillates around a slab boundary.
+///
+/// The blocks are aligned to alignof(std::max_align_t). This class is thread-safe.
+class SlabPool {
+ public:
+  /// Occupancy statistics of a pool.
+  struct Stats {
+    /// The size of each block in bytes, this may be larger than the requested block size.
+    std::size_t mBlockSize = 0;
+
+    /// The number of slabs currently allocated from the system.
+    std::size_t mSlabCount = 0;
+
+    /// The number of blocks in all slabs.
+    std::size_t mCapacity = 0;
+
+    /// The number of blocks currently in use.
+    std::size_t mUsed = 0;
+
+    /// The largest number of blocks which have been in use at the same time.
+    std::size_t mPeakUsed = 0;
+
+    /// The total number of allocations since the creation of the pool.
+    std::size_t mAllocations = 0;
+
+    /// The number of bytes currently allocated from the system.
+    std::size_t getReservedBytes() const;
+  };
+
+  /// Creates a pool for blocks of blockSize bytes. Each slab contains as many blocks as fit into
+  /// slabSize bytes, but at least one.
+  explicit SlabPool(std::size_t blockSize, std::size_t slabSize = 2 * 1024 * 1024);
+
+  SlabPool(SlabPool const& other) = delete;
+  SlabPool(SlabPool&& other)      = delete;
+
+  SlabPool& operator=(SlabPool const& other) = delete;
+  SlabPool& operator=(SlabPool&& other) = delete;
+
+  /// All blocks must have been deallocated before the pool is destroyed.
+  ~SlabPool();
+
+  /// Returns an uninitialized block. Throws std::bad_alloc if no new slab can be allocated.
+  void* allocate();
+
+  /// Returns a block to the pool. The block must have been allocated from this pool. Passing
+  /// nullptr does nothing.
+  void deallocate(void* block);
+
+  std::size_t getBlockSize() const;
+  std::size_t getBlocksPerSlab() const;
+
+  Stats getStats() const;
+
+ private:
+  struct Slab {
+    std::unique_ptr<std::byte[]> mMemory;
+
+    /// Blocks which have been deallocated, linked through their first bytes.
+    void* mFree = nullptr;
+
+    /// The blocks starting at this index have never been used.
+    std::size_t mUntouched = 0;
+
+    std::size_t mUsed = 0;
+  };
+
+  /// Allocates a new empty slab and adds it to mAvailable.
+  Slab* createSlab();
+
+  /// Removes the given empty slab from mAvailable and returns its memory to the system.
+  void releaseSlab(Slab* slab);
+
+  std::size_t const mBlockSize;
+  std::size_t const mBlocksPerSlab;
+
+  mutable std::mutex mMutex;
+
+  /// All slabs, sorted by the address of their memory to find the slab of a block.
+  std::map<std::byte const*, std::unique_ptr<Slab>> mSlabs;
+
+  /// Slabs with at least one free block.
+  std::vector<Slab*> mAvailable;
+
+  std::size_t mEmptySlabs = 0;
+  Stats       mStats;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_SLABPOOL_HPP
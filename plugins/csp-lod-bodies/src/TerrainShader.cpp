@@ -17,6 +17,35 @@ namespace csp::lodbodies {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+// Replaces the version directive of the given shader source with "#version 430" (required for
+// shader storage buffers) and adds the defines which make VistaPlanetTerrainShaderUniforms.glsl
+// read the per-tile parameters from the tile buffer.
+void addMultiDrawDefines(std::string& source, bool isVertexShader) {
+  std::string defines = "#version 430\n#define VP_MULTI_DRAW\n";
+
+  if (isVertexShader) {
+    defines += "#define VP_VERTEX_SHADER\n";
+  }
+
+  std::size_t start = source.find("#version");
+
+  if (start == std::string::npos) {
+    source.insert(0, defines);
+    return;
+  }
+
+  std::size_t end = source.find('\n', start);
+  end             = end == std::string::npos ? source.size() : end + 1;
+
+  source.replace(start, end - start, defines);
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 TerrainShader::TerrainShader(std::string vertexSource, std::string fragmentSource)
     : mVertexSource(std::move(vertexSource))
     , mFragmentSource(std::move(fragmentSource)) {
@@ -41,6 +70,21 @@ void TerrainShader::release() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TerrainShader::setMultiDraw(bool enable) {
+  if (mMultiDraw != enable) {
+    mMultiDraw   = enable;
+    mShaderDirty = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TerrainShader::getMultiDraw() const {
+  return mMultiDraw;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TerrainShader::compile() {
   VistaShaderRegistry& reg = VistaShaderRegistry::GetInstance();
 
@@ -54,6 +98,11 @@ void TerrainShader::compile() {
   cs::utils::replaceString(mFragmentSource, "$VP_TERRAIN_SHADER_UNIFORMS",
       reg.RetrieveShader("VistaPlanetTerrainShaderUniforms.glsl"));
 
+  if (mMultiDraw) {
+    addMultiDrawDefines(mVertexSource, true);
+    addMultiDrawDefines(mFragmentSource, false);
+  }
+
   mShader = VistaGLSLShader();
   mShader.InitVertexShaderFromString(mVertexSource);
   mShader.InitFragmentShaderFromString(mFragmentSource);
@@ -31,12 +31,19 @@ class TerrainShader {
   virtual void bind();
   virtual void release();
 
+  /// If enabled, the shader reads the per-tile parameters from a shader storage buffer instead of
+  /// uniforms so that all tiles can be drawn with a single call. This requires OpenGL 4.3, the
+  /// shader is recompiled on the next bind() if the value changes.
+  void setMultiDraw(bool enable);
+  bool getMultiDraw() const;
+
   friend class TileRenderer;
 
  protected:
   virtual void compile();
 
   bool            mShaderDirty = true;
+  bool            mMultiDraw   = false;
   std::string     mVertexSource;
   std::string     mFragmentSource;
   VistaGLSLShader mShader;
@@ -17,6 +17,16 @@ TestTileVisitor::TestTileVisitor(TileQuadTree* treeDEM, TileQuadTree* treeIMG)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TestTileVisitor::setMaxLevel(int level) {
+  mMaxLevel = level;
+}
+
+int TestTileVisitor::getMaxLevel() const {
+  return mMaxLevel;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 std::vector<TileId> const& TestTileVisitor::getLoadTilesDEM() const {
   return mLoadTilesDEM;
 }
@@ -48,7 +58,7 @@ bool TestTileVisitor::preVisitRoot(TileId const& tileId) {
     result = false;
   }
 
-  if (!nodeIMG) {
+  if (mTreeIMG && !nodeIMG) {
     mLoadTilesIMG.push_back(tileId);
     result = false;
   }
@@ -78,9 +88,18 @@ bool TestTileVisitor::visitLevel(TileId const& tileId) {
   bool refine = refineTile();
 
   if (refine) {
+    // Only children which are not in the trees yet have to be loaded.
+    TileNode* nodeDEM = getNodeDEM();
+    TileNode* nodeIMG = getNodeIMG();
+
     for (int i = 0; i < 4; ++i) {
-      mLoadTilesDEM.push_back(HEALPix::getChildTileId(tileId, i));
-      mLoadTilesIMG.push_back(HEALPix::getChildTileId(tileId, i));
+      if (!nodeDEM || !nodeDEM->getChild(i)) {
+        mLoadTilesDEM.push_back(HEALPix::getChildTileId(tileId, i));
+      }
+
+      if (mTreeIMG && (!nodeIMG || !nodeIMG->getChild(i))) {
+        mLoadTilesIMG.push_back(HEALPix::getChildTileId(tileId, i));
+      }
     }
 
     result = refine;
@@ -92,7 +111,7 @@ bool TestTileVisitor::visitLevel(TileId const& tileId) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool TestTileVisitor::refineTile() {
-  return getLevel() < 2;
+  return getLevel() < mMaxLevel;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -14,11 +14,18 @@
 
 namespace csp::lodbodies {
 
-/// DocTODO it isn't used anywhere...
+/// A minimal visitor which refines all tiles up to a fixed level, regardless of any view. It
+/// collects the tiles which are missing in the trees, so that a test can load them, insert them
+/// and traverse again until the trees are complete. Together with TileSourceProcedural, this can
+/// be used to build tile trees without network access.
 class TestTileVisitor : public TileVisitor<TestTileVisitor> {
  public:
   explicit TestTileVisitor(TileQuadTree* treeDEM, TileQuadTree* treeIMG = NULL);
 
+  /// Tiles are refined until they reach this level. The default is 2.
+  void setMaxLevel(int level);
+  int  getMaxLevel() const;
+
   std::vector<TileId> const& getLoadTilesDEM() const;
   std::vector<TileId> const& getLoadTilesIMG() const;
 
@@ -34,6 +41,7 @@ class TestTileVisitor : public TileVisitor<TestTileVisitor> {
 
   std::vector<TileId> mLoadTilesDEM;
   std::vector<TileId> mLoadTilesIMG;
+  int                 mMaxLevel = 2;
 
   friend class TileVisitor<TestTileVisitor>;
 };
@@ -28,6 +28,11 @@ class Tile : public TileBase {
 
   ~Tile() override;
 
+  /// Tiles are allocated from the SlabPool of their data type, see TileBase::getPool(). Classes
+  /// derived from Tile<T> have a different size and use the global operator new instead.
+  static void* operator new(std::size_t size);
+  static void  operator delete(void* block, std::size_t size);
+
   static std::type_info const& getStaticTypeId();
   static TileDataType          getStaticDataType();
 
@@ -78,6 +83,25 @@ Tile<T>::Tile(int level, glm::int64 patchIdx)
 template <typename T>
 Tile<T>::~Tile() = default;
 
+template <typename T>
+void* Tile<T>::operator new(std::size_t size) {
+  if (size != sizeof(Tile<T>)) {
+    return ::operator new(size);
+  }
+
+  return getPool(getStaticDataType()).allocate();
+}
+
+template <typename T>
+void Tile<T>::operator delete(void* block, std::size_t size) {
+  if (size != sizeof(Tile<T>)) {
+    ::operator delete(block);
+    return;
+  }
+
+  getPool(getStaticDataType()).deallocate(block);
+}
+
 template <typename T>
 std::type_info const& Tile<T>::getStaticTypeId() {
   return typeid(T);
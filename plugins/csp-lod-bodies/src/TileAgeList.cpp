@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileAgeList.hpp"
+
+#include "RenderData.hpp"
+
+#include <cassert>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileAgeList::~TileAgeList() {
+  clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileAgeList::insert(RenderData* rdata, int level) {
+  assert(rdata->mAgeList == nullptr);
+  assert(level >= 0 && level < sNumLevels);
+
+  rdata->mAgeList  = this;
+  rdata->mAgeLevel = level;
+  link(rdata);
+  ++mSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileAgeList::remove(RenderData* rdata) {
+  if (rdata->mAgeList != this) {
+    return;
+  }
+
+  unlink(rdata);
+  rdata->mAgeList = nullptr;
+  --mSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileAgeList::touch(RenderData* rdata) {
+  assert(rdata->mAgeList == this);
+
+  // Nothing to do if the RenderData is still the newest element.
+  if (rdata->mNewer == nullptr &&
+      (rdata->mOlder == nullptr || rdata->mOlder->mLastFrame <= rdata->mLastFrame)) {
+    return;
+  }
+
+  unlink(rdata);
+  link(rdata);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RenderData* TileAgeList::getOldest(int minLevel) const {
+  RenderData* result = nullptr;
+
+  // Iterate from the highest level, so that it wins in case of a tie.
+  for (int level = sNumLevels - 1; level >= minLevel; --level) {
+    RenderData* oldest = mLists.at(level).mOldest;
+
+    if (oldest && (!result || oldest->mLastFrame < result->mLastFrame)) {
+      result = oldest;
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileAgeList::clear() {
+  for (auto& list : mLists) {
+    for (RenderData* rdata = list.mOldest; rdata;) {
+      RenderData* newer = rdata->mNewer;
+
+      rdata->mAgeList = nullptr;
+      rdata->mOlder   = nullptr;
+      rdata->mNewer   = nullptr;
+
+      rdata = newer;
+    }
+
+    list = List();
+  }
+
+  mSize = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileAgeList::size() const {
+  return mSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileAgeList::link(RenderData* rdata) {
+  List& list = mLists.at(rdata->mAgeLevel);
+
+  // Usually the RenderData has just been used, so the loop does not run at all.
+  RenderData* older = list.mNewest;
+  while (older && older->mLastFrame > rdata->mLastFrame) {
+    older = older->mOlder;
+  }
+
+  RenderData* newer = older ? older->mNewer : list.mOldest;
+
+  rdata->mOlder = older;
+  rdata->mNewer = newer;
+
+  (older ? older->mNewer : list.mOldest) = rdata;
+  (newer ? newer->mOlder : list.mNewest) = rdata;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileAgeList::unlink(RenderData* rdata) {
+  List& list = mLists.at(rdata->mAgeLevel);
+
+  (rdata->mOlder ? rdata->mOlder->mNewer : list.mOldest) = rdata->mNewer;
+  (rdata->mNewer ? rdata->mNewer->mOlder : list.mNewest) = rdata->mOlder;
+
+  rdata->mOlder = nullptr;
+  rdata->mNewer = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
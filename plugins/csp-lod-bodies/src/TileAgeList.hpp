@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILEAGELIST_HPP
+#define CSP_LOD_BODIES_TILEAGELIST_HPP
+
+#include <array>
+#include <cstddef>
+
+namespace csp::lodbodies {
+
+class RenderData;
+
+/// Keeps RenderData ordered by the frame in which it has been used last, so that TreeManagerBase
+/// can find the nodes to prune without sorting all of them.
+///
+/// There is one intrusive, doubly linked list per tile level; the links are stored in the
+/// RenderData itself. Whenever RenderData::setLastFrame() is called, the data is moved towards the
+/// end of its list. As the frame count only increases, this is usually the very end, so marking a
+/// node as used costs O(1). Finding the oldest node only has to look at the first element of each
+/// list.
+///
+/// This class is not thread-safe.
+class TileAgeList {
+ public:
+  /// The number of levels supported by HEALPix.
+  static int const sNumLevels = 20;
+
+  TileAgeList() = default;
+
+  TileAgeList(TileAgeList const& other) = delete;
+  TileAgeList(TileAgeList&& other)      = delete;
+
+  TileAgeList& operator=(TileAgeList const& other) = delete;
+  TileAgeList& operator=(TileAgeList&& other) = delete;
+
+  /// Removes all RenderData, see clear().
+  ~TileAgeList();
+
+  /// Adds the given RenderData to the list of the given level. Its position is determined by its
+  /// last frame, so this should be set before. The RenderData must not be in any list already.
+  void insert(RenderData* rdata, int level);
+
+  /// Removes the given RenderData from its list. Does nothing if it is not in this list.
+  void remove(RenderData* rdata);
+
+  /// Moves the given RenderData to the position matching its last frame. This is called by
+  /// RenderData::setLastFrame().
+  void touch(RenderData* rdata);
+
+  /// Returns the RenderData with the oldest last frame of all levels in [minLevel, sNumLevels).
+  /// Of those with the same last frame, the one with the highest level is returned. Hence children
+  /// are always returned before their parents, if they have not been used after them. Returns
+  /// nullptr if there is no RenderData in these levels.
+  RenderData* getOldest(int minLevel = 0) const;
+
+  /// Removes all RenderData from the lists. The RenderData itself is not deleted.
+  void clear();
+
+  /// Returns the number of RenderData in all lists.
+  std::size_t size() const;
+
+ private:
+  struct List {
+    RenderData* mOldest{};
+    RenderData* mNewest{};
+  };
+
+  /// Inserts the RenderData into the list of its mAgeLevel, searching from the newest element.
+  void link(RenderData* rdata);
+
+  /// Removes the RenderData from the list of its mAgeLevel.
+  void unlink(RenderData* rdata);
+
+  std::array<List, sNumLevels> mLists;
+  std::size_t                  mSize = 0;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILEAGELIST_HPP
@@ -0,0 +1,203 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileAssembler.hpp"
+
+#include "DecodedTileCache.hpp"
+#include "HEALPix.hpp"
+#include "TileNode.hpp"
+#include "TileSourceWebMapService.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum class CopyPixels { eAboveDiagonal, eBelowDiagonal };
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Reads a map tile and copies the pixels above or below its diagonal to the tile.
+template <typename T>
+bool readHalf(ReadMapTile const& read, Tile<T>* tile, int level, int x, int y, CopyPixels which) {
+  auto pixels = std::make_unique<typename Tile<T>::Storage>();
+
+  if (!read(level, x, y, pixels->data())) {
+    return false;
+  }
+
+  for (int row = 0; row < 257; ++row) {
+    int offset = 257 * row;
+    int count  = 257 - row - 1;
+
+    if (which == CopyPixels::eBelowDiagonal) {
+      offset = 257 * row + (257 - row);
+      count  = row;
+    }
+
+    std::copy_n(pixels->begin() + offset, count, tile->data().begin() + offset);
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+void fillDiagonal(TileNode* node) {
+  auto tile = static_cast<Tile<T>*>(node->getTile());
+  for (int y = 1; y <= 257; y++) {
+    int pixelPos           = y * (257 - 1);
+    tile->data()[pixelPos] = (y < 257) ? tile->data()[pixelPos - 1] : tile->data()[pixelPos + 1];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+std::unique_ptr<TileNode> assembleImpl(int level, glm::int64 patchIdx, uint32_t maxLevel,
+    ReadMapTile const& read, std::shared_ptr<DecodedTileCache> const& decodedCache,
+    cs::utils::CancellationToken const* token) {
+  if (token && token->isCancelled()) {
+    return nullptr;
+  }
+
+  auto node = std::make_unique<TileNode>();
+
+  node->setTile(std::make_unique<Tile<T>>(level, patchIdx));
+  node->setChildMaxLevel(std::min(static_cast<uint32_t>(level) + 1, maxLevel));
+
+  auto* tile = static_cast<Tile<T>*>(node->getTile());
+
+  // If the tile has been loaded before, we can skip decoding and all post-processing below.
+  if (decodedCache && decodedCache->read(*tile)) {
+    return node;
+  }
+
+  int  x{};
+  int  y{};
+  bool onDiag = TileSourceWebMapService::getXY(level, patchIdx, x, y);
+  if (onDiag) {
+    if (!readHalf<T>(read, tile, level, x, y, CopyPixels::eBelowDiagonal)) {
+      return nullptr;
+    }
+
+    // The first download may have taken a while, skip the second one if the tile is not needed
+    // anymore.
+    if (token && token->isCancelled()) {
+      return nullptr;
+    }
+
+    x += 4 * (1 << level);
+    y -= 4 * (1 << level);
+
+    if (!readHalf<T>(read, tile, level, x, y, CopyPixels::eAboveDiagonal)) {
+      return nullptr;
+    }
+
+    fillDiagonal<T>(node.get());
+  } else {
+    if (!read(level, x, y, tile->data().data())) {
+      return nullptr;
+    }
+  }
+
+  // TODO: the NE and NW edges of all tiles should contain the values of the
+  // respective neighbours (for tile stiching). This is done by increasing the
+  // bounding box of the request by one pixel - this works more or less in the
+  // general case, but it doesn't when we are at a base patch border of the
+  // northern hemisphere. In this case we will get empty pixels! Therefore we
+  // fill the last column and row by copying.
+  // The proper solution would load the real neighbouring tiles and copy the
+  // pixel values!
+
+  glm::i64vec3 baseXY = HEALPix::getBaseXY(TileId(level, patchIdx));
+  glm::int64   nSide  = HEALPix::getNSide(TileId(level, patchIdx));
+
+  // northern hemisphere
+  if (baseXY.x < 4) {
+    // at north west boundary of base patch
+    if (baseXY.z == nSide - 1) {
+      // copy second pixel row to first
+      for (int i = 0; i < 257; i++) {
+        tile->data()[i + 257] = tile->data()[i + 257 * 2];
+        tile->data()[i]       = tile->data()[i + 257 * 2];
+      }
+    }
+
+    // at north east boundary of base patch
+    if (baseXY.y == nSide - 1) {
+      // copy last pixel column to last but one
+      for (int i = 0; i < 257; i++) {
+        tile->data()[i * 257 + 255] = tile->data()[i * 257 + 254];
+        tile->data()[i * 257 + 256] = tile->data()[i * 257 + 254];
+      }
+    }
+  }
+
+  // flip y --- that shouldn't be requiered, but somehow is how it was
+  // implemented in the original databases
+  for (int i = 0; i < 257 / 2; i++) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::swap_ranges(tile->data().data() + i * 257, tile->data().data() + (i + 1) * 257,
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        tile->data().data() + (256 - i) * 257);
+  }
+
+  if (token && token->isCancelled()) {
+    return nullptr;
+  }
+
+  if (tile->getDataType() == TileDataType::eFloat32) {
+    // Creating a MinMaxPyramid alongside the sampling beginning with a resolution of
+    // 128x128
+    // The MinMaxPyramid is later needed to deduce height information from this
+    // coarser level DEM tile to deeper level IMG tiles
+    auto* demTile = reinterpret_cast<Tile<float>*>(tile);
+    demTile->setMinMaxPyramid(std::make_unique<MinMaxPyramid>(demTile));
+  }
+
+  if (decodedCache) {
+    try {
+      decodedCache->write(*tile);
+    } catch (std::exception const& e) {
+      logger().warn("Failed to store decoded tile: {}", e.what());
+    }
+  }
+
+  return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<TileNode> assembleTile(TileDataType type, int level, glm::int64 patchIdx,
+    uint32_t maxLevel, ReadMapTile const& read,
+    std::shared_ptr<DecodedTileCache> const& decodedCache,
+    cs::utils::CancellationToken const* token) {
+  if (type == TileDataType::eFloat32) {
+    return assembleImpl<float>(level, patchIdx, maxLevel, read, decodedCache, token);
+  }
+  if (type == TileDataType::eUInt8) {
+    return assembleImpl<glm::uint8>(level, patchIdx, maxLevel, read, decodedCache, token);
+  }
+  if (type == TileDataType::eU8Vec3) {
+    return assembleImpl<glm::u8vec3>(level, patchIdx, maxLevel, read, decodedCache, token);
+  }
+
+  throw std::domain_error(fmt::format("Unsupported format: {}!", type));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,42 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILEASSEMBLER_HPP
+#define CSP_LOD_BODIES_TILEASSEMBLER_HPP
+
+#include "TileDataType.hpp"
+
+#include "../../../src/cs-utils/CancellationToken.hpp"
+
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+
+namespace csp::lodbodies {
+
+class DecodedTileCache;
+class TileNode;
+
+/// Reads the map tile at level, x, y into pixels, which points to 257 x 257 values of the data type
+/// of the tile. Map tiles are images in the HEALPix projection (EPSG:900914) as delivered by the
+/// map server, each one covers the area from (x, y) to (x + 1, y + 1) times 2^-level. The first row
+/// of the image is the northern one. Returns false if the map tile cannot be read.
+using ReadMapTile = std::function<bool(int level, int x, int y, void* pixels)>;
+
+/// Creates the TileNode with the given level and patchIdx from the corresponding map tile. Tiles
+/// on the diagonal of base patch 4 are composed of two map tiles, see
+/// TileSourceWebMapService::getXY(). The read function may be called concurrently for different
+/// tiles. If a DecodedTileCache is given, the tile is read from there if possible and stored there
+/// after it has been assembled. Returns nullptr if a map tile cannot be read or if the token has
+/// been cancelled.
+std::unique_ptr<TileNode> assembleTile(TileDataType type, int level, glm::int64 patchIdx,
+    uint32_t maxLevel, ReadMapTile const& read,
+    std::shared_ptr<DecodedTileCache> const& decodedCache,
+    cs::utils::CancellationToken const* token);
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILEASSEMBLER_HPP
@@ -6,6 +6,10 @@
 
 #include "TileBase.hpp"
 
+#include "Tile.hpp"
+
+#include <stdexcept>
+
 namespace csp::lodbodies {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -67,4 +71,27 @@ void TileBase::setMinMaxPyramid(std::unique_ptr<MinMaxPyramid> pyramid) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/* static */
+SlabPool& TileBase::getPool(TileDataType type) {
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory): Intentionally leaked, see header.
+  static auto* float32Pool = new SlabPool(sizeof(Tile<float>));
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory): Intentionally leaked, see header.
+  static auto* uint8Pool = new SlabPool(sizeof(Tile<glm::uint8>));
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory): Intentionally leaked, see header.
+  static auto* u8Vec3Pool = new SlabPool(sizeof(Tile<glm::u8vec3>));
+
+  switch (type) {
+  case TileDataType::eFloat32:
+    return *float32Pool;
+  case TileDataType::eUInt8:
+    return *uint8Pool;
+  case TileDataType::eU8Vec3:
+    return *u8Vec3Pool;
+  }
+
+  throw std::domain_error("Unsupported TileDataType!");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace csp::lodbodies
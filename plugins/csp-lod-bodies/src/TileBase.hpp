@@ -8,6 +8,7 @@
 #define CSP_LOD_BODIES_TILEBASE_HPP
 
 #include "MinMaxPyramid.hpp"
+#include "SlabPool.hpp"
 #include "TileDataType.hpp"
 #include "TileId.hpp"
 
@@ -62,6 +63,11 @@ class TileBase : private boost::noncopyable {
   MinMaxPyramid* getMinMaxPyramid() const;
   void           setMinMaxPyramid(std::unique_ptr<MinMaxPyramid> pyramid);
 
+  /// Returns the pool from which all Tile<T> with the given data type are allocated. There is one
+  /// pool per TileDataType, as each of them results in a different tile size. The pools are never
+  /// destroyed, so tiles may safely outlive any other static object.
+  static SlabPool& getPool(TileDataType type);
+
  protected:
   explicit TileBase(int level, glm::int64 patchIdx);
 
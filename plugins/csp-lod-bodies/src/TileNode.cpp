@@ -8,6 +8,17 @@
 
 namespace csp::lodbodies {
 
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// TileNodes are small, so the slabs are smaller than those of the tiles.
+std::size_t const NodeSlabSize = 64 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TileNode::TileNode()
@@ -40,6 +51,38 @@ TileNode::TileNode(std::unique_ptr<TileBase>&& tile, int childMaxLevel)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/* static */
+void* TileNode::operator new(std::size_t size) {
+  if (size != sizeof(TileNode)) {
+    return ::operator new(size);
+  }
+
+  return getPool().allocate();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* static */
+void TileNode::operator delete(void* block, std::size_t size) {
+  if (size != sizeof(TileNode)) {
+    ::operator delete(block);
+    return;
+  }
+
+  getPool().deallocate(block);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* static */
+SlabPool& TileNode::getPool() {
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory): Intentionally leaked, see header.
+  static auto* pool = new SlabPool(sizeof(TileNode), NodeSlabSize);
+  return *pool;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 int TileNode::getLevel() const {
   return mTile->getLevel();
 }
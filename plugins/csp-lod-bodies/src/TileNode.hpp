@@ -30,6 +30,14 @@ class TileNode {
   // move assignment -- disabled: triggers a bug with gcc 4.3?
   //     TileNode& operator=(BOOST_RV_REF(TileNode) source);
 
+  /// TileNodes are allocated from a SlabPool, see getPool().
+  static void* operator new(std::size_t size);
+  static void  operator delete(void* block, std::size_t size);
+
+  /// Returns the pool from which all TileNodes are allocated. Like the pools of the tiles, it is
+  /// never destroyed.
+  static SlabPool& getPool();
+
   int           getLevel() const;
   glm::int64    getPatchIdx() const;
   TileId const& getTileId() const;
@@ -0,0 +1,183 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileNodeCache.hpp"
+
+#include "MinMaxPyramid.hpp"
+#include "TileBase.hpp"
+#include "TileNode.hpp"
+
+#include <cassert>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* explicit */
+TileNodeCache::TileNodeCache(std::size_t maxBytes)
+    : mMaxBytes(maxBytes) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileNodeCache::~TileNodeCache() = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileNodeCache::insert(std::unique_ptr<TileNode> node) {
+  assert(node->getParent() == nullptr);
+
+  auto const& tileId = node->getTileId();
+  auto        it     = mIndex.find(tileId);
+
+  if (it != mIndex.end()) {
+    mBytes -= it->second->mSize;
+    mEntries.erase(it->second);
+    mIndex.erase(it);
+  }
+
+  std::size_t size = getNodeSize(*node);
+
+  // Inserting the node would only evict everything else.
+  if (size > mMaxBytes) {
+    ++mEvictions;
+    return;
+  }
+
+  mEntries.push_front({std::move(node), size});
+  mIndex.emplace(tileId, mEntries.begin());
+  mBytes += size;
+
+  evict();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<TileNode> TileNodeCache::take(TileId const& tileId) {
+  auto it = mIndex.find(tileId);
+
+  if (it == mIndex.end()) {
+    ++mMisses;
+    return nullptr;
+  }
+
+  ++mHits;
+
+  auto node = std::move(it->second->mNode);
+  mBytes -= it->second->mSize;
+  mEntries.erase(it->second);
+  mIndex.erase(it);
+
+  return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileNodeCache::clear() {
+  mIndex.clear();
+  mEntries.clear();
+  mBytes = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileNodeCache::setMaxBytes(std::size_t maxBytes) {
+  mMaxBytes = maxBytes;
+  evict();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileNodeCache::getMaxBytes() const {
+  return mMaxBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileNodeCache::getBytes() const {
+  return mBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileNodeCache::getNodeCount() const {
+  return mEntries.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t TileNodeCache::getHitCount() const {
+  return mHits;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t TileNodeCache::getMissCount() const {
+  return mMisses;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t TileNodeCache::getEvictionCount() const {
+  return mEvictions;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileNodeCache::resetStatistics() {
+  mHits      = 0;
+  mMisses    = 0;
+  mEvictions = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileNodeCache::getNodeSize(TileNode const& node) {
+  std::size_t size = sizeof(TileNode);
+  TileBase*   tile = node.getTile();
+
+  if (tile) {
+    std::size_t sampleSize = 0;
+
+    switch (tile->getDataType()) {
+    case TileDataType::eFloat32:
+      sampleSize = sizeof(float);
+      break;
+    case TileDataType::eUInt8:
+      sampleSize = sizeof(glm::uint8);
+      break;
+    case TileDataType::eU8Vec3:
+      sampleSize = sizeof(glm::u8vec3);
+      break;
+    }
+
+    size += sampleSize * TileBase::SizeX * TileBase::SizeY;
+
+    if (tile->getMinMaxPyramid()) {
+      size += MinMaxPyramid::getSerializedSize();
+    }
+  }
+
+  return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileNodeCache::evict() {
+  while (mBytes > mMaxBytes && !mEntries.empty()) {
+    auto& oldest = mEntries.back();
+
+    mBytes -= oldest.mSize;
+    mIndex.erase(oldest.mNode->getTileId());
+    mEntries.pop_back();
+
+    ++mEvictions;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILENODECACHE_HPP
+#define CSP_LOD_BODIES_TILENODECACHE_HPP
+
+#include "TileId.hpp"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace csp::lodbodies {
+
+class TileNode;
+
+/// A least-recently-used cache for TileNodes which have been removed from a TileQuadTree. When the
+/// camera returns to an area shortly after its tiles have been pruned, they can be taken from here
+/// instead of loading them again from the TileSource.
+///
+/// The cache has a budget in bytes, based on the size of the tile data and the MinMaxPyramid of the
+/// stored nodes. If it is exceeded, the nodes which have been inserted first are deleted. Nodes are
+/// removed from the cache when they are taken out, so the insertion order is also the order of the
+/// last use.
+///
+/// This class is not thread-safe.
+class TileNodeCache {
+ public:
+  /// Creates a cache which stores at most maxBytes of tile data. If maxBytes is zero, no nodes are
+  /// stored at all.
+  explicit TileNodeCache(std::size_t maxBytes = 0);
+
+  TileNodeCache(TileNodeCache const& other) = delete;
+  TileNodeCache(TileNodeCache&& other)      = delete;
+
+  TileNodeCache& operator=(TileNodeCache const& other) = delete;
+  TileNodeCache& operator=(TileNodeCache&& other) = delete;
+
+  ~TileNodeCache();
+
+  /// Takes ownership of the given node. The node must neither have a parent nor children. If there
+  /// is already a node with the same TileId, it is replaced. Afterwards, the oldest nodes are
+  /// deleted until the budget is met again.
+  void insert(std::unique_ptr<TileNode> node);
+
+  /// Removes the node with the given TileId from the cache and returns it. Returns nullptr if there
+  /// is no such node. Each call is counted as either a hit or a miss.
+  std::unique_ptr<TileNode> take(TileId const& tileId);
+
+  /// Deletes all nodes. The statistics are not reset.
+  void clear();
+
+  /// Changes the budget. If the cache currently contains more data, the oldest nodes are deleted.
+  void        setMaxBytes(std::size_t maxBytes);
+  std::size_t getMaxBytes() const;
+
+  /// The number of bytes currently used by all nodes in the cache.
+  std::size_t getBytes() const;
+
+  /// The number of nodes currently stored in the cache.
+  std::size_t getNodeCount() const;
+
+  /// Statistics since the creation of the cache or the last call to resetStatistics().
+  uint64_t getHitCount() const;
+  uint64_t getMissCount() const;
+  uint64_t getEvictionCount() const;
+  void     resetStatistics();
+
+  /// Returns the number of bytes of the tile data and the MinMaxPyramid of the given node.
+  static std::size_t getNodeSize(TileNode const& node);
+
+ private:
+  struct Entry {
+    std::unique_ptr<TileNode> mNode;
+    std::size_t               mSize;
+  };
+
+  /// Deletes the oldest nodes until the budget is met.
+  void evict();
+
+  /// Newest nodes are at the front.
+  std::list<Entry>                                        mEntries;
+  std::unordered_map<TileId, std::list<Entry>::iterator> mIndex;
+
+  std::size_t mMaxBytes;
+  std::size_t mBytes = 0;
+
+  uint64_t mHits      = 0;
+  uint64_t mMisses    = 0;
+  uint64_t mEvictions = 0;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILENODECACHE_HPP
@@ -0,0 +1,572 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TilePackCache.hpp"
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct TilePackCache::IndexHeader {
+  uint64_t mMagic;
+  uint32_t mVersion;
+  uint32_t mReserved;
+  uint64_t mCapacity; ///< Number of slots, always a power of two.
+  uint64_t mCount;    ///< Number of used slots.
+  uint64_t mDataSize; ///< Size of the data file when the index was last updated.
+};
+
+// An entry with mOffset == 0 is an empty slot, as no record can start at the beginning of the data
+// file.
+struct TilePackCache::IndexEntry {
+  uint64_t mLayer;
+  uint64_t mOffset;
+  uint32_t mLevel;
+  int32_t  mX;
+  int32_t  mY;
+  uint32_t mSize;
+};
+
+namespace {
+
+struct DataHeader {
+  uint64_t mMagic;
+  uint64_t mVersion;
+};
+
+struct RecordHeader {
+  uint32_t mMagic;
+  uint32_t mSize;
+  uint64_t mLayer;
+  uint32_t mLevel;
+  int32_t  mX;
+  int32_t  mY;
+  uint32_t mChecksum;
+};
+
+static_assert(sizeof(DataHeader) == 16, "Unexpected padding in DataHeader!");
+static_assert(sizeof(RecordHeader) == 32, "Unexpected padding in RecordHeader!");
+
+uint64_t const dataMagic   = 0x4b4341505344424cULL; // "LBDSPACK"
+uint64_t const indexMagic  = 0x5844494e5344424cULL; // "LBDSINDX"
+uint32_t const recordMagic = 0x454c4954;            // "TILE"
+uint32_t const version     = 1;
+
+// The index starts with this many slots and doubles its size whenever it is filled to more than
+// maxLoadFactor.
+uint64_t const initialCapacity = 1024;
+double const   maxLoadFactor   = 0.6;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// 64-bit FNV-1a hash of the layer name.
+uint64_t hashLayer(std::string const& layer) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : layer) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Finalizer of the splitmix64 generator, used for spreading the keys over the index slots.
+uint64_t mix(uint64_t value) {
+  value = (value ^ (value >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27U)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t hashKey(uint64_t layer, int level, int x, int y) {
+  uint64_t hash = mix(layer ^ static_cast<uint32_t>(level));
+  hash          = mix(hash ^ static_cast<uint32_t>(x));
+  return mix(hash ^ static_cast<uint32_t>(y));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t checksum(char const* data, size_t size) {
+  boost::crc_32_type crc;
+  crc.process_bytes(data, size);
+  return crc.checksum();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Creates a file of the given size which is filled with zeros.
+void createFile(std::string const& file, uint64_t size) {
+  {
+    std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+      throw std::runtime_error("Failed to create file '" + file + "'!");
+    }
+  }
+  boost::filesystem::resize_file(file, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<boost::interprocess::mapped_region> mapFile(
+    std::string const& file, boost::interprocess::mode_t mode) {
+  boost::interprocess::file_mapping mapping(file.c_str(), mode);
+  return std::make_unique<boost::interprocess::mapped_region>(mapping, mode);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<TilePackCache> TilePackCache::open(std::string const& file) {
+  static std::mutex                                          mutex;
+  static std::map<std::string, std::weak_ptr<TilePackCache>> instances;
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  auto path     = boost::filesystem::absolute(file).lexically_normal().string();
+  auto instance = instances[path].lock();
+
+  if (!instance) {
+    instance        = std::make_shared<TilePackCache>(path);
+    instances[path] = instance;
+  }
+
+  return instance;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TilePackCache::TilePackCache(std::string file)
+    : mFile(std::move(file))
+    , mIndexFile(mFile + ".index") {
+
+  try {
+    auto directory = boost::filesystem::path(mFile).parent_path();
+    if (!directory.empty()) {
+      boost::filesystem::create_directories(directory);
+    }
+
+    // A separate file is locked, as on POSIX systems closing any handle of a file releases all
+    // locks of the process on it, and the data file is opened and closed repeatedly.
+    std::string lockFile(mFile + ".lock");
+
+    {
+      std::ofstream stream(lockFile, std::ios::binary | std::ios::app);
+      if (!stream) {
+        throw std::runtime_error("Failed to create file '" + lockFile + "'!");
+      }
+    }
+
+    mLock = std::make_unique<boost::interprocess::file_lock>(lockFile.c_str());
+
+    if (!mLock->try_lock()) {
+      throw std::runtime_error(
+          "Failed to open tile pack '" + mFile + "': It is used by another process!");
+    }
+
+    if (!boost::filesystem::exists(mFile) || boost::filesystem::file_size(mFile) == 0) {
+      DataHeader header{dataMagic, version};
+
+      std::ofstream stream(mFile, std::ios::binary | std::ios::trunc);
+      stream.write(reinterpret_cast<char const*>(&header), sizeof(DataHeader));
+
+      if (!stream) {
+        throw std::runtime_error("Failed to create file '" + mFile + "'!");
+      }
+    }
+
+    mDataSize = boost::filesystem::file_size(mFile);
+    mapData();
+
+    DataHeader header{};
+    if (mDataSize >= sizeof(DataHeader)) {
+      std::memcpy(&header, mDataRegion->get_address(), sizeof(DataHeader));
+    }
+
+    if (header.mMagic != dataMagic || header.mVersion != version) {
+      throw std::runtime_error("File '" + mFile + "' is not a tile pack!");
+    }
+
+    if (!openIndex()) {
+      rebuildIndex(initialCapacity);
+    }
+  } catch (boost::interprocess::interprocess_exception const& e) {
+    throw std::runtime_error("Failed to map tile pack '" + mFile + "': " + e.what());
+  } catch (boost::filesystem::filesystem_error const& e) {
+    throw std::runtime_error("Failed to open tile pack '" + mFile + "': " + e.what());
+  }
+
+  mDataStream.open(mFile, std::ios::binary | std::ios::app);
+
+  if (!mDataStream) {
+    throw std::runtime_error("Failed to open file '" + mFile + "' for writing!");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TilePackCache::~TilePackCache() {
+  if (mIndexRegion) {
+    mIndexRegion->flush();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<std::string> TilePackCache::read(
+    std::string const& layer, int level, int x, int y) const {
+
+  std::optional<std::string> result;
+
+  read(layer, level, x, y, [&result](char const* data, size_t size) {
+    result.emplace(data, size);
+    return true;
+  });
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TilePackCache::read(std::string const& layer, int level, int x, int y,
+    std::function<bool(char const*, size_t)> const& reader) const {
+
+  uint64_t layerHash = hashLayer(layer);
+
+  std::shared_lock<std::shared_mutex> lock(mMutex);
+
+  uint64_t offset = 0;
+
+  while (true) {
+    IndexEntry const& entry = findEntry(layerHash, level, x, y);
+
+    if (entry.mOffset == 0) {
+      return false;
+    }
+
+    offset       = entry.mOffset;
+    uint64_t end = offset + sizeof(RecordHeader) + entry.mSize;
+
+    if (end <= mDataRegion->get_size()) {
+      break;
+    }
+
+    // The record has been appended after the data file was mapped. Only one thread must remap the
+    // file, so we have to switch to an exclusive lock. A writer may replace the entry in the
+    // meantime, therefore it is looked up again afterwards.
+    lock.unlock();
+    {
+      std::unique_lock<std::shared_mutex> writeLock(mMutex);
+      if (end > mDataRegion->get_size()) {
+        mapData();
+      }
+
+      // If the record is still beyond the end of the data file, the pack has been truncated, for
+      // example by a crash between writing the index and the data. The tile is treated as missing.
+      if (end > mDataRegion->get_size()) {
+        return false;
+      }
+    }
+    lock.lock();
+  }
+
+  auto const* data = static_cast<char const*>(mDataRegion->get_address()) + offset;
+
+  RecordHeader header{};
+  std::memcpy(&header, data, sizeof(RecordHeader));
+
+  // This should never happen unless the file has been modified by someone else. In this case we
+  // treat the tile as missing so that it will be downloaded again. The checksum is not verified
+  // here, as this would take about as long as decoding a compressed tile. Records which have not
+  // been written completely are already removed when the pack is opened.
+  if (header.mMagic != recordMagic || header.mLayer != layerHash ||
+      header.mLevel != static_cast<uint32_t>(level) || header.mX != x || header.mY != y) {
+    return false;
+  }
+
+  return reader(data + sizeof(RecordHeader), header.mSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TilePackCache::write(
+    std::string const& layer, int level, int x, int y, std::string const& data) {
+
+  if (data.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Failed to write tile to pack '" + mFile + "': Tile is too large!");
+  }
+
+  RecordHeader header{};
+  header.mMagic    = recordMagic;
+  header.mSize     = static_cast<uint32_t>(data.size());
+  header.mLayer    = hashLayer(layer);
+  header.mLevel    = static_cast<uint32_t>(level);
+  header.mX        = x;
+  header.mY        = y;
+  header.mChecksum = checksum(data.data(), data.size());
+
+  std::unique_lock<std::shared_mutex> lock(mMutex);
+
+  // The record is completely written to the data file before the index is touched. If we crash
+  // in between, the index will be rebuilt on the next start.
+  mDataStream.write(reinterpret_cast<char const*>(&header), sizeof(RecordHeader));
+  mDataStream.write(data.data(), static_cast<std::streamsize>(data.size()));
+  mDataStream.flush();
+
+  if (!mDataStream) {
+    // Try to remove the partial record, so that the next write does not append to garbage.
+    mDataStream.clear();
+    boost::system::error_code error;
+    boost::filesystem::resize_file(mFile, mDataSize, error);
+    throw std::runtime_error("Failed to write tile to pack '" + mFile + "'!");
+  }
+
+  uint64_t offset = mDataSize;
+  mDataSize += sizeof(RecordHeader) + data.size();
+
+  auto& indexHeader = getIndexHeader();
+
+  if (static_cast<double>(indexHeader.mCount + 1) >
+      static_cast<double>(indexHeader.mCapacity) * maxLoadFactor) {
+    growIndex(indexHeader.mCapacity * 2);
+  }
+
+  auto& entry = findEntry(header.mLayer, level, x, y);
+
+  if (entry.mOffset == 0) {
+    ++getIndexHeader().mCount;
+  }
+
+  entry.mLayer  = header.mLayer;
+  entry.mLevel  = header.mLevel;
+  entry.mX      = x;
+  entry.mY      = y;
+  entry.mSize   = header.mSize;
+  entry.mOffset = offset;
+
+  getIndexHeader().mDataSize = mDataSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t TilePackCache::getTileCount() const {
+  std::shared_lock<std::shared_mutex> lock(mMutex);
+  return getIndexHeader().mCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t TilePackCache::getDataSize() const {
+  std::shared_lock<std::shared_mutex> lock(mMutex);
+  return mDataSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string const& TilePackCache::getFile() const {
+  return mFile;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TilePackCache::mapData() const {
+  mDataRegion.reset();
+  mDataRegion = mapFile(mFile, boost::interprocess::read_only);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TilePackCache::openIndex() {
+  if (!boost::filesystem::exists(mIndexFile)) {
+    return false;
+  }
+
+  uint64_t fileSize = boost::filesystem::file_size(mIndexFile);
+
+  if (fileSize < sizeof(IndexHeader)) {
+    return false;
+  }
+
+  mIndexRegion = mapFile(mIndexFile, boost::interprocess::read_write);
+
+  auto const& header = getIndexHeader();
+
+  // If the data size does not match, the application has crashed after appending to the data file
+  // but before the index was written to disc.
+  bool valid = header.mMagic == indexMagic && header.mVersion == version &&
+               header.mCapacity > 0 && (header.mCapacity & (header.mCapacity - 1)) == 0 &&
+               fileSize == sizeof(IndexHeader) + header.mCapacity * sizeof(IndexEntry) &&
+               header.mDataSize == mDataSize;
+
+  if (!valid) {
+    mIndexRegion.reset();
+  }
+
+  return valid;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TilePackCache::rebuildIndex(uint64_t capacity) {
+  mIndexRegion.reset();
+
+  std::string tmpFile = mIndexFile + ".tmp";
+  createFile(tmpFile, sizeof(IndexHeader) + capacity * sizeof(IndexEntry));
+  mIndexRegion = mapFile(tmpFile, boost::interprocess::read_write);
+
+  auto& header     = getIndexHeader();
+  header.mMagic    = indexMagic;
+  header.mVersion  = version;
+  header.mCapacity = capacity;
+
+  auto const* data   = static_cast<char const*>(mDataRegion->get_address());
+  uint64_t    offset = sizeof(DataHeader);
+
+  while (offset + sizeof(RecordHeader) <= mDataSize) {
+    RecordHeader record{};
+    std::memcpy(&record, data + offset, sizeof(RecordHeader));
+
+    if (record.mMagic != recordMagic || offset + sizeof(RecordHeader) + record.mSize > mDataSize ||
+        record.mChecksum != checksum(data + offset + sizeof(RecordHeader), record.mSize)) {
+      break;
+    }
+
+    if (static_cast<double>(header.mCount + 1) >
+        static_cast<double>(header.mCapacity) * maxLoadFactor) {
+      // Start over with a larger index. This is simpler than growing a temporary index in place
+      // and only happens for packs which have been created by an older version or have lost
+      // their index.
+      mIndexRegion.reset();
+      rebuildIndex(capacity * 2);
+      return;
+    }
+
+    auto& entry = findEntry(record.mLayer, static_cast<int>(record.mLevel), record.mX, record.mY);
+
+    if (entry.mOffset == 0) {
+      ++header.mCount;
+    }
+
+    entry.mLayer  = record.mLayer;
+    entry.mLevel  = record.mLevel;
+    entry.mX      = record.mX;
+    entry.mY      = record.mY;
+    entry.mSize   = record.mSize;
+    entry.mOffset = offset;
+
+    offset += sizeof(RecordHeader) + record.mSize;
+  }
+
+  // Remove everything after the last valid record. This is most likely a partially written record.
+  if (offset != mDataSize) {
+    mDataRegion.reset();
+    boost::filesystem::resize_file(mFile, offset);
+    mDataSize = offset;
+    mapData();
+  }
+
+  header.mDataSize = mDataSize;
+
+  replaceIndex(tmpFile);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TilePackCache::growIndex(uint64_t capacity) {
+  std::string tmpFile = mIndexFile + ".tmp";
+  createFile(tmpFile, sizeof(IndexHeader) + capacity * sizeof(IndexEntry));
+
+  auto oldRegion = std::move(mIndexRegion);
+  mIndexRegion   = mapFile(tmpFile, boost::interprocess::read_write);
+
+  auto const& oldHeader = *static_cast<IndexHeader const*>(oldRegion->get_address());
+  auto const* oldEntries =
+      reinterpret_cast<IndexEntry const*>(static_cast<char const*>(oldRegion->get_address()) +
+                                          sizeof(IndexHeader));
+
+  auto& header     = getIndexHeader();
+  header.mMagic    = indexMagic;
+  header.mVersion  = version;
+  header.mCapacity = capacity;
+  header.mCount    = oldHeader.mCount;
+  header.mDataSize = oldHeader.mDataSize;
+
+  for (uint64_t i = 0; i < oldHeader.mCapacity; ++i) {
+    auto const& oldEntry = oldEntries[i];
+    if (oldEntry.mOffset != 0) {
+      findEntry(oldEntry.mLayer, static_cast<int>(oldEntry.mLevel), oldEntry.mX, oldEntry.mY) =
+          oldEntry;
+    }
+  }
+
+  oldRegion.reset();
+
+  replaceIndex(tmpFile);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TilePackCache::replaceIndex(std::string const& tmpFile) {
+  // Renaming is atomic, so there is always either the old or the new index on disc.
+  mIndexRegion->flush();
+  mIndexRegion.reset();
+  boost::filesystem::rename(tmpFile, mIndexFile);
+  mIndexRegion = mapFile(mIndexFile, boost::interprocess::read_write);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TilePackCache::IndexHeader& TilePackCache::getIndexHeader() const {
+  return *static_cast<IndexHeader*>(mIndexRegion->get_address());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TilePackCache::IndexEntry* TilePackCache::getIndexEntries() const {
+  return reinterpret_cast<IndexEntry*>(
+      static_cast<char*>(mIndexRegion->get_address()) + sizeof(IndexHeader));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TilePackCache::IndexEntry& TilePackCache::findEntry(uint64_t layer, int level, int x, int y) const {
+  auto*    entries = getIndexEntries();
+  uint64_t mask    = getIndexHeader().mCapacity - 1;
+  uint64_t slot    = hashKey(layer, level, x, y) & mask;
+
+  // Linear probing. As the load factor is limited, there is always an empty slot.
+  while (true) {
+    auto& entry = entries[slot];
+
+    if (entry.mOffset == 0 || (entry.mLayer == layer &&
+                                  entry.mLevel == static_cast<uint32_t>(level) &&
+                                  entry.mX == x && entry.mY == y)) {
+      return entry;
+    }
+
+    slot = (slot + 1) & mask;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILEPACKCACHE_HPP
+#define CSP_LOD_BODIES_TILEPACKCACHE_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+
+namespace boost::interprocess {
+class file_lock;
+class mapped_region;
+} // namespace boost::interprocess
+
+namespace csp::lodbodies {
+
+/// A cache which stores many tiles in a single file. This avoids the hundreds of thousands of small
+/// files of a directory based cache.
+///
+/// The pack consists of two files: The data file (e.g. "tiles.pack") contains the tiles in the
+/// order they were written. Each tile is preceded by a small header containing the tile's key and a
+/// checksum. New tiles are only ever appended to this file. The index file (e.g.
+/// "tiles.pack.index") is a hash table which maps the keys (layer, level, x, y) to the location of
+/// the tiles in the data file. Both files are memory-mapped.
+///
+/// The data file is the single source of truth. If the application crashes during a write, the
+/// index may be outdated or the last record may be incomplete. Both is detected when the pack is
+/// opened the next time: The index is then rebuilt from the data file and any incomplete trailing
+/// record is discarded.
+///
+/// An arbitrary number of threads may read from the pack at the same time, writes are serialized.
+/// A pack cannot be opened by more than one process at the same time. This is enforced with an
+/// advisory lock on a third file (e.g. "tiles.pack.lock"), which is held as long as the pack is
+/// open. Within one process, open() has to be used to share a pack between several users.
+class TilePackCache {
+ public:
+  /// Returns an instance for the given data file. If the file is already opened by another
+  /// instance, this instance is returned. Throws a std::runtime_error if the files cannot be opened
+  /// or created.
+  static std::shared_ptr<TilePackCache> open(std::string const& file);
+
+  /// Opens or creates the pack with the given data file. The index file is stored next to it with
+  /// an additional ".index" extension. Throws a std::runtime_error if the files cannot be opened or
+  /// created or if the pack is already opened by another process.
+  explicit TilePackCache(std::string file);
+
+  TilePackCache(TilePackCache const& other) = delete;
+  TilePackCache(TilePackCache&& other)      = delete;
+
+  TilePackCache& operator=(TilePackCache const& other) = delete;
+  TilePackCache& operator=(TilePackCache&& other) = delete;
+
+  ~TilePackCache();
+
+  /// Returns the data of the given tile or std::nullopt if it is not in the pack.
+  std::optional<std::string> read(std::string const& layer, int level, int x, int y) const;
+
+  /// Calls the given function with the data of the given tile. The data is not copied, the pointer
+  /// is only valid during the call and the pack must not be used from within the function. Returns
+  /// false if the tile is not in the pack, else the return value of the function.
+  bool read(std::string const& layer, int level, int x, int y,
+      std::function<bool(char const* data, size_t size)> const& reader) const;
+
+  /// Appends the data of the given tile to the pack. If the tile is already stored, the index will
+  /// point to the new data afterwards. Throws a std::runtime_error if writing fails.
+  void write(std::string const& layer, int level, int x, int y, std::string const& data);
+
+  /// Returns the number of tiles stored in the pack.
+  uint64_t getTileCount() const;
+
+  /// Returns the size of the data file in bytes.
+  uint64_t getDataSize() const;
+
+  /// Returns the path to the data file.
+  std::string const& getFile() const;
+
+ private:
+  struct IndexHeader;
+  struct IndexEntry;
+
+  /// Maps the data file again, this is required after data has been appended to it.
+  void mapData() const;
+
+  /// Opens the index file. Returns false if it does not exist or does not match the data file.
+  bool openIndex();
+
+  /// Scans the data file and creates a new index with the given capacity from it. Incomplete or
+  /// corrupt records at the end of the data file are removed.
+  void rebuildIndex(uint64_t capacity);
+
+  /// Creates a new index with the given capacity containing all entries of the current index.
+  void growIndex(uint64_t capacity);
+
+  /// Moves the given temporary index file over the current one and maps it.
+  void replaceIndex(std::string const& tmpFile);
+
+  IndexHeader& getIndexHeader() const;
+  IndexEntry*  getIndexEntries() const;
+
+  /// Returns the entry of the given key or the empty slot where it should be inserted.
+  IndexEntry& findEntry(uint64_t layer, int level, int x, int y) const;
+
+  std::string mFile;
+  std::string mIndexFile;
+
+  std::unique_ptr<boost::interprocess::file_lock> mLock;
+
+  mutable std::shared_mutex mMutex;
+
+  std::ofstream mDataStream;
+  uint64_t      mDataSize = 0;
+
+  mutable std::unique_ptr<boost::interprocess::mapped_region> mDataRegion;
+  std::unique_ptr<boost::interprocess::mapped_region>         mIndexRegion;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILEPACKCACHE_HPP
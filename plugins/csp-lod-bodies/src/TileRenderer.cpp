@@ -46,6 +46,13 @@ GLsizeiptr const NumVertices = SizeX * SizeY;
 //                                      * (3 indices per triangle)
 GLsizeiptr const NumIndices = (SizeX - 1) * (SizeY - 1) * 6;
 
+// binding point of the VP_TileBuffer storage block and location of the VP_iTileIndex attribute
+GLuint const tileBufferBinding = 0;
+GLuint const tileIndexLocation = 1;
+
+// maximum number of tiles drawn with a single glMultiDrawElementsIndirect call
+std::size_t const maxTilesPerDraw = 65536;
+
 const char* BoundsVertexShaderName("VistaPlanetTileBounds.vert");
 const char* BoundsFragmentShaderName("VistaPlanetTileBounds.frag");
 
@@ -295,6 +302,7 @@ glm::ivec4 calcEdgeOffset(RenderDataDEM* rdDEM) {
 
 std::unique_ptr<VistaBufferObject>      TileRenderer::mVboTerrain;
 std::unique_ptr<VistaBufferObject>      TileRenderer::mIboTerrain;
+std::unique_ptr<VistaBufferObject>      TileRenderer::mVboTileIndices;
 std::unique_ptr<VistaVertexArrayObject> TileRenderer::mVaoTerrain;
 std::unique_ptr<VistaBufferObject>      TileRenderer::mVboBounds;
 std::unique_ptr<VistaBufferObject>      TileRenderer::mIboBounds;
@@ -316,7 +324,17 @@ TileRenderer::TileRenderer(
     , mEnableDrawTiles(true)
     , mEnableDrawBounds(false)
     , mEnableWireframe(false)
-    , mEnableFaceCulling(true) {
+    , mEnableFaceCulling(true)
+    , mEnableMultiDraw(true) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileRenderer::~TileRenderer() {
+  if (mTileDataBuffer != 0U) {
+    glDeleteBuffers(1, &mTileDataBuffer);
+    glDeleteBuffers(1, &mDrawCommandBuffer);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -383,6 +401,7 @@ void TileRenderer::preRenderTiles(cs::graphics::ShadowMap* shadowMap) {
   }
 
   mVaoTerrain->Bind();
+  mProgTerrain->setMultiDraw(useMultiDraw());
   mProgTerrain->bind();
   VistaGLSLShader& shader = mProgTerrain->mShader;
 
@@ -444,6 +463,10 @@ void TileRenderer::renderTiles(
   locs.layerDEM         = shader.GetUniformLocation("VP_layerDEM");
   locs.layerIMG         = shader.GetUniformLocation("VP_layerIMG");
 
+  bool const multiDraw = useMultiDraw();
+  mTileData.clear();
+  mDrawCommands.clear();
+
   int missingDEM = 0;
   int missingIMG = 0;
 
@@ -468,8 +491,23 @@ void TileRenderer::renderTiles(
       continue;
     }
 
-    // render
-    renderTile(rdDEM, rdIMG, locs);
+    // render directly or collect the tile for a single indirect draw call
+    if (multiDraw) {
+      TileData data{};
+      GLuint   idxCount = NumIndices;
+      calcTileData(rdDEM, rdIMG, data, idxCount);
+
+      // the base instance selects the tile's entry in the tile buffer via VP_iTileIndex
+      auto baseInstance = static_cast<GLuint>(mTileData.size() % maxTilesPerDraw);
+      mDrawCommands.push_back({idxCount, 1U, 0U, 0, baseInstance});
+      mTileData.push_back(data);
+    } else {
+      renderTile(rdDEM, rdIMG, locs);
+    }
+  }
+
+  if (multiDraw) {
+    renderTilesIndirect();
   }
 
   if (missingDEM || missingIMG) {
@@ -496,14 +534,100 @@ void TileRenderer::renderTiles(
 
 void TileRenderer::renderTile(RenderDataDEM* rdDEM, RenderDataImg* rdIMG, UniformLocs const& locs) {
   VistaGLSLShader& shader   = mProgTerrain->mShader;
-  TileId const&    idDEM    = rdDEM->getTileId();
   GLuint           idxCount = NumIndices;
+  TileData         data{};
+
+  calcTileData(rdDEM, rdIMG, data, idxCount);
+
+  // update uniforms
+  shader.SetUniform(locs.demAverageHeight, data.mCorners[0].w);
+  shader.SetUniform(locs.tileOffsetScale, 3, 1, glm::value_ptr(data.mTileOffsetScale));
+  shader.SetUniform(locs.demOffsetScale, 3, 1, glm::value_ptr(data.mDemOffsetScale));
+  shader.SetUniform(locs.imgOffsetScale, 3, 1, glm::value_ptr(data.mImgOffsetScale));
+  shader.SetUniform(locs.layerIMG, data.mDemOffsetScale.w);
+  shader.SetUniform(locs.layerDEM, data.mTileOffsetScale.w);
+  shader.SetUniform(locs.edgeDelta, 4, 1, glm::value_ptr(data.mEdgeDelta));
+  shader.SetUniform(locs.edgeLayerDEM, 4, 1, glm::value_ptr(data.mEdgeLayerDEM));
+  shader.SetUniform(locs.edgeOffset, 4, 1, glm::value_ptr(data.mEdgeOffset));
+  shader.SetUniform(locs.f1f2, 2, 1, glm::value_ptr(data.mF1F2));
+
+  std::array<glm::fvec3, 4> cornersViewSpace{};
+  std::array<glm::fvec3, 4> normalsViewSpace{};
+
+  for (int i(0); i < 4; ++i) {
+    cornersViewSpace.at(i) = glm::fvec3(data.mCorners.at(i));
+    normalsViewSpace.at(i) = glm::fvec3(data.mNormals.at(i));
+  }
+
+  glUniform3fv(glGetUniformLocation(shader.GetProgram(), "VP_corners"), 4,
+      glm::value_ptr(cornersViewSpace[0]));
+  glUniform3fv(glGetUniformLocation(shader.GetProgram(), "VP_normals"), 4,
+      glm::value_ptr(normalsViewSpace[0]));
+
+  // draw tile
+  glDrawElements(GL_TRIANGLES, idxCount, GL_UNSIGNED_INT, nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileRenderer::renderTilesIndirect() {
+  static_assert(sizeof(TileData) == 15 * sizeof(glm::ivec4), "TileData must match std430 layout!");
+  static_assert(sizeof(DrawCommand) == 5 * sizeof(GLuint), "DrawCommand must be tightly packed!");
+
+  if (mTileData.empty()) {
+    return;
+  }
+
+  if (mTileDataBuffer == 0U) {
+    glGenBuffers(1, &mTileDataBuffer);
+    glGenBuffers(1, &mDrawCommandBuffer);
+  }
+
+  // Both buffers are respecified each frame, this allows the driver to hand out fresh memory
+  // instead of waiting for the draw calls of the previous frame.
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTileDataBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER,
+      static_cast<GLsizeiptr>(mTileData.size() * sizeof(TileData)), mTileData.data(),
+      GL_STREAM_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mDrawCommandBuffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER,
+      static_cast<GLsizeiptr>(mDrawCommands.size() * sizeof(DrawCommand)), mDrawCommands.data(),
+      GL_STREAM_DRAW);
+
+  // The tile index attribute only covers maxTilesPerDraw tiles, larger sets are drawn in chunks
+  // with the corresponding range of the tile buffer bound.
+  for (std::size_t first = 0; first < mTileData.size(); first += maxTilesPerDraw) {
+    std::size_t const count = std::min(mTileData.size() - first, maxTilesPerDraw);
+
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, tileBufferBinding, mTileDataBuffer,
+        static_cast<GLintptr>(first * sizeof(TileData)),
+        static_cast<GLsizeiptr>(count * sizeof(TileData)));
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+    auto const* offset = reinterpret_cast<void const*>(first * sizeof(DrawCommand));
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT, offset, static_cast<GLsizei>(count), 0);
+  }
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, tileBufferBinding, 0U);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileRenderer::calcTileData(
+    RenderDataDEM* rdDEM, RenderDataImg* rdIMG, TileData& data, GLuint& idxCount) const {
+  TileId const& idDEM = rdDEM->getTileId();
 
   std::array<glm::dvec2, 4> cornersLngLat{};
 
   glm::ivec3 demOS(0, 0, 256);
   glm::ivec3 imgOS(0, 0, 256);
 
+  idxCount = NumIndices;
+
   if (!rdIMG || rdDEM->getLevel() == rdIMG->getLevel()) {
     // no image data or same resolution
     cornersLngLat = HEALPix::getCornersLngLat(idDEM);
@@ -518,49 +642,43 @@ void TileRenderer::renderTile(RenderDataDEM* rdDEM, RenderDataImg* rdIMG, Unifor
   }
 
   auto  baseXY        = HEALPix::getBaseXY(idDEM);
-  auto  tileOS        = glm::ivec3(baseXY.y, baseXY.z, HEALPix::getNSide(idDEM));
-  auto  edgeDelta     = calcEdgeDelta(rdDEM);
-  auto  edgeLayerDEM  = calcEdgeLayerDEM(rdDEM);
-  auto  edgeOffset    = calcEdgeOffset(rdDEM);
-  auto  patchF1F2     = glm::ivec2(HEALPix::getF1(idDEM), HEALPix::getF2(idDEM));
   float averageHeight = rdDEM->getNode()->getTile()->getMinMaxPyramid()->getAverage();
 
-  // update uniforms
-  shader.SetUniform(locs.demAverageHeight, averageHeight);
-  shader.SetUniform(locs.tileOffsetScale, 3, 1, glm::value_ptr(tileOS));
-  shader.SetUniform(locs.demOffsetScale, 3, 1, glm::value_ptr(demOS));
-  shader.SetUniform(locs.imgOffsetScale, 3, 1, glm::value_ptr(imgOS));
-  shader.SetUniform(locs.layerIMG, rdIMG ? rdIMG->getTexLayer() : 0);
-  shader.SetUniform(locs.layerDEM, rdDEM->getTexLayer());
-  shader.SetUniform(locs.edgeDelta, 4, 1, glm::value_ptr(edgeDelta));
-  shader.SetUniform(locs.edgeLayerDEM, 4, 1, glm::value_ptr(edgeLayerDEM));
-  shader.SetUniform(locs.edgeOffset, 4, 1, glm::value_ptr(edgeOffset));
-  shader.SetUniform(locs.f1f2, 2, 1, glm::value_ptr(patchF1F2));
+  data.mTileOffsetScale =
+      glm::ivec4(baseXY.y, baseXY.z, HEALPix::getNSide(idDEM), rdDEM->getTexLayer());
+  data.mDemOffsetScale = glm::ivec4(demOS, rdIMG ? rdIMG->getTexLayer() : 0);
+  data.mImgOffsetScale = glm::ivec4(imgOS, 0);
+  data.mF1F2           = glm::ivec4(HEALPix::getF1(idDEM), HEALPix::getF2(idDEM), 0, 0);
+  data.mEdgeDelta      = calcEdgeDelta(rdDEM);
+  data.mEdgeLayerDEM   = calcEdgeLayerDEM(rdDEM);
+  data.mEdgeOffset     = calcEdgeOffset(rdDEM);
 
   // order of components: N, W, S, E
-  std::array<glm::dvec3, 4> corners{};
-  std::array<glm::dvec3, 4> normals{};
-  std::array<glm::fvec3, 4> cornersViewSpace{};
-  std::array<glm::fvec3, 4> normalsViewSpace{};
-
   glm::dmat4 matNormal = glm::transpose(glm::inverse(mMatVM));
 
   for (int i(0); i < 4; ++i) {
-    corners.at(i)          = cs::utils::convert::toCartesian(cornersLngLat.at(i), mParams->mRadii,
+    glm::dvec3 corner = cs::utils::convert::toCartesian(cornersLngLat.at(i), mParams->mRadii,
         averageHeight * static_cast<float>(mParams->mHeightScale));
-    cornersViewSpace.at(i) = glm::fvec3(mMatVM * glm::dvec4(corners.at(i), 1.0));
+    glm::dvec3 normal = cs::utils::convert::lngLatToNormal(cornersLngLat.at(i), mParams->mRadii);
 
-    normals.at(i) = cs::utils::convert::lngLatToNormal(cornersLngLat.at(i), mParams->mRadii);
-    normalsViewSpace.at(i) = glm::fvec3(matNormal * glm::dvec4(normals.at(i), 0.0));
+    data.mCorners.at(i) = glm::vec4(glm::vec3(mMatVM * glm::dvec4(corner, 1.0)), 0.F);
+    data.mNormals.at(i) = glm::vec4(glm::vec3(matNormal * glm::dvec4(normal, 0.0)), 0.F);
   }
 
-  glUniform3fv(glGetUniformLocation(shader.GetProgram(), "VP_corners"), 9,
-      glm::value_ptr(cornersViewSpace[0]));
-  glUniform3fv(glGetUniformLocation(shader.GetProgram(), "VP_normals"), 4,
-      glm::value_ptr(normalsViewSpace[0]));
+  data.mCorners[0].w = averageHeight;
+}
 
-  // draw tile
-  glDrawElements(GL_TRIANGLES, idxCount, GL_UNSIGNED_INT, nullptr);
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileRenderer::useMultiDraw() const {
+  // Shader storage buffers, indirect multi-draw and the base instance of the draw commands are all
+  // part of OpenGL 4.3, but may also be available as extensions. A non-null function pointer does
+  // not imply that the driver supports them.
+  static bool const supported =
+      GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object &&
+                              GLEW_ARB_base_instance);
+
+  return mEnableMultiDraw && supported;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -663,9 +781,13 @@ void TileRenderer::init() const {
     if (!mIboTerrain) {
       mIboTerrain = makeIBOTerrain();
     }
+    if (!mVboTileIndices) {
+      mVboTileIndices = makeVBOTileIndices();
+    }
 
     if (!mVaoTerrain) {
-      mVaoTerrain = makeVAOTerrain(mVboTerrain.get(), mIboTerrain.get());
+      mVaoTerrain =
+          makeVAOTerrain(mVboTerrain.get(), mIboTerrain.get(), mVboTileIndices.get());
     }
   }
 
@@ -740,13 +862,41 @@ std::unique_ptr<VistaBufferObject> TileRenderer::makeIBOTerrain() {
   return result;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Construct the per-instance vertex buffer which contains the numbers 0 to maxTilesPerDraw - 1.
+// When drawing with glMultiDrawElementsIndirect, the base instance of each draw command selects
+// the index of the tile's parameters in the tile buffer.
+std::unique_ptr<VistaBufferObject> TileRenderer::makeVBOTileIndices() {
+  auto             result = std::make_unique<VistaBufferObject>();
+  GLsizeiptr const size   = maxTilesPerDraw * sizeof(GLint);
+
+  result->BindAsVertexDataBuffer();
+  result->BufferData(size, nullptr, GL_STATIC_DRAW);
+
+  auto* buffer = static_cast<GLint*>(result->MapBuffer(GL_WRITE_ONLY));
+  for (std::size_t i = 0; i < maxTilesPerDraw; ++i) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    buffer[i] = static_cast<GLint>(i);
+  }
+  result->UnmapBuffer();
+  result->Release();
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 // Sets up the VertexArrayObject for rendering a Tile
 std::unique_ptr<VistaVertexArrayObject> TileRenderer::makeVAOTerrain(
-    VistaBufferObject* vbo, VistaBufferObject* ibo) {
+    VistaBufferObject* vbo, VistaBufferObject* ibo, VistaBufferObject* tileIndices) {
   auto result = std::make_unique<VistaVertexArrayObject>();
   result->Bind();
   result->EnableAttributeArray(0);
   result->SpecifyAttributeArrayInteger(0, 2, GL_UNSIGNED_SHORT, 0, 0, vbo);
+  result->EnableAttributeArray(tileIndexLocation);
+  result->SpecifyAttributeArrayInteger(tileIndexLocation, 1, GL_INT, 0, 0, tileIndices);
+  glVertexAttribDivisor(tileIndexLocation, 1);
   result->SpecifyIndexBufferObject(ibo, GL_UNSIGNED_INT);
   result->Release();
 
@@ -955,4 +1105,16 @@ bool TileRenderer::getFaceCulling() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TileRenderer::setMultiDraw(bool enable) {
+  mEnableMultiDraw = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileRenderer::getMultiDraw() const {
+  return mEnableMultiDraw;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace csp::lodbodies
@@ -13,6 +13,7 @@
 #include <VistaOGLExt/VistaBufferObject.h>
 #include <VistaOGLExt/VistaGLSLShader.h>
 #include <VistaOGLExt/VistaVertexArrayObject.h>
+#include <array>
 #include <boost/noncopyable.hpp>
 #include <vector>
 
@@ -34,6 +35,7 @@ class TileRenderer : private boost::noncopyable {
  public:
   explicit TileRenderer(PlanetParameters const& params, TreeManagerBase* treeMgrDEM = nullptr,
       TreeManagerBase* treeMgrIMG = nullptr);
+  ~TileRenderer();
 
   TreeManagerBase* getTreeManagerDEM() const;
   void             setTreeManagerDEM(TreeManagerBase* treeMgr);
@@ -89,6 +91,14 @@ class TileRenderer : private boost::noncopyable {
   void setFaceCulling(bool enable);
   bool getFaceCulling() const;
 
+  /// Enable or disable drawing all tiles with a single glMultiDrawElementsIndirect call. The
+  /// per-tile parameters are then read from a shader storage buffer. If neither OpenGL 4.3 nor the
+  /// required extensions (ARB_multi_draw_indirect, ARB_shader_storage_buffer_object and
+  /// ARB_base_instance) are available, the tiles are drawn one after another regardless of this
+  /// setting.
+  void setMultiDraw(bool enable);
+  bool getMultiDraw() const;
+
  private:
   struct UniformLocs {
     GLint demAverageHeight;
@@ -103,10 +113,37 @@ class TileRenderer : private boost::noncopyable {
     GLint layerIMG;
   };
 
+  /// Parameters of a single tile as stored in the shader storage buffer when multi-draw is used.
+  /// This has to match the std430 layout of VP_TileData in VistaPlanetTerrainShaderUniforms.glsl.
+  struct TileData {
+    glm::ivec4               mTileOffsetScale; ///< w: texture layer of the DEM tile
+    glm::ivec4               mDemOffsetScale;  ///< w: texture layer of the IMG tile
+    glm::ivec4               mImgOffsetScale;
+    glm::ivec4               mF1F2;
+    glm::ivec4               mEdgeDelta;
+    glm::ivec4               mEdgeLayerDEM;
+    glm::ivec4               mEdgeOffset;
+    std::array<glm::vec4, 4> mCorners; ///< view space, w of the first one: average height
+    std::array<glm::vec4, 4> mNormals; ///< view space
+  };
+
+  /// Layout of the commands read by glMultiDrawElementsIndirect.
+  struct DrawCommand {
+    GLuint mCount;
+    GLuint mInstanceCount;
+    GLuint mFirstIndex;
+    GLint  mBaseVertex;
+    GLuint mBaseInstance;
+  };
+
   void preRenderTiles(cs::graphics::ShadowMap* shadowMap);
   void renderTiles(
       std::vector<RenderData*> const& renderDEM, std::vector<RenderData*> const& renderIMG);
   void renderTile(RenderDataDEM* rdDEM, RenderDataImg* rdIMG, UniformLocs const& locs);
+  void renderTilesIndirect();
+  void calcTileData(
+      RenderDataDEM* rdDEM, RenderDataImg* rdIMG, TileData& data, GLuint& idxCount) const;
+  bool useMultiDraw() const;
   void postRenderTiles(cs::graphics::ShadowMap* shadowMap);
 
   void preRenderBounds();
@@ -116,8 +153,9 @@ class TileRenderer : private boost::noncopyable {
   void                                           init() const;
   static std::unique_ptr<VistaBufferObject>      makeVBOTerrain();
   static std::unique_ptr<VistaBufferObject>      makeIBOTerrain();
+  static std::unique_ptr<VistaBufferObject>      makeVBOTileIndices();
   static std::unique_ptr<VistaVertexArrayObject> makeVAOTerrain(
-      VistaBufferObject* vbo, VistaBufferObject* ibo);
+      VistaBufferObject* vbo, VistaBufferObject* ibo, VistaBufferObject* tileIndices);
 
   static std::unique_ptr<VistaBufferObject>      makeVBOBounds();
   static std::unique_ptr<VistaBufferObject>      makeIBOBounds();
@@ -135,9 +173,16 @@ class TileRenderer : private boost::noncopyable {
 
   static std::unique_ptr<VistaBufferObject>      mVboTerrain;
   static std::unique_ptr<VistaBufferObject>      mIboTerrain;
+  static std::unique_ptr<VistaBufferObject>      mVboTileIndices;
   static std::unique_ptr<VistaVertexArrayObject> mVaoTerrain;
   TerrainShader*                                 mProgTerrain;
 
+  // Per-frame data for multi-draw rendering. The buffers are allocated on first use.
+  std::vector<TileData>    mTileData;
+  std::vector<DrawCommand> mDrawCommands;
+  GLuint                   mTileDataBuffer    = 0U;
+  GLuint                   mDrawCommandBuffer = 0U;
+
   static std::unique_ptr<VistaBufferObject>      mVboBounds;
   static std::unique_ptr<VistaBufferObject>      mIboBounds;
   static std::unique_ptr<VistaVertexArrayObject> mVaoBounds;
@@ -148,6 +193,7 @@ class TileRenderer : private boost::noncopyable {
   bool mEnableDrawBounds;
   bool mEnableWireframe;
   bool mEnableFaceCulling;
+  bool mEnableMultiDraw;
 };
 
 } // namespace csp::lodbodies
@@ -0,0 +1,23 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILEREQUEST_HPP
+#define CSP_LOD_BODIES_TILEREQUEST_HPP
+
+#include "TileId.hpp"
+
+namespace csp::lodbodies {
+
+/// A tile which should be loaded together with the urgency of the request. Of all requests which
+/// are waiting for the TileSource, the ones with the highest priority are started first.
+struct TileRequest {
+  TileId mTileId;
+  double mPriority = 0.0; ///< Higher values are more urgent.
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILEREQUEST_HPP
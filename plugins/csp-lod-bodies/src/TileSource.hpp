@@ -10,6 +10,11 @@
 #include "TileDataType.hpp"
 #include "TileId.hpp"
 
+#include "../../../src/cs-utils/CancellationToken.hpp"
+
+#include <functional>
+#include <memory>
+
 namespace csp::lodbodies {
 
 class TileNode;
@@ -55,11 +60,22 @@ class TileSource {
   /// Optionally the node to store data in is passed as node - it must own a Tile of correct type or
   /// not own a tile at all (in which case a new one is allocated). If node is a nullptr a new node
   /// is allocated. Once the node is loaded the given OnLoadCallack is invoked.
-  virtual void loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb) = 0;
+  ///
+  /// The request can be revoked with the given token. Sub-classes should check the token before
+  /// and during loading and stop early if it has been cancelled. The OnLoadCallback has to be
+  /// invoked in any case - if the request was cancelled or loading failed, it is called with a
+  /// nullptr.
+  virtual void loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb,
+      std::shared_ptr<cs::utils::CancellationToken> token) = 0;
 
   /// Returns the number of currently active async requests.
   virtual int getPendingRequests() = 0;
 
+  /// Returns the number of async requests which the source can work on at the same time. The
+  /// TreeManagerBase passes at most this many requests to the source, the others are queued in the
+  /// order of their priority until a running request is finished.
+  virtual uint32_t getMaxConcurrentRequests() const = 0;
+
   /// Derived classes should check whether the given TileSource has the same type and members. This
   /// is used to prevent redundant tile source reloading.
   virtual bool isSame(TileSource const* other) const = 0;
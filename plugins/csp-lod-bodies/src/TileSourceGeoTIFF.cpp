@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileSourceGeoTIFF.hpp"
+
+#include "GeoTIFFReader.hpp"
+#include "TileAssembler.hpp"
+#include "TileNode.hpp"
+#include "logger.hpp"
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<TileNode> loadTile(TileSourceGeoTIFF* source, int level, glm::int64 patchIdx,
+    cs::utils::CancellationToken const* token) {
+  return assembleTile(
+      source->getDataType(), level, patchIdx, source->getMaxLevel(),
+      [source](int l, int x, int y, void* pixels) {
+        try {
+          source->readData(l, x, y, pixels);
+        } catch (std::exception const& e) {
+          logger().error("Tile loading failed: {}", e.what());
+          return false;
+        }
+
+        return true;
+      },
+      nullptr, token);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* explicit */
+TileSourceGeoTIFF::TileSourceGeoTIFF(uint32_t threads)
+    : mThreads(threads)
+    , mThreadPool(threads) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileSourceGeoTIFF::~TileSourceGeoTIFF() = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* virtual */ TileNode* TileSourceGeoTIFF::loadTile(int level, glm::int64 patchIdx) {
+  return csp::lodbodies::loadTile(this, level, patchIdx, nullptr).release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* virtual */ void TileSourceGeoTIFF::loadTileAsync(int level, glm::int64 patchIdx,
+    OnLoadCallback cb, std::shared_ptr<cs::utils::CancellationToken> token) {
+  // Nothing can be drawn before the base patches are loaded, so these are more urgent than anything
+  // else.
+  auto priority = level == 0 ? cs::utils::ThreadPool::Priority::eHigh
+                             : cs::utils::ThreadPool::Priority::eNormal;
+
+  mThreadPool.enqueue(
+      [=]() {
+        auto node = csp::lodbodies::loadTile(this, level, patchIdx, token.get());
+        cb(this, level, patchIdx, node.release());
+      },
+      priority);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileSourceGeoTIFF::getPendingRequests() {
+  return static_cast<int>(mThreadPool.getPendingTaskCount() + mThreadPool.getRunningTaskCount());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t TileSourceGeoTIFF::getMaxConcurrentRequests() const {
+  return mThreads;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceGeoTIFF::readData(int level, int x, int y, void* pixels) {
+  auto reader = getReader();
+
+  if (!reader) {
+    throw std::runtime_error("Cannot open '" + mFile + "'!");
+  }
+
+  double     size = 1.0 / (1 << level);
+  glm::dvec2 min(x * size, y * size);
+
+  reader->read(min, min + size, pixels);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<GeoTIFFReader> TileSourceGeoTIFF::getReader() {
+  std::unique_lock<std::mutex> lock(mReaderMutex);
+
+  if (!mReader && !mOpenFailed) {
+    try {
+      mReader = std::make_shared<GeoTIFFReader>(mFile, mFormat, mThreads);
+    } catch (std::exception const& e) {
+      // Do not try again for each tile.
+      logger().error("Failed to open GeoTIFF: {}", e.what());
+      mOpenFailed = true;
+    }
+  }
+
+  return mReader;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceGeoTIFF::setMaxLevel(uint32_t maxLevel) {
+  mMaxLevel = maxLevel;
+}
+
+uint32_t TileSourceGeoTIFF::getMaxLevel() const {
+  return mMaxLevel;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceGeoTIFF::setFile(std::string const& file) {
+  std::unique_lock<std::mutex> lock(mReaderMutex);
+  mFile = file;
+  mReader.reset();
+  mOpenFailed = false;
+}
+
+std::string const& TileSourceGeoTIFF::getFile() const {
+  return mFile;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceGeoTIFF::setDataType(TileDataType type) {
+  std::unique_lock<std::mutex> lock(mReaderMutex);
+  mFormat = type;
+  mReader.reset();
+  mOpenFailed = false;
+}
+
+TileDataType TileSourceGeoTIFF::getDataType() const {
+  return mFormat;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileSourceGeoTIFF::isSame(TileSource const* other) const {
+  auto const* casted = dynamic_cast<TileSourceGeoTIFF const*>(other);
+
+  return casted != nullptr && mFile == casted->mFile && mFormat == casted->mFormat &&
+         mMaxLevel == casted->mMaxLevel;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILESOURCEGEOTIFF_HPP
+#define CSP_LOD_BODIES_TILESOURCEGEOTIFF_HPP
+
+#include "../../../src/cs-utils/ThreadPool.hpp"
+#include "TileSource.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace csp::lodbodies {
+
+class GeoTIFFReader;
+
+/// The data of the tiles is read from a local GeoTIFF file, no map server is required. The raster
+/// has to use the same HEALPix projection (EPSG:900914) as the map server, usually it will be one
+/// of the files the map server would read. For good performance at coarse levels, it should
+/// contain overviews, e.g. as a Cloud Optimized GeoTIFF. See GeoTIFFReader for the supported
+/// sample formats.
+class TileSourceGeoTIFF : public TileSource {
+ public:
+  /// Tiles are read by the given number of threads in parallel.
+  explicit TileSourceGeoTIFF(uint32_t threads = 8);
+
+  TileSourceGeoTIFF(TileSourceGeoTIFF const& other) = delete;
+  TileSourceGeoTIFF(TileSourceGeoTIFF&& other)      = delete;
+
+  TileSourceGeoTIFF& operator=(TileSourceGeoTIFF const& other) = delete;
+  TileSourceGeoTIFF& operator=(TileSourceGeoTIFF&& other) = delete;
+
+  ~TileSourceGeoTIFF() override;
+
+  void init() override {
+  }
+
+  void fini() override {
+  }
+
+  TileNode* loadTile(int level, glm::int64 patchIdx) override;
+
+  void loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb,
+      std::shared_ptr<cs::utils::CancellationToken> token) override;
+  int      getPendingRequests() override;
+  uint32_t getMaxConcurrentRequests() const override;
+
+  void     setMaxLevel(uint32_t maxLevel);
+  uint32_t getMaxLevel() const;
+
+  void               setFile(std::string const& file);
+  std::string const& getFile() const;
+
+  void         setDataType(TileDataType type);
+  TileDataType getDataType() const override;
+
+  bool isSame(TileSource const* other) const override;
+
+  /// Reads the map tile at x, y into pixels, see ReadMapTile. Throws a std::runtime_error if the
+  /// file cannot be read.
+  void readData(int level, int x, int y, void* pixels);
+
+ private:
+  /// Opens the file if that has not been done yet.
+  std::shared_ptr<GeoTIFFReader> getReader();
+
+  uint32_t mThreads;
+
+  std::string  mFile;
+  TileDataType mFormat   = TileDataType::eU8Vec3;
+  uint32_t     mMaxLevel = 10;
+
+  std::mutex                     mReaderMutex;
+  std::shared_ptr<GeoTIFFReader> mReader;
+  bool                           mOpenFailed = false;
+
+  // The pool is destroyed first, so that running tasks can still use the members above.
+  cs::utils::ThreadPool mThreadPool;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILESOURCEGEOTIFF_HPP
@@ -0,0 +1,380 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileSourceProcedural.hpp"
+
+#include "HEALPix.hpp"
+#include "MinMaxPyramid.hpp"
+#include "Tile.hpp"
+#include "TileNode.hpp"
+
+#include "../../../src/cs-utils/convert.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The number of samples in each direction of a tile.
+int const TileSize = 257;
+
+// The frequency of the first noise octave on the unit sphere.
+double const BaseFrequency = 2.0;
+
+// Delays are split into steps of this length, so that cancelled requests are noticed early.
+auto const SleepStep = std::chrono::milliseconds(5);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Maps the integer lattice position to a pseudo-random value in [-1, 1]. This uses the finalizer
+// of SplitMix64 to mix the coordinates.
+double latticeValue(glm::i64vec3 const& p, uint32_t seed) {
+  uint64_t h = seed;
+  h ^= static_cast<uint64_t>(p.x) * 0x9E3779B97F4A7C15ULL;
+  h ^= static_cast<uint64_t>(p.y) * 0xC2B2AE3D27D4EB4FULL;
+  h ^= static_cast<uint64_t>(p.z) * 0x165667B19E3779F9ULL;
+
+  h = (h ^ (h >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+  h = (h ^ (h >> 27U)) * 0x94D049BB133111EBULL;
+  h = h ^ (h >> 31U);
+
+  return static_cast<double>(h >> 11U) / static_cast<double>(1ULL << 52U) - 1.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Trilinearly interpolated value noise with smoothed weights, the result is in [-1, 1].
+double valueNoise(glm::dvec3 const& p, uint32_t seed) {
+  glm::dvec3   cell = glm::floor(p);
+  glm::dvec3   f    = p - cell;
+  glm::dvec3   w    = f * f * (3.0 - 2.0 * f);
+  glm::i64vec3 i(cell);
+
+  std::array<double, 8> v{};
+  for (int c = 0; c < 8; ++c) {
+    v.at(c) = latticeValue(i + glm::i64vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1), seed);
+  }
+
+  double x0 = glm::mix(glm::mix(v[0], v[1], w.x), glm::mix(v[2], v[3], w.x), w.y);
+  double x1 = glm::mix(glm::mix(v[4], v[5], w.x), glm::mix(v[6], v[7], w.x), w.y);
+
+  return glm::mix(x0, x1, w.z);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Sums the given number of noise octaves at the position on the unit sphere. The result is in
+// [-1, 1].
+double fractalNoise(glm::dvec3 const& p, uint32_t seed, int octaves) {
+  double sum       = 0.0;
+  double total     = 0.0;
+  double amplitude = 1.0;
+  double frequency = BaseFrequency;
+
+  for (int o = 0; o < octaves; ++o) {
+    // Each octave uses different lattice values, otherwise all octaves would share a feature at
+    // the origin.
+    sum += amplitude * valueNoise(p * frequency, seed + static_cast<uint32_t>(o) * 7919U);
+    total += amplitude;
+    amplitude *= 0.5;
+    frequency *= 2.0;
+  }
+
+  return total > 0.0 ? sum / total : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Maps a normalized height in [-1, 1] to a color from deep water to snow.
+glm::u8vec3 colorRamp(double height) {
+  struct Stop {
+    double     mHeight;
+    glm::dvec3 mColor;
+  };
+
+  static std::array<Stop, 6> const stops{{
+      {-1.0, glm::dvec3(10, 20, 80)},
+      {0.0, glm::dvec3(40, 110, 180)},
+      {0.02, glm::dvec3(200, 190, 140)},
+      {0.2, glm::dvec3(60, 130, 50)},
+      {0.5, glm::dvec3(110, 90, 70)},
+      {0.7, glm::dvec3(240, 240, 245)},
+  }};
+
+  if (height <= stops.front().mHeight) {
+    return glm::u8vec3(stops.front().mColor);
+  }
+
+  for (std::size_t i = 1; i < stops.size(); ++i) {
+    if (height <= stops.at(i).mHeight) {
+      Stop const& a = stops.at(i - 1);
+      Stop const& b = stops.at(i);
+      double      t = (height - a.mHeight) / (b.mHeight - a.mHeight);
+      return glm::u8vec3(glm::mix(a.mColor, b.mColor, t));
+    }
+  }
+
+  return glm::u8vec3(stops.back().mColor);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void convert(std::vector<double> const& heights, double amplitude, Tile<float>* tile) {
+  std::transform(heights.begin(), heights.end(), tile->data().begin(),
+      [amplitude](double h) { return static_cast<float>(h * amplitude); });
+
+  tile->setMinMaxPyramid(std::make_unique<MinMaxPyramid>(tile));
+}
+
+void convert(std::vector<double> const& heights, double /*amplitude*/, Tile<glm::uint8>* tile) {
+  std::transform(heights.begin(), heights.end(), tile->data().begin(),
+      [](double h) { return static_cast<glm::uint8>((h * 0.5 + 0.5) * 255.0 + 0.5); });
+}
+
+void convert(std::vector<double> const& heights, double /*amplitude*/, Tile<glm::u8vec3>* tile) {
+  std::transform(heights.begin(), heights.end(), tile->data().begin(), &colorRamp);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+std::unique_ptr<TileNode> createNode(int level, glm::int64 patchIdx, uint32_t maxLevel,
+    double amplitude, std::vector<double> const& heights) {
+  auto node = std::make_unique<TileNode>();
+
+  node->setTile(std::make_unique<Tile<T>>(level, patchIdx));
+  node->setChildMaxLevel(std::min(static_cast<uint32_t>(level) + 1, maxLevel));
+
+  convert(heights, amplitude, static_cast<Tile<T>*>(node->getTile()));
+
+  return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* explicit */
+TileSourceProcedural::TileSourceProcedural(uint32_t threads)
+    : mThreads(threads)
+    , mThreadPool(threads) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileSourceProcedural::~TileSourceProcedural() = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* virtual */ TileNode* TileSourceProcedural::loadTile(int level, glm::int64 patchIdx) {
+  return generateTile(level, patchIdx, nullptr).release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* virtual */ void TileSourceProcedural::loadTileAsync(int level, glm::int64 patchIdx,
+    OnLoadCallback cb, std::shared_ptr<cs::utils::CancellationToken> token) {
+  // Nothing can be drawn before the base patches are loaded, so these are more urgent than anything
+  // else.
+  auto priority = level == 0 ? cs::utils::ThreadPool::Priority::eHigh
+                             : cs::utils::ThreadPool::Priority::eNormal;
+
+  mThreadPool.enqueue(
+      [=]() {
+        auto node = generateTile(level, patchIdx, token.get());
+        cb(this, level, patchIdx, node.release());
+      },
+      priority);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileSourceProcedural::getPendingRequests() {
+  return static_cast<int>(mThreadPool.getPendingTaskCount() + mThreadPool.getRunningTaskCount());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t TileSourceProcedural::getMaxConcurrentRequests() const {
+  return mThreads;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<TileNode> TileSourceProcedural::generateTile(
+    int level, glm::int64 patchIdx, cs::utils::CancellationToken const* token) {
+
+  double latency{};
+  bool   fail{};
+
+  {
+    std::unique_lock<std::mutex>           lock(mRandomMutex);
+    std::uniform_real_distribution<double> random(0.0, 1.0);
+    latency = mLatency * (0.5 + random(mRandom));
+    fail    = random(mRandom) < mFailureRate;
+  }
+
+  // Simulate the time it takes the map server to answer.
+  auto end = std::chrono::steady_clock::now() +
+             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                 std::chrono::duration<double, std::milli>(latency));
+
+  for (auto now = std::chrono::steady_clock::now(); now < end;
+       now      = std::chrono::steady_clock::now()) {
+    if (token && token->isCancelled()) {
+      return nullptr;
+    }
+
+    std::this_thread::sleep_for(
+        std::min<std::chrono::steady_clock::duration>(SleepStep, end - now));
+  }
+
+  if (token && token->isCancelled()) {
+    return nullptr;
+  }
+
+  if (fail) {
+    ++mFailedTiles;
+    return nullptr;
+  }
+
+  // Sample the noise at the positions of all vertices of the tile. The vertices are distributed
+  // regularly in the HEALPix base patch, the first index runs along the base patch's x direction.
+  glm::dvec3          offsetScale = HEALPix::getPatchOffsetScale(TileId(level, patchIdx));
+  int                 basePatch   = HEALPix::getBasePatch(TileId(level, patchIdx));
+  std::vector<double> heights(TileSize * TileSize);
+
+  for (int y = 0; y < TileSize; ++y) {
+    for (int x = 0; x < TileSize; ++x) {
+      double     bx     = offsetScale.x + offsetScale.z * x / (TileSize - 1.0);
+      double     by     = offsetScale.y + offsetScale.z * y / (TileSize - 1.0);
+      glm::dvec2 lngLat = HEALPix::convertBaseXY2LngLat(basePatch, bx, by);
+      glm::dvec3 pos    = cs::utils::convert::toCartesian(lngLat, glm::dvec3(1.0));
+
+      heights[y * TileSize + x] = fractalNoise(pos, mSeed, mOctaves);
+    }
+  }
+
+  std::unique_ptr<TileNode> node;
+
+  if (mFormat == TileDataType::eFloat32) {
+    node = createNode<float>(level, patchIdx, mMaxLevel, mAmplitude, heights);
+  } else if (mFormat == TileDataType::eUInt8) {
+    node = createNode<glm::uint8>(level, patchIdx, mMaxLevel, mAmplitude, heights);
+  } else {
+    node = createNode<glm::u8vec3>(level, patchIdx, mMaxLevel, mAmplitude, heights);
+  }
+
+  ++mGeneratedTiles;
+
+  return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceProcedural::setMaxLevel(uint32_t maxLevel) {
+  mMaxLevel = maxLevel;
+}
+
+uint32_t TileSourceProcedural::getMaxLevel() const {
+  return mMaxLevel;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceProcedural::setDataType(TileDataType type) {
+  mFormat = type;
+}
+
+TileDataType TileSourceProcedural::getDataType() const {
+  return mFormat;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceProcedural::setSeed(uint32_t seed) {
+  std::unique_lock<std::mutex> lock(mRandomMutex);
+  mSeed = seed;
+  mRandom.seed(seed);
+}
+
+uint32_t TileSourceProcedural::getSeed() const {
+  return mSeed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceProcedural::setOctaves(int octaves) {
+  mOctaves = octaves;
+}
+
+int TileSourceProcedural::getOctaves() const {
+  return mOctaves;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceProcedural::setAmplitude(double meters) {
+  mAmplitude = meters;
+}
+
+double TileSourceProcedural::getAmplitude() const {
+  return mAmplitude;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceProcedural::setLatency(double milliseconds) {
+  mLatency = milliseconds;
+}
+
+double TileSourceProcedural::getLatency() const {
+  return mLatency;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceProcedural::setFailureRate(double rate) {
+  mFailureRate = rate;
+}
+
+double TileSourceProcedural::getFailureRate() const {
+  return mFailureRate;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t TileSourceProcedural::getGeneratedTileCount() const {
+  return mGeneratedTiles;
+}
+
+uint64_t TileSourceProcedural::getFailedTileCount() const {
+  return mFailedTiles;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileSourceProcedural::isSame(TileSource const* other) const {
+  auto const* casted = dynamic_cast<TileSourceProcedural const*>(other);
+
+  return casted != nullptr && mFormat == casted->mFormat && mMaxLevel == casted->mMaxLevel &&
+         mSeed == casted->mSeed && mOctaves == casted->mOctaves &&
+         mAmplitude == casted->mAmplitude && mLatency == casted->mLatency &&
+         mFailureRate == casted->mFailureRate;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
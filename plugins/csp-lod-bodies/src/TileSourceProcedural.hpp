@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILESOURCEPROCEDURAL_HPP
+#define CSP_LOD_BODIES_TILESOURCEPROCEDURAL_HPP
+
+#include "../../../src/cs-utils/ThreadPool.hpp"
+#include "TileSource.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+
+namespace csp::lodbodies {
+
+/// Generates tiles of a synthetic fractal terrain instead of loading them. This makes it possible
+/// to exercise the whole level-of-detail pipeline in tests and benchmarks without any network
+/// access or data on disk.
+///
+/// The terrain is fractal value noise evaluated on the unit sphere, so the content of a tile only
+/// depends on its level and patchIdx and on the seed, the octaves and the amplitude of the source.
+/// Neighbouring tiles match seamlessly. Elevation tiles contain heights in meters, gray tiles the
+/// height mapped to [0, 255] and image tiles a simple color ramp from deep water to snow.
+///
+/// In order to simulate a map server, the loading of each tile can be delayed and a fraction of
+/// the requests can be made to fail. These effects are random, but the random numbers are drawn
+/// from a generator with the same seed, so single threaded runs are reproducible.
+///
+/// The settings should not be changed while tiles are being loaded.
+class TileSourceProcedural : public TileSource {
+ public:
+  /// Tiles are generated by the given number of threads in parallel.
+  explicit TileSourceProcedural(uint32_t threads = 4);
+
+  TileSourceProcedural(TileSourceProcedural const& other) = delete;
+  TileSourceProcedural(TileSourceProcedural&& other)      = delete;
+
+  TileSourceProcedural& operator=(TileSourceProcedural const& other) = delete;
+  TileSourceProcedural& operator=(TileSourceProcedural&& other) = delete;
+
+  ~TileSourceProcedural() override;
+
+  void init() override {
+  }
+
+  void fini() override {
+  }
+
+  TileNode* loadTile(int level, glm::int64 patchIdx) override;
+
+  void loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb,
+      std::shared_ptr<cs::utils::CancellationToken> token) override;
+  int      getPendingRequests() override;
+  uint32_t getMaxConcurrentRequests() const override;
+
+  void     setMaxLevel(uint32_t maxLevel);
+  uint32_t getMaxLevel() const;
+
+  void         setDataType(TileDataType type);
+  TileDataType getDataType() const override;
+
+  /// The seed of the terrain and of the random latencies and failures.
+  void     setSeed(uint32_t seed);
+  uint32_t getSeed() const;
+
+  /// The number of noise octaves. Each octave doubles the frequency and halves the amplitude of
+  /// the previous one. More octaves give more detail at deep levels but take longer to compute.
+  void setOctaves(int octaves);
+  int  getOctaves() const;
+
+  /// The maximum height of elevation tiles in meters.
+  void   setAmplitude(double meters);
+  double getAmplitude() const;
+
+  /// The average time in milliseconds it takes to load a tile. The actual delay of each tile is
+  /// uniformly distributed between half and one and a half times this value.
+  void   setLatency(double milliseconds);
+  double getLatency() const;
+
+  /// The probability in [0, 1] that loading a tile fails.
+  void   setFailureRate(double rate);
+  double getFailureRate() const;
+
+  /// The number of tiles which have been generated and the number of simulated failures since the
+  /// source has been created. Cancelled requests are not counted.
+  uint64_t getGeneratedTileCount() const;
+  uint64_t getFailedTileCount() const;
+
+  bool isSame(TileSource const* other) const override;
+
+ private:
+  std::unique_ptr<TileNode> generateTile(
+      int level, glm::int64 patchIdx, cs::utils::CancellationToken const* token);
+
+  uint32_t mThreads;
+
+  uint32_t     mMaxLevel    = 15;
+  TileDataType mFormat      = TileDataType::eFloat32;
+  uint32_t     mSeed        = 0;
+  int          mOctaves     = 8;
+  double       mAmplitude   = 8000.0;
+  double       mLatency     = 0.0;
+  double       mFailureRate = 0.0;
+
+  std::mutex   mRandomMutex;
+  std::mt19937 mRandom{0};
+
+  std::atomic<uint64_t> mGeneratedTiles{0};
+  std::atomic<uint64_t> mFailedTiles{0};
+
+  // The pool is destroyed first, so that running tasks can still use the members above.
+  cs::utils::ThreadPool mThreadPool;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILESOURCEPROCEDURAL_HPP
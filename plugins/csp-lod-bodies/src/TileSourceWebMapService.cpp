@@ -6,19 +6,21 @@
 
 #include "TileSourceWebMapService.hpp"
 
+#include "DecodedTileCache.hpp"
+#include "FetchEngine.hpp"
 #include "HEALPix.hpp"
+#include "TileAssembler.hpp"
 #include "TileNode.hpp"
+#include "TilePackCache.hpp"
 #include "logger.hpp"
 
 #include "../../../src/cs-utils/filesystem.hpp"
 
+#include <algorithm>
 #include <boost/filesystem.hpp>
-#include <curlpp/Easy.hpp>
-#include <curlpp/Info.hpp>
-#include <curlpp/Infos.hpp>
-#include <curlpp/Options.hpp>
-#include <curlpp/cURLpp.hpp>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -26,6 +28,7 @@
 #include <stb_image.h>
 
 #include <tiffio.h>
+#include <tiffio.hxx>
 
 namespace csp::lodbodies {
 
@@ -35,89 +38,69 @@ namespace {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-enum class CopyPixels { eAll, eAboveDiagonal, eBelowDiagonal };
+// The file extension of cached tiles of the given type.
+std::string getFileType(TileDataType type) {
+  return type == TileDataType::eFloat32 ? "tiff" : "png";
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-template <typename T>
-bool loadImpl(
-    TileSourceWebMapService* source, TileNode* node, int level, int x, int y, CopyPixels which) {
-  auto        tile = static_cast<Tile<T>*>(node->getTile());
-  std::string cacheFile;
+// Downloads the map tile at level, x, y and decodes it to pixels, see ReadMapTile.
+bool readMapTile(TileSourceWebMapService* source, int level, int x, int y, void* pixels,
+    cs::utils::CancellationToken const* token) {
+  std::string encoded;
 
   try {
-    cacheFile = source->loadData(level, x, y);
+    encoded = source->loadData(level, x, y);
   } catch (std::exception const& e) {
     logger().error("Tile loading failed: {}", e.what());
     return false;
   }
 
-  if (tile->getDataType() == TileDataType::eFloat32) {
+  // The download may have taken a while, skip decoding if the tile is not needed anymore.
+  if (token && token->isCancelled()) {
+    return false;
+  }
+
+  if (source->getDataType() == TileDataType::eFloat32) {
     TIFFSetWarningHandler(nullptr);
-    auto* data = TIFFOpen(cacheFile.c_str(), "r");
+    std::istringstream stream(encoded);
+    auto*              data = TIFFStreamOpen("tile", static_cast<std::istream*>(&stream));
     if (!data) {
-      logger().error("Tile loading failed: Cannot open '{}' with libtiff!", cacheFile);
+      logger().error("Tile loading failed: Cannot decode tile {}/{}/{} with libtiff!", level, x, y);
       return false;
     }
 
     int imagelength{};
     TIFFGetField(data, TIFFTAG_IMAGELENGTH, &imagelength);
-    for (int y = 0; y < imagelength; y++) {
-      if (which == CopyPixels::eAll) {
-        TIFFReadScanline(data, &tile->data()[257 * y], y);
-      } else if (which == CopyPixels::eAboveDiagonal) {
-        std::array<float, 257> tmp{};
-        TIFFReadScanline(data, tmp.data(), y);
-        int offset = 257 * y;
-        int count  = 257 - y - 1;
-
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-        std::memcpy(tile->data().data() + offset, tmp.data(), count * sizeof(float));
-      } else if (which == CopyPixels::eBelowDiagonal) {
-        std::array<float, 257> tmp{};
-        TIFFReadScanline(data, tmp.data(), y);
-        int offset = 257 * y + (257 - y);
-        int count  = y;
-
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-        std::memcpy(tile->data().data() + offset, tmp.data() + 257 - y, count * sizeof(float));
-      }
+    for (int row = 0; row < std::min(imagelength, 257); row++) {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      TIFFReadScanline(data, static_cast<float*>(pixels) + 257 * row, row);
     }
     TIFFClose(data);
   } else {
     int width{};
     int height{};
     int bpp{};
-    int channels = tile->getDataType() == TileDataType::eU8Vec3 ? 3 : 1;
+    int channels = source->getDataType() == TileDataType::eU8Vec3 ? 3 : 1;
 
-    auto* data =
-        reinterpret_cast<T*>(stbi_load(cacheFile.c_str(), &width, &height, &bpp, channels));
+    auto* data = stbi_load_from_memory(reinterpret_cast<stbi_uc const*>(encoded.data()),
+        static_cast<int>(encoded.size()), &width, &height, &bpp, channels);
 
     if (!data) {
-      logger().error("Tile loading failed: Cannot open '{}' with stbi!", cacheFile);
+      logger().error("Tile loading failed: Cannot decode tile {}/{}/{} with stbi!", level, x, y);
       return false;
     }
 
-    if (which == CopyPixels::eAll) {
-      std::memcpy(tile->data().data(), data, channels * width * height);
-    } else if (which == CopyPixels::eAboveDiagonal) {
-      for (int y = 0; y < height; ++y) {
-        int offset = width * y;
-        int count  = channels * (width - y - 1);
-
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-        std::memcpy(tile->data().data() + offset, data + offset, count);
-      }
-    } else if (which == CopyPixels::eBelowDiagonal) {
-      for (int y = 0; y < height; ++y) {
-        int offset = width * y + (width - y);
-        int count  = channels * y;
-
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-        std::memcpy(tile->data().data() + offset, data + offset, count);
-      }
+    if (width != 257 || height != 257) {
+      logger().error("Tile loading failed: Tile {}/{}/{} has a size of {}x{} pixels instead of "
+                     "257x257!",
+          level, x, y, width, height);
+      stbi_image_free(data);
+      return false;
     }
 
+    std::memcpy(pixels, data, channels * width * height);
     stbi_image_free(data);
   }
 
@@ -126,102 +109,14 @@ bool loadImpl(
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-template <typename T>
-void fillDiagonal(TileNode* node) {
-  auto tile = static_cast<Tile<T>*>(node->getTile());
-  for (int y = 1; y <= 257; y++) {
-    int pixelPos           = y * (257 - 1);
-    tile->data()[pixelPos] = (y < 257) ? tile->data()[pixelPos - 1] : tile->data()[pixelPos + 1];
-  }
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-template <typename T>
-TileNode* loadImpl(TileSourceWebMapService* source, uint32_t level, glm::int64 patchIdx) {
-  auto* node = new TileNode(); // NOLINT(cppcoreguidelines-owning-memory): TODO this is bad!
-
-  node->setTile(std::make_unique<Tile<T>>(level, patchIdx));
-  node->setChildMaxLevel(std::min(level + 1, source->getMaxLevel()));
-
-  int  x{};
-  int  y{};
-  bool onDiag = csp::lodbodies::TileSourceWebMapService::getXY(level, patchIdx, x, y);
-  if (onDiag) {
-    if (!loadImpl<T>(source, node, level, x, y, CopyPixels::eBelowDiagonal)) {
-      delete node; // NOLINT(cppcoreguidelines-owning-memory): TODO this is bad!
-      return nullptr;
-    }
-
-    x += 4 * (1 << level);
-    y -= 4 * (1 << level);
-
-    if (!loadImpl<T>(source, node, level, x, y, CopyPixels::eAboveDiagonal)) {
-      delete node; // NOLINT(cppcoreguidelines-owning-memory): TODO this is bad!
-      return nullptr;
-    }
-
-    fillDiagonal<T>(node);
-  } else {
-    if (!loadImpl<T>(source, node, level, x, y, CopyPixels::eAll)) {
-      delete node; // NOLINT(cppcoreguidelines-owning-memory): TODO this is bad!
-      return nullptr;
-    }
-  }
-
-  // TODO: the NE and NW edges of all tiles should contain the values of the
-  // respective neighbours (for tile stiching). This is done by increasing the
-  // bounding box of the request by one pixel - this works more or less in the
-  // general case, but it doesn't when we are at a base patch border of the
-  // northern hemisphere. In this case we will get empty pixels! Therefore we
-  // fill the last column and row by copying.
-  // The proper solution would load the real neighbouring tiles and copy the
-  // pixel values!
-
-  auto         tile   = static_cast<Tile<T>*>(node->getTile());
-  glm::i64vec3 baseXY = HEALPix::getBaseXY(TileId(level, patchIdx));
-  glm::int64   nSide  = HEALPix::getNSide(TileId(level, patchIdx));
-
-  // northern hemisphere
-  if (baseXY.x < 4) {
-    // at north west boundary of base patch
-    if (baseXY.z == nSide - 1) {
-      // copy second pixel row to first
-      for (int i = 0; i < 257; i++) {
-        tile->data()[i + 257] = tile->data()[i + 257 * 2];
-        tile->data()[i]       = tile->data()[i + 257 * 2];
-      }
-    }
-
-    // at north east boundary of base patch
-    if (baseXY.y == nSide - 1) {
-      // copy last pixel column to last but one
-      for (int i = 0; i < 257; i++) {
-        tile->data()[i * 257 + 255] = tile->data()[i * 257 + 254];
-        tile->data()[i * 257 + 256] = tile->data()[i * 257 + 254];
-      }
-    }
-  }
-
-  // flip y --- that shouldn't be requiered, but somehow is how it was
-  // implemented in the original databases
-  for (int i = 0; i < 257 / 2; i++) {
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    std::swap_ranges(tile->data().data() + i * 257, tile->data().data() + (i + 1) * 257,
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-        tile->data().data() + (256 - i) * 257);
-  }
-
-  if (tile->getDataType() == TileDataType::eFloat32) {
-    // Creating a MinMaxPyramid alongside the sampling beginning with a resolution of
-    // 128x128
-    // The MinMaxPyramid is later needed to deduce height information from this
-    // coarser level DEM tile to deeper level IMG tiles
-    auto* demTile = reinterpret_cast<Tile<float>*>(tile);
-    demTile->setMinMaxPyramid(std::make_unique<MinMaxPyramid>(demTile));
-  }
-
-  return node;
+std::unique_ptr<TileNode> loadTile(TileSourceWebMapService* source, int level, glm::int64 patchIdx,
+    cs::utils::CancellationToken const* token) {
+  return assembleTile(
+      source->getDataType(), level, patchIdx, source->getMaxLevel(),
+      [source, token](int l, int x, int y, void* pixels) {
+        return readMapTile(source, l, x, y, pixels, token);
+      },
+      source->getDecodedCache(), token);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -234,24 +129,20 @@ std::mutex TileSourceWebMapService::mTileSystemMutex;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-TileSourceWebMapService::TileSourceWebMapService()
-    : mThreadPool(32) {
+/* explicit */
+TileSourceWebMapService::TileSourceWebMapService(uint32_t threads)
+    : mFetchEngine(std::make_unique<FetchEngine>(threads))
+    , mThreadPool(threads) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-/* virtual */ TileNode* TileSourceWebMapService::loadTile(int level, glm::int64 patchIdx) {
-  if (mFormat == TileDataType::eFloat32) {
-    return loadImpl<float>(this, level, patchIdx);
-  }
-  if (mFormat == TileDataType::eUInt8) {
-    return loadImpl<glm::uint8>(this, level, patchIdx);
-  }
-  if (mFormat == TileDataType::eU8Vec3) {
-    return loadImpl<glm::u8vec3>(this, level, patchIdx);
-  }
+TileSourceWebMapService::~TileSourceWebMapService() = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  throw std::domain_error(fmt::format("Unsupported format: {}!", mFormat));
+/* virtual */ TileNode* TileSourceWebMapService::loadTile(int level, glm::int64 patchIdx) {
+  return csp::lodbodies::loadTile(this, level, patchIdx, nullptr).release();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -286,24 +177,16 @@ bool TileSourceWebMapService::getXY(int level, glm::int64 patchIdx, int& x, int&
 std::string TileSourceWebMapService::loadData(int level, int x, int y) {
 
   std::string format;
-  std::string type;
+  std::string type = getFileType(mFormat);
 
   if (mFormat == TileDataType::eFloat32) {
     format = "tiffGray";
-    type   = "tiff";
   } else if (mFormat == TileDataType::eU8Vec3) {
     format = "pngRGB";
-    type   = "png";
   } else {
     format = "pngGray";
-    type   = "png";
   }
 
-  std::stringstream cacheDir;
-  cacheDir << mCache << "/" << mLayers << "/" << level << "/" << x;
-
-  std::stringstream cacheFile(cacheDir.str());
-  cacheFile << cacheDir.str() << "/" << y << "." << type;
   std::stringstream url;
 
   double size = 1.0 / (1 << level);
@@ -313,16 +196,34 @@ std::string TileSourceWebMapService::loadData(int level, int x, int y) {
       << "&bbox=" << x * size << "," << y * size << "," << x * size + size << "," << y * size + size
       << "&width=257&height=257&srs=EPSG:900914&format=" << format;
 
+  // The pack stores the tiles with the same key as the directory based cache below.
+  auto        pack = getCachePack();
+  std::string packLayer(mLayers + "." + type);
+
+  if (pack) {
+    auto data = pack->read(packLayer, level, x, y);
+    if (data) {
+      return *data;
+    }
+  }
+
+  std::stringstream cacheDir;
+  cacheDir << mCache << "/" << mLayers << "/" << level << "/" << x;
+
+  std::stringstream cacheFile(cacheDir.str());
+  cacheFile << cacheDir.str() << "/" << y << "." << type;
+
   auto cacheFilePath(boost::filesystem::path(cacheFile.str()));
 
   // the file is already there, we can return it
-  if (boost::filesystem::exists(cacheFilePath) &&
+  if (!pack && boost::filesystem::exists(cacheFilePath) &&
       boost::filesystem::file_size(cacheFile.str()) > 0) {
-    return cacheFile.str();
+    std::ifstream in(cacheFile.str(), std::ifstream::in | std::ifstream::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
   }
 
   // the file is corrupt not available
-  {
+  if (!pack) {
     std::unique_lock<std::mutex> lock(mTileSystemMutex);
 
     if (boost::filesystem::exists(cacheFilePath) &&
@@ -341,53 +242,134 @@ std::string TileSourceWebMapService::loadData(int level, int x, int y) {
     }
   }
 
-  bool fail = false;
-  {
-    std::ofstream out;
-    out.open(cacheFile.str(), std::ofstream::out | std::ofstream::binary);
+  // This blocks until the shared fetch engine has downloaded the tile.
+  auto response = mFetchEngine->fetch(url.str()).get();
 
-    if (!out) {
-      logger().error(
-          "Failed to download tile data: Cannot open '{}' for writing!", cacheFile.str());
-    }
+  if (!response.mError.empty()) {
+    throw std::runtime_error(response.mError);
+  }
 
-    curlpp::Easy request;
-    request.setOpt(curlpp::options::Url(url.str()));
-    request.setOpt(curlpp::options::WriteStream(&out));
-    request.setOpt(curlpp::options::NoSignal(true));
+  // Overloaded servers often answer with an HTML page, this must not end up in the cache.
+  if (response.mStatus < 200 || response.mStatus >= 300) {
+    throw std::runtime_error("Failed to download tile data: Server responded with status " +
+                             std::to_string(response.mStatus) + "!");
+  }
 
-    request.perform();
+  // The map server reports errors with an xml document.
+  if (response.mContentType.substr(0, 11) == "application") {
+    throw std::runtime_error(response.mBody);
+  }
 
-    fail = curlpp::Info<CURLINFO_CONTENT_TYPE, std::string>::get(request).substr(0, 11) ==
-           "application";
+  if (pack) {
+    pack->write(packLayer, level, x, y, response.mBody);
+    return std::move(response.mBody);
   }
 
-  if (fail) {
-    std::ifstream     in(cacheFile.str());
-    std::stringstream sstr;
-    sstr << in.rdbuf();
+  // The data is written to a temporary file first, so that an interrupted write does not leave a
+  // truncated tile behind which would be taken for a complete one later. The name is unique, as
+  // other threads or processes may download the same tile at the same time.
+  auto partFile = cacheFilePath.parent_path() /
+                  boost::filesystem::unique_path(cacheFilePath.filename() += ".%%%%-%%%%.part");
+
+  {
+    std::ofstream out;
+    out.open(partFile.string(), std::ofstream::out | std::ofstream::binary);
+
+    if (!out) {
+      throw std::runtime_error(
+          "Failed to download tile data: Cannot open '" + partFile.string() + "' for writing!");
+    }
 
-    std::remove(cacheFile.str().c_str());
-    throw std::runtime_error(sstr.str());
+    out.write(response.mBody.data(), static_cast<std::streamsize>(response.mBody.size()));
   }
 
+  boost::filesystem::rename(partFile, cacheFilePath);
+
   boost::filesystem::perms filePerms =
       boost::filesystem::perms::owner_read | boost::filesystem::perms::owner_write |
       boost::filesystem::perms::group_read | boost::filesystem::perms::group_write |
       boost::filesystem::perms::others_read | boost::filesystem::perms::others_write;
   boost::filesystem::permissions(cacheFilePath, filePerms);
 
-  return cacheFile.str();
+  return std::move(response.mBody);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileSourceWebMapService::isCached(int level, int x, int y) {
+  std::string type = getFileType(mFormat);
+  auto        pack = getCachePack();
+
+  if (pack) {
+    return pack->read(mLayers + "." + type, level, x, y,
+        [](char const* /*data*/, size_t size) { return size > 0; });
+  }
+
+  std::stringstream cacheFile;
+  cacheFile << mCache << "/" << mLayers << "/" << level << "/" << x << "/" << y << "." << type;
+
+  boost::system::error_code error;
+  auto                      size = boost::filesystem::file_size(cacheFile.str(), error);
+
+  return !error && size > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<TilePackCache> TileSourceWebMapService::getCachePack() {
+  std::unique_lock<std::mutex> lock(mCachePackMutex);
+
+  if (mUseCachePack && !mCachePack) {
+    try {
+      mCachePack = TilePackCache::open(mCache + "/tiles.pack");
+    } catch (std::exception const& e) {
+      // Do not try again for each tile, the directory based cache is used instead.
+      logger().error("Failed to open tile cache pack, falling back to the cache directory: {}",
+          e.what());
+      mUseCachePack = false;
+    }
+  }
+
+  return mCachePack;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-/* virtual */ void TileSourceWebMapService::loadTileAsync(
-    int level, glm::int64 patchIdx, OnLoadCallback cb) {
-  mThreadPool.enqueue([=]() {
-    auto* n = loadTile(level, patchIdx);
-    cb(this, level, patchIdx, n);
-  });
+std::shared_ptr<DecodedTileCache> TileSourceWebMapService::getDecodedCache() {
+  std::unique_lock<std::mutex> lock(mCachePackMutex);
+
+  if (mUseDecodedCache && !mDecodedCache) {
+    try {
+      std::stringstream layer;
+      layer << mLayers << "." << mFormat;
+
+      mDecodedCache = std::make_shared<DecodedTileCache>(
+          TilePackCache::open(mCache + "/decoded.pack"), layer.str());
+    } catch (std::exception const& e) {
+      // Do not try again for each tile.
+      logger().error("Failed to open decoded tile cache: {}", e.what());
+      mUseDecodedCache = false;
+    }
+  }
+
+  return mDecodedCache;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* virtual */ void TileSourceWebMapService::loadTileAsync(int level, glm::int64 patchIdx,
+    OnLoadCallback cb, std::shared_ptr<cs::utils::CancellationToken> token) {
+  // Nothing can be drawn before the base patches are loaded, so these are more urgent than anything
+  // else.
+  auto priority = level == 0 ? cs::utils::ThreadPool::Priority::eHigh
+                             : cs::utils::ThreadPool::Priority::eNormal;
+
+  mThreadPool.enqueue(
+      [=]() {
+        auto node = csp::lodbodies::loadTile(this, level, patchIdx, token.get());
+        cb(this, level, patchIdx, node.release());
+      },
+      priority);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -408,7 +390,10 @@ uint32_t TileSourceWebMapService::getMaxLevel() const {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TileSourceWebMapService::setCacheDirectory(std::string const& cacheDirectory) {
+  std::unique_lock<std::mutex> lock(mCachePackMutex);
   mCache = cacheDirectory;
+  mCachePack.reset();
+  mDecodedCache.reset();
 }
 
 std::string const& TileSourceWebMapService::getCacheDirectory() const {
@@ -417,8 +402,34 @@ std::string const& TileSourceWebMapService::getCacheDirectory() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TileSourceWebMapService::setUseCachePack(bool enable) {
+  std::unique_lock<std::mutex> lock(mCachePackMutex);
+  mUseCachePack = enable;
+  mCachePack.reset();
+}
+
+bool TileSourceWebMapService::getUseCachePack() const {
+  return mUseCachePack;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileSourceWebMapService::setUseDecodedCache(bool enable) {
+  std::unique_lock<std::mutex> lock(mCachePackMutex);
+  mUseDecodedCache = enable;
+  mDecodedCache.reset();
+}
+
+bool TileSourceWebMapService::getUseDecodedCache() const {
+  return mUseDecodedCache;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TileSourceWebMapService::setLayers(std::string const& layers) {
+  std::unique_lock<std::mutex> lock(mCachePackMutex);
   mLayers = layers;
+  mDecodedCache.reset();
 }
 
 std::string const& TileSourceWebMapService::getLayers() const {
@@ -438,7 +449,9 @@ std::string const& TileSourceWebMapService::getUrl() const {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TileSourceWebMapService::setDataType(TileDataType type) {
+  std::unique_lock<std::mutex> lock(mCachePackMutex);
   mFormat = type;
+  mDecodedCache.reset();
 }
 
 TileDataType TileSourceWebMapService::getDataType() const {
@@ -447,10 +460,21 @@ TileDataType TileSourceWebMapService::getDataType() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TileSourceWebMapService::setMaxConcurrentRequests(uint32_t maxRequests) {
+  mFetchEngine->setMaxRequests(maxRequests);
+}
+
+uint32_t TileSourceWebMapService::getMaxConcurrentRequests() const {
+  return mFetchEngine->getMaxRequests();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 bool TileSourceWebMapService::isSame(TileSource const* other) const {
   auto const* casted = dynamic_cast<TileSourceWebMapService const*>(other);
 
   return casted != nullptr && mUrl == casted->mUrl && mCache == casted->mCache &&
+         mUseCachePack == casted->mUseCachePack && mUseDecodedCache == casted->mUseDecodedCache &&
          mLayers == casted->mLayers && mFormat == casted->mFormat && mMaxLevel == casted->mMaxLevel;
 }
 
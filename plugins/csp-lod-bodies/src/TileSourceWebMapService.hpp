@@ -12,14 +12,24 @@
 #include "TileSource.hpp"
 
 #include <cstdio>
+#include <memory>
+#include <mutex>
 #include <string>
 
 namespace csp::lodbodies {
 
-/// The data of the tiles is fetched via a web map service.
+class DecodedTileCache;
+class FetchEngine;
+class TilePackCache;
+
+/// The data of the tiles is fetched via a web map service. All requests of a source share one
+/// FetchEngine, so connections to the server are reused. Downloaded tiles are stored in a local
+/// cache, either as one file per tile or in a single TilePackCache.
 class TileSourceWebMapService : public TileSource {
  public:
-  TileSourceWebMapService();
+  /// Tiles are downloaded and decoded by the given number of threads in parallel. This is also the
+  /// initial value of setMaxConcurrentRequests().
+  explicit TileSourceWebMapService(uint32_t threads = 32);
 
   TileSourceWebMapService(TileSourceWebMapService const& other) = delete;
   TileSourceWebMapService(TileSourceWebMapService&& other)      = delete;
@@ -27,7 +37,7 @@ class TileSourceWebMapService : public TileSource {
   TileSourceWebMapService& operator=(TileSourceWebMapService const& other) = delete;
   TileSourceWebMapService& operator=(TileSourceWebMapService&& other) = delete;
 
-  ~TileSourceWebMapService() override = default;
+  ~TileSourceWebMapService() override;
 
   void init() override {
   }
@@ -37,7 +47,8 @@ class TileSourceWebMapService : public TileSource {
 
   TileNode* loadTile(int level, glm::int64 patchIdx) override;
 
-  void loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb) override;
+  void loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb,
+      std::shared_ptr<cs::utils::CancellationToken> token) override;
   int  getPendingRequests() override;
 
   void     setMaxLevel(uint32_t maxLevel);
@@ -46,6 +57,21 @@ class TileSourceWebMapService : public TileSource {
   void               setCacheDirectory(std::string const& cacheDirectory);
   std::string const& getCacheDirectory() const;
 
+  /// If enabled, all tiles are stored in the file "tiles.pack" in the cache directory instead of
+  /// one file per tile. If the pack cannot be opened, for example because another process uses it,
+  /// an error is logged and this is disabled again.
+  void setUseCachePack(bool enable);
+  bool getUseCachePack() const;
+
+  /// If enabled, processed tiles are additionally stored uncompressed in the file "decoded.pack"
+  /// in the cache directory. Loading tiles from there is much faster than decoding the image files.
+  void setUseDecodedCache(bool enable);
+  bool getUseDecodedCache() const;
+
+  /// Returns the DecodedTileCache for the current layers and data type, or nullptr if it is
+  /// disabled or cannot be opened.
+  std::shared_ptr<DecodedTileCache> getDecodedCache();
+
   void               setLayers(std::string const& layers);
   std::string const& getLayers() const;
 
@@ -55,22 +81,45 @@ class TileSourceWebMapService : public TileSource {
   void         setDataType(TileDataType type);
   TileDataType getDataType() const override;
 
+  /// The maximum number of HTTP requests which are sent to the server at the same time. Additional
+  /// requests are queued. Values larger than the number of threads given to the constructor have no
+  /// effect, as each thread waits for one request.
+  void     setMaxConcurrentRequests(uint32_t maxRequests);
+  uint32_t getMaxConcurrentRequests() const override;
+
   bool isSame(TileSource const* other) const override;
 
   /// These can be used to pre-populate the local cache, returns true if the tile is on the diagonal
-  /// of base patch 4 (the one which is cut in two halves).
+  /// of base patch 4 (the one which is cut in two halves). loadData() returns the encoded image
+  /// data of the tile, it is downloaded if it is not in the cache yet.
   static bool getXY(int level, glm::int64 patchIdx, int& x, int& y);
   std::string loadData(int level, int x, int y);
 
+  /// Returns true if the data of the tile at x, y is already in the local cache, so that
+  /// loadData() does not have to download it.
+  bool isCached(int level, int x, int y);
+
  private:
+  /// Opens the pack in the current cache directory if that has not been done yet.
+  std::shared_ptr<TilePackCache> getCachePack();
+
   static std::mutex mTileSystemMutex;
 
-  cs::utils::ThreadPool mThreadPool;
-  std::string           mUrl;
-  std::string           mCache = "cache/img";
-  std::string           mLayers;
-  TileDataType          mFormat   = TileDataType::eU8Vec3;
-  uint32_t              mMaxLevel = 10;
+  // The engine has to outlive the thread pool, as the tasks of the pool use the engine.
+  std::unique_ptr<FetchEngine> mFetchEngine;
+  cs::utils::ThreadPool        mThreadPool;
+
+  std::string  mUrl;
+  std::string  mCache           = "cache/img";
+  bool         mUseCachePack    = false;
+  bool         mUseDecodedCache = false;
+  std::string  mLayers;
+  TileDataType mFormat   = TileDataType::eU8Vec3;
+  uint32_t     mMaxLevel = 10;
+
+  std::mutex                        mCachePackMutex;
+  std::shared_ptr<TilePackCache>    mCachePack;
+  std::shared_ptr<DecodedTileCache> mDecodedCache;
 };
 } // namespace csp::lodbodies
 
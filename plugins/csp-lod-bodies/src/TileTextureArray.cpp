@@ -9,14 +9,32 @@
 #include "RenderData.hpp"
 #include "TreeManagerBase.hpp"
 
+#include "../../../src/cs-utils/FrameTimings.hpp"
+#include "../../../src/cs-utils/ThreadPool.hpp"
+
 #include <VistaBase/VistaStreamUtils.h>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 namespace csp::lodbodies {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 namespace {
 
+// number of tiles which can be staged in the pixel buffer at the same time
+std::size_t const stagingSlotCount = 32;
+
+// number of threads copying tile data into the pixel buffer
+std::size_t const stagingThreadCount = 2;
+
+// offsets into the pixel buffer are aligned to this
+std::size_t const stagingSlotAlignment = 256;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 // functions to obtain texture internal/external format and type
 // from TileDataType value
 GLenum getInternalFormat(TileDataType dataType) {
@@ -70,19 +88,65 @@ GLenum getType(TileDataType dataType) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Returns the GPU memory occupied by a single tile. Three-component textures are usually padded
+// to four components by the driver.
+std::size_t getLayerSize(TileDataType dataType) {
+  std::size_t texelSize = 4;
+
+  if (dataType == TileDataType::eUInt8) {
+    texelSize = 1;
+  }
+
+  return texelSize * TileBase::SizeX * TileBase::SizeY;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the size of the data of a single tile in client memory.
+std::size_t getDataSize(TileDataType dataType) {
+  std::size_t texelSize = 0;
+
+  switch (dataType) {
+  case TileDataType::eFloat32:
+    texelSize = sizeof(float);
+    break;
+  case TileDataType::eUInt8:
+    texelSize = sizeof(glm::uint8);
+    break;
+  case TileDataType::eU8Vec3:
+    texelSize = sizeof(glm::u8vec3);
+    break;
+  }
+
+  return texelSize * TileBase::SizeX * TileBase::SizeY;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the number of tiles which fit into the given amount of GPU memory.
+GLint getLayerCount(TileDataType dataType, std::size_t bytes) {
+  return static_cast<GLint>(std::min<std::size_t>(
+      bytes / getLayerSize(dataType), std::numeric_limits<GLint>::max()));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /* explicit */
-TileTextureArray::TileTextureArray(TileDataType dataType, int maxLayerCount)
+TileTextureArray::TileTextureArray(
+    TileDataType dataType, int initialLayerCount, std::size_t maxBytes)
     : boost::noncopyable()
     , mTexId(0U)
     , mIformat()
     , mFormat()
     , mType()
     , mDataType(dataType)
-    , mNumLayers(maxLayerCount) {
+    , mInitialLayers(std::max(initialLayerCount, 1))
+    , mMaxLayers(std::max(mInitialLayers, getLayerCount(dataType, maxBytes)))
+    , mNumLayers(mInitialLayers) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -96,7 +160,7 @@ TileTextureArray::~TileTextureArray() {
 void TileTextureArray::allocateGPU(RenderData* rdata) {
   assert(rdata->getTexLayer() < 0);
 
-  mUploadQueue.push_back(rdata);
+  mUploadQueue.push_back({rdata, Clock::now()});
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -109,63 +173,66 @@ void TileTextureArray::releaseGPU(RenderData* rdata) {
     // XXX TODO Linear search, but mUploadQueue is usually small and
     //          this case should be rare
 
-    auto rIt = std::find(mUploadQueue.begin(), mUploadQueue.end(), rdata);
+    auto rIt = std::find_if(mUploadQueue.begin(), mUploadQueue.end(),
+        [rdata](UploadRequest const& request) { return request.mRData == rdata; });
 
     // avoid erasing an element in the middle of std::vector,
     // just invalidate the pointer and skip NULL entries when uploading
     if (rIt != mUploadQueue.end()) {
-      *rIt = nullptr;
+      rIt->mRData = nullptr;
+      return;
+    }
+
+    // The tile may also be copied to the pixel buffer right now. The copy has to be finished
+    // before the tile data can be destroyed.
+    for (std::size_t i = 0; i < mSlots.size(); ++i) {
+      if (mSlots[i].mRData == rdata) {
+        mSlots[i].mCopy.wait();
+        mSlots[i].mRData = nullptr;
+        mStagedSlots.erase(std::find(mStagedSlots.begin(), mStagedSlots.end(), i));
+        return;
+      }
     }
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TileTextureArray::processQueue(int maxItems) {
-  if (mUploadQueue.empty()) {
-    return;
-  }
-
-  preUpload();
-
-  std::size_t upload = std::min<std::size_t>(maxItems, mUploadQueue.size());
+void TileTextureArray::processQueue(double maxMilliseconds) {
+  mUploadedBytes = 0;
+  mUploadCount   = 0;
+  mUploadLatency = 0.0;
 
-  if (mFreeLayers.size() < upload) {
-    // XXX TODO This is bad for performance and visuals, since *all* tiles
-    // must be (re)-uploaded to the larger texture
-    vstr::warnp() << "[TileTextureArray::processQueue]"
-                  << " Pre-allocated GPU storage exhausted!"
-                  << " [" << getUsedLayerCount() << " | " << getTotalLayerCount() << "]"
-                  << std::endl;
+  if (mUploadQueue.empty() && mStagedSlots.empty()) {
+    return;
   }
 
-  int count = 0;
+  // The budget is enforced with a CPU clock, the FrameTimings results only become available a few
+  // frames later. They are recorded nevertheless to make the uploads visible in the user interface.
+  cs::utils::FrameTimings::ScopedTimer timer("LoD-Body Tile Upload");
 
-  while (!mUploadQueue.empty() && count < maxItems) {
-    if (mFreeLayers.empty()) {
-      break;
-    }
+  auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                     std::chrono::duration<double, std::milli>(maxMilliseconds));
 
-    RenderData* rdata = mUploadQueue.back();
-
-    // rdata could be NULL if a tile is removed before it is ever
-    // uploaded to the GPU, c.f. releaseGPU
-    if (rdata != nullptr) {
-      allocateLayer(rdata);
-      ++count;
-    }
+  preUpload();
 
-    mUploadQueue.pop_back();
+  if (mPixelBuffer > 0U || allocatePixelBuffer()) {
+    uploadStaged(deadline);
+    stageQueued();
+  } else {
+    uploadDirect(deadline);
   }
 
   postUpload();
 
-  if (count > 0) {
+  if (mUploadCount > 0) {
 #if !defined(NDEBUG) && !defined(VISTAPLANET_NO_VERBOSE)
     vstr::outi() << "[TileTextureArray::processQueue]"
-                 << " uploaded/pending/used/free layers " << count << " / " << mUploadQueue.size()
-                 << " / " << (mNumLayers - mFreeLayers.size()) << " / " << mFreeLayers.size()
-                 << std::endl;
+                 << " uploaded/staged/pending/used/free layers " << mUploadCount << " / "
+                 << mStagedSlots.size() << " / " << mUploadQueue.size() << " / "
+                 << (mNumLayers - mFreeLayers.size()) << " / " << mFreeLayers.size()
+                 << " uploaded bytes " << mUploadedBytes << " avg. latency "
+                 << getAverageUploadLatency() << " ms" << std::endl;
 #endif
   }
 }
@@ -190,28 +257,283 @@ std::size_t TileTextureArray::getUsedLayerCount() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+std::size_t TileTextureArray::getMaxLayerCount() const {
+  return mMaxLayers;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileTextureArray::getEvictionCount() const {
+  return mEvictionCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileTextureArray::getUploadedBytes() const {
+  return mUploadedBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double TileTextureArray::getAverageUploadLatency() const {
+  return mUploadCount > 0 ? mUploadLatency / static_cast<double>(mUploadCount) : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileTextureArray::allocatePixelBuffer() {
+  if (!mPixelBufferSupported) {
+    return false;
+  }
+
+  // persistently mapped buffers require OpenGL 4.4 or ARB_buffer_storage
+  if (!glBufferStorage) {
+    mPixelBufferSupported = false;
+    return false;
+  }
+
+  mSlotSize = (getDataSize(mDataType) + stagingSlotAlignment - 1) / stagingSlotAlignment *
+              stagingSlotAlignment;
+
+  GLsizeiptr const size  = static_cast<GLsizeiptr>(mSlotSize * stagingSlotCount);
+  GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+  glGenBuffers(1, &mPixelBuffer);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer);
+  glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+  mPixelBufferData = static_cast<char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0U);
+
+  if (!mPixelBufferData) {
+    vstr::warnp() << "[TileTextureArray::allocatePixelBuffer]"
+                  << " Failed to map pixel buffer, uploading tiles directly!" << std::endl;
+    glDeleteBuffers(1, &mPixelBuffer);
+    mPixelBuffer          = 0U;
+    mPixelBufferSupported = false;
+    return false;
+  }
+
+  mSlots       = std::vector<StagingSlot>(stagingSlotCount);
+  mCopyThreads = std::make_unique<cs::utils::ThreadPool>(stagingThreadCount);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::releasePixelBuffer() {
+  // wait for running copies and give all queued tiles back to the upload queue
+  for (auto& slot : mSlots) {
+    if (slot.mCopy.valid()) {
+      slot.mCopy.wait();
+    }
+
+    if (slot.mRData) {
+      mUploadQueue.push_back({slot.mRData, slot.mTime});
+    }
+
+    if (slot.mFence) {
+      glDeleteSync(slot.mFence);
+    }
+  }
+
+  mSlots.clear();
+  mStagedSlots.clear();
+  mCopyThreads.reset();
+
+  if (mPixelBuffer > 0U) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0U);
+    glDeleteBuffers(1, &mPixelBuffer);
+
+    mPixelBuffer     = 0U;
+    mPixelBufferData = nullptr;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::uploadStaged(Clock::time_point deadline) {
+  while (!mStagedSlots.empty()) {
+    std::size_t  index = mStagedSlots.front();
+    StagingSlot& slot  = mSlots[index];
+
+    // The slots are staged in order - if the oldest one is not ready yet, the others are most
+    // likely still being copied as well.
+    if (slot.mCopy.wait_for(std::chrono::seconds(0)) != std::future_status::ready ||
+        !reserveLayer(slot.mRData)) {
+      break;
+    }
+
+    // With a bound pixel buffer, the data pointer is an offset into the buffer. It is only bound
+    // after reserveLayer(), as growing the texture must not read from the pixel buffer.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer);
+    allocateLayer(slot.mRData, reinterpret_cast<GLvoid const*>(index * mSlotSize), slot.mTime);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0U);
+
+    slot.mRData = nullptr;
+    slot.mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mStagedSlots.pop_front();
+
+    if (Clock::now() >= deadline) {
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::stageQueued() {
+  std::size_t dataSize = getDataSize(mDataType);
+
+  for (std::size_t i = 0; i < mSlots.size() && !mUploadQueue.empty(); ++i) {
+    if (!isSlotFree(mSlots[i])) {
+      continue;
+    }
+
+    // skip entries of tiles which have been removed in the meantime, c.f. releaseGPU
+    while (!mUploadQueue.empty() && !mUploadQueue.back().mRData) {
+      mUploadQueue.pop_back();
+    }
+
+    if (mUploadQueue.empty()) {
+      break;
+    }
+
+    UploadRequest request = mUploadQueue.back();
+    mUploadQueue.pop_back();
+
+    TileBase*   tile   = request.mRData->getNode()->getTile();
+    char*       target = mPixelBufferData + i * mSlotSize;
+    char const* source = static_cast<char const*>(tile->getDataPtr());
+
+    mSlots[i].mRData = request.mRData;
+    mSlots[i].mTime  = request.mTime;
+    mSlots[i].mCopy  = mCopyThreads->enqueue(
+        [target, source, dataSize]() { std::memcpy(target, source, dataSize); });
+
+    mStagedSlots.push_back(i);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::uploadDirect(Clock::time_point deadline) {
+  while (!mUploadQueue.empty()) {
+    // rdata could be NULL if a tile is removed before it is ever
+    // uploaded to the GPU, c.f. releaseGPU
+    if (!mUploadQueue.back().mRData) {
+      mUploadQueue.pop_back();
+      continue;
+    }
+
+    // reserveLayer may insert evicted tiles at the front, so the request is copied
+    UploadRequest request = mUploadQueue.back();
+
+    if (!reserveLayer(request.mRData)) {
+      break;
+    }
+
+    allocateLayer(
+        request.mRData, request.mRData->getNode()->getTile()->getDataPtr(), request.mTime);
+    mUploadQueue.pop_back();
+
+    if (Clock::now() >= deadline) {
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileTextureArray::isSlotFree(StagingSlot& slot) {
+  if (slot.mRData) {
+    return false;
+  }
+
+  if (slot.mFence) {
+    GLenum status = glClientWaitSync(slot.mFence, 0, 0);
+
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      return false;
+    }
+
+    glDeleteSync(slot.mFence);
+    slot.mFence = nullptr;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileTextureArray::reserveLayer(RenderData const* rdata) {
+  // first try to grow the texture, then try to replace tiles which have not been used for a
+  // while - if both fails, the remaining tiles have to wait until layers are released
+  if (!mFreeLayers.empty() || growTexture() || evictLayer(rdata)) {
+    return true;
+  }
+
+  if (!mExhausted) {
+    vstr::warnp() << "[TileTextureArray::reserveLayer]"
+                  << " GPU storage exhausted!"
+                  << " [" << getUsedLayerCount() << " | " << getTotalLayerCount() << "]"
+                  << std::endl;
+    mExhausted = true;
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TileTextureArray::allocateTexture(TileDataType dataType) {
   if (mTexId > 0U) {
     return;
   }
 
+  // the texture can not grow beyond what the OpenGL implementation supports
+  GLint maxLayers = 0;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+  if (maxLayers > 0) {
+    mMaxLayers = std::min(mMaxLayers, maxLayers);
+    mNumLayers = std::min(mNumLayers, maxLayers);
+  }
+
   // allocate a 2D array texture for storing tile data of type dataType
+  mIformat = getInternalFormat(dataType);
+  mFormat  = getFormat(dataType);
+  mType    = getType(dataType);
+
+  mTexId = createTexture(mNumLayers);
 
-  glGenTextures(1, &mTexId);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
+
+  // all layers of newly allocated texture are available for use
+  mFreeLayers.reserve(mNumLayers);
+  mLayerOwners.resize(mNumLayers, nullptr);
+
+  for (int i = 0; i < mNumLayers; ++i) {
+    mFreeLayers.push_back(mNumLayers - i - 1);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GLuint TileTextureArray::createTexture(GLsizei layerCount) const {
+  GLuint texId = 0U;
+  glGenTextures(1, &texId);
 
   GLsizei const level  = 0;
   GLsizei const width  = TileBase::SizeX;
   GLsizei const height = TileBase::SizeY;
-  GLsizei const depth  = mNumLayers;
   GLint const   border = 0;
 
-  mIformat = getInternalFormat(dataType);
-  mFormat  = getFormat(dataType);
-  mType    = getType(dataType);
-
-  glBindTexture(GL_TEXTURE_2D_ARRAY, mTexId);
-  glTexImage3D(
-      GL_TEXTURE_2D_ARRAY, level, mIformat, width, height, depth, border, mFormat, mType, nullptr);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texId);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, level, mIformat, width, height, layerCount, border, mFormat,
+      mType, nullptr);
 
   // set filter and wrapping parameters
   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -219,19 +541,91 @@ void TileTextureArray::allocateTexture(TileDataType dataType) {
   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-  glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
+  return texId;
+}
 
-  // all layers of newly allocated texture are available for use
-  mFreeLayers.reserve(mNumLayers);
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  for (int i = 0; i < mNumLayers; ++i) {
-    mFreeLayers.push_back(mNumLayers - i - 1);
+// Reallocates the texture with mInitialLayers additional layers and copies the existing tiles to
+// the new texture on the GPU.
+// @note May only be called after a call to @c preUpload.
+bool TileTextureArray::growTexture() {
+  GLint numLayers = std::min(mNumLayers + mInitialLayers, mMaxLayers);
+
+  if (numLayers <= mNumLayers) {
+    return false;
   }
+
+  GLuint texId = createTexture(numLayers);
+
+  if (glCopyImageSubData) {
+    glCopyImageSubData(mTexId, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, texId, GL_TEXTURE_2D_ARRAY, 0, 0,
+        0, 0, TileBase::SizeX, TileBase::SizeY, mNumLayers);
+  } else {
+    // without GPU-side copies, all tiles have to be uploaded again
+    for (auto& owner : mLayerOwners) {
+      if (owner) {
+        RenderData* rdata = owner;
+        releaseLayer(rdata);
+        mUploadQueue.insert(mUploadQueue.begin(), {rdata, Clock::now()});
+      }
+    }
+  }
+
+  glDeleteTextures(1, &mTexId);
+  mTexId = texId;
+
+  // the new layers are used before the free layers of the old texture
+  std::vector<GLint> freeLayers;
+  freeLayers.reserve(numLayers);
+  freeLayers.insert(freeLayers.end(), mFreeLayers.begin(), mFreeLayers.end());
+
+  for (GLint i = numLayers - 1; i >= mNumLayers; --i) {
+    freeLayers.push_back(i);
+  }
+
+  mFreeLayers = std::move(freeLayers);
+  mLayerOwners.resize(numLayers, nullptr);
+
+#if !defined(NDEBUG) && !defined(VISTAPLANET_NO_VERBOSE)
+  vstr::outi() << "[TileTextureArray::growTexture]"
+               << " grown from " << mNumLayers << " to " << numLayers << " layers" << std::endl;
+#endif
+
+  mNumLayers = numLayers;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileTextureArray::evictLayer(RenderData const* rdata) {
+  RenderData* victim = nullptr;
+
+  for (auto* owner : mLayerOwners) {
+    if (owner && (!victim || owner->getLastFrame() < victim->getLastFrame())) {
+      victim = owner;
+    }
+  }
+
+  // never replace tiles which are at least as important as the new one, this would only result in
+  // tiles replacing each other over and over again
+  if (!victim || victim->getLastFrame() >= rdata->getLastFrame()) {
+    return false;
+  }
+
+  releaseLayer(victim);
+  mUploadQueue.insert(mUploadQueue.begin(), {victim, Clock::now()});
+  ++mEvictionCount;
+
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TileTextureArray::releaseTexture() {
+  releasePixelBuffer();
+
   if (mTexId == 0U) {
     return;
   }
@@ -239,19 +633,18 @@ void TileTextureArray::releaseTexture() {
   glDeleteTextures(1, &mTexId);
   mTexId = 0U;
   mFreeLayers.clear();
+  mLayerOwners.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// Uploads tile data from the node associated with @a rdata to the GPU.
+// Uploads tile data for @a rdata to the GPU.
 // @note May only be called after a call to @c preUpload.
-void TileTextureArray::allocateLayer(RenderData* rdata) {
+void TileTextureArray::allocateLayer(
+    RenderData* rdata, GLvoid const* data, Clock::time_point queueTime) {
   assert(!mFreeLayers.empty());
   assert(rdata->getTexLayer() < 0);
 
-  TileNode* node = rdata->getNode();
-  TileBase* tile = node->getTile();
-
   int layer = mFreeLayers.back();
   mFreeLayers.pop_back();
 
@@ -261,12 +654,16 @@ void TileTextureArray::allocateLayer(RenderData* rdata) {
   GLsizei const width   = TileBase::SizeX;
   GLsizei const height  = TileBase::SizeY;
   GLsizei const depth   = 1;
-  GLvoid const* data    = tile->getDataPtr();
 
   glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, xoffset, yoffset, layer, width, height, depth,
       mFormat, mType, data);
 
   rdata->setTexLayer(layer);
+  mLayerOwners[layer] = rdata;
+
+  mUploadedBytes += getDataSize(mDataType);
+  mUploadLatency += std::chrono::duration<double, std::milli>(Clock::now() - queueTime).count();
+  ++mUploadCount;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -277,7 +674,9 @@ void TileTextureArray::releaseLayer(RenderData* rdata) {
   // simply mark the layer as available and record that rdata is not
   // currently on the GPU (i.e. set the texture layer to an invalid value)
   mFreeLayers.push_back(rdata->getTexLayer());
+  mLayerOwners[rdata->getTexLayer()] = nullptr;
   rdata->setTexLayer(-1);
+  mExhausted = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -12,9 +12,16 @@
 #include <GL/glew.h>
 #include <array>
 #include <boost/noncopyable.hpp>
+#include <chrono>
+#include <deque>
+#include <future>
 #include <memory>
 #include <vector>
 
+namespace cs::utils {
+class ThreadPool;
+} // namespace cs::utils
+
 namespace csp::lodbodies {
 
 class TileNode;
@@ -26,12 +33,26 @@ class TreeManagerBase;
 ///
 /// Tile data is stored in a 2D array texture (GL_TEXTURE_2D_ARRAY) with width and height matching
 /// those of a single tile and as many layers as there are tiles that can be kept on the GPU at
-/// once. If more tiles are needed on the GPU the array texture must be resized (which requires all
-/// tiles to be re-uploaded), this should be avoided to prevent the tile resolution to drop
-/// dramatically while only low resolution tiles are on the GPU.
+/// once. The texture starts with a given number of layers. If more tiles are needed on the GPU, the
+/// texture is reallocated with additional layers and the existing tiles are copied over on the GPU.
+/// This happens in chunks of the initial layer count until a memory budget (or the maximum layer
+/// count supported by the OpenGL implementation) is reached.
+///
+/// Once the texture cannot grow anymore, the layers of the least recently used tiles are taken over
+/// by new tiles. A tile is only evicted if it has been used less recently than the tile which
+/// needs the layer (see RenderData::getLastFrame). Evicted tiles are queued for upload again with
+/// the lowest priority.
+///
+/// Uploads are streamed through a ring of slots in a persistently mapped pixel buffer. The tile
+/// data is copied into a free slot by a worker thread, the render thread then only issues the
+/// copy from the pixel buffer to the texture. Each call to processQueue issues such copies until
+/// its time budget is used up. If the OpenGL implementation does not support persistently mapped
+/// buffers, the tiles are uploaded directly from client memory within the same time budget.
 class TileTextureArray : private boost::noncopyable {
  public:
-  explicit TileTextureArray(TileDataType dataType, int maxLayerCount);
+  /// The texture is allocated with initialLayerCount layers and may grow until it uses maxBytes of
+  /// GPU memory.
+  explicit TileTextureArray(TileDataType dataType, int initialLayerCount, std::size_t maxBytes);
 
   TileTextureArray(TileTextureArray const& other) = delete;
   TileTextureArray(TileTextureArray&& other)      = delete;
@@ -47,8 +68,9 @@ class TileTextureArray : private boost::noncopyable {
   /// Release GPU resources allocated for the tile associated with rdata.
   void releaseGPU(RenderData* rdata);
 
-  /// Process up to maxItems upload requests.
-  void processQueue(int maxItems);
+  /// Processes upload requests until maxMilliseconds have passed. At least one tile is uploaded
+  /// per call if there is one ready for upload.
+  void processQueue(double maxMilliseconds);
 
   /// Returns the OpenGL id of the texture used to store tiles on the GPU. This is an internal
   /// interface for TileRenderer.
@@ -60,11 +82,73 @@ class TileTextureArray : private boost::noncopyable {
   /// Gets Used Layer Count
   std::size_t getUsedLayerCount() const;
 
+  /// Returns the number of layers the texture may have at most.
+  std::size_t getMaxLayerCount() const;
+
+  /// Returns how often a tile had to be removed from the GPU to make room for another one.
+  std::size_t getEvictionCount() const;
+
+  /// Returns the number of bytes uploaded during the last call to processQueue().
+  std::size_t getUploadedBytes() const;
+
+  /// Returns the average time in milliseconds the tiles uploaded during the last call to
+  /// processQueue() spent between allocateGPU() and the upload.
+  double getAverageUploadLatency() const;
+
  private:
+  using Clock = std::chrono::steady_clock;
+
+  /// A tile waiting for upload and the time it was queued.
+  struct UploadRequest {
+    RenderData*       mRData;
+    Clock::time_point mTime;
+  };
+
+  /// A slot of the pixel buffer ring. It is in use while mRData is set or the GPU still reads from
+  /// it (mFence has not been signaled yet).
+  struct StagingSlot {
+    RenderData*       mRData = nullptr;
+    Clock::time_point mTime;
+    std::future<void> mCopy;
+    GLsync            mFence = nullptr;
+  };
+
+  /// Creates the persistently mapped pixel buffer. Returns false if this is not supported.
+  bool allocatePixelBuffer();
+  void releasePixelBuffer();
+
+  /// Copies tiles from the pixel buffer to the texture until the deadline is reached.
+  void uploadStaged(Clock::time_point deadline);
+
+  /// Passes queued tiles to the worker threads for copying them into free slots.
+  void stageQueued();
+
+  /// Uploads queued tiles directly from client memory until the deadline is reached.
+  void uploadDirect(Clock::time_point deadline);
+
+  /// Returns true if the slot is not used anymore, neither by a worker nor by the GPU.
+  static bool isSlotFree(StagingSlot& slot);
+
+  /// Ensures that there is a free layer for rdata, either by growing the texture or by evicting
+  /// another tile. Returns false if neither is possible.
+  bool reserveLayer(RenderData const* rdata);
+
   void allocateTexture(TileDataType dataType);
   void releaseTexture();
 
-  void allocateLayer(RenderData* rdata);
+  /// Creates a texture with the given number of layers, binds it and returns its id.
+  GLuint createTexture(GLsizei layerCount) const;
+
+  /// Reallocates the texture with more layers. Returns false if it cannot grow any further.
+  bool growTexture();
+
+  /// Frees the layer of the least recently used tile, but only if it has been used less recently
+  /// than rdata. Returns false if there is no such tile.
+  bool evictLayer(RenderData const* rdata);
+
+  /// Copies the data to a free layer and assigns it to rdata. The data is either a pointer to
+  /// client memory or an offset into the bound pixel buffer.
+  void allocateLayer(RenderData* rdata, GLvoid const* data, Clock::time_point queueTime);
   void releaseLayer(RenderData* rdata);
 
   void        preUpload();
@@ -76,22 +160,42 @@ class TileTextureArray : private boost::noncopyable {
   GLenum       mType;
   TileDataType mDataType;
 
-  const GLint        mNumLayers;
+  GLint const        mInitialLayers;
+  GLint              mMaxLayers;
+  GLint              mNumLayers;
   std::vector<GLint> mFreeLayers;
 
-  std::vector<RenderData*> mUploadQueue;
+  /// The tile stored in each layer, nullptr for free layers.
+  std::vector<RenderData*> mLayerOwners;
+  std::size_t              mEvictionCount = 0;
+  bool                     mExhausted     = false;
+
+  std::vector<UploadRequest> mUploadQueue;
+
+  bool                                   mPixelBufferSupported = true;
+  GLuint                                 mPixelBuffer          = 0U;
+  char*                                  mPixelBufferData      = nullptr;
+  std::size_t                            mSlotSize             = 0;
+  std::vector<StagingSlot>               mSlots;
+  std::deque<std::size_t>                mStagedSlots;
+  std::unique_ptr<cs::utils::ThreadPool> mCopyThreads;
+
+  std::size_t mUploadedBytes = 0;
+  std::size_t mUploadCount   = 0;
+  double      mUploadLatency = 0.0;
 };
 
 /// DocTODO
 class GLResources {
  public:
-  GLResources(int maxLayersFloat32, int maxLayersUInt8, int maxLayersU8Vec3) {
-    mextureArrays[static_cast<int>(TileDataType::eFloat32)] =
-        std::make_unique<TileTextureArray>(TileDataType::eFloat32, maxLayersFloat32);
-    mextureArrays[static_cast<int>(TileDataType::eUInt8)] =
-        std::make_unique<TileTextureArray>(TileDataType::eUInt8, maxLayersUInt8);
-    mextureArrays[static_cast<int>(TileDataType::eU8Vec3)] =
-        std::make_unique<TileTextureArray>(TileDataType::eU8Vec3, maxLayersU8Vec3);
+  GLResources(
+      int layersFloat32, int layersUInt8, int layersU8Vec3, std::size_t maxBytesPerDataType) {
+    mextureArrays[static_cast<int>(TileDataType::eFloat32)] = std::make_unique<TileTextureArray>(
+        TileDataType::eFloat32, layersFloat32, maxBytesPerDataType);
+    mextureArrays[static_cast<int>(TileDataType::eUInt8)] = std::make_unique<TileTextureArray>(
+        TileDataType::eUInt8, layersUInt8, maxBytesPerDataType);
+    mextureArrays[static_cast<int>(TileDataType::eU8Vec3)] = std::make_unique<TileTextureArray>(
+        TileDataType::eU8Vec3, layersU8Vec3, maxBytesPerDataType);
   }
 
   TileTextureArray& operator[](TileDataType type) {
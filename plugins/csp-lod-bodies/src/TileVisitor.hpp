@@ -94,6 +94,11 @@ class TileVisitor {
   void visitRoot(TileNode* rootDEM, TileNode* rootIMG, TileId tileId);
   void visitLevel(TileNode* nodeDEM, TileNode* nodeIMG, TileId tileId);
 
+  /// Called between preTraverse and postTraverse, visits all root nodes one after another.
+  /// Reimplement in the derived class to change how the root nodes are traversed, for example to
+  /// visit them in parallel.
+  virtual void visitRoots();
+
   /// Called before visiting the first root node. Returns if traversal should commence or
   /// not.
   /// Reimplement in the derived class, the default just returns true.
@@ -153,13 +158,7 @@ TileVisitor<DerivedT>::TileVisitor(TileQuadTree* treeDEM, TileQuadTree* treeIMG)
 template <typename DerivedT>
 void TileVisitor<DerivedT>::visit() {
   if (self().preTraverse()) {
-    for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
-      TileNode* rootDEM = mTreeDEM->getRoot(i);
-      TileNode* rootIMG = mTreeIMG ? mTreeIMG->getRoot(i) : nullptr;
-
-      // if (i==7)
-      visitRoot(rootDEM, rootIMG, TileId(0, i));
-    }
+    self().visitRoots();
   }
 
   self().postTraverse();
@@ -296,6 +295,16 @@ void TileVisitor<DerivedT>::visitLevel(TileNode* nodeDEM, TileNode* nodeIMG, Til
   self().popState();
 }
 
+template <typename DerivedT>
+void TileVisitor<DerivedT>::visitRoots() {
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    TileNode* rootDEM = mTreeDEM->getRoot(i);
+    TileNode* rootIMG = mTreeIMG ? mTreeIMG->getRoot(i) : nullptr;
+
+    visitRoot(rootDEM, rootIMG, TileId(0, i));
+  }
+}
+
 template <typename DerivedT>
 bool TileVisitor<DerivedT>::preTraverse() {
   // default impl - start traversal
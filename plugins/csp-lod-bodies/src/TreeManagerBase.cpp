@@ -6,6 +6,7 @@
 
 #include "TreeManagerBase.hpp"
 
+#include "HEALPix.hpp"
 #include "PlanetParameters.hpp"
 #include "RenderData.hpp"
 #include "TileSource.hpp"
@@ -13,6 +14,7 @@
 
 #include <VistaBase/VistaStreamUtils.h>
 
+#include <algorithm>
 #include <utility>
 
 namespace csp::lodbodies {
@@ -34,6 +36,13 @@ int const maxNodeAge = 10;
 // is kept around
 int const maxUnmergedAge = 500;
 
+// number of frames a pending request is kept alive without being requested
+// again before it gets cancelled
+int const maxRequestAge = 2;
+
+// default time in milliseconds spent on uploading tiles in each frame
+double const defaultUploadBudget = 1.0;
+
 // number of nodes to pre-allocate data structures
 std::size_t const preAllocNodeCount = 500;
 
@@ -46,44 +55,9 @@ std::size_t const preAllocIONodeCount = 200;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// Function object to compare RDMapValue objects by their age.
-struct TreeManagerBase::AgeLess {
-  explicit AgeLess(int frame);
-
-  bool operator()(RDMapValue const* lhs, RDMapValue const* rhs) const;
-
-  int mFrame;
-};
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/* explicit */
-TreeManagerBase::AgeLess::AgeLess(int frame)
-    : mFrame(frame) {
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool TreeManagerBase::AgeLess::operator()(RDMapValue const* lhs, RDMapValue const* rhs) const {
-  // sort by age (frames since last use), in case of a tie use
-  // tile level - this ensure that child nodes are always sorted
-  // after parent nodes
-
-  int ageLHS = lhs->second->getAge(mFrame);
-  int ageRHS = rhs->second->getAge(mFrame);
-
-  if (ageLHS == ageRHS) {
-    return lhs->first.level() < rhs->first.level();
-  }
-
-  return ageLHS < ageRHS;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
 /* explicit */
-TreeManagerBase::NodeAge::NodeAge(TileNode* node, int frame)
-    : mNode(node)
+TreeManagerBase::NodeAge::NodeAge(std::unique_ptr<TileNode> node, int frame)
+    : mNode(std::move(node))
     , mFrame(frame) {
 }
 
@@ -95,11 +69,13 @@ TreeManagerBase::TreeManagerBase(
     : mParams(&params)
     , mGlMgr(std::move(glResources))
     , mSrc()
+    , mRunningRequests(0)
     , mFrameCount(0)
-    , mAsyncLoading(true) {
+    , mAsyncLoading(true)
+    , mUploadBudget(defaultUploadBudget) {
   mRdMap.reserve(preAllocNodeCount);
-  mAgeStore.reserve(preAllocNodeCount);
 
+  mRequestQueue.reserve(preAllocIONodeCount);
   mUnmergedNodes.reserve(preAllocIONodeCount);
   mLoadedNodes.reserve(preAllocIONodeCount);
 }
@@ -112,10 +88,14 @@ TreeManagerBase::~TreeManagerBase() = default;
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TreeManagerBase::setSource(TileSource* src) {
+  // Nodes of the old source which are loaded from now on are discarded by onNodeLoaded.
+  {
+    std::unique_lock<std::mutex> lck(mLoadedMtx);
+    mSrc = src;
+  }
+
   // remove all existing nodes
-  std::unique_lock<std::mutex> lck(mLoadedMtx);
   clear();
-  mSrc = src;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -126,41 +106,47 @@ TileSource* TreeManagerBase::getSource() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TreeManagerBase::request(std::vector<TileId> const& tileIds) {
+void TreeManagerBase::request(std::vector<TileRequest> const& requests) {
   // for each requested tile, check if it is already in the mPendingTiles
   // set (those are tiles that have already been requesed from the tile
-  // source), otherwise put the tile in mPendingTiles and ask the source to
-  // load the tile.
-  // In the case of async loading, register @c onNodeLoaded as the callback
-  // that the source invokes when the tile is ready.
+  // source or which are waiting in the queue), otherwise put the tile in
+  // mPendingTiles. Afterwards, the most urgent queued requests are passed
+  // to the source.
   std::unique_lock<std::mutex> lck(mLoadedMtx);
 
-  auto iIt  = tileIds.begin();
-  auto iEnd = tileIds.end();
+  for (auto const& request : requests) {
+    auto pending = mPendingTiles.find(request.mTileId);
+
+    if (pending != mPendingTiles.end()) {
+      // keep the request alive and re-rank it
+      pending->second.mLastFrame = mFrameCount;
+      pending->second.mPriority  = request.mPriority;
+    } else {
+      auto token = std::make_shared<cs::utils::CancellationToken>();
 
-  for (; iIt != iEnd; ++iIt) {
-    if (mPendingTiles.count(*iIt) == 0) {
-      mPendingTiles.insert(*iIt);
+      // Tiles which have been pruned recently do not have to be loaded again. They are passed to
+      // merge() like any other loaded node, the request is marked as started so that the tile is
+      // not requested again in the meantime.
+      auto node = mTileCache.take(request.mTileId);
 
-      if (mAsyncLoading) {
-#if (BOOST_VERSION / 100) % 1000 < 60
-        mSrc->loadTileAsync(iIt->level(), iIt->patchIdx(),
-            std::bind(&TreeManagerBase::onNodeLoaded, this, _1, _2, _3, _4));
-#else
-        mSrc->loadTileAsync(iIt->level(), iIt->patchIdx(),
-            [this](auto a, auto b, auto c, auto d) { onNodeLoaded(a, b, c, d); });
-#endif
-      } else {
-        TileNode* node = mSrc->loadTile(iIt->level(), iIt->patchIdx());
-        onNodeLoaded(mSrc, iIt->level(), iIt->patchIdx(), node);
+      mPendingTiles.emplace(
+          request.mTileId, PendingRequest{token, mFrameCount, request.mPriority, node != nullptr});
+
+      if (node) {
+        mLoadedNodes.push_back(std::move(node));
       }
     }
   }
+
+  startQueuedRequests();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TreeManagerBase::update() {
+  // revoke requests for tiles which are not needed anymore
+  cancelStaleRequests();
+
   // remove unused nodes - do this before the merge to free up resources
   // that can then be consumed by newly loaded ones.
   prune();
@@ -169,14 +155,29 @@ void TreeManagerBase::update() {
   merge();
 
   // upload tiles to GPU
-  getTileTextureArray().processQueue(20);
+  if (mGlMgr) {
+    getTileTextureArray().processQueue(mUploadBudget);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TreeManagerBase::clear() {
-  mPendingTiles.clear();
-  mLoadedNodes.clear();
+  {
+    // The source may still call onNodeLoaded on its loader threads.
+    std::unique_lock<std::mutex> lck(mLoadedMtx);
+
+    for (auto& pending : mPendingTiles) {
+      pending.second.mToken->cancel();
+    }
+
+    // requests which have been started already will still decrement
+    // mRunningRequests in onNodeLoaded
+    mPendingTiles.clear();
+    mRequestQueue.clear();
+    mLoadedNodes.clear();
+    mTileCache.clear();
+  }
 
   auto rdIt  = mRdMap.begin();
   auto rdEnd = mRdMap.end();
@@ -186,7 +187,6 @@ void TreeManagerBase::clear() {
   }
 
   mRdMap.clear();
-  mAgeStore.clear();
 
   for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
     mTree.setRoot(i, nullptr);
@@ -240,25 +240,61 @@ std::size_t TreeManagerBase::getNodeCount() const {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::size_t TreeManagerBase::getNodeCountGPU() const {
+  if (!mGlMgr) {
+    return mRdMap.size();
+  }
+
   return getTileTextureArray().getUsedLayerCount();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TreeManagerBase::setTileCacheSize(std::size_t bytes) {
+  std::unique_lock<std::mutex> lck(mLoadedMtx);
+  mTileCache.setMaxBytes(bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileNodeCache const& TreeManagerBase::getTileCache() const {
+  return mTileCache;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::setUploadBudget(double milliseconds) {
+  mUploadBudget = milliseconds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double TreeManagerBase::getUploadBudget() const {
+  return mUploadBudget;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TreeManagerBase::onNodeLoaded(
     TileSource* source, int level, glm::int64 patchIdx, TileNode* node) {
+  // The node is owned by this from now on. If it is not needed anymore, it is deleted on return.
+  std::unique_ptr<TileNode> loaded(node);
+
   std::unique_lock<std::mutex> lck(mLoadedMtx);
-  if (node && source == mSrc) {
+
+  // this frees a slot for the next queued request, it will be started with
+  // the next call to request()
+  --mRunningRequests;
+
+  if (loaded && source == mSrc) {
     // Only add node to list of loaded nodes, actual insertion into the
     // quad-tree is done in merge().
     // This ensures that the tree is not modified at unpredictable moments
     // in time (for example while a traversal is in progress).
 
-    mLoadedNodes.push_back(node);
+    mLoadedNodes.push_back(std::move(loaded));
   } else {
     // source has changed or loading failed, discard node
     mPendingTiles.erase(TileId(level, patchIdx));
-    delete node; // NOLINT(cppcoreguidelines-owning-memory): TODO where does it get created?
   }
 }
 
@@ -277,54 +313,151 @@ void TreeManagerBase::onNodeInserted(TileNode* node) {
   auto res = mRdMap.insert(RDMapValue(node->getTileId(), rdata));
   assert(res.second);
 
-  getTileTextureArray().allocateGPU(rdata);
-  mAgeStore.push_back(&(*res.first));
+  // Without GPU resources, tiles are usable right away.
+  if (mGlMgr) {
+    getTileTextureArray().allocateGPU(rdata);
+  } else {
+    rdata->setTexLayer(0);
+  }
+
+  mAgeList.insert(rdata, node->getLevel());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TreeManagerBase::releaseResources(RenderData* rdata) {
-  getTileTextureArray().releaseGPU(rdata);
+  mAgeList.remove(rdata);
+
+  if (mGlMgr) {
+    getTileTextureArray().releaseGPU(rdata);
+  }
+
   releaseRenderData(rdata);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TreeManagerBase::startQueuedRequests() {
+  int freeSlots = static_cast<int>(mSrc->getMaxConcurrentRequests()) - mRunningRequests;
+
+  if (freeSlots <= 0) {
+    return;
+  }
+
+  mRequestQueue.clear();
+
+  for (auto& pending : mPendingTiles) {
+    if (!pending.second.mStarted) {
+      mRequestQueue.push_back(&pending);
+    }
+  }
+
+  // Sort by priority, most urgent requests first. In case of a tie, use the
+  // tile level - this ensures that parent nodes are loaded before their
+  // children.
+  auto count = std::min(mRequestQueue.size(), static_cast<std::size_t>(freeSlots));
+
+  std::partial_sort(mRequestQueue.begin(), mRequestQueue.begin() + count, mRequestQueue.end(),
+      [](PendingMapValue const* lhs, PendingMapValue const* rhs) {
+        if (lhs->second.mPriority == rhs->second.mPriority) {
+          return lhs->first.level() < rhs->first.level();
+        }
+
+        return lhs->second.mPriority > rhs->second.mPriority;
+      });
+
+  for (std::size_t i = 0; i < count; ++i) {
+    startRequest(mRequestQueue[i]->first, mRequestQueue[i]->second);
+  }
+
+  mRequestQueue.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::startRequest(TileId const& tileId, PendingRequest& request) {
+  // In the case of async loading, register @c onNodeLoaded as the callback
+  // that the source invokes when the tile is ready.
+  request.mStarted = true;
+  ++mRunningRequests;
+
+  if (mAsyncLoading) {
+#if (BOOST_VERSION / 100) % 1000 < 60
+    mSrc->loadTileAsync(tileId.level(), tileId.patchIdx(),
+        std::bind(&TreeManagerBase::onNodeLoaded, this, _1, _2, _3, _4), request.mToken);
+#else
+    mSrc->loadTileAsync(tileId.level(), tileId.patchIdx(),
+        [this](auto a, auto b, auto c, auto d) { onNodeLoaded(a, b, c, d); }, request.mToken);
+#endif
+  } else {
+    TileNode* node = mSrc->loadTile(tileId.level(), tileId.patchIdx());
+    onNodeLoaded(mSrc, tileId.level(), tileId.patchIdx(), node);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::cancelStaleRequests() {
+  std::unique_lock<std::mutex> lck(mLoadedMtx);
+
+  for (auto it = mPendingTiles.begin(); it != mPendingTiles.end();) {
+    if (mFrameCount - it->second.mLastFrame > maxRequestAge) {
+      if (!it->second.mStarted) {
+        // the source does not know about this request, just drop it
+        it = mPendingTiles.erase(it);
+        continue;
+      }
+
+      it->second.mToken->cancel();
+    }
+
+    ++it;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TreeManagerBase::prune() {
-  // sort by age, oldest nodes at the back
-  std::sort(mAgeStore.begin(), mAgeStore.end(), AgeLess(mFrameCount));
   int count = 0;
 
-  while (!mAgeStore.empty()) {
-    RDMapValue* value = mAgeStore.back();
+  // Remove unused nodes, but never root nodes. Of nodes with the same age, the one with the highest
+  // level comes first - this ensures that child nodes are removed before their parents.
+  for (RenderData* rdata = mAgeList.getOldest(1);
+       rdata != nullptr && rdata->getAge(mFrameCount) > maxNodeAge;
+       rdata = mAgeList.getOldest(1)) {
+    TileId const tileId = rdata->getTileId();
+    TileNode*    node   = rdata->getNode();
+    TileNode*    parent = node->getParent();
 
-    // remove unnused nodes, but never root nodes
-    if (value->second->getAge(mFrameCount) > maxNodeAge && value->first.level() > 0) {
-      TileNode* node = value->second->getNode();
+    releaseResources(rdata);
 
-      releaseResources(value->second);
+    bool hasChildren = false;
+    for (int i = 0; i < 4; ++i) {
+      hasChildren = hasChildren || node->getChild(i) != nullptr;
+    }
 
-      if (!removeNode(&mTree, node)) {
-        vstr::errp() << "[TreeManagerBase::prune] [" << mName << "] Failed to remove node "
-                     << value->first << " @ " << node << "!" << std::endl;
-      }
+    // Leaf nodes are kept in the cache in case they are requested again soon. Nodes with
+    // children are removed together with their children.
+    if (parent && !hasChildren) {
+      std::unique_ptr<TileNode> released(parent->releaseChild(HEALPix::getChildIdx(tileId)));
 
-      // remove entries for node from internal data structures
-      mRdMap.erase(value->first);
-      mAgeStore.pop_back();
-      ++count;
-    } else {
-      // The node at the back of mAgeStore can not be removed - stop
-      // The sorting of mAgeStore ensures that there is no node that
-      // could be removed beyond this point.
-      break;
+      std::unique_lock<std::mutex> lck(mLoadedMtx);
+      mTileCache.insert(std::move(released));
+    } else if (!removeNode(&mTree, node)) {
+      vstr::errp() << "[TreeManagerBase::prune] [" << mName << "] Failed to remove node "
+                   << tileId << " @ " << node << "!" << std::endl;
     }
+
+    // remove entries for node from internal data structures
+    mRdMap.erase(tileId);
+    ++count;
   }
 
   if (count > 0) {
 #if !defined(NDEBUG) && !defined(VISTAPLANET_NO_VERBOSE)
     vstr::outi() << "[TreeManagerBase::prune] [" << mName << "] nodes removed/kept " << count
-                 << " / " << mRdMap.size() << std::endl;
+                 << " / " << mRdMap.size() << " cached nodes/bytes " << mTileCache.getNodeCount()
+                 << " / " << mTileCache.getBytes() << std::endl;
 #endif
   }
 }
@@ -334,27 +467,31 @@ void TreeManagerBase::prune() {
 void TreeManagerBase::merge() {
   // exchange mLoadedNodes and mergeNodes so the lock need not be held
   // for the duration of the whole merge
-  std::vector<TileNode*> mergeNodes;
+  std::vector<std::unique_ptr<TileNode>> mergeNodes;
   {
     std::unique_lock<std::mutex> lck(mLoadedMtx);
 
-    mergeNodes = mLoadedNodes;
-    mLoadedNodes.clear();
+    mergeNodes.swap(mLoadedNodes);
+    mLoadedNodes.reserve(mergeNodes.capacity());
   }
 
   int merged   = 0;
   int unmerged = 0;
 
+  // The requests of merged or discarded nodes are finished. mPendingTiles is also modified by
+  // onNodeLoaded on the loader threads, so they are removed below while holding mLoadedMtx.
+  std::vector<TileId> finished;
+
   for (auto& node : mergeNodes) {
     assert(node != nullptr);
     assert(node->getTile() != nullptr);
 
-    if (insertNode(&mTree, node)) {
-      mPendingTiles.erase(node->getTileId());
-      onNodeInserted(node);
+    if (insertNode(&mTree, node.get())) {
+      // the tree owns the node now
+      finished.push_back(node->getTileId());
+      onNodeInserted(node.release());
 
       ++merged;
-      node = nullptr;
     } else {
       // keep track of nodes that could not be inserted, e.g. because
       // their parent is currently not loaded
@@ -367,34 +504,41 @@ void TreeManagerBase::merge() {
   // tree. If that fails and the nodes age exceeds maxUnmergedAge, it is
   // discarded.
   for (std::size_t i = 0; i < mUnmergedNodes.size();) {
-    TileNode* node = mUnmergedNodes[i].mNode;
+    TileNode* node = mUnmergedNodes[i].mNode.get();
 
     if (insertNode(&mTree, node)) {
       // insert succeeded, remove from pending and unmerged and
       // associate render data with node
-      mPendingTiles.erase(node->getTileId());
+      finished.push_back(node->getTileId());
+      mUnmergedNodes[i].mNode.release();
       mUnmergedNodes.erase(mUnmergedNodes.begin() + i);
 
       onNodeInserted(node);
     } else if ((mFrameCount - mUnmergedNodes[i].mFrame) > maxUnmergedAge) {
       // node is waiting for too long to be merged - discard it
-      mPendingTiles.erase(node->getTileId());
+      finished.push_back(node->getTileId());
       mUnmergedNodes.erase(mUnmergedNodes.begin() + i);
-
-      delete node; // NOLINT(cppcoreguidelines-owning-memory): TODO where does it get created?
     } else {
       ++i;
     }
   }
 
+  if (!finished.empty()) {
+    std::unique_lock<std::mutex> lck(mLoadedMtx);
+
+    for (auto const& tileId : finished) {
+      mPendingTiles.erase(tileId);
+    }
+  }
+
   // copy any nodes that where not merged to mUnmergedNodes
   if (unmerged > 0) {
     // Store unmerged nodes together with the current frame number.
     // Attempts to merge these into the tree will be made until their age
     // exceeds maxUnmergedAge (see mergeUnmerged).
-    for (auto const& node : mergeNodes) {
+    for (auto& node : mergeNodes) {
       if (node) {
-        mUnmergedNodes.emplace_back(node, mFrameCount);
+        mUnmergedNodes.emplace_back(std::move(node), mFrameCount);
         --unmerged;
       }
     }
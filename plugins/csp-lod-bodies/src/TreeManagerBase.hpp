@@ -7,8 +7,13 @@
 #ifndef CSP_LOD_BODIES_TREEMANAGERBASE_HPP
 #define CSP_LOD_BODIES_TREEMANAGERBASE_HPP
 
+#include "TileAgeList.hpp"
 #include "TileId.hpp"
+#include "TileNodeCache.hpp"
 #include "TileQuadTree.hpp"
+#include "TileRequest.hpp"
+
+#include "../../../src/cs-utils/CancellationToken.hpp"
 
 #include <boost/cast.hpp>
 #include <boost/noncopyable.hpp>
@@ -33,18 +38,28 @@ class TileTextureArray;
 /// Tiles to load from the configured TileSource are passed in with a call to request and previously
 /// (asynchronously) loaded tiles are merged into the TileQuadTree with a call to update.
 ///
+/// Only a limited number of requests is passed to the TileSource at the same time. All other
+/// requests are queued and re-ranked whenever they are requested again, usually once per frame.
+/// When the source finishes a tile, its slot becomes free. The queued requests with the highest
+/// priorities are started with the next call to request(), so that the source is never called from
+/// its own loader threads.
+///
 /// In addition to managing the loading of tiles and inserting them into the managed TileQuadTree
 /// this also keeps track of the "age" of nodes. A nodes age is measured in frames since the last
 /// time it was used - other classes mark nodes as used (e.g. LODVisitor when testing visibility of
 /// a node).
 ///
-/// In order to quickly find "old" nodes a vector of pointers (AgeStore) to the entries of the
-/// RenderDataMap is used (this is possible because unordered_map guarantees that pointers to values
-/// do not change, even when rehashing occurs). The AgeStore is sorted so that the oldest nodes are
-/// at the back and those are removed if their age exceeds a certain threshold (see
-/// TreeManagerBase::prune).
+/// In order to quickly find "old" nodes, the RenderData of all nodes is kept in a TileAgeList which
+/// is ordered by the frame of the last use. The oldest nodes are removed if their age exceeds a
+/// certain threshold (see TreeManagerBase::prune).
+///
+/// Pruned nodes are not deleted right away but parked in a TileNodeCache with a limited budget. If
+/// such a tile is requested again, it is taken from there without involving the TileSource.
 class TreeManagerBase : private boost::noncopyable {
  public:
+  /// If glResources is a nullptr, no data is uploaded to the GPU and tiles can be used as soon as
+  /// they are merged into the tree. This allows running the level-of-detail selection without an
+  /// OpenGL context, e.g. for benchmarks.
   explicit TreeManagerBase(
       PlanetParameters const& params, std::shared_ptr<GLResources> glResources);
 
@@ -72,15 +87,18 @@ class TreeManagerBase : private boost::noncopyable {
   /// Returns the name for this instance.
   std::string const& getName() const;
 
-  /// Request data tiles with indices tileIds to be loaded and queued to be merged into the quad
-  /// tree (with a subsequent call to update).
-  void request(std::vector<TileId> const& tileIds);
+  /// Request data tiles to be loaded and queued to be merged into the quad tree (with a subsequent
+  /// call to update). Requests for tiles which are already queued update the priority of the queued
+  /// request.
+  void request(std::vector<TileRequest> const& requests);
 
   /// Update the TileQuadTree managed by this with the tiles that have been loaded from the
-  /// TileSource since the last call to update.
+  /// TileSource since the last call to update. Pending requests which have not been repeated for a
+  /// few frames are cancelled.
   void update();
 
-  /// Removes all nodes from the tree and frees data associated with them.
+  /// Removes all nodes from the tree and frees data associated with them. Pending requests are
+  /// cancelled, this may be called while the source is still loading tiles.
   void clear();
 
   int  getFrameCount() const;
@@ -123,27 +141,48 @@ class TreeManagerBase : private boost::noncopyable {
   RenderData* findRData(TileId const& tileId);
 
   /// Returns a pointer to the TileTextureArray used by this to manage texture data. This is an
-  /// internal interface for use by TileRenderer.
+  /// internal interface for use by TileRenderer. It must not be called without GPU resources.
   TileTextureArray& getTileTextureArray() const;
 
   /// Returns the number of nodes in the tree managed by this.
   std::size_t getNodeCount() const;
 
-  /// Returns the number of nodes uploaded to the GPU.
+  /// Returns the number of nodes uploaded to the GPU. Without GPU resources, this is the number of
+  /// all nodes.
   std::size_t getNodeCountGPU() const;
 
+  /// Sets the number of bytes which can be used for keeping pruned nodes in memory. If set to zero,
+  /// pruned nodes are deleted immediately.
+  void setTileCacheSize(std::size_t bytes);
+
+  /// Returns the cache of pruned nodes. This can be used to query its statistics.
+  TileNodeCache const& getTileCache() const;
+
+  /// Sets the time in milliseconds which each call to update may spend on uploading tiles to the
+  /// GPU. See TileTextureArray::processQueue.
+  void   setUploadBudget(double milliseconds);
+  double getUploadBudget() const;
+
  protected:
   using RDMapValue = std::unordered_map<TileId, RenderData*>::value_type;
-  using AgeStore   = std::vector<RDMapValue*>;
 
-  struct AgeLess;
+  /// Tracks a request to the TileSource and the last frame it was requested in. Requests which
+  /// have not been started yet are waiting in the queue for a free slot.
+  struct PendingRequest {
+    std::shared_ptr<cs::utils::CancellationToken> mToken;
+    int                                           mLastFrame;
+    double                                        mPriority;
+    bool                                          mStarted;
+  };
+
+  using PendingMapValue = std::unordered_map<TileId, PendingRequest>::value_type;
 
   /// Tracks a node and the frame it was loaded in - for nodes that can not immediately be merged.
   struct NodeAge {
-    explicit NodeAge(TileNode* node, int frame);
+    explicit NodeAge(std::unique_ptr<TileNode> node, int frame);
 
-    TileNode* mNode;
-    int       mFrame;
+    std::unique_ptr<TileNode> mNode;
+    int                       mFrame;
   };
 
   /// Used as a callback for the TileSource to call when a node is loaded.
@@ -162,9 +201,25 @@ class TreeManagerBase : private boost::noncopyable {
   /// Releases the data associated with a node, which was previously returned by allocateRenderData.
   virtual void releaseRenderData(RenderData* rdata) = 0;
 
+  /// Passes the queued requests with the highest priorities to the TileSource until its maximum
+  /// number of concurrent requests is reached, see TileSource::getMaxConcurrentRequests. mLoadedMtx
+  /// must be locked by the caller.
+  void startQueuedRequests();
+
+  /// Passes a single request to the TileSource. mLoadedMtx must be locked by the caller.
+  void startRequest(TileId const& tileId, PendingRequest& request);
+
+  /// Cancels all pending requests which have not been repeated for a number of frames. This happens
+  /// for example when the camera moved on before the tiles were loaded. Queued requests are simply
+  /// dropped. For started requests, the source will call onNodeLoaded (usually with a nullptr),
+  /// only then the request is removed. Until then, the tile can not be requested again - this
+  /// ensures that a tile is never loaded twice.
+  void cancelStaleRequests();
+
   /// Remove nodes from the managed TileQuadTree that have not been used for a number of frames.
-  /// Sort tiles by age (frames since last use, see TreeManagerBase::AgeLess for details) and
-  /// removes those considered too "old".
+  /// The oldest nodes are taken from the TileAgeList (see TileAgeList::getOldest() for details)
+  /// until there is no node left which is considered too "old". Hence the costs only depend on
+  /// the number of removed nodes.
   void prune();
 
   /// Merge nodes loaded since the last merge into the managed TileQuadTree. It is possible that a
@@ -178,20 +233,24 @@ class TreeManagerBase : private boost::noncopyable {
   PlanetParameters const*                 mParams;
   std::shared_ptr<GLResources>            mGlMgr;
   std::unordered_map<TileId, RenderData*> mRdMap;
-  AgeStore                                mAgeStore;
+  TileAgeList                             mAgeList;
 
   TileQuadTree mTree;
   TileSource*  mSrc;
 
-  std::unordered_set<TileId> mPendingTiles;
-  std::vector<NodeAge>       mUnmergedNodes;
+  std::unordered_map<TileId, PendingRequest> mPendingTiles;
+  std::vector<PendingMapValue*>              mRequestQueue;
+  int                                        mRunningRequests;
+  std::vector<NodeAge>                       mUnmergedNodes;
 
-  std::mutex             mLoadedMtx;
-  std::vector<TileNode*> mLoadedNodes;
+  std::mutex                             mLoadedMtx;
+  std::vector<std::unique_ptr<TileNode>> mLoadedNodes;
+  TileNodeCache                          mTileCache;
 
   std::string mName;
   int         mFrameCount;
   bool        mAsyncLoading;
+  double      mUploadBudget;
 };
 
 template <typename RDataT>
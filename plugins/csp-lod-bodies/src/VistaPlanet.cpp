@@ -6,9 +6,6 @@
 
 #include "VistaPlanet.hpp"
 
-#include "TileSource.hpp"
-#include "UpdateBoundsVisitor.hpp"
-
 #include <../../../src/cs-utils/utils.hpp>
 
 #include <VistaBase/VistaStreamUtils.h>
@@ -21,8 +18,6 @@
 
 namespace csp::lodbodies {
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
 /* static */ bool VistaPlanet::sGlewInitialized = false;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -30,39 +25,20 @@ namespace csp::lodbodies {
 /* explicit */
 VistaPlanet::VistaPlanet(std::shared_ptr<GLResources> const& glResources)
     : mWorldTransform(1.0)
-    , mLodVisitor(mParams)
-    , mRenderer(mParams)
-    , mSrcDEM(nullptr)
-    , mTreeMgrDEM(mParams, glResources)
-    , mSrcIMG(nullptr)
-    , mTreeMgrIMG(mParams, glResources)
+    , mPipeline(glResources)
+    , mRenderer(mPipeline.getParameters())
     , mLastFrameClock(GetVistaSystem()->GetFrameClock())
     , mSumFrameClock(0.0)
     , mSumDrawTiles(0)
     , mSumLoadTiles(0)
     , mMaxDrawTiles(0)
-    , mMaxLoadTiles(0)
-    , mFlags(0) {
-  mTreeMgrDEM.setName("DEM");
-  mTreeMgrIMG.setName("IMG");
+    , mMaxLoadTiles(0) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /* virtual */
 VistaPlanet::~VistaPlanet() {
-  // clear tree managers
-  mTreeMgrDEM.clear();
-  mTreeMgrIMG.clear();
-
-  if (mSrcDEM) {
-    mSrcDEM->fini();
-  }
-
-  if (mSrcIMG) {
-    mSrcIMG->fini();
-  }
-
 #if !defined(NDEBUG) && !defined(VISTAPLANET_NO_VERBOSE)
   vstr::outi() << "[VistaPlanet::~VistaPlanet] maxDrawTiles " << mMaxDrawTiles << " maxLoadTiles "
                << mMaxLoadTiles << std::endl;
@@ -79,7 +55,11 @@ VistaPlanet::~VistaPlanet() {
   glm::fmat4x4 matP       = getProjectionMatrix();
   glm::ivec4   viewport   = getViewport();
 
-  traverseTileTrees(frameCount, matVM, matP, viewport);
+  // The shadow cascades change in every frame, hence their decisions could not be reused anyways
+  // and would only displace those of the camera views.
+  mPipeline.getLODVisitor().setSkipDecisions(true);
+  mPipeline.traverseTileTrees(frameCount, matVM, matP, viewport);
+  mPipeline.getLODVisitor().setSkipDecisions(false);
 
   renderTiles(frameCount, matVM, matP, nullptr);
 }
@@ -128,6 +108,18 @@ glm::dmat4 VistaPlanet::getWorldTransform() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void VistaPlanet::setPredictedWorldTransform(std::optional<glm::dmat4> const& mat) {
+  mPredictedWorldTransform = mat;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<glm::dmat4> const& VistaPlanet::getPredictedWorldTransform() const {
+  return mPredictedWorldTransform;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void VistaPlanet::setTerrainShader(TerrainShader* shader) {
   mRenderer.setTerrainShader(shader);
 }
@@ -141,71 +133,27 @@ TerrainShader* VistaPlanet::getTerrainShader() const {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void VistaPlanet::setDEMSource(TileSource* srcDEM) {
-  // Don't do anything if nothing changed.
-  if (mSrcDEM == srcDEM) {
-    return;
-  }
-
-  // shut down old source
-  if (mSrcDEM) {
-    mSrcDEM->fini();
-
-    mLodVisitor.setTreeManagerDEM(nullptr);
-    mRenderer.setTreeManagerDEM(nullptr);
-    mTreeMgrDEM.setSource(nullptr);
-  }
-
-  mSrcDEM = srcDEM;
-
-  // init new source
-  if (mSrcDEM) {
-    mSrcDEM->init();
-
-    mTreeMgrDEM.setSource(mSrcDEM);
-    mLodVisitor.setTreeManagerDEM(&mTreeMgrDEM);
-    mRenderer.setTreeManagerDEM(&mTreeMgrDEM);
-  }
+  mPipeline.setDEMSource(srcDEM);
+  mRenderer.setTreeManagerDEM(srcDEM ? &mPipeline.getTreeManagerDEM() : nullptr);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TileSource* VistaPlanet::getDEMSource() const {
-  return mSrcDEM;
+  return mPipeline.getDEMSource();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void VistaPlanet::setIMGSource(TileSource* srcIMG) {
-  // Don't do anything if nothing changed.
-  if (mSrcIMG == srcIMG) {
-    return;
-  }
-
-  // shut down old source
-  if (mSrcIMG) {
-    mSrcIMG->fini();
-
-    mLodVisitor.setTreeManagerIMG(nullptr);
-    mRenderer.setTreeManagerIMG(nullptr);
-    mTreeMgrIMG.setSource(nullptr);
-  }
-
-  mSrcIMG = srcIMG;
-
-  // init new source
-  if (mSrcIMG) {
-    mSrcIMG->init();
-
-    mTreeMgrIMG.setSource(mSrcIMG);
-    mLodVisitor.setTreeManagerIMG(&mTreeMgrIMG);
-    mRenderer.setTreeManagerIMG(&mTreeMgrIMG);
-  }
+  mPipeline.setIMGSource(srcIMG);
+  mRenderer.setTreeManagerIMG(srcIMG ? &mPipeline.getTreeManagerIMG() : nullptr);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TileSource* VistaPlanet::getIMGSource() const {
-  return mSrcIMG;
+  return mPipeline.getIMGSource();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -225,16 +173,23 @@ void VistaPlanet::doFrame() {
   updateStatistics(frameCount);
 
   // update bounding boxes
-  updateTileBounds();
+  mPipeline.updateTileBounds();
 
   // integrate newly loaded tiles/remove unused tiles
-  updateTileTrees(frameCount);
+  mPipeline.updateTileTrees(frameCount);
 
   // determine tiles to draw and load
-  traverseTileTrees(frameCount, matVM, matP, viewport);
+  mPipeline.traverseTileTrees(frameCount, matVM, matP, viewport);
+
+  // determine tiles to load for the predicted view, the view matrix stays the same, only the
+  // planet is moved to its predicted location
+  if (mPredictedWorldTransform) {
+    mPipeline.prefetchTileTrees(frameCount,
+        matVM * glm::inverse(mWorldTransform) * *mPredictedWorldTransform, matP, viewport);
+  }
 
   // pass requests to load tiles to TreeManagers
-  processLoadRequests();
+  mPipeline.processLoadRequests();
 
   // render
   renderTiles(frameCount, matVM, matP, mShadowMap);
@@ -247,26 +202,34 @@ void VistaPlanet::updateStatistics(int frameCount) {
   double frameT     = (frameClock - mLastFrameClock);
   mLastFrameClock   = frameClock;
 
+  auto const& lodVisitor = mPipeline.getLODVisitor();
+
   // update statistics
   mMaxDrawTiles = std::max(mMaxDrawTiles,
-      std::max(mLodVisitor.getRenderDEM().size(), mLodVisitor.getRenderIMG().size()));
+      std::max(lodVisitor.getRenderDEM().size(), lodVisitor.getRenderIMG().size()));
   mMaxLoadTiles =
-      std::max(mMaxLoadTiles, mLodVisitor.getLoadDEM().size() + mLodVisitor.getLoadIMG().size());
+      std::max(mMaxLoadTiles, lodVisitor.getLoadDEM().size() + lodVisitor.getLoadIMG().size());
 
   // running sums of frame time, tiles to draw, and tiles to load
   // used below to calculate averages every 60 frames
   mSumFrameClock += frameT;
-  mSumDrawTiles += std::max(mLodVisitor.getRenderDEM().size(), mLodVisitor.getRenderIMG().size());
-  mSumLoadTiles += mLodVisitor.getLoadDEM().size() + mLodVisitor.getLoadIMG().size();
+  mSumDrawTiles += std::max(lodVisitor.getRenderDEM().size(), lodVisitor.getRenderIMG().size());
+  mSumLoadTiles += lodVisitor.getLoadDEM().size() + lodVisitor.getLoadIMG().size();
 
   // print and reset statistics every 60 frames
   if (frameCount % 60 == 0) {
 #if !defined(NDEBUG) && !defined(VISTAPLANET_NO_VERBOSE)
+    auto const& cacheDEM = mPipeline.getTreeManagerDEM().getTileCache();
+    auto const& cacheIMG = mPipeline.getTreeManagerIMG().getTileCache();
+
     vstr::outi() << "[VistaPlanet::Do] frame [" << vstr::framecount << "] avg. fps ["
                  << std::setprecision(2) << std::setw(4) << (60.0 / mSumFrameClock)
                  << "] avg. frameclock [" << std::setprecision(3) << std::setw(4)
                  << (mSumFrameClock / 60.0) << "] avg. draw tiles [" << (mSumDrawTiles / 60.0)
-                 << "] avg. load tiles [" << (mSumLoadTiles / 60.0) << "]"
+                 << "] avg. load tiles [" << (mSumLoadTiles / 60.0) << "] tile cache hits/misses ["
+                 << cacheDEM.getHitCount() + cacheIMG.getHitCount() << " / "
+                 << cacheDEM.getMissCount() + cacheIMG.getMissCount() << "] tile cache memory ["
+                 << (cacheDEM.getBytes() + cacheIMG.getBytes()) / (1024 * 1024) << " MB]"
                  << std::setprecision(6); // reset to default
 
     if ((mSumFrameClock / 60.0) > 0.017) {
@@ -284,61 +247,6 @@ void VistaPlanet::updateStatistics(int frameCount) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void VistaPlanet::updateTileBounds() {
-  if ((mFlags & sFlagTileBoundsInvalid) != 0) {
-    // rebuild bounding boxes
-    UpdateBoundsVisitor ubVisitor(&mTreeMgrDEM, mParams);
-    ubVisitor.visit();
-
-    mFlags &= ~sFlagTileBoundsInvalid;
-  }
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-void VistaPlanet::updateTileTrees(int frameCount) {
-  // update DEM tree
-  if (mSrcDEM) {
-    mTreeMgrDEM.setFrameCount(frameCount);
-    mTreeMgrDEM.update();
-  }
-
-  // update IMG tree
-  if (mSrcIMG) {
-    mTreeMgrIMG.setFrameCount(frameCount);
-    mTreeMgrIMG.update();
-  }
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-void VistaPlanet::traverseTileTrees(
-    int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP, glm::ivec4 const& viewport) {
-  // update per-frame information of LODVisitor
-  mLodVisitor.setFrameCount(frameCount);
-  mLodVisitor.setModelview(matVM);
-  mLodVisitor.setProjection(matP);
-  mLodVisitor.setViewport(viewport);
-
-  // traverse quad trees and determine nodes to render and load
-  // respectively
-  mLodVisitor.visit();
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-void VistaPlanet::processLoadRequests() {
-  if (mSrcDEM) {
-    mTreeMgrDEM.request(mLodVisitor.getLoadDEM());
-  }
-
-  if (mSrcIMG) {
-    mTreeMgrIMG.request(mLodVisitor.getLoadIMG());
-  }
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
 void VistaPlanet::renderTiles(int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP,
     cs::graphics::ShadowMap* shadowMap) {
   // update per-frame information of TileRenderer
@@ -346,7 +254,9 @@ void VistaPlanet::renderTiles(int frameCount, glm::dmat4 const& matVM, glm::fmat
   mRenderer.setModelview(matVM);
   mRenderer.setProjection(matP);
   mRenderer.setFarClip(cs::utils::getCurrentFarClipDistance());
-  mRenderer.render(mLodVisitor.getRenderDEM(), mLodVisitor.getRenderIMG(), shadowMap);
+
+  auto const& lodVisitor = mPipeline.getLODVisitor();
+  mRenderer.render(lodVisitor.getRenderDEM(), lodVisitor.getRenderIMG(), shadowMap);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -397,53 +307,61 @@ glm::ivec4 VistaPlanet::getViewport() {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void VistaPlanet::setRadii(glm::dvec3 const& radii) {
-  mParams.mRadii = radii;
-
-  mFlags |= sFlagTileBoundsInvalid;
+  mPipeline.setRadii(radii);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 glm::dvec3 const& VistaPlanet::getRadii() const {
-  return mParams.mRadii;
+  return mPipeline.getRadii();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void VistaPlanet::setHeightScale(float scale) {
-  mParams.mHeightScale = scale;
-
-  mFlags |= sFlagTileBoundsInvalid;
+  mPipeline.setHeightScale(scale);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 double VistaPlanet::getHeightScale() const {
-  return mParams.mHeightScale;
+  return mPipeline.getHeightScale();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void VistaPlanet::setLODFactor(float lodFactor) {
-  mParams.mLodFactor = lodFactor;
+  mPipeline.setLODFactor(lodFactor);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 double VistaPlanet::getLODFactor() const {
-  return mParams.mLodFactor;
+  return mPipeline.getLODFactor();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void VistaPlanet::setMinLevel(int minLevel) {
-  mParams.mMinLevel = minLevel;
+  mPipeline.setMinLevel(minLevel);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int VistaPlanet::getMinLevel() const {
-  return mParams.mMinLevel;
+  return mPipeline.getMinLevel();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VistaPlanet::setTileCacheSize(std::size_t bytes) {
+  mPipeline.setTileCacheSize(bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VistaPlanet::setTileUploadBudget(double milliseconds) {
+  mPipeline.setTileUploadBudget(milliseconds);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -461,13 +379,13 @@ TileRenderer const& VistaPlanet::getTileRenderer() const {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 LODVisitor& VistaPlanet::getLODVisitor() {
-  return mLodVisitor;
+  return mPipeline.getLODVisitor();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 LODVisitor const& VistaPlanet::getLODVisitor() const {
-  return mLodVisitor;
+  return mPipeline.getLODVisitor();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
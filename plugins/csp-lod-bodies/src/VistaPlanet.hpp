@@ -7,13 +7,12 @@
 #ifndef CSP_LOD_BODIES_VISTAPLANET_HPP
 #define CSP_LOD_BODIES_VISTAPLANET_HPP
 
-#include "LODVisitor.hpp"
-#include "PlanetParameters.hpp"
+#include "LODPipeline.hpp"
 #include "TileRenderer.hpp"
-#include "TreeManager.hpp"
 
 #include "../../../src/cs-graphics/Shadows.hpp"
 #include <VistaKernel/GraphicsManager/VistaOpenGLDraw.h>
+#include <optional>
 
 class VistaGLSLShader;
 class VistaSystem;
@@ -23,8 +22,6 @@ namespace csp::lodbodies {
 class TileBase;
 class TileNode;
 class TileSource;
-class RenderDataDEM;
-class RenderDataImg;
 class TerrainShader;
 
 /// Renders a planet from databases of hierarchical tiles.
@@ -43,6 +40,9 @@ class TerrainShader;
 ///
 /// Additionally, VistaPlanet provides the interface to set the data sources that are used to obtain
 /// data (setDEMSource, setIMGSource).
+///
+/// The level-of-detail selection and the loading of tiles are done by a LODPipeline, VistaPlanet
+/// only adds the ViSTA integration and the rendering.
 class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
  public:
   explicit VistaPlanet(std::shared_ptr<GLResources> const& glResources);
@@ -64,6 +64,13 @@ class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
   void       setWorldTransform(glm::dmat4 const& mat);
   glm::dmat4 getWorldTransform() const;
 
+  /// Sets the world transform the planet is expected to have shortly, see ObserverPredictor. If
+  /// set, the tiles needed for the view from the predicted position are requested as well. They
+  /// are loaded after all tiles which are needed for the current view. Pass std::nullopt to stop
+  /// prefetching.
+  void                             setPredictedWorldTransform(std::optional<glm::dmat4> const& mat);
+  std::optional<glm::dmat4> const& getPredictedWorldTransform() const;
+
   /// Sets shader to use for terrain rendering. This class does not take ownership of the passed in
   /// object.
   void setTerrainShader(TerrainShader* shader);
@@ -101,6 +108,14 @@ class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
   void setMinLevel(int minLevel);
   int  getMinLevel() const;
 
+  /// Sets the amount of memory in bytes which each of the two tile trees may use for keeping
+  /// recently removed tiles around. See TreeManagerBase::setTileCacheSize.
+  void setTileCacheSize(std::size_t bytes);
+
+  /// Sets the time in milliseconds which each of the two tile trees may spend on uploading tiles to
+  /// the GPU each frame.
+  void setTileUploadBudget(double milliseconds);
+
   /// Returns the TileRenderer instance used to render this VistaPlanet.
   TileRenderer&       getTileRenderer();
   TileRenderer const& getTileRenderer() const;
@@ -112,11 +127,6 @@ class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
  private:
   void doFrame();
   void updateStatistics(int frameCount);
-  void updateTileBounds();
-  void updateTileTrees(int frameCount);
-  void traverseTileTrees(int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP,
-      glm::ivec4 const& viewport);
-  void processLoadRequests();
   void renderTiles(int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP,
       cs::graphics::ShadowMap* shadowMap);
 
@@ -124,20 +134,13 @@ class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
   static glm::dmat4 getProjectionMatrix();
   static glm::ivec4 getViewport();
 
-  static glm::uint8 const sFlagTileBoundsInvalid = 0x01;
-  static bool             sGlewInitialized;
+  static bool sGlewInitialized;
 
-  glm::dmat4 mWorldTransform;
+  glm::dmat4                mWorldTransform;
+  std::optional<glm::dmat4> mPredictedWorldTransform;
 
-  PlanetParameters mParams;
-  LODVisitor       mLodVisitor;
-  TileRenderer     mRenderer;
-
-  TileSource*                mSrcDEM;
-  TreeManager<RenderDataDEM> mTreeMgrDEM;
-
-  TileSource*                mSrcIMG;
-  TreeManager<RenderDataImg> mTreeMgrIMG;
+  LODPipeline  mPipeline;
+  TileRenderer mRenderer;
 
   // global statistics
   double      mLastFrameClock;
@@ -147,8 +150,6 @@ class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
 
   std::size_t mMaxDrawTiles;
   std::size_t mMaxLoadTiles;
-
-  glm::uint8 mFlags;
 };
 } // namespace csp::lodbodies
 #endif // CSP_LOD_BODIES_VISTAPLANET_HPP
@@ -6,31 +6,630 @@
 
 #include "utils.hpp"
 
+#include "FrustumCulling.hpp"
 #include "HEALPix.hpp"
 
+#include "MinMaxPyramid.hpp"
 #include "RenderDataDEM.hpp"
+#include "TreeManagerBase.hpp"
 #include "VistaPlanet.hpp"
 
 #include "../../../src/cs-utils/convert.hpp"
 
 #include <VistaKernel/GraphicsManager/VistaOpenGLNode.h>
 
+#include <algorithm>
+#include <array>
 #include <glm/gtx/quaternion.hpp>
+#include <limits>
+#include <type_traits>
+
+// SSE2 is always available on x86-64. The AVX2 functions are compiled for AVX2 using a function
+// attribute and are only called if the CPU supports AVX2, see FrustumCulling.cpp.
+#if defined(__x86_64__) || defined(_M_X64)
+#define CSP_LOD_BODIES_SIMD_AVX2
+#define CSP_LOD_BODIES_SIMD_SSE2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define CSP_LOD_BODIES_TARGET_AVX2
+#else
+#define CSP_LOD_BODIES_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CSP_LOD_BODIES_SIMD_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace csp::lodbodies::utils {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Bilinearly interpolates the samples of a tile at the given relative coordinates.
+template <typename T>
+double interpolateHeight(T const* data, glm::dvec2 relative) {
+  int sizeX = TileBase::SizeX;
+  int sizeY = TileBase::SizeY;
+
+  // Figure out flip
+  std::swap(relative.x, relative.y);
+
+  double u = relative.x * (sizeX - 1);
+  double v = relative.y * (sizeY - 1);
+
+  int uB = static_cast<int>(u);
+  int vB = static_cast<int>(v);
+
+  double uP = u - uB;
+  double vP = v - vB;
+
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  double h = data[vB + sizeY * uB];
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  double hP1 = data[vB + sizeY * (uB + 1)];
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  double hP2 = data[vB + 1 + sizeY * uB];
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  double hPP = data[vB + 1 + sizeY * (uB + 1)];
+
+  double interpol1 = (1.0 - uP) * h + uP * hP1;
+  double interpol2 = (1.0 - uP) * hP2 + uP * hPP;
+
+  return (1.0 - vP) * interpol1 + vP * interpol2;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the index of the child which contains the given relative coordinates and transforms
+// them to the coordinate system of that child.
+int descend(glm::dvec2& relative) {
+  int childIndex = 0;
+
+  if (relative.x < 0.5) {
+    relative.x = relative.x * 2.0;
+  } else {
+    childIndex += 1;
+    relative.x = (relative.x - 0.5) * 2.0;
+  }
+
+  if (relative.y < 0.5) {
+    relative.y = relative.y * 2.0;
+  } else {
+    childIndex += 2;
+    relative.y = (relative.y - 0.5) * 2.0;
+  }
+
+  return childIndex;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The state of a batched height query. While descending the tile quadtree, the queries are
+// grouped by the node they fall into: mOrder[begin..end) always contains the indices of all
+// queries within the current node.
+struct HeightQueries {
+  HeightSamplePrecision   mPrecision;
+  std::vector<glm::dvec2> mRelative; ///< Relative coordinates in the current node.
+  std::vector<size_t>     mOrder;
+  std::vector<size_t>     mScratch;
+  std::vector<double>*    mHeights;
+  std::vector<TileId>*    mMissingTiles; ///< Receives missing children for eFine.
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The versions below interpolate several queries at once, the samples are loaded one by one for
+// SSE2 and gathered for AVX2. All operations are performed in the same order as in
+// interpolateHeight(), which makes the results bit-identical. They return the number of processed
+// queries, the remaining ones have to be interpolated by the scalar version.
+#if defined(CSP_LOD_BODIES_SIMD_SSE2)
+
+namespace sse2 {
+
+template <typename T>
+size_t interpolateHeights(T const* data, glm::dvec2 const* relative, size_t const* order,
+    size_t count, double* heights) {
+  __m128d const one   = _mm_set1_pd(1.0);
+  __m128d const sizeX = _mm_set1_pd(TileBase::SizeX - 1);
+  __m128d const sizeY = _mm_set1_pd(TileBase::SizeY - 1);
+
+  size_t i = 0;
+
+  for (; i + 2 <= count; i += 2) {
+    // Load the coordinates of two queries and swap x and y, just like interpolateHeight().
+    __m128d const r0 = _mm_loadu_pd(&relative[order[i]].x);
+    __m128d const r1 = _mm_loadu_pd(&relative[order[i + 1]].x);
+    __m128d const u  = _mm_mul_pd(_mm_unpackhi_pd(r0, r1), sizeX);
+    __m128d const v  = _mm_mul_pd(_mm_unpacklo_pd(r0, r1), sizeY);
+
+    __m128i const uB = _mm_cvttpd_epi32(u);
+    __m128i const vB = _mm_cvttpd_epi32(v);
+    __m128d const uP = _mm_sub_pd(u, _mm_cvtepi32_pd(uB));
+    __m128d const vP = _mm_sub_pd(v, _mm_cvtepi32_pd(vB));
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    T const* p0 = data + _mm_cvtsi128_si32(vB) + TileBase::SizeY * _mm_cvtsi128_si32(uB);
+    T const* p1 = data + _mm_cvtsi128_si32(_mm_shuffle_epi32(vB, 1)) +
+                  TileBase::SizeY * _mm_cvtsi128_si32(_mm_shuffle_epi32(uB, 1));
+
+    __m128d const h   = _mm_set_pd(p1[0], p0[0]);
+    __m128d const hP1 = _mm_set_pd(p1[TileBase::SizeY], p0[TileBase::SizeY]);
+    __m128d const hP2 = _mm_set_pd(p1[1], p0[1]);
+    __m128d const hPP = _mm_set_pd(p1[TileBase::SizeY + 1], p0[TileBase::SizeY + 1]);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    __m128d const uQ        = _mm_sub_pd(one, uP);
+    __m128d const interpol1 = _mm_add_pd(_mm_mul_pd(uQ, h), _mm_mul_pd(uP, hP1));
+    __m128d const interpol2 = _mm_add_pd(_mm_mul_pd(uQ, hP2), _mm_mul_pd(uP, hPP));
+    __m128d const height    = _mm_add_pd(
+        _mm_mul_pd(_mm_sub_pd(one, vP), interpol1), _mm_mul_pd(vP, interpol2));
+
+    _mm_storel_pd(&heights[order[i]], height);
+    _mm_storeh_pd(&heights[order[i + 1]], height);
+  }
+
+  return i;
+}
+
+} // namespace sse2
+
+#endif
+
+#if defined(CSP_LOD_BODIES_SIMD_AVX2)
+
+namespace avx2 {
+
+// There is no gather instruction for single bytes, hence only float tiles are supported.
+CSP_LOD_BODIES_TARGET_AVX2 size_t interpolateHeights(float const* data,
+    glm::dvec2 const* relative, size_t const* order, size_t count, double* heights) {
+  __m256d const one    = _mm256_set1_pd(1.0);
+  __m256d const sizeX  = _mm256_set1_pd(TileBase::SizeX - 1);
+  __m256d const sizeY  = _mm256_set1_pd(TileBase::SizeY - 1);
+  __m128i const stride = _mm_set1_epi32(TileBase::SizeY);
+  int const     scale  = sizeof(float);
+
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    // Queries 0 and 2 are loaded into the first, 1 and 3 into the second register, so that the
+    // unpack instructions (which work on 128 bit lanes) yield the coordinates in order.
+    __m256d const r02 = _mm256_insertf128_pd(
+        _mm256_castpd128_pd256(_mm_loadu_pd(&relative[order[i]].x)),
+        _mm_loadu_pd(&relative[order[i + 2]].x), 1);
+    __m256d const r13 = _mm256_insertf128_pd(
+        _mm256_castpd128_pd256(_mm_loadu_pd(&relative[order[i + 1]].x)),
+        _mm_loadu_pd(&relative[order[i + 3]].x), 1);
+    __m256d const u = _mm256_mul_pd(_mm256_unpackhi_pd(r02, r13), sizeX);
+    __m256d const v = _mm256_mul_pd(_mm256_unpacklo_pd(r02, r13), sizeY);
+
+    __m128i const uB = _mm256_cvttpd_epi32(u);
+    __m128i const vB = _mm256_cvttpd_epi32(v);
+    __m256d const uP = _mm256_sub_pd(u, _mm256_cvtepi32_pd(uB));
+    __m256d const vP = _mm256_sub_pd(v, _mm256_cvtepi32_pd(vB));
+
+    __m128i const idx = _mm_add_epi32(vB, _mm_mullo_epi32(uB, stride));
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    __m256d const h   = _mm256_cvtps_pd(_mm_i32gather_ps(data, idx, scale));
+    __m256d const hP1 = _mm256_cvtps_pd(_mm_i32gather_ps(data + TileBase::SizeY, idx, scale));
+    __m256d const hP2 = _mm256_cvtps_pd(_mm_i32gather_ps(data + 1, idx, scale));
+    __m256d const hPP = _mm256_cvtps_pd(_mm_i32gather_ps(data + TileBase::SizeY + 1, idx, scale));
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    __m256d const uQ        = _mm256_sub_pd(one, uP);
+    __m256d const interpol1 = _mm256_add_pd(_mm256_mul_pd(uQ, h), _mm256_mul_pd(uP, hP1));
+    __m256d const interpol2 = _mm256_add_pd(_mm256_mul_pd(uQ, hP2), _mm256_mul_pd(uP, hPP));
+    __m256d const height    = _mm256_add_pd(
+        _mm256_mul_pd(_mm256_sub_pd(one, vP), interpol1), _mm256_mul_pd(vP, interpol2));
+
+    std::array<double, 4> lanes{};
+    _mm256_storeu_pd(lanes.data(), height);
+
+    for (size_t j = 0; j < lanes.size(); ++j) {
+      heights[order[i + j]] = lanes.at(j);
+    }
+  }
+
+  return i;
+}
+
+} // namespace avx2
+
+#endif
+
+// Whether the AVX2 version is used, see setUseInterpolationAVX2().
+bool useAVX2 = isCullingAVX2Supported();
+
+template <typename T>
+void interpolateHeights(HeightQueries& queries, T const* data, size_t begin, size_t end) {
+  size_t i = begin;
+
+#if defined(CSP_LOD_BODIES_SIMD_AVX2)
+  if constexpr (std::is_same_v<T, float>) {
+    if (useAVX2) {
+      i += avx2::interpolateHeights(data, queries.mRelative.data(), queries.mOrder.data() + i,
+          end - i, queries.mHeights->data());
+    }
+  }
+#endif
+
+#if defined(CSP_LOD_BODIES_SIMD_SSE2)
+  i += sse2::interpolateHeights(data, queries.mRelative.data(), queries.mOrder.data() + i,
+      end - i, queries.mHeights->data());
+#endif
+
+  for (; i < end; ++i) {
+    size_t const idx         = queries.mOrder[i];
+    (*queries.mHeights)[idx] = interpolateHeight(data, queries.mRelative[idx]);
+  }
+}
+
+// Interpolates the heights of all queries in mOrder[begin..end) from the data of the given node.
+// The type of the data is checked only once for all queries.
+void interpolateHeights(HeightQueries& queries, TileNode const* node, size_t begin, size_t end) {
+  if (node->getTileDataType() == TileDataType::eFloat32) {
+    interpolateHeights(queries, node->getTile()->getTypedPtr<float>(), begin, end);
+  } else {
+    interpolateHeights(queries, node->getTile()->getTypedPtr<unsigned char>(), begin, end);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Sorts the queries in mOrder[begin..end) by the child of the current node they fall into. Upon
+// return, offsets[i] is the start of the range of child i and offsets[4] equals end.
+void sortByChild(HeightQueries& queries, size_t begin, size_t end, std::array<size_t, 5>& offsets) {
+  std::array<int, 4> counts{};
+
+  // Compute the child indices without modifying the coordinates yet, they are still needed if a
+  // child is not available.
+  for (size_t i = begin; i < end; ++i) {
+    glm::dvec2 relative = queries.mRelative[queries.mOrder[i]];
+    ++counts.at(descend(relative));
+  }
+
+  offsets[0] = begin;
+  for (size_t i = 0; i < 4; ++i) {
+    offsets.at(i + 1) = offsets.at(i) + counts.at(i);
+  }
+
+  auto positions = offsets;
+  for (size_t i = begin; i < end; ++i) {
+    glm::dvec2 relative = queries.mRelative[queries.mOrder[i]];
+    queries.mScratch[positions.at(descend(relative))++] = queries.mOrder[i];
+  }
+
+  std::copy(queries.mScratch.begin() + static_cast<std::ptrdiff_t>(begin),
+      queries.mScratch.begin() + static_cast<std::ptrdiff_t>(end),
+      queries.mOrder.begin() + static_cast<std::ptrdiff_t>(begin));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Computes the heights of all queries in mOrder[begin..end) which all fall into the given node.
+void sampleNode(HeightQueries& queries, TileNode* node, size_t begin, size_t end) {
+  if (isLeaf(*node) || queries.mPrecision == HeightSamplePrecision::eCoarse) {
+    interpolateHeights(queries, node, begin, end);
+    return;
+  }
+
+  std::array<size_t, 5> offsets{};
+  sortByChild(queries, begin, end, offsets);
+
+  for (int i = 0; i < 4; ++i) {
+    size_t const childBegin = offsets.at(i);
+    size_t const childEnd   = offsets.at(i + 1);
+
+    if (childBegin == childEnd) {
+      continue;
+    }
+
+    TileNode* child = node->getChild(i);
+
+    if (child != nullptr) {
+      for (size_t j = childBegin; j < childEnd; ++j) {
+        descend(queries.mRelative[queries.mOrder[j]]);
+      }
+
+      sampleNode(queries, child, childBegin, childEnd);
+    } else {
+      // Child is unavailable, use the data of this node.
+      interpolateHeights(queries, node, childBegin, childEnd);
+
+      if (queries.mPrecision == HeightSamplePrecision::eFine) {
+        queries.mMissingTiles->push_back(HEALPix::getChildTileId(node->getTileId(), i));
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the height of the given node at the given relative coordinates.
+double sampleHeight(TileNode const* node, glm::dvec2 const& relative) {
+  if (node->getTileDataType() == TileDataType::eFloat32) {
+    return interpolateHeight(node->getTile()->getTypedPtr<float>(), relative);
+  }
+
+  return interpolateHeight(node->getTile()->getTypedPtr<unsigned char>(), relative);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The number of bisection steps used to narrow down an intersection of a ray with the terrain.
+int const HitRefinementSteps = 16;
+
+// A tile whose bounds are hit by a ray.
+struct RayCandidate {
+  TileNode* mNode;
+  double    mEntry;
+  double    mExit;
+
+  // std::push_heap creates a max-heap, the tile which is entered first should be on top.
+  bool operator<(RayCandidate const& other) const {
+    return mEntry > other.mEntry;
+  }
+};
+
+// Adds the given node to the queue of candidates if the ray hits its bounds in front of the origin.
+void pushCandidate(TreeManagerBase* treeMgrDEM, TileNode* node, glm::dvec3 const& origin,
+    glm::dvec3 const& direction, std::vector<RayCandidate>& candidates) {
+  auto* rdDEM = treeMgrDEM->find<RenderDataDEM>(node->getTileId());
+
+  if (rdDEM == nullptr) {
+    return;
+  }
+
+  BoundingBox<double> bounds = rdDEM->getBounds();
+  double              entry{};
+  double              exit{};
+
+  if (bounds.GetIntersectionDistance(origin, direction, true, entry, exit) && exit > 0.0) {
+    candidates.push_back({node, entry, exit});
+    std::push_heap(candidates.begin(), candidates.end());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The properties of a leaf tile which are needed for marching a ray through its height field.
+struct TileRay {
+  TileNode const*      mNode;
+  MinMaxPyramid const* mPyramid;
+  glm::dvec3           mRadii;
+  double               mHeightScale;
+  int                  mBasePatch;
+  glm::dvec3           mOffsetScale;
+
+  // A lower bound for the distance between two adjacent samples of the tile. This is half of the
+  // shortest edge divided by the number of samples, to account for the distortion of the patches.
+  double mSampleDistance;
+};
+
+TileRay createTileRay(TileNode const* node, glm::dvec3 const& radii, double heightScale) {
+  TileId const& tileId = node->getTileId();
+
+  auto   corners = HEALPix::getCornersCartesian(tileId, radii);
+  double edge    = std::numeric_limits<double>::max();
+
+  for (size_t i = 0; i < corners.size(); ++i) {
+    edge = std::min(edge, glm::length(corners.at(i) - corners.at((i + 1) % corners.size())));
+  }
+
+  return {node, node->getTile()->getMinMaxPyramid(), radii, heightScale,
+      HEALPix::getBasePatch(tileId), HEALPix::getPatchOffsetScale(tileId),
+      0.5 * edge / (TileBase::SizeX - 1)};
+}
+
+// Computes the relative coordinates of the given point in the tile, the height of the point above
+// the ellipsoid and its altitude above the terrain. Returns false if the point is not within the
+// tile.
+bool sampleTileRay(TileRay const& ray, glm::dvec3 const& point, glm::dvec2& relative,
+    double& height, double& altitude) {
+  glm::dvec3 lngLatHeight = cs::utils::convert::cartesianToLngLatHeight(point, ray.mRadii);
+
+  relative = (HEALPix::convertBaseLngLat2XY(ray.mBasePatch, glm::dvec2(lngLatHeight)) -
+                 glm::dvec2(ray.mOffsetScale)) /
+             ray.mOffsetScale.z;
+
+  if (relative.x < 0.0 || relative.x >= 1.0 || relative.y < 0.0 || relative.y >= 1.0) {
+    return false;
+  }
+
+  height   = lngLatHeight.z;
+  altitude = height - ray.mHeightScale * sampleHeight(ray.mNode, relative);
+  return true;
+}
+
+// Returns how far the ray can advance from a point at the given relative coordinates and height
+// above the ellipsoid without passing through the terrain. The MinMaxPyramid is used as a
+// max-mipmap: Within a cell, the terrain is not higher than the maximum of the cell. As the ray's
+// height decreases by at most one unit per unit of distance, it can advance by its height above
+// this maximum, as long as it does not leave the cell. The cell which allows the largest step is
+// chosen. The step is never smaller than the distance between two samples.
+double getSafeStep(TileRay const& ray, glm::dvec2 const& relative, double height) {
+  double result = ray.mSampleDistance;
+
+  if (ray.mPyramid == nullptr) {
+    return result;
+  }
+
+  int const        last   = TileBase::SizeX - 1;
+  glm::dvec2 const sample = relative * static_cast<double>(last);
+
+  for (int level = 1; level <= MinMaxPyramid::sNumLevels; ++level) {
+    int const cells = 1 << level;
+    int const size  = last / cells;
+    int const x     = std::min(static_cast<int>(sample.x) / size, cells - 1);
+    int const y     = std::min(static_cast<int>(sample.y) / size, cells - 1);
+
+    double const margin = height - ray.mHeightScale * ray.mPyramid->getMax(level, x, y);
+
+    if (margin <= result) {
+      continue;
+    }
+
+    // The interpolated heights only depend on the samples of the cell as long as the position is
+    // not between the last sample of the cell and the first sample of the next cell.
+    double const maxX = x == cells - 1 ? last : (x + 1) * size - 1;
+    double const maxY = y == cells - 1 ? last : (y + 1) * size - 1;
+    double const distance = std::min(std::min(sample.x - x * size, maxX - sample.x),
+        std::min(sample.y - y * size, maxY - sample.y));
+
+    result = std::max(result, std::min(margin, distance * ray.mSampleDistance));
+  }
+
+  return result;
+}
+
+// Narrows down the intersection between a sample above and a sample below the terrain by
+// bisection. Finally, the intersection is interpolated linearly between the remaining samples.
+double refineHit(TileRay const& ray, glm::dvec3 const& origin, glm::dvec3 const& direction,
+    double tAbove, double altitudeAbove, double tBelow, double altitudeBelow) {
+  for (int i = 0; i < HitRefinementSteps; ++i) {
+    double     t = 0.5 * (tAbove + tBelow);
+    glm::dvec2 relative{};
+    double     height{};
+    double     altitude{};
+
+    if (!sampleTileRay(ray, origin + t * direction, relative, height, altitude)) {
+      break;
+    }
+
+    if (altitude < 0.0) {
+      tBelow        = t;
+      altitudeBelow = altitude;
+    } else {
+      tAbove        = t;
+      altitudeAbove = altitude;
+    }
+  }
+
+  return tAbove + (tBelow - tAbove) * altitudeAbove / (altitudeAbove - altitudeBelow);
+}
+
+// Marches along the ray from tMin to tMax through the height field of a tile. Returns true and the
+// distance to the intersection if the terrain is hit. The number of steps is bounded by the
+// distance between two samples of the tile.
+bool marchTileRay(TileRay const& ray, glm::dvec3 const& origin, glm::dvec3 const& direction,
+    double tMin, double tMax, double& tHit) {
+  double lastT{};
+  double lastAltitude{};
+  bool   firstSample = true;
+
+  for (double t = tMin;;) {
+    glm::dvec2 relative{};
+    double     height{};
+    double     altitude{};
+    double     step = ray.mSampleDistance;
+
+    if (sampleTileRay(ray, origin + t * direction, relative, height, altitude)) {
+      // Detect hit as soon as a sample point below the surface is found
+      if (altitude < 0.0) {
+        // Ignore sampling, which already starts below a patch due to exaggeration
+        if (firstSample) {
+          return false;
+        }
+
+        tHit = refineHit(ray, origin, direction, lastT, lastAltitude, t, altitude);
+        return true;
+      }
+
+      firstSample  = false;
+      lastT        = t;
+      lastAltitude = altitude;
+      step         = getSafeStep(ray, relative, height);
+    }
+
+    if (t >= tMax) {
+      return false;
+    }
+
+    t = std::min(t + step, tMax);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Intersects a ray with the leaf tiles of the given tree. The tiles are visited in the order in
+// which the ray enters their bounds. The direction has to be normalized.
+bool intersectTree(TreeManagerBase* treeMgrDEM, glm::dvec3 const& radii, double heightScale,
+    glm::dvec3 const& origin, glm::dvec3 const& direction, std::vector<RayCandidate>& candidates,
+    glm::dvec3& pos) {
+  // Check if TreeManagerDEM is ok
+  if (treeMgrDEM == nullptr || treeMgrDEM->getTree() == nullptr) {
+    return false;
+  }
+
+  candidates.clear();
+
+  // Determine intersected root patches
+  for (int rootIndex = 0; rootIndex < TileQuadTree::sNumRoots; ++rootIndex) {
+    TileNode* root = treeMgrDEM->getTree()->getRoot(rootIndex);
+
+    if (root == nullptr) {
+      return false;
+    }
+
+    pushCandidate(treeMgrDEM, root, origin, direction, candidates);
+  }
+
+  // Process intersected tile patch priority queue:
+  while (!candidates.empty()) {
+    std::pop_heap(candidates.begin(), candidates.end());
+    RayCandidate candidate = candidates.back();
+    candidates.pop_back();
+
+    // Parent is not a leaf in cut -> push intersected children into queue:
+    if (isRefined(*candidate.mNode)) {
+      for (int childIndex = 0; childIndex < 4; ++childIndex) {
+        pushCandidate(
+            treeMgrDEM, candidate.mNode->getChild(childIndex), origin, direction, candidates);
+      }
+
+      continue;
+    }
+
+    // March through the height field of cut leaf node, starting not behind the origin.
+    TileRay ray = createTileRay(candidate.mNode, radii, heightScale);
+    double  tHit{};
+
+    if (marchTileRay(ray, origin, direction, std::max(0.0, candidate.mEntry), candidate.mExit,
+            tHit)) {
+      pos = origin + tHit * direction;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 double getHeight(
     VistaPlanet const* planet, HeightSamplePrecision precision, glm::dvec2 const& lngLat) {
+  return getHeight(planet->getTileRenderer().getTreeManagerDEM(), precision, lngLat);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double getHeight(
+    TreeManagerBase* treeMgrDEM, HeightSamplePrecision precision, glm::dvec2 const& lngLat) {
 
   // Check if TreeManagerDEM is ok
-  if (planet->getTileRenderer().getTreeManagerDEM() == nullptr) {
+  if (treeMgrDEM == nullptr) {
     return 0.0F;
   }
 
   // Check if TreeManagerDEM -> GetTree is ok
-  if (planet->getTileRenderer().getTreeManagerDEM()->getTree() == nullptr) {
+  if (treeMgrDEM->getTree() == nullptr) {
     return 0.0F;
   }
 
@@ -43,7 +642,7 @@ double getHeight(
   relative1 = HEALPix::convertBaseLngLat2XY(rootIndex, lngLat);
 
   // Get the right root
-  TileNode* parent = planet->getTileRenderer().getTreeManagerDEM()->getTree()->getRoot(rootIndex);
+  TileNode* parent = treeMgrDEM->getTree()->getRoot(rootIndex);
 
   // Check if parent is valid
   if (parent == nullptr) {
@@ -60,112 +659,141 @@ double getHeight(
   int childIndex = -1;
 
   // Go down tree only if not coarse precision
-  while (child && !isLeaf(*child) && int(precision) > 1) {
+  while (!isLeaf(*child) && int(precision) > 1) {
     parent = child;
 
-    relative2 = relative1;
-
-    if (relative1.x < 0.5 && relative1.y < 0.5) {
-      childIndex  = 0;
-      relative1.x = relative1.x * 2.0;
-      relative1.y = relative1.y * 2.0;
-    } else if (relative1.x >= 0.5 && relative1.y < 0.5) {
-      childIndex  = 1;
-      relative1.x = (relative1.x - 0.5) * 2.0;
-      relative1.y = relative1.y * 2.0;
-    } else if (relative1.x < 0.5 && relative1.y >= 0.5) {
-      childIndex  = 2;
-      relative1.x = relative1.x * 2.0;
-      relative1.y = (relative1.y - 0.5) * 2.0;
-    } else {
-      childIndex  = 3;
-      relative1.x = (relative1.x - 0.5) * 2.0;
-      relative1.y = (relative1.y - 0.5) * 2.0;
-    }
+    relative2  = relative1;
+    childIndex = descend(relative1);
 
     // Get the new Child
     child = parent->getChild(childIndex);
 
-    // Child is unavailable and precision is "HeightSamplePrecision::eActual"
-    if (child == nullptr && precision == HeightSamplePrecision::eActual) {
+    // Child is unavailable, use the parent
+    if (child == nullptr) {
       child = parent;
 
       // Reset coordinates
       relative1 = relative2;
+
+      // With "Fine" precision, the child is requested. It will be merged into the tree by the next
+      // regular update of the TreeManager, this function never waits for it.
+      if (precision == HeightSamplePrecision::eFine) {
+        // height queries are more urgent than any tile requested by the LODVisitor
+        std::vector<TileRequest> requested;
+
+        requested.push_back({HEALPix::getChildTileId(parent->getTileId(), childIndex),
+            std::numeric_limits<double>::max()});
+
+        treeMgrDEM->request(requested);
+      }
+
       break;
     }
+  }
 
-    // Child is unavailable and precision is "Fine"
-    if (child == nullptr && precision == HeightSamplePrecision::eFine) {
-      std::vector<TileId> requested;
+  if (child->getTileDataType() == TileDataType::eFloat32) {
+    return interpolateHeight(child->getTile()->getTypedPtr<float>(), relative1);
+  }
 
-      requested.push_back(HEALPix::getChildTileId(parent->getTileId(), childIndex));
+  return interpolateHeight(child->getTile()->getTypedPtr<unsigned char>(), relative1);
+}
 
-      planet->getTileRenderer().getTreeManagerDEM()->request(requested);
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-      // planet->getTileRenderer().getTreeManagerDEM()->merge();
-      planet->getTileRenderer().getTreeManagerDEM()->update();
+void getHeights(VistaPlanet const* planet, HeightSamplePrecision precision,
+    std::vector<glm::dvec2> const& lngLats, std::vector<double>& heights) {
+  getHeights(planet->getTileRenderer().getTreeManagerDEM(), precision, lngLats, heights);
+}
 
-      child = parent->getChild(childIndex);
-    }
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void getHeights(TreeManagerBase* treeMgrDEM, HeightSamplePrecision precision,
+    std::vector<glm::dvec2> const& lngLats, std::vector<double>& heights) {
+  if (treeMgrDEM == nullptr || treeMgrDEM->getTree() == nullptr) {
+    heights.assign(lngLats.size(), 0.0);
+    return;
   }
 
-  // Check if Child Exists
-  if (child == nullptr) {
-    return 0.0;
+  std::vector<TileId> missingTiles;
+  getHeights(treeMgrDEM->getTree(), precision, lngLats, heights, missingTiles);
+
+  // The missing tiles will be merged into the tree by the next regular update of the TreeManager.
+  if (!missingTiles.empty()) {
+    std::vector<TileRequest> requests;
+    requests.reserve(missingTiles.size());
+
+    for (auto const& tileId : missingTiles) {
+      // height queries are more urgent than any tile requested by the LODVisitor
+      requests.push_back({tileId, std::numeric_limits<double>::max()});
+    }
+
+    treeMgrDEM->request(requests);
   }
+}
 
-  int sizeX = TileBase::SizeX;
-  int sizeY = TileBase::SizeY;
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  // Figure out flip
-  std::swap(relative1.x, relative1.y);
+void getHeights(TileQuadTree const* tree, HeightSamplePrecision precision,
+    std::vector<glm::dvec2> const& lngLats, std::vector<double>& heights,
+    std::vector<TileId>& missingTiles) {
+  heights.assign(lngLats.size(), 0.0);
 
-  double u = relative1.x * (sizeX - 1);
-  double v = relative1.y * (sizeY - 1);
+  HeightQueries queries{precision, std::vector<glm::dvec2>(lngLats.size()),
+      std::vector<size_t>(lngLats.size()), std::vector<size_t>(lngLats.size()), &heights,
+      &missingTiles};
 
-  int uB = static_cast<int>(u);
-  int vB = static_cast<int>(v);
+  // Group the queries by their root patch.
+  std::vector<int>                                rootIndices(lngLats.size());
+  std::array<size_t, TileQuadTree::sNumRoots + 1> offsets{};
 
-  double uP = u - uB;
-  double vP = v - vB;
+  for (size_t i = 0; i < lngLats.size(); ++i) {
+    rootIndices[i]       = HEALPix::convertLngLat2Base(lngLats[i]);
+    queries.mRelative[i] = HEALPix::convertBaseLngLat2XY(rootIndices[i], lngLats[i]);
+    ++offsets.at(rootIndices[i] + 1);
+  }
 
-  // if (uB >= sizeX - 1)
-  // {
-  //     uB = sizeX - 2;
-  //     uP = 1;
-  // }
+  for (size_t i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    offsets.at(i + 1) += offsets.at(i);
+  }
 
-  // if (vB >= sizeY - 1)
-  // {
-  //     vB = sizeY - 2;
-  //     vP = 1;
-  // }
+  auto positions = offsets;
+  for (size_t i = 0; i < lngLats.size(); ++i) {
+    queries.mOrder[positions.at(rootIndices[i])++] = i;
+  }
 
-  double h{};
-  double hP1{};
-  double hP2{};
-  double hPP{};
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    TileNode* root = tree->getRoot(i);
 
-  if (child->getTileDataType() == TileDataType::eFloat32) {
-    const auto* ptr = child->getTile()->getTypedPtr<float>();
-    h   = ptr[vB + sizeY * uB];           // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    hP1 = ptr[vB + sizeY * (uB + 1)];     // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    hP2 = ptr[vB + 1 + sizeY * uB];       // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    hPP = ptr[vB + 1 + sizeY * (uB + 1)]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-  } else {
-    const auto* ptr = child->getTile()->getTypedPtr<unsigned char>();
-    h   = ptr[vB + sizeY * uB];           // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    hP1 = ptr[vB + sizeY * (uB + 1)];     // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    hP2 = ptr[vB + 1 + sizeY * uB];       // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    hPP = ptr[vB + 1 + sizeY * (uB + 1)]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (root != nullptr && offsets.at(i) < offsets.at(i + 1)) {
+      sampleNode(queries, root, offsets.at(i), offsets.at(i + 1));
+    }
   }
+}
 
-  double interpol1 = (1.0 - uP) * h + uP * hP1;
-  double interpol2 = (1.0 - uP) * hP2 + uP * hPP;
-  double height    = (1.0 - vP) * interpol1 + vP * interpol2;
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  return height;
+void setUseInterpolationAVX2(bool enable) {
+  useAVX2 = enable && isCullingAVX2Supported();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool getUseInterpolationAVX2() {
+  return useAVX2;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+char const* getInterpolationInstructionSet() {
+  if (useAVX2) {
+    return "AVX2";
+  }
+
+#if defined(CSP_LOD_BODIES_SIMD_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -193,228 +821,57 @@ bool intersectTileBounds(TileNode const* tileNode, VistaPlanet const* planet,
 
 bool intersectPlanet(
     VistaPlanet const* planet, glm::dvec3 rayOrigin, glm::dvec3 rayDir, glm::dvec3& pos) {
-  // Check if TreeManagerDEM is ok
-  if (planet->getTileRenderer().getTreeManagerDEM() == nullptr) {
-    return false;
-  }
-
-  // Check if TreeManagerDEM -> GetTree is ok
-  if (planet->getTileRenderer().getTreeManagerDEM()->getTree() == nullptr) {
-    return false;
-  }
-
-  // Initialize Result to Zero
-  pos = glm::dvec3(0);
-
-  // Tile sizes
-  int sizeX = TileBase::SizeX;
-  int sizeY = TileBase::SizeY;
-
   // Planet transform -> Inverse -> so we are in planet space
-  glm::dmat4 planet_transform = planet->getWorldTransform();
-  glm::dmat4 planet_transformnv;
-  planet_transformnv = glm::inverse(planet_transform);
-
-  // Transform ray into planet coordinate system
-  glm::dvec4 origin(rayOrigin[0], rayOrigin[1], rayOrigin[2], 1.0);
-  origin = planet_transformnv * origin;
-
-  glm::dvec4 direction(rayDir[0], rayDir[1], rayDir[2], 0.0);
-  direction = planet_transformnv * direction;
-  direction = glm::normalize(direction);
-
-  // Determine intersected root patches
-  std::multimap<double, TileNode*> intersected_tiles;
-  for (int rootIndex = 0; rootIndex < 12; ++rootIndex) {
-
-    TileNode* root_node =
-        planet->getTileRenderer().getTreeManagerDEM()->getTree()->getRoot(rootIndex);
-
-    if (root_node == nullptr) {
-      return false;
-    }
+  glm::dmat4 transform = glm::inverse(planet->getWorldTransform());
 
-    double min_dist{};
-    double max_dist{};
-    bool intersects = intersectTileBounds(root_node, planet, origin, direction, min_dist, max_dist);
-    if (intersects) {
-      intersected_tiles.insert(std::pair<double, TileNode*>(min_dist, root_node));
-    }
-  }
-
-  TileNode* parent = nullptr;
-  TileNode* child  = nullptr;
-
-  // Process intersected tile patch priority queue:
-  while (!intersected_tiles.empty()) {
-    parent = intersected_tiles.begin()->second;
-    intersected_tiles.erase(intersected_tiles.begin());
+  return intersectPlanet(planet->getTileRenderer().getTreeManagerDEM(), planet->getRadii(),
+      planet->getHeightScale(), glm::dvec3(transform * glm::dvec4(rayOrigin, 1.0)),
+      glm::dvec3(transform * glm::dvec4(rayDir, 0.0)), pos);
+}
 
-    if (parent == nullptr) {
-      return false;
-    }
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    // Sample height field of cut leaf node
-    if (!isRefined(*parent)) {
-      // Get entry and exit point again:
-      double min_dist{};
-      double max_dist{};
-      intersectTileBounds(parent, planet, origin, direction, min_dist, max_dist);
-
-      // Prevent entry being behind the camera:
-      min_dist             = std::max(0.0, min_dist);
-      glm::dvec4 entry     = origin + direction * min_dist;
-      glm::dvec4 exit      = origin + direction * max_dist;
-      auto       sampleDir = (exit - entry).xyz();
-      glm::dvec3 lastSampleCartesian{};
-      glm::dvec3 sampleCartesian{};
-      glm::dvec3 lastSampleLngLatHeight{};
-      glm::dvec3 sampleLngLatHeight{};
-      double     height(0.0);
-      double     lastHeight(0.0);
-      bool       first_sample(true);
-
-      // Estimate number of sampling steps
-      //        -------------------- BboxMax
-      //        |        /\        |
-      //        |   255 /  \       |
-      //        |     /      \     |
-      //        |   /          \   |
-      //        | /     Tile     \ |
-      //        | \               /|
-      //        |   \            / |
-      //        |     \        /   |
-      //        |  255 \      /    |
-      //        |        \   /     |
-      //        |         \/       |
-      // BboxMin--------------------
-      TileBase* tile   = parent->getTile();
-      auto      tileId = tile->getTileId();
-      auto*     rdDEM  = planet->getTileRenderer().getTreeManagerDEM()->find<RenderDataDEM>(tileId);
-      auto      tile_bounds = rdDEM->getBounds();
-
-      auto max_tile_samplings = sqrt((255.0 * 255.0) + (255.0 * 255.0));
-      auto max_bbox_samplings = sqrt(
-          (max_tile_samplings * max_tile_samplings) + (max_tile_samplings * max_tile_samplings));
-
-      auto step_factor =
-          glm::length(sampleDir) / glm::length(tile_bounds.getMax() - tile_bounds.getMin());
-      auto step_nr = step_factor * max_bbox_samplings;
-
-      // Sample between entry and exit:
-      for (int step(0); step <= static_cast<int>(step_nr); ++step) {
-        lastSampleCartesian    = sampleCartesian;
-        lastSampleLngLatHeight = sampleLngLatHeight;
-        lastHeight             = height;
-
-        // Sample along ray and then convert to polar:
-        sampleCartesian = glm::dvec3(entry[0], entry[1], entry[2]) +
-                          glm::dvec3((step / step_nr) * sampleDir[0],
-                              (step / step_nr) * sampleDir[1], (step / step_nr) * sampleDir[2]);
-
-        sampleLngLatHeight =
-            cs::utils::convert::cartesianToLngLatHeight(sampleCartesian, planet->getRadii());
-
-        // Calc correct HPix coordinate for child patch in relation to base batch
-        int        base   = HEALPix::getBasePatch(parent->getTileId());
-        auto       scale  = HEALPix::getPatchOffsetScale(parent->getTileId());
-        glm::dvec2 HPixPt = HEALPix::convertBaseLngLat2XY(base, sampleLngLatHeight.xy());
-        HPixPt            = (HPixPt - glm::dvec2(scale[0], scale[1])) / scale[2];
-
-        /* Figure out flip */
-        std::swap(HPixPt.x, HPixPt.y);
-
-        // Calc coords in texture space
-        double u = HPixPt.x * (sizeX - 1);
-        double v = HPixPt.y * (sizeY - 1);
-
-        int uB = static_cast<int>(u);
-        int vB = static_cast<int>(v);
-
-        double uP = u - uB;
-        double vP = v - vB;
-
-        double hP1{};
-        double hP2{};
-        double hPP{};
-        if (uB >= sizeX - 1 || uB < 0) {
-          continue;
-        }
-        if (vB >= sizeY - 1 || vB < 0) {
-          continue;
-        }
+bool intersectPlanet(TreeManagerBase* treeMgrDEM, glm::dvec3 const& radii, double heightScale,
+    glm::dvec3 const& rayOrigin, glm::dvec3 const& rayDir, glm::dvec3& pos) {
+  std::vector<RayCandidate> candidates;
+  return intersectTree(
+      treeMgrDEM, radii, heightScale, rayOrigin, glm::normalize(rayDir), candidates, pos);
+}
 
-        // Access height data
-        if (parent->getTileDataType() == TileDataType::eFloat32) {
-          const auto* ptr = parent->getTile()->getTypedPtr<float>();
-          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-          height = ptr[vB + sizeY * uB];
-          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-          hP1 = ptr[vB + sizeY * (uB + 1)];
-          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-          hP2 = ptr[vB + 1 + sizeY * uB];
-          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-          hPP = ptr[vB + 1 + sizeY * (uB + 1)];
-        } else {
-          const auto* ptr = parent->getTile()->getTypedPtr<unsigned char>();
-          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-          height = ptr[vB + sizeY * uB];
-          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-          hP1 = ptr[vB + sizeY * (uB + 1)];
-          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-          hP2 = ptr[vB + 1 + sizeY * uB];
-          // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-          hPP = ptr[vB + 1 + sizeY * (uB + 1)];
-        }
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-        double interpol1 = (1.0 - uP) * height + uP * hP1;
-        double interpol2 = (1.0 - uP) * hP2 + uP * hPP;
-        height           = (1.0 - vP) * interpol1 + vP * interpol2;
-        height *= planet->getHeightScale();
+void intersectPlanet(VistaPlanet const* planet, std::vector<glm::dvec3> const& rayOrigins,
+    std::vector<glm::dvec3> const& rayDirs, std::vector<glm::dvec3>& positions,
+    std::vector<bool>& hits) {
+  glm::dmat4 transform = glm::inverse(planet->getWorldTransform());
 
-        // Detect hit as soon as a sample point below the surface is found
-        if (sampleLngLatHeight.z < height) {
-          // Ignore sampling, which already starts below a patch due to exaggeration
-          if (first_sample) {
-            break;
-          }
+  std::vector<glm::dvec3> origins(rayOrigins.size());
+  std::vector<glm::dvec3> directions(rayDirs.size());
 
-          double lastWeight = lastSampleLngLatHeight.z - lastHeight;
-          double curWeight  = height - sampleLngLatHeight.z;
+  for (size_t i = 0; i < rayOrigins.size(); ++i) {
+    origins[i]    = glm::dvec3(transform * glm::dvec4(rayOrigins[i], 1.0));
+    directions[i] = glm::dvec3(transform * glm::dvec4(rayDirs[i], 0.0));
+  }
 
-          double sum = lastWeight + curWeight;
+  intersectPlanet(planet->getTileRenderer().getTreeManagerDEM(), planet->getRadii(),
+      planet->getHeightScale(), origins, directions, positions, hits);
+}
 
-          lastWeight /= sum;
-          curWeight /= sum;
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-          pos = lastSampleCartesian * (1.0 - lastWeight) + sampleCartesian * (1.0 - curWeight);
+void intersectPlanet(TreeManagerBase* treeMgrDEM, glm::dvec3 const& radii, double heightScale,
+    std::vector<glm::dvec3> const& rayOrigins, std::vector<glm::dvec3> const& rayDirs,
+    std::vector<glm::dvec3>& positions, std::vector<bool>& hits) {
+  positions.assign(rayOrigins.size(), glm::dvec3(0.0));
+  hits.assign(rayOrigins.size(), false);
 
-          // FOUND VALID INTERSECTION!!!
-          return true;
-        }
-        first_sample = false;
-      }
-    }
-    // Parent is not a leaf in cut -> push intersected children into queue:
-    else {
-      // Check all children for intersection
-      for (int childIndex = 0; childIndex < 4; ++childIndex) {
-        /* Get the new Child */
-        child = parent->getChild(childIndex);
-        if (child == nullptr) {
-          continue;
-        }
+  // The candidate queue is shared by all rays, so that it is allocated only once.
+  std::vector<RayCandidate> candidates;
 
-        double min_dist{};
-        double max_dist{};
-        bool intersects = intersectTileBounds(child, planet, origin, direction, min_dist, max_dist);
-        if (intersects && max_dist > 0.0) {
-          intersected_tiles.insert(std::pair<double, TileNode*>(min_dist, child));
-        }
-      }
-    }
+  for (size_t i = 0; i < rayOrigins.size(); ++i) {
+    hits[i] = intersectTree(treeMgrDEM, radii, heightScale, rayOrigins[i],
+        glm::normalize(rayDirs[i]), candidates, positions[i]);
   }
-  return false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
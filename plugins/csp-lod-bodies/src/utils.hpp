@@ -7,10 +7,13 @@
 #ifndef CSP_LOD_BODIES_UTIL_HPP
 #define CSP_LOD_BODIES_UTIL_HPP
 
+#include "TileId.hpp"
+
 #define _USE_MATH_DEFINES // Use Math.h defines like M_PI
 #include <cmath>          // C++ Math
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
+#include <vector>
 
 class VistaTransformNode;
 class VistaOpenGLNode;
@@ -19,12 +22,15 @@ namespace csp::lodbodies {
 
 class VistaPlanet;
 class TileNode;
+class TileQuadTree;
+class TreeManagerBase;
 
 /// Defines the Sample Precision
 enum class HeightSamplePrecision {
   eCoarse = 1, ///< Use the Base Patches (LOD 0) only.
   eActual = 2, ///< Use the already loaded Patches.
-  eFine   = 3  ///< Use the highest LOD available in database.
+  eFine   = 3  ///< Use the already loaded Patches and request the missing finer ones. Use an
+               ///< AsyncHeightSampler to wait for the highest LOD available in database.
 };
 
 namespace utils {
@@ -37,15 +43,76 @@ namespace utils {
 double getHeight(
     VistaPlanet const* planet, HeightSamplePrecision precision, glm::dvec2 const& lngLat);
 
+/// Same as above, but directly uses the given tree of elevation tiles.
+double getHeight(
+    TreeManagerBase* treeMgrDEM, HeightSamplePrecision precision, glm::dvec2 const& lngLat);
+
+/// Retrieve the Planets Height at many lat / long positions at once. The results are the same as
+/// calling getHeight() for each position, but the positions are sorted by the tiles they fall
+/// into while descending the tile quadtree. Hence each tile is visited only once, which is much
+/// faster for large numbers of positions.
+/// @param planet    VistaPlanet to get the Heights from
+/// @param precision Defines the Height Sample Precision
+/// @param lngLats   The positions, see getHeight()
+/// @param heights   Receives one height for each position
+void getHeights(VistaPlanet const* planet, HeightSamplePrecision precision,
+    std::vector<glm::dvec2> const& lngLats, std::vector<double>& heights);
+
+/// Same as above, but directly uses the given tree of elevation tiles.
+void getHeights(TreeManagerBase* treeMgrDEM, HeightSamplePrecision precision,
+    std::vector<glm::dvec2> const& lngLats, std::vector<double>& heights);
+
+/// Same as above, but samples the given tree without requesting any tiles. With
+/// HeightSamplePrecision::eFine, the tiles which are required for a more precise result but are
+/// not in the tree are appended to missingTiles.
+void getHeights(TileQuadTree const* tree, HeightSamplePrecision precision,
+    std::vector<glm::dvec2> const& lngLats, std::vector<double>& heights,
+    std::vector<TileId>& missingTiles);
+
+/// The batched getHeights() functions interpolate two heights at once with SSE2 on x86-64. For
+/// float tiles, four heights are interpolated at once with AVX2 if the CPU supports it (see
+/// isCullingAVX2Supported()). The results are identical to those of getHeight(). As for the
+/// culling, AVX2 can be disabled for comparisons, this must not be done while other threads
+/// sample heights.
+void setUseInterpolationAVX2(bool enable);
+bool getUseInterpolationAVX2();
+
+/// Returns the name of the instruction set currently used by the batched getHeights() functions,
+/// this is either "AVX2", "SSE2" or "scalar".
+char const* getInterpolationInstructionSet();
+
 /// Intersects a ray with the height field of a VistaPlanet. The Ray is defined by a position
 /// and orientation.
 /// @param planet VistaPlanet to be intersected
 /// @param rayPos Ray position in world space
 /// @param rayDir Ray direction in world space
 /// @param pos    Gives (first) intersection in cartesian
+///
+/// The terrain is traversed hierarchically: Tiles are visited in the order in which the ray enters
+/// their bounds and within a tile, the MinMaxPyramid is used to skip regions which are lower than
+/// the ray. Once a sample below the terrain is found, the intersection is refined by bisection.
 bool intersectPlanet(
     VistaPlanet const* planet, glm::dvec3 rayOrigin, glm::dvec3 rayDir, glm::dvec3& pos);
 
+/// Same as above, but directly uses the given tree of elevation tiles. The ray and the resulting
+/// position are in the planet's coordinate system.
+bool intersectPlanet(TreeManagerBase* treeMgrDEM, glm::dvec3 const& radii, double heightScale,
+    glm::dvec3 const& rayOrigin, glm::dvec3 const& rayDir, glm::dvec3& pos);
+
+/// Intersects many rays with the height field of a VistaPlanet. This is considerably faster than
+/// calling the method above for each ray, as the planet's transformation is inverted only once and
+/// no memory is allocated per ray. For each ray, hits tells whether the terrain is intersected and
+/// positions contains the intersection in cartesian planet coordinates.
+void intersectPlanet(VistaPlanet const* planet, std::vector<glm::dvec3> const& rayOrigins,
+    std::vector<glm::dvec3> const& rayDirs, std::vector<glm::dvec3>& positions,
+    std::vector<bool>& hits);
+
+/// Same as above, but directly uses the given tree of elevation tiles. The rays are given in the
+/// planet's coordinate system.
+void intersectPlanet(TreeManagerBase* treeMgrDEM, glm::dvec3 const& radii, double heightScale,
+    std::vector<glm::dvec3> const& rayOrigins, std::vector<glm::dvec3> const& rayDirs,
+    std::vector<glm::dvec3>& positions, std::vector<bool>& hits);
+
 /// Retrieve entry and exit distance along a ray on the bbox of a tile node. The ray parameters must
 /// be transformed into the planet coordinate system before!
 bool intersectTileBounds(TileNode const* tileNode, VistaPlanet const* planet,
@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/AsyncHeightSampler.hpp"
+
+#include "../src/HEALPix.hpp"
+#include "../src/Tile.hpp"
+#include "../src/TileNode.hpp"
+#include "../src/TileSource.hpp"
+#include "TestPositions.hpp"
+
+#include "../../../src/cs-utils/ThreadPool.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Counts the tiles which exist at the same time.
+struct TileCounter {
+  std::atomic<int> mCount{0};
+  std::atomic<int> mMaxCount{0};
+};
+
+class CountedTile : public Tile<float> {
+ public:
+  CountedTile(int level, glm::int64 patchIdx, std::shared_ptr<TileCounter> counter)
+      : Tile<float>(level, patchIdx)
+      , mCounter(std::move(counter)) {
+    int count   = ++mCounter->mCount;
+    int maximum = mCounter->mMaxCount;
+    while (count > maximum && !mCounter->mMaxCount.compare_exchange_weak(maximum, count)) {
+    }
+  }
+
+  CountedTile(CountedTile const& other) = delete;
+  CountedTile(CountedTile&& other)      = delete;
+
+  CountedTile& operator=(CountedTile const& other) = delete;
+  CountedTile& operator=(CountedTile&& other) = delete;
+
+  ~CountedTile() override {
+    --mCounter->mCount;
+  }
+
+ private:
+  std::shared_ptr<TileCounter> mCounter;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// All samples of a tile are set to its level, hence the sampled heights tell which level has been
+// used. The tiles are created on a thread pool, one tile can be configured to fail.
+class LevelTileSource : public TileSource {
+ public:
+  explicit LevelTileSource(int maxLevel, TileId failingTile = TileId())
+      : mMaxLevel(maxLevel)
+      , mFailingTile(failingTile)
+      , mThreadPool(4) {
+  }
+
+  void init() override {
+  }
+
+  void fini() override {
+  }
+
+  TileDataType getDataType() const override {
+    return TileDataType::eFloat32;
+  }
+
+  TileNode* loadTile(int level, glm::int64 patchIdx) override {
+    ++mLoadedTiles;
+
+    if (TileId(level, patchIdx) == mFailingTile) {
+      return nullptr;
+    }
+
+    auto* tile = new CountedTile(level, patchIdx, mTileCounter);
+    std::fill(tile->data().begin(), tile->data().end(), static_cast<float>(level));
+
+    return new TileNode(tile, std::min(level + 1, mMaxLevel));
+  }
+
+  void loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb,
+      std::shared_ptr<cs::utils::CancellationToken> token) override {
+    mThreadPool.enqueue([this, level, patchIdx, cb = std::move(cb), token = std::move(token)]() {
+      cb(this, level, patchIdx, token->isCancelled() ? nullptr : loadTile(level, patchIdx));
+    });
+  }
+
+  int getPendingRequests() override {
+    return static_cast<int>(mThreadPool.getPendingTaskCount() + mThreadPool.getRunningTaskCount());
+  }
+
+  uint32_t getMaxConcurrentRequests() const override {
+    return 4;
+  }
+
+  bool isSame(TileSource const* other) const override {
+    return other == this;
+  }
+
+  std::atomic<int> mLoadedTiles{0};
+
+  // The tiles may outlive the source.
+  std::shared_ptr<TileCounter> mTileCounter = std::make_shared<TileCounter>();
+
+ private:
+  int                   mMaxLevel;
+  TileId                mFailingTile;
+  cs::utils::ThreadPool mThreadPool;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::AsyncHeightSampler reaches the finest level") {
+  auto source  = std::make_shared<LevelTileSource>(3);
+  auto lngLats = createLngLats(1000);
+
+  AsyncHeightSampler sampler(10000);
+  sampler.setSource(source);
+
+  auto heights = sampler.getHeights(lngLats).get();
+
+  REQUIRE_EQ(heights.size(), lngLats.size());
+  CHECK_UNARY(std::all_of(heights.begin(), heights.end(), [](double h) { return h == 3.0; }));
+
+  // The tiles of the first query are reused.
+  int loadedTiles = source->mLoadedTiles.load();
+  CHECK_EQ(sampler.getHeights(lngLats).get(), heights);
+  CHECK_EQ(source->mLoadedTiles.load(), loadedTiles);
+}
+
+TEST_CASE("csp::lodbodies::AsyncHeightSampler falls back to coarser tiles") {
+  TileId const failingTile = HEALPix::getChildTileId(TileId(0, 4), 2);
+
+  auto source  = std::make_shared<LevelTileSource>(3, failingTile);
+  auto lngLats = createLngLats(1000);
+
+  AsyncHeightSampler sampler;
+  sampler.setSource(source);
+
+  auto heights = sampler.getHeights(lngLats).get();
+
+  // All positions within the failing tile are sampled from its parent.
+  auto coarse = std::count(heights.begin(), heights.end(), 0.0);
+  auto fine   = std::count(heights.begin(), heights.end(), 3.0);
+
+  CHECK_GT(coarse, 0);
+  CHECK_EQ(coarse + fine, static_cast<std::ptrdiff_t>(heights.size()));
+}
+
+TEST_CASE("csp::lodbodies::AsyncHeightSampler limits the number of tiles during a query") {
+  // Many positions along a path, like those of the PathTool.
+  std::vector<glm::dvec2> lngLats;
+  for (int i = 0; i < 4000; ++i) {
+    lngLats.emplace_back(0.3 + 0.0002 * i, -1.2 + 0.0006 * i);
+  }
+
+  auto source = std::make_shared<LevelTileSource>(6);
+
+  AsyncHeightSampler sampler(32);
+  sampler.setSource(source);
+
+  auto heights = sampler.getHeights(lngLats).get();
+
+  REQUIRE_EQ(heights.size(), lngLats.size());
+  CHECK_UNARY(std::all_of(heights.begin(), heights.end(), [](double h) { return h == 6.0; }));
+
+  // The tiles of the whole path are never stored at the same time.
+  CHECK_LT(2 * source->mTileCounter->mMaxCount.load(), source->mLoadedTiles.load());
+}
+
+TEST_CASE("csp::lodbodies::AsyncHeightSampler cancelled queries") {
+  auto source  = std::make_shared<LevelTileSource>(3);
+  auto lngLats = createLngLats(100);
+
+  AsyncHeightSampler sampler;
+  sampler.setSource(source);
+
+  // A query which is cancelled before it is processed does not load anything.
+  auto token = std::make_shared<cs::utils::CancellationToken>();
+  token->cancel();
+
+  CHECK_EQ(sampler.getHeights(lngLats, token).get(), std::vector<double>(lngLats.size(), 0.0));
+  CHECK_EQ(source->mLoadedTiles.load(), 0);
+
+  // Other queries are not affected.
+  auto heights = sampler.getHeights(lngLats).get();
+  CHECK_UNARY(std::all_of(heights.begin(), heights.end(), [](double h) { return h == 3.0; }));
+}
+
+TEST_CASE("csp::lodbodies::AsyncHeightSampler without a source") {
+  AsyncHeightSampler sampler;
+  CHECK_EQ(sampler.getHeights({glm::dvec2(0.1, 0.2)}).get(), std::vector<double>{0.0});
+
+  // Tiles of a previous source must not be used.
+  sampler.setSource(std::make_shared<LevelTileSource>(2));
+  CHECK_EQ(sampler.getHeights({glm::dvec2(0.1, 0.2)}).get(), std::vector<double>{2.0});
+
+  sampler.setSource(std::make_shared<LevelTileSource>(1));
+  CHECK_EQ(sampler.getHeights({glm::dvec2(0.1, 0.2)}).get(), std::vector<double>{1.0});
+
+  sampler.setSource(nullptr);
+  CHECK_EQ(sampler.getHeights({glm::dvec2(0.1, 0.2)}).get(), std::vector<double>{0.0});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
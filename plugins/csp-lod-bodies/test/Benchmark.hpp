@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TEST_BENCHMARK_HPP
+#define CSP_LOD_BODIES_TEST_BENCHMARK_HPP
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <ratio>
+#include <type_traits>
+
+namespace csp::lodbodies {
+
+/// Returns the wall-clock time it takes to call f. The unit is given by Period, e.g. std::milli
+/// for milliseconds.
+template <typename Period = std::milli, typename F>
+double measureTime(F const& f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, Period>(end - start).count();
+}
+
+/// Returns the symbol of the time unit given by Period, see measureTime().
+template <typename Period>
+constexpr char const* getTimeUnit() {
+  if constexpr (std::is_same_v<Period, std::nano>) {
+    return "ns";
+  } else if constexpr (std::is_same_v<Period, std::micro>) {
+    return "us";
+  } else if constexpr (std::is_same_v<Period, std::milli>) {
+    return "ms";
+  } else {
+    static_assert(std::is_same_v<Period, std::ratio<1>>, "Unsupported time unit!");
+    return "s";
+  }
+}
+
+/// Calls f, which processes count items, and reports the average time per item, e.g.
+/// "SlabPool: 12.3 ns per allocation". Returns the reported time.
+template <typename Period = std::milli, typename F>
+double benchmark(char const* name, std::size_t count, char const* item, F const& f) {
+  double time = measureTime<Period>(f) / static_cast<double>(count);
+  MESSAGE(name << ": " << time << " " << getTimeUnit<Period>() << " per " << item);
+  return time;
+}
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TEST_BENCHMARK_HPP
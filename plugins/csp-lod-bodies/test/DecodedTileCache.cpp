@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/DecodedTileCache.hpp"
+#include "../src/TilePackCache.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::DecodedTileCache") {
+  auto file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+  {
+    auto             pack = std::make_shared<TilePackCache>((file / "decoded.pack").string());
+    DecodedTileCache cache(pack, "layer.Float32");
+
+    // A large patch index, this does not fit into 32 bit.
+    glm::int64 const patchIdx = 12LL * (1LL << 40) - 5;
+
+    Tile<float> tile(20, patchIdx);
+    for (size_t i = 0; i < tile.data().size(); ++i) {
+      tile.data()[i] = static_cast<float>(i % 1000) - 500.F;
+    }
+    tile.setMinMaxPyramid(std::make_unique<MinMaxPyramid>(&tile));
+
+    Tile<float> restored(20, patchIdx);
+    CHECK_FALSE(cache.read(restored));
+
+    cache.write(tile);
+    CHECK_UNARY(cache.read(restored));
+
+    CHECK_UNARY(restored.data() == tile.data());
+    REQUIRE_UNARY(restored.getMinMaxPyramid() != nullptr);
+    CHECK_EQ(restored.getMinMaxPyramid()->getMin(), tile.getMinMaxPyramid()->getMin());
+    CHECK_EQ(restored.getMinMaxPyramid()->getMax(), tile.getMinMaxPyramid()->getMax());
+    CHECK_EQ(restored.getMinMaxPyramid()->getAverage(), tile.getMinMaxPyramid()->getAverage());
+    CHECK_UNARY(restored.getMinMaxPyramid()->getValues() == tile.getMinMaxPyramid()->getValues());
+
+    // Tiles with the same key but a different data type are not returned.
+    Tile<glm::uint8> wrongType(20, patchIdx);
+    CHECK_FALSE(cache.read(wrongType));
+
+    // Tiles of other layers are not returned.
+    DecodedTileCache other(pack, "other.Float32");
+    CHECK_FALSE(other.read(restored));
+
+    Tile<glm::u8vec3> color(3, 42);
+    color.data()[100] = glm::u8vec3(1, 2, 3);
+    cache.write(color);
+
+    Tile<glm::u8vec3> restoredColor(3, 42);
+    CHECK_UNARY(cache.read(restoredColor));
+    CHECK_UNARY(restoredColor.data()[100] == glm::u8vec3(1, 2, 3));
+    CHECK_UNARY(restoredColor.getMinMaxPyramid() == nullptr);
+
+    // If the stored pyramid is corrupt, the tile must not be modified at all. Minimum and maximum
+    // are swapped in the raw record, for small patch indices the key is (patchIdx, 0).
+    Tile<float> small(5, 7);
+    small.data()[0] = 1.F;
+    small.setMinMaxPyramid(std::make_unique<MinMaxPyramid>(&small));
+    cache.write(small);
+
+    auto record = pack->read("layer.Float32", 5, 7, 0);
+    REQUIRE_UNARY(record.has_value());
+
+    std::size_t const pyramid = record->size() - MinMaxPyramid::getSerializedSize();
+    std::swap_ranges(record->begin() + pyramid, record->begin() + pyramid + sizeof(float),
+        record->begin() + pyramid + sizeof(float));
+    pack->write("layer.Float32", 5, 7, 0, *record);
+
+    Tile<float> corrupt(5, 7);
+    CHECK_FALSE(cache.read(corrupt));
+    CHECK_EQ(corrupt.data()[0], 0.F);
+    CHECK_UNARY(corrupt.getMinMaxPyramid() == nullptr);
+  }
+
+  boost::filesystem::remove_all(file);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
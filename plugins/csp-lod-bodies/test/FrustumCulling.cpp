@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/FrustumCulling.hpp"
+#include "Benchmark.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <array>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::array<glm::dvec3, 8> getCorners(BoundingBox<double> const& tb) {
+  glm::dvec3 const& tbMin = tb.getMin();
+  glm::dvec3 const& tbMax = tb.getMax();
+
+  return {{glm::dvec3(tbMin[0], tbMin[1], tbMin[2]), glm::dvec3(tbMax[0], tbMin[1], tbMin[2]),
+      glm::dvec3(tbMax[0], tbMin[1], tbMax[2]), glm::dvec3(tbMin[0], tbMin[1], tbMax[2]),
+      glm::dvec3(tbMin[0], tbMax[1], tbMin[2]), glm::dvec3(tbMax[0], tbMax[1], tbMin[2]),
+      glm::dvec3(tbMax[0], tbMax[1], tbMax[2]), glm::dvec3(tbMin[0], tbMax[1], tbMax[2])}};
+}
+
+// The frustum test which was used by the LODVisitor before: All eight corners are tested against
+// all planes.
+bool testInFrustumReference(Frustum const& frustum, BoundingBox<double> const& tb) {
+  auto corners = getCorners(tb);
+
+  for (auto const& plane : frustum.getPlanes()) {
+    glm::dvec3 const normal(plane);
+    bool             outside = true;
+
+    for (auto const& corner : corners) {
+      if (glm::dot(normal, corner) >= -plane[3]) {
+        outside = false;
+        break;
+      }
+    }
+
+    if (outside) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// The angle estimate which was used by the LODVisitor before: The largest angle between the
+// directions to the center and to any corner of the box.
+double getMaxAngleReference(glm::dvec3 const& eye, BoundingBox<double> const& tb) {
+  glm::dvec3 centerDir = glm::normalize(0.5 * (tb.getMin() + tb.getMax()) - eye);
+  double     maxAngle  = 0.0;
+
+  for (auto const& corner : getCorners(tb)) {
+    maxAngle = std::max(
+        std::acos(std::min(1.0, glm::dot(glm::normalize(corner - eye), centerDir))), maxAngle);
+  }
+
+  return maxAngle;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Random boxes of very different sizes around the origin.
+std::vector<BoundingBox<double>> createBoxes(std::size_t count) {
+  std::mt19937                           engine(42);
+  std::uniform_real_distribution<double> position(-2.0, 2.0);
+  std::uniform_real_distribution<double> exponent(-4.0, 0.0);
+
+  std::vector<BoundingBox<double>> boxes;
+  boxes.reserve(count);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    glm::dvec3 center(position(engine), position(engine), position(engine));
+    glm::dvec3 extent(std::pow(10.0, exponent(engine)), std::pow(10.0, exponent(engine)),
+        std::pow(10.0, exponent(engine)));
+    boxes.emplace_back(center - extent, center + extent);
+  }
+
+  return boxes;
+}
+
+Frustum createFrustum(glm::dvec3 const& eye) {
+  glm::dmat4 matP  = glm::perspective(glm::radians(60.0), 16.0 / 9.0, 0.01, 3.0);
+  glm::dmat4 matVM = glm::lookAt(eye, glm::dvec3(0.0), glm::dvec3(0.0, 1.0, 0.0));
+
+  return Frustum::fromMatrix(matP * matVM);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::getFrustumDistance matches testing all corners") {
+  glm::dvec3 const eye(0.3, 0.4, 2.0);
+  Frustum const    frustum = createFrustum(eye);
+  auto const       boxes   = createBoxes(10001);
+
+  std::size_t visible = 0;
+
+  for (std::size_t i = 0; i < boxes.size(); ++i) {
+    bool expected = testInFrustumReference(frustum, boxes[i]);
+    visible += expected ? 1 : 0;
+
+    CHECK_EQ(getFrustumDistance(frustum, boxes[i]) >= 0.0, expected);
+  }
+
+  // make sure both cases are covered
+  CHECK_GT(visible, 0U);
+  CHECK_LT(visible, boxes.size());
+
+  // All available implementations of the batched version have to match the scalar one.
+  bool const useAVX2 = getUseCullingAVX2();
+  CHECK_EQ(useAVX2, isCullingAVX2Supported());
+
+  std::vector<bool> implementations = {false};
+  if (isCullingAVX2Supported()) {
+    implementations.push_back(true);
+  }
+
+  for (bool avx2 : implementations) {
+    setUseCullingAVX2(avx2);
+
+    std::vector<double> distances(boxes.size());
+    getFrustumDistances(frustum, boxes.data(), boxes.size(), distances.data());
+
+    bool equal = true;
+    for (std::size_t i = 0; i < boxes.size(); ++i) {
+      equal = equal && distances[i] == getFrustumDistance(frustum, boxes[i]);
+    }
+
+    CHECK_MESSAGE(equal, getCullingInstructionSet());
+  }
+
+  setUseCullingAVX2(useAVX2);
+}
+
+TEST_CASE("csp::lodbodies::getMinCornerCosine matches the angle estimate") {
+  glm::dvec3 const eye(0.3, 0.4, 2.0);
+  auto const       boxes = createBoxes(10001);
+
+  for (double threshold : {0.001, 0.01, 0.1, 0.5}) {
+    std::size_t refined = 0;
+
+    for (std::size_t i = 0; i < boxes.size(); ++i) {
+      bool expected = getMaxAngleReference(eye, boxes[i]) > threshold;
+      refined += expected ? 1 : 0;
+
+      CHECK_EQ(getMinCornerCosine(eye, boxes[i]) < std::cos(threshold), expected);
+    }
+
+    CHECK_GT(refined, 0U);
+    CHECK_LT(refined, boxes.size());
+  }
+
+  // All available implementations of the batched version have to match the scalar one.
+  bool const useAVX2 = getUseCullingAVX2();
+
+  std::vector<bool> implementations = {false};
+  if (isCullingAVX2Supported()) {
+    implementations.push_back(true);
+  }
+
+  for (bool avx2 : implementations) {
+    setUseCullingAVX2(avx2);
+
+    std::vector<double> cosines(boxes.size());
+    getMinCornerCosines(eye, boxes.data(), boxes.size(), cosines.data());
+
+    bool equal = true;
+    for (std::size_t i = 0; i < boxes.size(); ++i) {
+      equal = equal && cosines[i] == getMinCornerCosine(eye, boxes[i]);
+    }
+
+    CHECK_MESSAGE(equal, getCullingInstructionSet());
+  }
+
+  setUseCullingAVX2(useAVX2);
+}
+
+TEST_CASE("csp::lodbodies::FrustumCulling [benchmark]") {
+  int const        iterations = 50;
+  glm::dvec3 const eye(0.3, 0.4, 2.0);
+  Frustum const    frustum   = createFrustum(eye);
+  auto const       boxes     = createBoxes(10000);
+  double const     threshold = std::cos(0.1);
+
+  std::vector<double> distances(boxes.size());
+  std::vector<double> cosines(boxes.size());
+  std::size_t         count = 0;
+
+  auto run = [&](char const* name, auto const& f) {
+    benchmark<std::nano>(name, iterations * boxes.size(), "tile", [&]() {
+      for (int i = 0; i < iterations; ++i) {
+        f();
+      }
+    });
+  };
+
+  run("all corners and std::acos", [&]() {
+    for (auto const& box : boxes) {
+      count += testInFrustumReference(frustum, box) && getMaxAngleReference(eye, box) > 0.1;
+    }
+  });
+
+  run("scalar", [&]() {
+    for (auto const& box : boxes) {
+      count += getFrustumDistance(frustum, box) >= 0.0 && getMinCornerCosine(eye, box) < threshold;
+    }
+  });
+
+  bool const useAVX2 = getUseCullingAVX2();
+
+  std::vector<bool> implementations = {false};
+  if (isCullingAVX2Supported()) {
+    implementations.push_back(true);
+  }
+
+  for (bool avx2 : implementations) {
+    setUseCullingAVX2(avx2);
+
+    run(getCullingInstructionSet(), [&]() {
+      getFrustumDistances(frustum, boxes.data(), boxes.size(), distances.data());
+      getMinCornerCosines(eye, boxes.data(), boxes.size(), cosines.data());
+
+      for (std::size_t i = 0; i < boxes.size(); ++i) {
+        count += distances[i] >= 0.0 && cosines[i] < threshold;
+      }
+    });
+  }
+
+  setUseCullingAVX2(useAVX2);
+
+  // prevent the compiler from optimizing everything away
+  CHECK_GT(count, 0U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
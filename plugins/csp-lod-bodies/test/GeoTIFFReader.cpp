@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/GeoTIFFReader.hpp"
+
+#include "TestGeoTIFF.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::GeoTIFFReader") {
+  TemporaryGeoTIFF file;
+  GeoTIFFReader    reader(file.getFile(), TileDataType::eFloat32);
+
+  CHECK(reader.getImageCount() == 2);
+  CHECK(reader.getMin().x == doctest::Approx(0.0));
+  CHECK(reader.getMin().y == doctest::Approx(0.0));
+  CHECK(reader.getMax().x == doctest::Approx(1.0));
+  CHECK(reader.getMax().y == doctest::Approx(1.0));
+
+  std::vector<float> pixels(257 * 257);
+
+  SUBCASE("Fine grids use the full resolution image") {
+    reader.read(glm::dvec2(0.0), glm::dvec2(1.0), pixels.data());
+
+    CHECK(pixels.front() == doctest::Approx(5.F));
+    CHECK(pixels[128 * 257 + 128] == doctest::Approx(5.F));
+    CHECK(pixels.back() == doctest::Approx(5.F));
+  }
+
+  SUBCASE("Coarse grids use the overview") {
+    // The raster covers only the lower left eighth of this area.
+    reader.read(glm::dvec2(0.0), glm::dvec2(8.0), pixels.data());
+
+    CHECK(pixels[255 * 257 + 1] == doctest::Approx(7.F));
+    CHECK(pixels[250 * 257 + 20] == doctest::Approx(7.F));
+
+    // Samples outside of the raster are zero.
+    CHECK(pixels.front() == 0.F);
+    CHECK(pixels.back() == 0.F);
+  }
+
+  SUBCASE("Concurrent reads") {
+    std::atomic<int>         failures{0};
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < 8; ++i) {
+      threads.emplace_back([&reader, &failures]() {
+        std::vector<float> data(257 * 257);
+
+        for (int j = 0; j < 10; ++j) {
+          reader.read(glm::dvec2(0.25), glm::dvec2(0.75), data.data());
+
+          if (data[128 * 257 + 128] != 5.F) {
+            ++failures;
+          }
+        }
+      });
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    CHECK(failures == 0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::GeoTIFFReader Unsupported files") {
+  CHECK_THROWS_AS(
+      GeoTIFFReader("csp-lod-bodies-missing.tif", TileDataType::eFloat32), std::runtime_error);
+
+  // Image data requires three samples per pixel.
+  TemporaryGeoTIFF file;
+  CHECK_THROWS_AS(GeoTIFFReader(file.getFile(), TileDataType::eU8Vec3), std::runtime_error);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::GeoTIFFReader Files without overviews") {
+  TemporaryGeoTIFF file(false);
+  GeoTIFFReader    reader(file.getFile(), TileDataType::eFloat32);
+
+  CHECK(reader.getImageCount() == 1);
+
+  // Coarse grids have to use the full resolution image, of which only the used pixels are read.
+  std::vector<float> pixels(257 * 257);
+  reader.read(glm::dvec2(0.0), glm::dvec2(8.0), pixels.data());
+
+  CHECK(pixels[255 * 257 + 1] == doctest::Approx(5.F));
+  CHECK(pixels[250 * 257 + 20] == doctest::Approx(5.F));
+  CHECK(pixels.front() == 0.F);
+  CHECK(pixels.back() == 0.F);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::GeoTIFFReader NoData") {
+  // The right half of the raster contains NoData values.
+  TemporaryGeoTIFF file(false, "-9999");
+  GeoTIFFReader    reader(file.getFile(), TileDataType::eFloat32);
+
+  REQUIRE(reader.getNoData().has_value());
+  CHECK(*reader.getNoData() == doctest::Approx(-9999.0));
+
+  std::vector<float> pixels(257 * 257);
+  reader.read(glm::dvec2(0.0), glm::dvec2(1.0), pixels.data());
+
+  CHECK(pixels[128 * 257 + 10] == doctest::Approx(5.F));
+  CHECK(pixels[128 * 257 + 250] == 0.F);
+
+  // NoData values are never blended with valid pixels.
+  int blended = 0;
+
+  for (float pixel : pixels) {
+    if (pixel != 0.F && pixel != doctest::Approx(5.F)) {
+      ++blended;
+    }
+  }
+
+  CHECK(blended == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -5,10 +5,193 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "../src/HEALPix.hpp"
+#include "Benchmark.hpp"
 #include "../../../src/cs-utils/doctest.hpp"
 
+#include <random>
+#include <string>
+#include <vector>
+
 namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Interleaves the bits of x and y one by one: x gives the even bits, y the odd bits.
+glm::int64 interleaveBits(glm::int64 x, glm::int64 y) {
+  glm::int64 result = 0;
+
+  for (int i = 0; i < 32; ++i) {
+    result |= ((x >> i) & 1) << (2 * i);
+    result |= ((y >> i) & 1) << (2 * i + 1);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<glm::int64> createPatchIdxs(HEALPixLevel const& level, std::size_t count) {
+  std::mt19937_64                           engine(42);
+  std::uniform_int_distribution<glm::int64> patchIdx(0, level.getTotalPatchCount() - 1);
+
+  std::vector<glm::int64> patchIdxs;
+  patchIdxs.reserve(count);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    patchIdxs.push_back(patchIdx(engine));
+  }
+
+  return patchIdxs;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 TEST_CASE("csp::lodbodies::HEALPIX") {
   CHECK_EQ(HEALPix::getLevel(1).getLevel(), 1);
 }
-} // namespace csp::lodbodies
\ No newline at end of file
+
+TEST_CASE("csp::lodbodies::HEALPixLevel bit interleaving") {
+  bool const useBMI2 = HEALPixLevel::getUseBMI2();
+  CHECK_EQ(useBMI2, HEALPixLevel::isBMI2Fast());
+
+  // All available implementations have to match the reference.
+  std::vector<bool> implementations = {false};
+  if (HEALPixLevel::isBMI2Supported()) {
+    implementations.push_back(true);
+  }
+
+  for (bool bmi2 : implementations) {
+    HEALPixLevel::setUseBMI2(bmi2);
+
+    for (int l = 0; l < 20; ++l) {
+      HEALPixLevel const& level = HEALPix::getLevel(l);
+
+      bool equal = true;
+      for (glm::int64 patchIdx : createPatchIdxs(level, 1000)) {
+        glm::i64vec3 bxy = level.getBaseXY(patchIdx);
+
+        equal = equal && bxy[0] == level.getBasePatch(patchIdx) &&
+                (bxy[0] << (2 * l)) + interleaveBits(bxy[1], bxy[2]) == patchIdx &&
+                level.getPatchIdx(bxy) == patchIdx;
+      }
+
+      CHECK_MESSAGE(equal, "BMI2: " << bmi2 << ", level: " << l);
+    }
+  }
+
+  // Both implementations have to find the same neighbours.
+  if (HEALPixLevel::isBMI2Supported()) {
+    HEALPixLevel const& level     = HEALPix::getLevel(6);
+    auto const          patchIdxs = createPatchIdxs(level, 1000);
+
+    std::vector<std::array<glm::int64, 4>> neighbours;
+
+    HEALPixLevel::setUseBMI2(false);
+    for (glm::int64 patchIdx : patchIdxs) {
+      neighbours.push_back(level.getNeighbours(patchIdx));
+    }
+
+    HEALPixLevel::setUseBMI2(true);
+    bool equal = true;
+    for (std::size_t i = 0; i < patchIdxs.size(); ++i) {
+      equal = equal && level.getNeighbours(patchIdxs[i]) == neighbours[i];
+    }
+
+    CHECK_UNARY(equal);
+  }
+
+  HEALPixLevel::setUseBMI2(useBMI2);
+  CHECK_EQ(HEALPixLevel::getUseBMI2(), useBMI2);
+}
+
+TEST_CASE("csp::lodbodies::HEALPixLevel batched corners and centers") {
+  HEALPixLevel const& level     = HEALPix::getLevel(8);
+  auto const          patchIdxs = createPatchIdxs(level, 1000);
+  glm::dvec3 const    radii(6378137.0, 6378137.0, 6356752.3);
+
+  std::vector<glm::dvec2> centers;
+  std::vector<glm::dvec3> corners;
+  level.getCentersLngLat(patchIdxs, centers);
+  level.getCornersCartesian(patchIdxs, radii, corners);
+
+  REQUIRE_EQ(centers.size(), patchIdxs.size());
+  REQUIRE_EQ(corners.size(), 4 * patchIdxs.size());
+
+  bool equal = true;
+  for (std::size_t i = 0; i < patchIdxs.size(); ++i) {
+    auto single = level.getCornersCartesian(patchIdxs[i], radii);
+
+    equal = equal && centers[i] == level.getCenterLngLat(patchIdxs[i]);
+
+    for (std::size_t j = 0; j < single.size(); ++j) {
+      equal = equal && corners[4 * i + j] == single.at(j);
+    }
+  }
+
+  CHECK_UNARY(equal);
+
+  // An empty batch must not do anything.
+  level.getCornersCartesian({}, radii, corners);
+  CHECK_UNARY(corners.empty());
+}
+
+TEST_CASE("csp::lodbodies::HEALPixLevel [benchmark]") {
+  bool const useBMI2 = HEALPixLevel::getUseBMI2();
+
+  HEALPixLevel const& level     = HEALPix::getLevel(12);
+  auto const          patchIdxs = createPatchIdxs(level, 1000000);
+  glm::int64          sum       = 0;
+
+  auto benchmarkIndices = [&](char const* suffix) {
+    benchmark<std::nano>((std::string("getBaseXY / getPatchIdx ") + suffix).c_str(),
+        patchIdxs.size(), "patch", [&]() {
+          for (glm::int64 patchIdx : patchIdxs) {
+            sum += level.getPatchIdx(level.getBaseXY(patchIdx));
+          }
+        });
+
+    benchmark<std::nano>((std::string("getNeighbours ") + suffix).c_str(), patchIdxs.size(),
+        "patch", [&]() {
+          for (glm::int64 patchIdx : patchIdxs) {
+            sum += level.getNeighbours(patchIdx)[0];
+          }
+        });
+  };
+
+  HEALPixLevel::setUseBMI2(false);
+  benchmarkIndices("(LUT)");
+
+  if (HEALPixLevel::isBMI2Supported()) {
+    HEALPixLevel::setUseBMI2(true);
+    benchmarkIndices("(BMI2)");
+  }
+
+  HEALPixLevel::setUseBMI2(useBMI2);
+
+  glm::dvec3 const        radii(1.0);
+  std::vector<glm::dvec3> corners;
+  std::size_t const       count = 100000;
+  std::vector<glm::int64> subset(patchIdxs.begin(), patchIdxs.begin() + count);
+
+  benchmark<std::nano>("getCornersCartesian", count, "patch", [&]() {
+    for (glm::int64 patchIdx : subset) {
+      sum += static_cast<glm::int64>(level.getCornersCartesian(patchIdx, radii)[0].x);
+    }
+  });
+
+  benchmark<std::nano>("getCornersCartesian (batched)", count, "patch",
+      [&]() { level.getCornersCartesian(subset, radii, corners); });
+
+  // prevent the compiler from optimizing everything away
+  CHECK_NE(sum, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
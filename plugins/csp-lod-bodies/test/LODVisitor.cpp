@@ -0,0 +1,482 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/HEALPix.hpp"
+#include "../src/LODVisitor.hpp"
+#include "../src/PlanetParameters.hpp"
+#include "../src/RenderDataDEM.hpp"
+#include "../src/Tile.hpp"
+#include "../src/TileBounds.hpp"
+#include "../src/TileNode.hpp"
+#include "../src/TreeManager.hpp"
+#include "Benchmark.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A tile without any samples. The LODVisitor only looks at the bounds of inner nodes, so these
+// are used for all but the root nodes of the synthetic trees below to keep the memory usage low.
+class EmptyTile : public TileBase {
+ public:
+  EmptyTile(int level, glm::int64 patchIdx)
+      : TileBase(level, patchIdx) {
+  }
+
+  std::type_info const& getTypeId() const override {
+    return typeid(float);
+  }
+
+  TileDataType getDataType() const override {
+    return TileDataType::eFloat32;
+  }
+
+  void const* getDataPtr() const override {
+    return nullptr;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Creates a complete elevation tile tree of the given depth without a TileSource or any GPU
+// resources. All nodes pretend to be uploaded to the GPU, so the LODVisitor may refine them as
+// required. Their render data is stored in the TileAgeList, so unused nodes can be pruned.
+class SyntheticTreeManager : public TreeManager<RenderDataDEM> {
+ public:
+  SyntheticTreeManager(PlanetParameters const& params, int depth)
+      : TreeManager<RenderDataDEM>(params, nullptr) {
+    for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+      // The root tiles need a MinMaxPyramid, it is used for horizon culling.
+      auto* root = new Tile<float>(0, i);
+      root->setMinMaxPyramid(std::make_unique<MinMaxPyramid>(root));
+      addNode(new TileNode(root), depth);
+    }
+  }
+
+ private:
+  void addNode(TileNode* node, int depth) {
+    insertNode(&mTree, node);
+
+    RenderDataDEM* rdata = mPool.construct();
+    rdata->setNode(node);
+    rdata->setTexLayer(0);
+    rdata->setBounds(calcTileBounds(
+        0.0, 0.0, node->getLevel(), node->getPatchIdx(), mParams->mRadii, mParams->mHeightScale));
+    mRdMap.emplace(node->getTileId(), rdata);
+    mAgeList.insert(rdata, node->getLevel());
+
+    if (node->getLevel() < depth) {
+      for (int i = 0; i < 4; ++i) {
+        TileId childId = HEALPix::getChildTileId(node->getTileId(), i);
+        addNode(new TileNode(new EmptyTile(childId.level(), childId.patchIdx())), depth);
+      }
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// By default, the observer hovers close to the surface of the unit sphere and looks towards the
+// horizon, this results in a deep level-of-detail cut with tiles of many different levels.
+void setupView(LODVisitor& visitor, glm::dvec3 const& eye = glm::dvec3(0.0, 0.0, 1.05),
+    glm::dvec3 const& target = glm::dvec3(0.0, 0.6, 0.8)) {
+  glm::dvec3 const up(0.0, 0.0, 1.0);
+
+  visitor.setModelview(glm::lookAt(eye, target, up));
+  visitor.setProjection(glm::perspective(glm::radians(60.0), 16.0 / 9.0, 0.001, 10.0));
+  visitor.setViewport(glm::ivec4(0, 0, 1920, 1080));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct TraversalResult {
+  std::vector<TileId>     mRender;
+  std::vector<glm::ivec4> mEdgeDeltas;
+  std::vector<TileId>     mLoad;
+  std::vector<double>     mPriorities;
+};
+
+// Runs one traversal and resets the render data afterwards, just like the TileRenderer does.
+TraversalResult runTraversal(LODVisitor& visitor, int frame) {
+  TraversalResult result;
+
+  visitor.setFrameCount(frame);
+  visitor.visit();
+
+  for (auto* rd : visitor.getRenderDEM()) {
+    auto* rdDEM = static_cast<RenderDataDEM*>(rd);
+    result.mRender.push_back(rdDEM->getTileId());
+    result.mEdgeDeltas.emplace_back(rdDEM->getEdgeDelta(0), rdDEM->getEdgeDelta(1),
+        rdDEM->getEdgeDelta(2), rdDEM->getEdgeDelta(3));
+
+    rdDEM->resetEdgeDeltas();
+    rdDEM->resetEdgeRData();
+    rdDEM->clearFlags();
+  }
+
+  for (auto const& request : visitor.getLoadDEM()) {
+    result.mLoad.push_back(request.mTileId);
+    result.mPriorities.push_back(request.mPriority);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::LODVisitor parallel traversal yields the same result") {
+  PlanetParameters params;
+  params.mLodFactor = 1000.0;
+
+  SyntheticTreeManager treeMgr(params, 4);
+  LODVisitor           visitor(params, &treeMgr);
+  setupView(visitor);
+
+  visitor.setThreadCount(1);
+  auto serial = runTraversal(visitor, 1);
+
+  REQUIRE_FALSE(serial.mRender.empty());
+  REQUIRE_FALSE(serial.mLoad.empty());
+
+  for (std::size_t threads : {2, 5, 12}) {
+    visitor.setThreadCount(threads);
+    auto parallel = runTraversal(visitor, 1);
+
+    CHECK_UNARY(parallel.mRender == serial.mRender);
+    CHECK_UNARY(parallel.mEdgeDeltas == serial.mEdgeDeltas);
+    CHECK_UNARY(parallel.mLoad == serial.mLoad);
+    CHECK_UNARY(parallel.mPriorities == serial.mPriorities);
+  }
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor thread count") {
+  PlanetParameters params;
+  LODVisitor       visitor(params);
+
+  CHECK_EQ(visitor.getThreadCount(), 1U);
+
+  visitor.setThreadCount(0);
+  CHECK_EQ(visitor.getThreadCount(), 1U);
+
+  visitor.setThreadCount(64);
+  CHECK_EQ(visitor.getThreadCount(), static_cast<std::size_t>(TileQuadTree::sNumRoots));
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor parallel traversal marks the used nodes") {
+  PlanetParameters params;
+  params.mLodFactor = 1000.0;
+
+  // The visitors of the root patches must not modify the TileAgeList concurrently. If nodes are
+  // marked in a different order than on a single thread, or not at all, the pruned nodes differ.
+  SyntheticTreeManager serialMgr(params, 4);
+  SyntheticTreeManager parallelMgr(params, 4);
+  LODVisitor           serial(params, &serialMgr);
+  LODVisitor           parallel(params, &parallelMgr);
+  parallel.setThreadCount(4);
+
+  setupView(serial);
+  setupView(parallel);
+
+  runTraversal(serial, 1);
+  runTraversal(parallel, 1);
+
+  // After turning around, the nodes which were only visible in the first frame become too old.
+  glm::dvec3 const eye(0.0, 0.0, 1.05);
+  glm::dvec3 const target(0.0, -0.6, 0.8);
+  setupView(serial, eye, target);
+  setupView(parallel, eye, target);
+
+  std::size_t const nodeCount = parallelMgr.getNodeCount();
+  TraversalResult   expected;
+  TraversalResult   result;
+
+  for (int frame = 2; frame < 20; ++frame) {
+    expected = runTraversal(serial, frame);
+    result   = runTraversal(parallel, frame);
+
+    serialMgr.setFrameCount(frame);
+    serialMgr.update();
+    parallelMgr.setFrameCount(frame);
+    parallelMgr.update();
+  }
+
+  REQUIRE_FALSE(result.mRender.empty());
+  CHECK_UNARY(result.mRender == expected.mRender);
+  CHECK_LT(parallelMgr.getNodeCount(), nodeCount);
+  CHECK_EQ(parallelMgr.getNodeCount(), serialMgr.getNodeCount());
+
+  // The nodes which are still used must not be pruned.
+  bool rendered = true;
+  for (auto const& tileId : result.mRender) {
+    rendered = rendered && parallelMgr.find<RenderDataDEM>(tileId) != nullptr;
+  }
+
+  CHECK_UNARY(rendered);
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor incremental traversal yields the same result") {
+  PlanetParameters params;
+  params.mLodFactor = 1000.0;
+
+  SyntheticTreeManager treeMgr(params, 4);
+  LODVisitor           full(params, &treeMgr);
+  LODVisitor           incremental(params, &treeMgr);
+  incremental.setIncremental(true);
+
+  glm::dvec3 const eye(0.0, 0.0, 1.05);
+  glm::dvec3 const target(0.0, 0.6, 0.8);
+
+  // In the first frame, all visited nodes have to be tested.
+  setupView(full, eye, target);
+  setupView(incremental, eye, target);
+
+  auto expected = runTraversal(full, 1);
+  auto result   = runTraversal(incremental, 1);
+
+  REQUIRE_FALSE(expected.mRender.empty());
+  CHECK_UNARY(result.mRender == expected.mRender);
+  CHECK_UNARY(result.mEdgeDeltas == expected.mEdgeDeltas);
+  CHECK_UNARY(result.mLoad == expected.mLoad);
+  CHECK_EQ(incremental.getNumTestedNodes(), full.getNumTestedNodes());
+
+  // Without any movement, only the nodes behind the horizon are tested again.
+  result = runTraversal(incremental, 2);
+
+  CHECK_UNARY(result.mRender == expected.mRender);
+  CHECK_UNARY(result.mLoad == expected.mLoad);
+  CHECK_LT(incremental.getNumTestedNodes(), full.getNumTestedNodes());
+
+  // A small movement must not change the selected tiles.
+  glm::dvec3 const offset(0.0, 1e-6, 0.0);
+  setupView(full, eye + offset, target + offset);
+  setupView(incremental, eye + offset, target + offset);
+
+  expected = runTraversal(full, 3);
+  result   = runTraversal(incremental, 3);
+
+  CHECK_UNARY(result.mRender == expected.mRender);
+  CHECK_UNARY(result.mEdgeDeltas == expected.mEdgeDeltas);
+  CHECK_UNARY(result.mLoad == expected.mLoad);
+
+  // After turning around, all decisions have to be made again.
+  setupView(full, eye, glm::dvec3(0.0, -0.6, 0.8));
+  setupView(incremental, eye, glm::dvec3(0.0, -0.6, 0.8));
+
+  expected = runTraversal(full, 4);
+  result   = runTraversal(incremental, 4);
+
+  CHECK_UNARY(result.mRender == expected.mRender);
+  CHECK_UNARY(result.mEdgeDeltas == expected.mEdgeDeltas);
+  CHECK_UNARY(result.mLoad == expected.mLoad);
+  CHECK_UNARY(result.mPriorities == expected.mPriorities);
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor incremental traversal with alternating projections") {
+  PlanetParameters params;
+  params.mLodFactor = 1000.0;
+
+  SyntheticTreeManager treeMgr(params, 4);
+  LODVisitor           full(params, &treeMgr);
+  LODVisitor           incremental(params, &treeMgr);
+  incremental.setIncremental(true);
+
+  setupView(full);
+  setupView(incremental);
+
+  // Like the two eyes of a stereo setup, the projection changes in every frame.
+  std::vector<glm::dmat4> const projections = {
+      glm::perspective(glm::radians(60.0), 16.0 / 9.0, 0.001, 10.0),
+      glm::perspective(glm::radians(50.0), 16.0 / 9.0, 0.001, 10.0)};
+
+  for (int frame = 1; frame <= 6; ++frame) {
+    auto const& matP = projections.at(static_cast<std::size_t>(frame % 2));
+    full.setProjection(matP);
+    incremental.setProjection(matP);
+
+    auto expected = runTraversal(full, frame);
+    auto result   = runTraversal(incremental, frame);
+
+    CHECK_UNARY(result.mRender == expected.mRender);
+    CHECK_UNARY(result.mEdgeDeltas == expected.mEdgeDeltas);
+    CHECK_UNARY(result.mLoad == expected.mLoad);
+
+    // Once both projections have been used, their decisions are reused.
+    if (frame > 2) {
+      CHECK_LT(incremental.getNumTestedNodes(), full.getNumTestedNodes());
+    }
+  }
+
+  // A traversal which skips the decisions, like that of a shadow map, must neither use nor displace
+  // them.
+  glm::dmat4 const shadowP = glm::ortho(-1.0, 1.0, -1.0, 1.0, 0.001, 10.0);
+  full.setProjection(shadowP);
+  incremental.setProjection(shadowP);
+  incremental.setSkipDecisions(true);
+
+  auto expected = runTraversal(full, 7);
+  auto result   = runTraversal(incremental, 7);
+
+  CHECK_UNARY(result.mRender == expected.mRender);
+  CHECK_UNARY(result.mLoad == expected.mLoad);
+  CHECK_EQ(incremental.getNumTestedNodes(), full.getNumTestedNodes());
+
+  incremental.setSkipDecisions(false);
+
+  for (int frame = 8; frame <= 9; ++frame) {
+    auto const& matP = projections.at(static_cast<std::size_t>(frame % 2));
+    full.setProjection(matP);
+    incremental.setProjection(matP);
+
+    expected = runTraversal(full, frame);
+    result   = runTraversal(incremental, frame);
+
+    CHECK_UNARY(result.mRender == expected.mRender);
+    CHECK_UNARY(result.mLoad == expected.mLoad);
+    CHECK_LT(incremental.getNumTestedNodes(), full.getNumTestedNodes());
+  }
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor load only traversal") {
+  PlanetParameters params;
+  params.mLodFactor = 1000.0;
+
+  SyntheticTreeManager treeMgr(params, 4);
+  LODVisitor           visitor(params, &treeMgr);
+  LODVisitor           prefetch(params, &treeMgr);
+  prefetch.setLoadOnly(true);
+
+  CHECK_UNARY_FALSE(visitor.getLoadOnly());
+  CHECK_UNARY(prefetch.getLoadOnly());
+
+  // The same tiles are requested, but none is drawn.
+  setupView(visitor);
+  setupView(prefetch);
+
+  auto expected = runTraversal(visitor, 1);
+  auto result   = runTraversal(prefetch, 1);
+
+  REQUIRE_FALSE(expected.mLoad.empty());
+  CHECK_UNARY(result.mRender.empty());
+  CHECK_UNARY(result.mLoad == expected.mLoad);
+  CHECK_UNARY(result.mPriorities == expected.mPriorities);
+
+  // A load only traversal with a different view between the traversal and the rendering must not
+  // change what is drawn.
+  visitor.setFrameCount(2);
+  visitor.visit();
+
+  setupView(prefetch, glm::dvec3(0.0, 0.0, 1.05), glm::dvec3(0.0, -0.6, 0.8));
+  prefetch.setThreadCount(4);
+  prefetch.setFrameCount(2);
+  prefetch.visit();
+
+  CHECK_UNARY(prefetch.getRenderDEM().empty());
+  CHECK_UNARY_FALSE(prefetch.getLoadDEM().empty());
+
+  std::vector<TileId>     render;
+  std::vector<glm::ivec4> edgeDeltas;
+
+  for (auto* rd : visitor.getRenderDEM()) {
+    auto* rdDEM = static_cast<RenderDataDEM*>(rd);
+    render.push_back(rdDEM->getTileId());
+    edgeDeltas.emplace_back(rdDEM->getEdgeDelta(0), rdDEM->getEdgeDelta(1),
+        rdDEM->getEdgeDelta(2), rdDEM->getEdgeDelta(3));
+  }
+
+  CHECK_UNARY(render == expected.mRender);
+  CHECK_UNARY(edgeDeltas == expected.mEdgeDeltas);
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor [benchmark]") {
+  int const frames = 20;
+
+  PlanetParameters params;
+  params.mLodFactor = 1000.0;
+
+  SyntheticTreeManager treeMgr(params, 7);
+  LODVisitor           visitor(params, &treeMgr);
+  setupView(visitor);
+
+  double serialTime = 0.0;
+
+  for (std::size_t threads : {1, 2, 4, 8, 12}) {
+    visitor.setThreadCount(threads);
+
+    // warm up, this also creates the thread pool
+    runTraversal(visitor, 0);
+
+    double time = measureTime([&]() {
+      for (int i = 1; i <= frames; ++i) {
+        runTraversal(visitor, i);
+      }
+    }) / frames;
+    if (threads == 1) {
+      serialTime = time;
+    }
+
+    MESSAGE(threads << " thread(s): " << time << " ms per frame, speedup " << serialTime / time
+                    << ", " << visitor.getRenderDEM().size() << " tiles drawn");
+  }
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor incremental [benchmark]") {
+  int const frames = 100;
+
+  PlanetParameters params;
+  params.mLodFactor = 1000.0;
+
+  SyntheticTreeManager treeMgr(params, 7);
+  LODVisitor           visitor(params, &treeMgr);
+
+  double fullTime = 0.0;
+
+  for (bool incremental : {false, true}) {
+    visitor.setIncremental(incremental);
+
+    std::size_t testedNodes = 0;
+    double      time        = 0.0;
+
+    // The observer slowly flies towards the horizon.
+    for (int i = 0; i <= frames; ++i) {
+      glm::dvec3 const offset(0.0, 1e-5 * i, 0.0);
+      setupView(visitor, glm::dvec3(0.0, 0.0, 1.05) + offset, glm::dvec3(0.0, 0.6, 0.8) + offset);
+
+      double const frameTime = measureTime([&]() { runTraversal(visitor, i); });
+
+      // the first frame is the same for both modes
+      if (i > 0) {
+        time += frameTime / frames;
+        testedNodes += visitor.getNumTestedNodes();
+      }
+    }
+
+    if (!incremental) {
+      fullTime = time;
+    }
+
+    std::size_t const testedPerFrame = testedNodes / static_cast<std::size_t>(frames);
+
+    MESSAGE((incremental ? "incremental: " : "full: ") << time << " ms per frame, speedup "
+                                                       << fullTime / time << ", " << testedPerFrame
+                                                       << " nodes tested");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,205 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/HEALPix.hpp"
+#include "../src/MinMaxPyramid.hpp"
+#include "../src/Tile.hpp"
+#include "Benchmark.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The pyramid as it was computed before: One vector per level, starting with the finest level.
+// Each cell of the finest level covers 2x2 samples, the last row and column of samples are added
+// to the last row and column of cells.
+struct ReferencePyramid {
+  std::vector<std::vector<float>> mMin;
+  std::vector<std::vector<float>> mMax;
+
+  explicit ReferencePyramid(Tile<float> const& tile) {
+    for (int size = 128; size >= 2; size /= 2) {
+      mMin.emplace_back(size * size, std::numeric_limits<float>::max());
+      mMax.emplace_back(size * size, -std::numeric_limits<float>::max());
+    }
+
+    for (int y = 0; y < TileBase::SizeY; ++y) {
+      for (int x = 0; x < TileBase::SizeX; ++x) {
+        float const v   = tile.data()[y * TileBase::SizeX + x];
+        int const   idx = std::min(y / 2, 127) * 128 + std::min(x / 2, 127);
+
+        mMin[0][idx] = std::min(mMin[0][idx], v);
+        mMax[0][idx] = std::max(mMax[0][idx], v);
+      }
+    }
+
+    for (size_t i = 1; i < mMin.size(); ++i) {
+      int const size = 128 >> i;
+
+      for (int y = 0; y < 2 * size; ++y) {
+        for (int x = 0; x < 2 * size; ++x) {
+          int const idx = (y / 2) * size + x / 2;
+
+          mMin[i][idx] = std::min(mMin[i][idx], mMin[i - 1][y * 2 * size + x]);
+          mMax[i][idx] = std::max(mMax[i][idx], mMax[i - 1][y * 2 * size + x]);
+        }
+      }
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Random terrain with some larger features, so that the extrema are not all in the same cell.
+void fillTile(Tile<float>& tile, unsigned seed) {
+  std::mt19937                          engine(seed);
+  std::uniform_real_distribution<float> noise(-100.F, 100.F);
+
+  for (int y = 0; y < TileBase::SizeY; ++y) {
+    for (int x = 0; x < TileBase::SizeX; ++x) {
+      float const hills = std::sin(0.05F * static_cast<float>(x)) *
+                          std::cos(0.03F * static_cast<float>(y));
+
+      tile.data()[y * TileBase::SizeX + x] = 1000.F * hills + noise(engine);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::MinMaxPyramid matches the per-level computation") {
+  auto tile = std::make_unique<Tile<float>>(3, 42);
+
+  for (unsigned seed : {1U, 2U, 3U}) {
+    fillTile(*tile, seed);
+
+    // The extreme samples are in the last row and column, which are handled separately.
+    tile->data()[TileBase::SizeX * TileBase::SizeY - 1]       = 5000.F;
+    tile->data()[TileBase::SizeX * (TileBase::SizeY - 1) + 3] = -5000.F;
+
+    MinMaxPyramid    pyramid(tile.get());
+    ReferencePyramid reference(*tile);
+
+    CHECK_EQ(pyramid.getMin(), -5000.F);
+    CHECK_EQ(pyramid.getMax(), 5000.F);
+
+    for (int level = 1; level <= MinMaxPyramid::sNumLevels; ++level) {
+      int const   size  = 1 << level;
+      auto const& mins  = reference.mMin[MinMaxPyramid::sNumLevels - level];
+      auto const& maxs  = reference.mMax[MinMaxPyramid::sNumLevels - level];
+      bool        equal = true;
+
+      for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+          equal = equal && pyramid.getMin(level, x, y) == mins[y * size + x] &&
+                  pyramid.getMax(level, x, y) == maxs[y * size + x];
+        }
+      }
+
+      CHECK_UNARY(equal);
+    }
+  }
+}
+
+TEST_CASE("csp::lodbodies::MinMaxPyramid quadrant queries") {
+  auto tile = std::make_unique<Tile<float>>(3, 42);
+  fillTile(*tile, 1);
+
+  MinMaxPyramid pyramid(tile.get());
+
+  // The examples of the documentation.
+  CHECK_EQ(pyramid.getMin(3, 0b010101U), pyramid.getMin(3, 7, 0));
+  CHECK_EQ(pyramid.getMin(3, 0b010110U), pyramid.getMin(3, 6, 1));
+  CHECK_EQ(pyramid.getMin(3, 0b000101U), pyramid.getMin(3, 3, 0));
+  CHECK_EQ(pyramid.getMax(3, 0b000110U), pyramid.getMax(3, 2, 1));
+
+  // The quadrants of a tile are the lowest bits of its patch index.
+  TileId tileId(10, 12345);
+  int    x = 0;
+  int    y = 0;
+
+  for (int level = 1; level <= MinMaxPyramid::sNumLevels; ++level) {
+    int const quadrant = HEALPix::getChildIdxAtLevel(tileId, tileId.level() - level + 1);
+    x += (quadrant & 1) << (level - 1);
+    y += (quadrant >> 1) << (level - 1);
+
+    auto const quadrants = static_cast<uint32_t>(tileId.patchIdx() & ((1 << (2 * level)) - 1));
+    CHECK_EQ(pyramid.getMin(level, quadrants), pyramid.getMin(level, x, y));
+    CHECK_EQ(pyramid.getMax(level, quadrants), pyramid.getMax(level, x, y));
+  }
+}
+
+TEST_CASE("csp::lodbodies::MinMaxPyramid serialization") {
+  auto tile = std::make_unique<Tile<float>>(3, 42);
+  fillTile(*tile, 1);
+
+  MinMaxPyramid pyramid(tile.get());
+  std::string   data("header");
+  pyramid.serialize(data);
+
+  REQUIRE_EQ(data.size(), 6 + MinMaxPyramid::getSerializedSize());
+
+  MinMaxPyramid restored;
+  CHECK_FALSE(restored.deserialize(data.data(), data.size()));
+  CHECK_UNARY(restored.deserialize(data.data() + 6, data.size() - 6));
+
+  CHECK_EQ(restored.getMin(), pyramid.getMin());
+  CHECK_EQ(restored.getMax(), pyramid.getMax());
+  CHECK_EQ(restored.getAverage(), pyramid.getAverage());
+  CHECK_UNARY(restored.getValues() == pyramid.getValues());
+
+  // Swap minimum and maximum, such data must be rejected.
+  std::string corrupt = data.substr(6);
+  std::swap_ranges(
+      corrupt.begin(), corrupt.begin() + sizeof(float), corrupt.begin() + sizeof(float));
+  MinMaxPyramid rejected;
+  CHECK_FALSE(rejected.deserialize(corrupt.data(), corrupt.size()));
+  CHECK_EQ(rejected.getMin(), MinMaxPyramid().getMin());
+}
+
+TEST_CASE("csp::lodbodies::MinMaxPyramid [benchmark]") {
+  int const iterations = 100;
+
+  auto tile = std::make_unique<Tile<float>>(3, 42);
+  fillTile(*tile, 1);
+
+  float sum = 0.F;
+
+  benchmark<std::micro>("per-level vectors", iterations, "pyramid", [&]() {
+    for (int i = 0; i < iterations; ++i) {
+      sum += ReferencePyramid(*tile).mMin.back()[0];
+    }
+  });
+
+  benchmark<std::micro>("flat buffer", iterations, "pyramid", [&]() {
+    for (int i = 0; i < iterations; ++i) {
+      sum += MinMaxPyramid(tile.get()).getMin(1, 0, 0);
+    }
+  });
+
+  // prevent the compiler from optimizing everything away
+  CHECK_NE(sum, 0.F);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/ObserverPredictor.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The world transform of a body which is rotated and seen by an observer at the given position in
+// the body's coordinate system.
+glm::dmat4 getWorldTransform(glm::dvec3 const& observer) {
+  glm::dmat4 rotation = glm::rotate(glm::dmat4(1.0), 0.5, glm::dvec3(0.0, 1.0, 0.0));
+  return glm::translate(rotation, -observer);
+}
+
+// The position of the observer in the coordinate system of a body with the given world transform.
+glm::dvec3 getObserver(glm::dmat4 const& worldTransform) {
+  return glm::dvec3(glm::inverse(worldTransform) * glm::dvec4(0.0, 0.0, 0.0, 1.0));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::ObserverPredictor extrapolates the velocity") {
+  ObserverPredictor predictor(1.0, 2.0, 0.1);
+
+  // Without any motion, nothing is predicted.
+  CHECK_UNARY_FALSE(predictor.getPrediction().has_value());
+  predictor.update(getWorldTransform(glm::dvec3(0.0, 0.0, 2.0)), 0.0);
+  CHECK_UNARY_FALSE(predictor.getPrediction().has_value());
+  predictor.update(getWorldTransform(glm::dvec3(0.0, 0.0, 2.0)), 1.0);
+  CHECK_UNARY_FALSE(predictor.getPrediction().has_value());
+
+  // Slow motion compared to the altitude is ignored as well.
+  predictor.update(getWorldTransform(glm::dvec3(0.01, 0.0, 2.0)), 2.0);
+  CHECK_UNARY_FALSE(predictor.getPrediction().has_value());
+
+  // The observer moves along the x-axis with a velocity of 0.5 per second.
+  predictor.reset();
+
+  for (int i = 0; i <= 10; ++i) {
+    predictor.update(getWorldTransform(glm::dvec3(0.05 * i, 0.0, 2.0)), 0.1 * i);
+  }
+
+  CHECK_EQ(predictor.getVelocity().x, doctest::Approx(0.5));
+
+  auto prediction = predictor.getPrediction();
+  REQUIRE_UNARY(prediction.has_value());
+
+  // With a look ahead of two seconds, the observer is expected one unit further.
+  glm::dvec3 observer = getObserver(*prediction);
+  CHECK_EQ(observer.x, doctest::Approx(1.5));
+  CHECK_EQ(observer.y, doctest::Approx(0.0));
+  CHECK_EQ(observer.z, doctest::Approx(2.0));
+}
+
+TEST_CASE("csp::lodbodies::ObserverPredictor ignores jumps") {
+  ObserverPredictor predictor(1.0, 2.0, 0.1);
+
+  // The observer moves along the x-axis with a velocity of 0.5 per second.
+  for (int i = 0; i <= 10; ++i) {
+    predictor.update(getWorldTransform(glm::dvec3(0.05 * i, 0.0, 2.0)), 0.1 * i);
+  }
+
+  REQUIRE_UNARY(predictor.getPrediction().has_value());
+
+  // Then it jumps to the other side of the body. This must not be extrapolated.
+  predictor.update(getWorldTransform(glm::dvec3(0.0, 0.0, -2.0)), 1.1);
+  CHECK_UNARY_FALSE(predictor.getPrediction().has_value());
+  CHECK_EQ(predictor.getVelocity(), glm::dvec3(0.0));
+
+  // Once it moves on from there, the new velocity is measured.
+  predictor.update(getWorldTransform(glm::dvec3(0.05, 0.0, -2.0)), 1.2);
+  CHECK_EQ(predictor.getVelocity().x, doctest::Approx(0.5));
+  CHECK_EQ(predictor.getVelocity().z, doctest::Approx(0.0));
+  CHECK_UNARY(predictor.getPrediction().has_value());
+}
+
+TEST_CASE("csp::lodbodies::ObserverPredictor stays above the surface") {
+  ObserverPredictor predictor(1.0, 2.0, 0.1);
+
+  // The observer falls towards the body with a velocity of 0.5 per second. After two seconds it
+  // would be below the surface.
+  for (int i = 0; i <= 10; ++i) {
+    predictor.update(getWorldTransform(glm::dvec3(0.0, 0.0, 2.0 - 0.05 * i)), 0.1 * i);
+  }
+
+  auto prediction = predictor.getPrediction();
+  REQUIRE_UNARY(prediction.has_value());
+
+  glm::dvec3 observer = getObserver(*prediction);
+  CHECK_EQ(observer.x, doctest::Approx(0.0));
+  CHECK_EQ(observer.z, doctest::Approx(1.05));
+}
+
+TEST_CASE("csp::lodbodies::ObserverPredictor prefers the animation target") {
+  ObserverPredictor predictor(1.0);
+
+  predictor.update(getWorldTransform(glm::dvec3(0.0, 0.0, 2.0)), 0.0);
+  predictor.update(getWorldTransform(glm::dvec3(0.0, 0.0, 2.0)), 1.0);
+
+  glm::dmat4 const target = getWorldTransform(glm::dvec3(0.0, 3.0, 0.0));
+  predictor.setTarget(target);
+
+  auto prediction = predictor.getPrediction();
+  REQUIRE_UNARY(prediction.has_value());
+  CHECK_UNARY(*prediction == target);
+
+  predictor.setTarget(std::nullopt);
+  CHECK_UNARY_FALSE(predictor.getPrediction().has_value());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
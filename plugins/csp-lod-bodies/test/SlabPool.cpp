@@ -0,0 +1,175 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/SlabPool.hpp"
+
+#include "../src/Tile.hpp"
+#include "../src/TileNode.hpp"
+#include "Benchmark.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace csp::lodbodies {
+
+TEST_CASE("csp::lodbodies::SlabPool") {
+  SlabPool pool(100, 1000);
+
+  // Blocks are padded to keep them aligned.
+  CHECK_EQ(pool.getBlockSize() % alignof(std::max_align_t), 0);
+  CHECK_GE(pool.getBlockSize(), 100);
+  CHECK_EQ(pool.getBlocksPerSlab(), 1000 / pool.getBlockSize());
+
+  std::size_t const count = 5 * pool.getBlocksPerSlab();
+
+  std::vector<void*> blocks;
+  for (std::size_t i = 0; i < count; ++i) {
+    blocks.push_back(pool.allocate());
+  }
+
+  // All blocks have to be distinct and aligned.
+  std::set<void*> unique(blocks.begin(), blocks.end());
+  CHECK_EQ(unique.size(), count);
+  CHECK_UNARY(std::all_of(blocks.begin(), blocks.end(), [](void* block) {
+    return reinterpret_cast<std::uintptr_t>(block) % alignof(std::max_align_t) == 0;
+  }));
+
+  auto stats = pool.getStats();
+  CHECK_EQ(stats.mSlabCount, 5);
+  CHECK_EQ(stats.mUsed, count);
+  CHECK_EQ(stats.mPeakUsed, count);
+  CHECK_EQ(stats.mAllocations, count);
+  CHECK_EQ(stats.getReservedBytes(), 5 * pool.getBlocksPerSlab() * pool.getBlockSize());
+
+  // Freed blocks are handed out again without creating new slabs.
+  pool.deallocate(blocks.back());
+  CHECK_EQ(pool.allocate(), blocks.back());
+  CHECK_EQ(pool.getStats().mSlabCount, 5);
+
+  pool.deallocate(nullptr);
+  CHECK_EQ(pool.getStats().mUsed, count);
+
+  // Empty slabs are returned to the system, except for one spare slab.
+  for (void* block : blocks) {
+    pool.deallocate(block);
+  }
+
+  stats = pool.getStats();
+  CHECK_EQ(stats.mUsed, 0);
+  CHECK_EQ(stats.mSlabCount, 1);
+  CHECK_EQ(stats.mCapacity, pool.getBlocksPerSlab());
+  CHECK_EQ(stats.mPeakUsed, count);
+}
+
+TEST_CASE("csp::lodbodies::SlabPool is thread-safe") {
+  SlabPool pool(64, 4096);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&pool, t]() {
+      std::mt19937       engine(t);
+      std::vector<void*> blocks;
+
+      for (int i = 0; i < 20000; ++i) {
+        if (blocks.empty() || engine() % 3 != 0) {
+          // Write to the whole block to detect blocks which are handed out twice.
+          auto* block = static_cast<unsigned char*>(pool.allocate());
+          std::fill(block, block + 64, static_cast<unsigned char>(t));
+          blocks.push_back(block);
+        } else {
+          std::swap(blocks[engine() % blocks.size()], blocks.back());
+          pool.deallocate(blocks.back());
+          blocks.pop_back();
+        }
+      }
+
+      for (void* block : blocks) {
+        pool.deallocate(block);
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto stats = pool.getStats();
+  CHECK_EQ(stats.mUsed, 0);
+  CHECK_EQ(stats.mSlabCount, 1);
+}
+
+TEST_CASE("csp::lodbodies::SlabPool tiles and nodes") {
+  auto const before     = TileBase::getPool(TileDataType::eFloat32).getStats();
+  auto const nodeBefore = TileNode::getPool().getStats();
+
+  {
+    std::vector<std::unique_ptr<TileNode>> nodes;
+    for (int i = 0; i < 10; ++i) {
+      nodes.push_back(std::make_unique<TileNode>(std::make_unique<Tile<float>>(1, i)));
+    }
+
+    auto stats = TileBase::getPool(TileDataType::eFloat32).getStats();
+    CHECK_EQ(stats.mUsed, before.mUsed + 10);
+    CHECK_GE(stats.mBlockSize, sizeof(Tile<float>));
+    CHECK_EQ(TileNode::getPool().getStats().mUsed, nodeBefore.mUsed + 10);
+
+    // The other data types have their own size classes.
+    auto tile = std::make_unique<Tile<glm::u8vec3>>(1, 0);
+    CHECK_EQ(TileBase::getPool(TileDataType::eU8Vec3).getStats().mUsed, 1);
+    CHECK_NE(TileBase::getPool(TileDataType::eUInt8).getBlockSize(), stats.mBlockSize);
+  }
+
+  CHECK_EQ(TileBase::getPool(TileDataType::eFloat32).getStats().mUsed, before.mUsed);
+  CHECK_EQ(TileBase::getPool(TileDataType::eU8Vec3).getStats().mUsed, 0);
+  CHECK_EQ(TileNode::getPool().getStats().mUsed, nodeBefore.mUsed);
+}
+
+TEST_CASE("csp::lodbodies::SlabPool [benchmark]") {
+  // Tiles are created and destroyed in random order, like during a long session.
+  std::size_t const count    = 200000;
+  std::size_t const resident = 500;
+
+  auto run = [&](char const* name, auto const& allocate, auto const& deallocate) {
+    std::mt19937               engine(42);
+    std::vector<std::uint8_t*> blocks;
+
+    benchmark<std::nano>(name, count, "allocation", [&]() {
+      for (std::size_t i = 0; i < count; ++i) {
+        if (blocks.size() == resident) {
+          std::swap(blocks[engine() % blocks.size()], blocks.back());
+          deallocate(blocks.back());
+          blocks.pop_back();
+        }
+
+        blocks.push_back(static_cast<std::uint8_t*>(allocate()));
+        blocks.back()[0] = 1;
+      }
+
+      for (auto* block : blocks) {
+        deallocate(block);
+      }
+    });
+  };
+
+  std::size_t const size = sizeof(Tile<glm::uint8>);
+  SlabPool          pool(size);
+
+  run(
+      "operator new", [&]() { return ::operator new(size); },
+      [](void* block) { ::operator delete(block); });
+  run("SlabPool", [&]() { return pool.allocate(); }, [&](void* block) { pool.deallocate(block); });
+
+  CHECK_EQ(pool.getStats().mUsed, 0);
+  CHECK_EQ(pool.getStats().mPeakUsed, resident);
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TEST_GEOTIFF_HPP
+#define CSP_LOD_BODIES_TEST_GEOTIFF_HPP
+
+#include "../src/GeoTIFFReader.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <boost/filesystem.hpp>
+#include <tiffio.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// Writes one image of a float raster. Tiled images use 16 x 16 tiles, the others one strip per 8
+/// rows. The pixels in columns before noDataColumn have the given value, the others noData.
+inline void writeGeoTIFFImage(TIFF* tif, uint32_t size, float value, bool tiled, bool reduced,
+    uint32_t noDataColumn, float noData) {
+  TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, size);
+  TIFFSetField(tif, TIFFTAG_IMAGELENGTH, size);
+  TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 32);
+  TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
+  TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
+  TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+  TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+
+  if (reduced) {
+    TIFFSetField(tif, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE);
+  }
+
+  auto getValue = [&](uint32_t x) { return x < noDataColumn ? value : noData; };
+
+  if (tiled) {
+    uint32_t const     tileSize = 16;
+    std::vector<float> tile(tileSize * tileSize);
+    TIFFSetField(tif, TIFFTAG_TILEWIDTH, tileSize);
+    TIFFSetField(tif, TIFFTAG_TILELENGTH, tileSize);
+
+    for (uint32_t y = 0; y < size; y += tileSize) {
+      for (uint32_t x = 0; x < size; x += tileSize) {
+        for (uint32_t i = 0; i < tile.size(); ++i) {
+          tile[i] = getValue(x + i % tileSize);
+        }
+
+        TIFFWriteTile(tif, tile.data(), x, y, 0, 0);
+      }
+    }
+  } else {
+    std::vector<float> row(size);
+    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, 8);
+
+    for (uint32_t x = 0; x < size; ++x) {
+      row[x] = getValue(x);
+    }
+
+    for (uint32_t y = 0; y < size; ++y) {
+      TIFFWriteScanline(tif, row.data(), y, 0);
+    }
+  }
+
+  TIFFWriteDirectory(tif);
+}
+
+/// A temporary GeoTIFF file which covers the area from (0, 0) to (1, 1) in model coordinates. The
+/// full resolution image has 64 x 64 tiled pixels with the value 5, the optional overview 32 x 32
+/// pixels in strips with the value 7. If noData is given, it is stored as the NoData value and used
+/// for the right half of the full resolution image. The file is removed again when the object goes
+/// out of scope.
+class TemporaryGeoTIFF {
+ public:
+  explicit TemporaryGeoTIFF(bool overview = true, std::string const& noData = "")
+      : mPath(boost::filesystem::temp_directory_path() /
+              boost::filesystem::unique_path("csp-lod-bodies-%%%%-%%%%-%%%%.tif")) {
+    GeoTIFFReader::registerTags();
+
+    TIFF* tif = TIFFOpen(mPath.string().c_str(), "w");
+    REQUIRE(tif != nullptr);
+
+    std::array<double, 3> scale{1.0 / 64.0, 1.0 / 64.0, 0.0};
+    std::array<double, 6> tiepoint{0.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+    TIFFSetField(tif, 33550, 3, scale.data());
+    TIFFSetField(tif, 33922, 6, tiepoint.data());
+
+    uint32_t noDataColumn = 64;
+    float    noDataValue  = 0.F;
+
+    if (!noData.empty()) {
+      TIFFSetField(tif, 42113, noData.c_str());
+      noDataColumn = 32;
+      noDataValue  = std::stof(noData);
+    }
+
+    writeGeoTIFFImage(tif, 64, 5.F, true, false, noDataColumn, noDataValue);
+
+    if (overview) {
+      writeGeoTIFFImage(tif, 32, 7.F, false, true, 32, 0.F);
+    }
+
+    TIFFClose(tif);
+  }
+
+  TemporaryGeoTIFF(TemporaryGeoTIFF const& other) = delete;
+  TemporaryGeoTIFF(TemporaryGeoTIFF&& other)      = delete;
+
+  TemporaryGeoTIFF& operator=(TemporaryGeoTIFF const& other) = delete;
+  TemporaryGeoTIFF& operator=(TemporaryGeoTIFF&& other) = delete;
+
+  ~TemporaryGeoTIFF() {
+    boost::system::error_code error;
+    boost::filesystem::remove(mPath, error);
+  }
+
+  std::string getFile() const {
+    return mPath.string();
+  }
+
+ private:
+  boost::filesystem::path mPath;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TEST_GEOTIFF_HPP
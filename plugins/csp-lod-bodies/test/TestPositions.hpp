@@ -0,0 +1,38 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TEST_POSITIONS_HPP
+#define CSP_LOD_BODIES_TEST_POSITIONS_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// Returns count random longitudes and latitudes (in radians) which cover the entire sphere. The
+/// same seed is used for each call, so that the tests are reproducible.
+inline std::vector<glm::dvec2> createLngLats(std::size_t count) {
+  std::mt19937                           engine(42);
+  std::uniform_real_distribution<double> lng(-glm::pi<double>(), glm::pi<double>());
+  std::uniform_real_distribution<double> lat(-0.5 * glm::pi<double>(), 0.5 * glm::pi<double>());
+
+  std::vector<glm::dvec2> lngLats;
+  lngLats.reserve(count);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    lngLats.emplace_back(lng(engine), lat(engine));
+  }
+
+  return lngLats;
+}
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TEST_POSITIONS_HPP
@@ -0,0 +1,248 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TileAgeList.hpp"
+
+#include "../src/RenderDataDEM.hpp"
+#include "Benchmark.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// RenderData without a node, the level is only known to the TileAgeList.
+struct AgedData {
+  std::unique_ptr<RenderDataDEM> mRData = std::make_unique<RenderDataDEM>();
+  int                            mLevel{};
+};
+
+std::vector<AgedData> createData(std::size_t count, int frame) {
+  std::mt19937                       engine(42);
+  std::uniform_int_distribution<int> level(1, TileAgeList::sNumLevels - 1);
+
+  std::vector<AgedData> data(count);
+
+  for (auto& d : data) {
+    d.mLevel = level(engine);
+    d.mRData->setLastFrame(frame);
+  }
+
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// This is how TreeManagerBase used to find the nodes to prune: All data is sorted by age and
+// level, the oldest data with the highest level is at the back.
+struct AgeLess {
+  bool operator()(AgedData const* lhs, AgedData const* rhs) const {
+    if (lhs->mRData->getLastFrame() == rhs->mRData->getLastFrame()) {
+      return lhs->mLevel < rhs->mLevel;
+    }
+
+    return lhs->mRData->getLastFrame() > rhs->mRData->getLastFrame();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TileAgeList::getOldest") {
+  TileAgeList   list;
+  RenderDataDEM parent;
+  RenderDataDEM child;
+  RenderDataDEM other;
+
+  parent.setLastFrame(5);
+  child.setLastFrame(5);
+  other.setLastFrame(7);
+
+  list.insert(&other, 3);
+  list.insert(&parent, 1);
+  list.insert(&child, 2);
+
+  CHECK_EQ(list.size(), 3);
+
+  // In case of a tie, children come first.
+  CHECK_EQ(list.getOldest(), &child);
+
+  // Using a node moves it to the end.
+  child.setLastFrame(8);
+  CHECK_EQ(list.getOldest(), &parent);
+  CHECK_EQ(list.getOldest(2), &other);
+  CHECK_EQ(list.getOldest(4), nullptr);
+
+  // Data may be inserted with an older frame than the rest of the list.
+  RenderDataDEM sibling;
+  sibling.setLastFrame(6);
+  list.insert(&sibling, 2);
+  CHECK_EQ(list.getOldest(2), &sibling);
+
+  list.remove(&parent);
+  list.remove(&parent);
+  CHECK_EQ(list.size(), 3);
+  CHECK_EQ(list.getOldest(), &sibling);
+
+  // Deleted data removes itself from the list.
+  {
+    RenderDataDEM temporary;
+    temporary.setLastFrame(1);
+    list.insert(&temporary, 5);
+    CHECK_EQ(list.getOldest(), &temporary);
+  }
+
+  CHECK_EQ(list.size(), 3);
+  CHECK_EQ(list.getOldest(), &sibling);
+
+  list.clear();
+  CHECK_EQ(list.size(), 0);
+  CHECK_EQ(list.getOldest(), nullptr);
+
+  // After clearing, the data is not linked anymore and can be inserted again.
+  list.insert(&parent, 1);
+  CHECK_EQ(list.getOldest(), &parent);
+}
+
+TEST_CASE("csp::lodbodies::TileAgeList matches sorting") {
+  std::mt19937                          engine(42);
+  std::uniform_real_distribution<float> random;
+
+  TileAgeList list;
+  auto        data = createData(2000, 0);
+
+  for (auto& d : data) {
+    list.insert(d.mRData.get(), d.mLevel);
+  }
+
+  // Each frame, some data is used. Then the data which has not been used for two frames is
+  // removed in the order given by sorting.
+  std::vector<AgedData*> remaining;
+  for (auto& d : data) {
+    remaining.push_back(&d);
+  }
+
+  bool equal = true;
+
+  for (int frame = 1; frame < 50 && !remaining.empty(); ++frame) {
+    for (auto* d : remaining) {
+      if (random(engine) < 0.9F) {
+        d->mRData->setLastFrame(frame);
+      }
+    }
+
+    std::sort(remaining.begin(), remaining.end(), AgeLess());
+
+    while (!remaining.empty() && frame - remaining.back()->mRData->getLastFrame() > 2) {
+      RenderData* oldest = list.getOldest();
+
+      equal = equal && oldest != nullptr &&
+              oldest->getLastFrame() == remaining.back()->mRData->getLastFrame();
+
+      // The order of data with the same frame and level is not defined.
+      auto same = std::find_if(remaining.rbegin(), remaining.rend(),
+          [&](AgedData const* d) { return d->mRData.get() == oldest; });
+
+      equal = equal && same != remaining.rend() && (*same)->mLevel == remaining.back()->mLevel;
+
+      if (!equal) {
+        break;
+      }
+
+      // All elements between same and the back have the same frame and level, hence swapping
+      // keeps the order.
+      list.remove(oldest);
+      std::iter_swap(same, remaining.rbegin());
+      remaining.pop_back();
+    }
+
+    equal = equal && list.size() == remaining.size();
+  }
+
+  CHECK_UNARY(equal);
+}
+
+TEST_CASE("csp::lodbodies::TileAgeList [benchmark]") {
+  // A large resident set where most tiles are used each frame and a few percent are pruned.
+  std::size_t const count     = 200000;
+  int const         frames    = 20;
+  int const         maxAge    = 2;
+  float const       usedRatio = 0.98F;
+
+  auto run = [&](char const* name, auto const& prune) {
+    std::mt19937                          engine(42);
+    std::uniform_real_distribution<float> random;
+
+    auto        data   = createData(count, 0);
+    std::size_t pruned = 0;
+    double      time   = 0.0;
+
+    TileAgeList            list;
+    std::vector<AgedData*> store;
+
+    for (auto& d : data) {
+      list.insert(d.mRData.get(), d.mLevel);
+      store.push_back(&d);
+    }
+
+    for (int frame = 1; frame <= frames; ++frame) {
+      // Pruned data is marked with a negative frame and not used anymore.
+      for (auto& d : data) {
+        if (random(engine) < usedRatio && d.mRData->getLastFrame() >= 0) {
+          d.mRData->setLastFrame(frame);
+        }
+      }
+
+      time += measureTime([&]() { pruned += prune(list, store, frame); });
+    }
+
+    MESSAGE(name << ": " << time / frames << " ms per frame, " << pruned << " pruned");
+    return pruned;
+  };
+
+  auto sorted = run("std::sort", [&](TileAgeList& list, auto& store, int frame) {
+    std::sort(store.begin(), store.end(), AgeLess());
+
+    std::size_t pruned = 0;
+    while (!store.empty() && frame - store.back()->mRData->getLastFrame() > maxAge) {
+      list.remove(store.back()->mRData.get());
+      store.back()->mRData->setLastFrame(-1);
+      store.pop_back();
+      ++pruned;
+    }
+
+    return pruned;
+  });
+
+  auto aged = run("TileAgeList", [&](TileAgeList& list, auto& /*store*/, int frame) {
+    std::size_t pruned = 0;
+    for (RenderData* oldest = list.getOldest();
+         oldest != nullptr && frame - oldest->getLastFrame() > maxAge; oldest = list.getOldest()) {
+      list.remove(oldest);
+      oldest->setLastFrame(-1);
+      ++pruned;
+    }
+
+    return pruned;
+  });
+
+  CHECK_EQ(sorted, aged);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
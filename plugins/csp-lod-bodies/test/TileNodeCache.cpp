@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TileNodeCache.hpp"
+
+#include "../src/Tile.hpp"
+#include "../src/TileNode.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<TileNode> createNode(int level, glm::int64 patchIdx) {
+  return std::make_unique<TileNode>(std::make_unique<Tile<float>>(level, patchIdx));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TileNodeCache::insert / take") {
+  auto        node     = createNode(5, 42);
+  std::size_t nodeSize = TileNodeCache::getNodeSize(*node);
+  TileNode*   pointer  = node.get();
+
+  TileNodeCache cache(nodeSize * 10);
+  cache.insert(std::move(node));
+
+  CHECK_EQ(cache.getNodeCount(), 1);
+  CHECK_EQ(cache.getBytes(), nodeSize);
+
+  CHECK_EQ(cache.take(TileId(5, 43)), nullptr);
+  CHECK_EQ(cache.take(TileId(5, 42)).get(), pointer);
+  CHECK_EQ(cache.take(TileId(5, 42)), nullptr);
+
+  CHECK_EQ(cache.getNodeCount(), 0);
+  CHECK_EQ(cache.getBytes(), 0);
+  CHECK_EQ(cache.getHitCount(), 1);
+  CHECK_EQ(cache.getMissCount(), 2);
+}
+
+TEST_CASE("csp::lodbodies::TileNodeCache evicts the oldest nodes") {
+  std::size_t   nodeSize = TileNodeCache::getNodeSize(*createNode(0, 0));
+  TileNodeCache cache(nodeSize * 3);
+
+  for (int i = 0; i < 5; ++i) {
+    cache.insert(createNode(1, i));
+  }
+
+  // Only the three most recently inserted nodes fit into the budget.
+  CHECK_EQ(cache.getNodeCount(), 3);
+  CHECK_EQ(cache.getBytes(), nodeSize * 3);
+  CHECK_EQ(cache.getEvictionCount(), 2);
+  CHECK_EQ(cache.take(TileId(1, 0)), nullptr);
+  CHECK_EQ(cache.take(TileId(1, 1)), nullptr);
+  CHECK_NE(cache.take(TileId(1, 4)), nullptr);
+
+  // Reducing the budget evicts more nodes.
+  cache.setMaxBytes(nodeSize);
+  CHECK_EQ(cache.getNodeCount(), 1);
+  CHECK_NE(cache.take(TileId(1, 3)), nullptr);
+
+  // Nodes which are larger than the budget are not stored at all.
+  cache.setMaxBytes(0);
+  cache.insert(createNode(1, 5));
+  CHECK_EQ(cache.getNodeCount(), 0);
+  CHECK_EQ(cache.getBytes(), 0);
+}
+
+TEST_CASE("csp::lodbodies::TileNodeCache replaces nodes with the same id") {
+  std::size_t   nodeSize = TileNodeCache::getNodeSize(*createNode(0, 0));
+  TileNodeCache cache(nodeSize * 3);
+
+  auto      node    = createNode(2, 7);
+  TileNode* pointer = node.get();
+
+  cache.insert(createNode(2, 7));
+  cache.insert(std::move(node));
+
+  CHECK_EQ(cache.getNodeCount(), 1);
+  CHECK_EQ(cache.getBytes(), nodeSize);
+  CHECK_EQ(cache.take(TileId(2, 7)).get(), pointer);
+}
+
+TEST_CASE("csp::lodbodies::TileNodeCache::getNodeSize") {
+  std::size_t demSize   = TileNodeCache::getNodeSize(*createNode(0, 0));
+  std::size_t colorSize = TileNodeCache::getNodeSize(
+      TileNode(std::make_unique<Tile<glm::u8vec3>>(0, 0)));
+
+  CHECK_EQ(demSize - sizeof(TileNode), TileBase::SizeX * TileBase::SizeY * sizeof(float));
+  CHECK_EQ(colorSize - sizeof(TileNode), TileBase::SizeX * TileBase::SizeY * 3);
+}
+
+} // namespace csp::lodbodies
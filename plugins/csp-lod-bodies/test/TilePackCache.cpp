@@ -0,0 +1,262 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TilePackCache.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Creates an empty temporary directory which is removed again when the object goes out of scope.
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory()
+      : mPath(boost::filesystem::temp_directory_path() /
+              boost::filesystem::unique_path("csp-lod-bodies-%%%%-%%%%-%%%%")) {
+    boost::filesystem::create_directories(mPath);
+  }
+
+  TemporaryDirectory(TemporaryDirectory const& other) = delete;
+  TemporaryDirectory(TemporaryDirectory&& other)      = delete;
+
+  TemporaryDirectory& operator=(TemporaryDirectory const& other) = delete;
+  TemporaryDirectory& operator=(TemporaryDirectory&& other) = delete;
+
+  ~TemporaryDirectory() {
+    boost::system::error_code error;
+    boost::filesystem::remove_all(mPath, error);
+  }
+
+  std::string getFile(std::string const& name) const {
+    return (mPath / name).string();
+  }
+
+ private:
+  boost::filesystem::path mPath;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string getTileData(int level, int x, int y) {
+  return std::string(100 + (x * 7 + y * 13) % 300, static_cast<char>('a' + (level + x + y) % 26));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Writes ten tiles to a new pack and returns the size of the data file.
+uint64_t createPack(std::string const& file) {
+  TilePackCache pack(file);
+  for (int i = 0; i < 10; ++i) {
+    pack.write("earth.img", 3, i, 0, getTileData(3, i, 0));
+  }
+  return pack.getDataSize();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TilePackCache::read / write") {
+  TemporaryDirectory directory;
+  TilePackCache      pack(directory.getFile("tiles.pack"));
+
+  CHECK_FALSE(pack.read("earth.dem", 0, 0, 0).has_value());
+
+  pack.write("earth.dem", 0, 0, 0, "dem");
+  pack.write("earth.img", 0, 0, 0, "img");
+  pack.write("earth.dem", 1, 0, 0, "");
+
+  CHECK_EQ(pack.read("earth.dem", 0, 0, 0).value_or("missing"), "dem");
+  CHECK_EQ(pack.read("earth.img", 0, 0, 0).value_or("missing"), "img");
+  CHECK_EQ(pack.read("earth.dem", 1, 0, 0).value_or("missing"), "");
+  CHECK_FALSE(pack.read("earth.dem", 0, 1, 0).has_value());
+  CHECK_FALSE(pack.read("mars.dem", 0, 0, 0).has_value());
+
+  // Overwriting a tile appends the new data, the index points to the latest version.
+  pack.write("earth.dem", 0, 0, 0, "new dem");
+  CHECK_EQ(pack.read("earth.dem", 0, 0, 0).value_or("missing"), "new dem");
+  CHECK_EQ(pack.getTileCount(), 3);
+}
+
+TEST_CASE("csp::lodbodies::TilePackCache persistence and index growth") {
+  TemporaryDirectory directory;
+  std::string        file = directory.getFile("tiles.pack");
+
+  // This is more than the initial capacity of the index, so it has to grow a couple of times.
+  int const size = 64;
+
+  {
+    TilePackCache pack(file);
+    for (int x = 0; x < size; ++x) {
+      for (int y = 0; y < size; ++y) {
+        pack.write("earth.dem", 6, x, y, getTileData(6, x, y));
+      }
+    }
+    CHECK_EQ(pack.getTileCount(), size * size);
+  }
+
+  TilePackCache pack(file);
+  CHECK_EQ(pack.getTileCount(), size * size);
+
+  bool allEqual = true;
+  for (int x = 0; x < size; ++x) {
+    for (int y = 0; y < size; ++y) {
+      allEqual = allEqual && pack.read("earth.dem", 6, x, y) == getTileData(6, x, y);
+    }
+  }
+  CHECK_UNARY(allEqual);
+}
+
+TEST_CASE("csp::lodbodies::TilePackCache rebuilds a missing index") {
+  TemporaryDirectory directory;
+  std::string        file = directory.getFile("tiles.pack");
+
+  createPack(file);
+  boost::filesystem::remove(file + ".index");
+
+  TilePackCache pack(file);
+  CHECK_EQ(pack.getTileCount(), 10);
+  CHECK_EQ(pack.read("earth.img", 3, 9, 0).value_or("missing"), getTileData(3, 9, 0));
+}
+
+TEST_CASE("csp::lodbodies::TilePackCache discards incomplete records") {
+  TemporaryDirectory directory;
+  std::string        file      = directory.getFile("tiles.pack");
+  uint64_t           validSize = createPack(file);
+
+  // Simulate a crash while writing a record: The data file contains a part of the record, but the
+  // index has not been updated.
+  {
+    std::ofstream stream(file, std::ios::binary | std::ios::app);
+    stream << "TILE partial record";
+  }
+
+  TilePackCache pack(file);
+  CHECK_EQ(pack.getTileCount(), 10);
+  CHECK_EQ(pack.getDataSize(), validSize);
+  CHECK_EQ(pack.read("earth.img", 3, 0, 0).value_or("missing"), getTileData(3, 0, 0));
+
+  // New tiles are appended directly after the last valid record.
+  pack.write("earth.img", 3, 10, 0, getTileData(3, 10, 0));
+  CHECK_EQ(pack.read("earth.img", 3, 10, 0).value_or("missing"), getTileData(3, 10, 0));
+}
+
+TEST_CASE("csp::lodbodies::TilePackCache discards corrupt records") {
+  TemporaryDirectory directory;
+  std::string        file      = directory.getFile("tiles.pack");
+  uint64_t           validSize = createPack(file);
+
+  // Modify the payload of the last record and remove the index. When the index is rebuilt, the
+  // checksum of the last record does not match anymore.
+  {
+    std::fstream stream(file, std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(static_cast<std::streamoff>(validSize - 1));
+    stream.put('#');
+  }
+  boost::filesystem::remove(file + ".index");
+
+  TilePackCache pack(file);
+  CHECK_EQ(pack.getTileCount(), 9);
+  CHECK_FALSE(pack.read("earth.img", 3, 9, 0).has_value());
+  CHECK_EQ(pack.read("earth.img", 3, 8, 0).value_or("missing"), getTileData(3, 8, 0));
+}
+
+#ifndef _WIN32
+TEST_CASE("csp::lodbodies::TilePackCache cannot be opened by two processes") {
+  TemporaryDirectory directory;
+
+  {
+    TilePackCache pack(directory.getFile("tiles.pack"));
+
+    // The child process reports with its exit code whether opening the pack failed. It must not
+    // run any doctest code and does not clean up.
+    pid_t child = fork();
+    if (child == 0) {
+      try {
+        TilePackCache other(directory.getFile("tiles.pack"));
+        std::_Exit(0);
+      } catch (std::runtime_error const&) {
+        std::_Exit(1);
+      }
+    }
+
+    int status = 0;
+    REQUIRE_EQ(waitpid(child, &status, 0), child);
+    CHECK_UNARY(WIFEXITED(status));
+    CHECK_EQ(WEXITSTATUS(status), 1);
+  }
+
+  // The lock is released when the pack is closed.
+  CHECK_NOTHROW(TilePackCache(directory.getFile("tiles.pack")));
+}
+#endif
+
+TEST_CASE("csp::lodbodies::TilePackCache concurrent access") {
+  TemporaryDirectory directory;
+  auto               pack = TilePackCache::open(directory.getFile("tiles.pack"));
+
+  // The same file always results in the same instance.
+  CHECK_EQ(pack, TilePackCache::open(directory.getFile("tiles.pack")));
+
+  int const tileCount = 2000;
+
+  for (int i = 0; i < tileCount / 2; ++i) {
+    pack->write("earth.dem", 10, i, 0, getTileData(10, i, 0));
+  }
+
+  // Several threads read the tiles written so far while another thread appends new tiles.
+  std::atomic<bool> failed{false};
+  std::atomic<int>  written{tileCount / 2};
+
+  std::thread writer([&]() {
+    for (int i = tileCount / 2; i < tileCount; ++i) {
+      pack->write("earth.dem", 10, i, 0, getTileData(10, i, 0));
+      ++written;
+    }
+  });
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&, t]() {
+      for (int j = 0; j < tileCount * 2; ++j) {
+        int  i    = (j * 31 + t) % written.load();
+        auto data = pack->read("earth.dem", 10, i, 0);
+        if (data != getTileData(10, i, 0)) {
+          failed = true;
+        }
+      }
+    });
+  }
+
+  writer.join();
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  CHECK_FALSE(failed.load());
+  CHECK_EQ(pack->getTileCount(), tileCount);
+}
+
+} // namespace csp::lodbodies
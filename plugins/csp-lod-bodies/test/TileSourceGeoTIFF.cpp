@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TileSourceGeoTIFF.hpp"
+
+#include "../src/TileNode.hpp"
+#include "TestGeoTIFF.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TileSourceGeoTIFF") {
+  TemporaryGeoTIFF  file;
+  TileSourceGeoTIFF source(2);
+  source.setDataType(TileDataType::eFloat32);
+
+  SUBCASE("Tiles are loaded from the file") {
+    source.setFile(file.getFile());
+
+    std::unique_ptr<TileNode> node(source.loadTile(0, 0));
+    CHECK(node != nullptr);
+  }
+
+  SUBCASE("Tiles are read from the area of the file") {
+    source.setFile(file.getFile());
+
+    std::vector<float> pixels(257 * 257);
+
+    // The raster covers exactly the area of the base patch.
+    source.readData(0, 0, 0, pixels.data());
+    CHECK(pixels[128 * 257 + 128] == doctest::Approx(5.F));
+
+    // This tile is not covered by the raster at all.
+    source.readData(1, 2, 2, pixels.data());
+    CHECK(std::all_of(pixels.begin(), pixels.end(), [](float pixel) { return pixel == 0.F; }));
+  }
+
+  SUBCASE("Tiles are loaded asynchronously") {
+    source.setFile(file.getFile());
+
+    std::mutex              mutex;
+    std::condition_variable loaded;
+    bool                    done = false;
+    TileNode*               node = nullptr;
+
+    auto token = std::make_shared<cs::utils::CancellationToken>();
+
+    source.loadTileAsync(
+        0, 0,
+        [&](TileSource* /*source*/, int /*level*/, glm::int64 /*patchIdx*/, TileNode* result) {
+          std::unique_lock<std::mutex> lock(mutex);
+          node = result;
+          done = true;
+          loaded.notify_one();
+        },
+        token);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    loaded.wait(lock, [&done]() { return done; });
+
+    std::unique_ptr<TileNode> owner(node);
+    CHECK(owner != nullptr);
+  }
+
+  SUBCASE("Missing files result in failed tiles") {
+    source.setFile(file.getFile() + ".missing");
+
+    std::unique_ptr<TileNode> node(source.loadTile(0, 0));
+    CHECK(node == nullptr);
+
+    std::vector<float> pixels(257 * 257);
+    CHECK_THROWS_AS(source.readData(0, 0, 0, pixels.data()), std::runtime_error);
+  }
+
+  SUBCASE("Sources are compared by file, format and level") {
+    source.setFile(file.getFile());
+
+    TileSourceGeoTIFF other(4);
+    other.setDataType(TileDataType::eFloat32);
+    other.setFile(file.getFile());
+    CHECK(source.isSame(&other));
+
+    other.setMaxLevel(source.getMaxLevel() + 1);
+    CHECK_FALSE(source.isSame(&other));
+
+    other.setMaxLevel(source.getMaxLevel());
+    other.setDataType(TileDataType::eU8Vec3);
+    CHECK_FALSE(source.isSame(&other));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,298 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TileSourceProcedural.hpp"
+
+#include "../src/HEALPix.hpp"
+#include "../src/MinMaxPyramid.hpp"
+#include "../src/TestTileVisitor.hpp"
+#include "../src/Tile.hpp"
+#include "../src/TileNode.hpp"
+#include "../src/TileQuadTree.hpp"
+#include "Benchmark.hpp"
+
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<TileNode> load(TileSourceProcedural& source, int level, glm::int64 patchIdx) {
+  return std::unique_ptr<TileNode>(source.loadTile(level, patchIdx));
+}
+
+float const* getHeights(TileNode const* node) {
+  return node->getTile()->getTypedPtr<float>();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Loads tiles synchronously until the TestTileVisitor does not request any more tiles. Returns
+// the number of inserted tiles.
+std::size_t buildTrees(TestTileVisitor& visitor, TileSourceProcedural& sourceDEM,
+    TileSourceProcedural& sourceIMG) {
+  std::size_t count = 0;
+
+  for (visitor.visit();
+       !visitor.getLoadTilesDEM().empty() || !visitor.getLoadTilesIMG().empty();
+       visitor.visit()) {
+    for (auto const& id : visitor.getLoadTilesDEM()) {
+      TileNode* node = sourceDEM.loadTile(id.level(), id.patchIdx());
+      REQUIRE(node != nullptr);
+      REQUIRE(insertNode(visitor.getTreeDEM(), node));
+      ++count;
+    }
+
+    for (auto const& id : visitor.getLoadTilesIMG()) {
+      TileNode* node = sourceIMG.loadTile(id.level(), id.patchIdx());
+      REQUIRE(node != nullptr);
+      REQUIRE(insertNode(visitor.getTreeIMG(), node));
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Loads tiles asynchronously until the TestTileVisitor does not request any more tiles. Failed
+// tiles are requested again by the next traversal.
+void buildTreeAsync(TestTileVisitor& visitor, TileSourceProcedural& source) {
+  std::mutex                 mutex;
+  std::vector<TileNode*>     loaded;
+  std::unordered_set<TileId> pending;
+
+  auto token = std::make_shared<cs::utils::CancellationToken>();
+
+  auto onLoad = [&](TileSource* /*source*/, int level, glm::int64 patchIdx, TileNode* node) {
+    std::unique_lock<std::mutex> lock(mutex);
+    pending.erase(TileId(level, patchIdx));
+
+    if (node) {
+      loaded.push_back(node);
+    }
+  };
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      for (auto* node : loaded) {
+        insertNode(visitor.getTreeDEM(), node);
+      }
+
+      loaded.clear();
+      visitor.visit();
+
+      if (visitor.getLoadTilesDEM().empty()) {
+        break;
+      }
+
+      for (auto const& id : visitor.getLoadTilesDEM()) {
+        if (pending.insert(id).second) {
+          source.loadTileAsync(id.level(), id.patchIdx(), onLoad, token);
+        }
+      }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TileSourceProcedural") {
+  TileSourceProcedural source(2);
+  source.setOctaves(4);
+
+  SUBCASE("Tiles are deterministic") {
+    TileSourceProcedural other(2);
+    other.setOctaves(4);
+
+    auto a = load(source, 3, 123);
+    auto b = load(other, 3, 123);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+
+    CHECK(std::equal(getHeights(a.get()), getHeights(a.get()) + 257 * 257, getHeights(b.get())));
+
+    other.setSeed(1);
+    auto c = load(other, 3, 123);
+    CHECK(!std::equal(getHeights(a.get()), getHeights(a.get()) + 257 * 257, getHeights(c.get())));
+  }
+
+  SUBCASE("Neighbouring tiles share their edges") {
+    auto const&  level = HEALPix::getLevel(2);
+    glm::i64vec3 bxy(5, 1, 2);
+
+    auto a = load(source, 2, level.getPatchIdx(bxy));
+    auto b = load(source, 2, level.getPatchIdx(bxy + glm::i64vec3(0, 1, 0)));
+    auto c = load(source, 2, level.getPatchIdx(bxy + glm::i64vec3(0, 0, 1)));
+
+    int mismatches = 0;
+    for (int i = 0; i < 257; ++i) {
+      // The first index runs along the x direction of the base patch.
+      if (getHeights(a.get())[i * 257 + 256] != doctest::Approx(getHeights(b.get())[i * 257])) {
+        ++mismatches;
+      }
+      if (getHeights(a.get())[256 * 257 + i] != doctest::Approx(getHeights(c.get())[i])) {
+        ++mismatches;
+      }
+    }
+
+    CHECK(mismatches == 0);
+  }
+
+  SUBCASE("Elevation tiles have heights and a MinMaxPyramid") {
+    source.setAmplitude(1000.0);
+    auto node = load(source, 0, 4);
+
+    REQUIRE(node != nullptr);
+    CHECK(node->getTileDataType() == TileDataType::eFloat32);
+    REQUIRE(node->getTile()->getMinMaxPyramid() != nullptr);
+
+    float min = node->getTile()->getMinMaxPyramid()->getMin();
+    float max = node->getTile()->getMinMaxPyramid()->getMax();
+    CHECK(min >= -1000.F);
+    CHECK(max <= 1000.F);
+    CHECK(min < max);
+  }
+
+  SUBCASE("Image tiles") {
+    source.setDataType(TileDataType::eU8Vec3);
+    auto node = load(source, 1, 17);
+
+    REQUIRE(node != nullptr);
+    CHECK(node->getTileDataType() == TileDataType::eU8Vec3);
+  }
+
+  SUBCASE("Failures") {
+    source.setFailureRate(1.0);
+    CHECK(load(source, 0, 0) == nullptr);
+    CHECK(source.getFailedTileCount() == 1);
+    CHECK(source.getGeneratedTileCount() == 0);
+
+    source.setFailureRate(0.0);
+    CHECK(load(source, 0, 0) != nullptr);
+    CHECK(source.getFailedTileCount() == 1);
+    CHECK(source.getGeneratedTileCount() == 1);
+  }
+
+  SUBCASE("Cancelled requests do not wait for the latency") {
+    source.setLatency(10000.0);
+
+    auto                    token = std::make_shared<cs::utils::CancellationToken>();
+    std::mutex              mutex;
+    std::condition_variable done;
+    bool                    called = false;
+    TileNode*               result = nullptr;
+
+    auto start = std::chrono::steady_clock::now();
+
+    source.loadTileAsync(
+        0, 0,
+        [&](TileSource* /*source*/, int /*level*/, glm::int64 /*patchIdx*/, TileNode* node) {
+          std::unique_lock<std::mutex> lock(mutex);
+          called = true;
+          result = node;
+          done.notify_one();
+        },
+        token);
+
+    token->cancel();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]() { return called; });
+
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    CHECK(result == nullptr);
+    CHECK(seconds < 5.0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TestTileVisitor completes trees from a TileSourceProcedural") {
+  TileSourceProcedural sourceDEM(1);
+  TileSourceProcedural sourceIMG(1);
+  sourceDEM.setOctaves(2);
+  sourceIMG.setOctaves(2);
+  sourceIMG.setDataType(TileDataType::eU8Vec3);
+
+  TileQuadTree    treeDEM;
+  TileQuadTree    treeIMG;
+  TestTileVisitor visitor(&treeDEM, &treeIMG);
+  visitor.setMaxLevel(1);
+
+  // Twelve root tiles with four children each in both trees.
+  CHECK(buildTrees(visitor, sourceDEM, sourceIMG) == 2 * (12 + 48));
+
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    REQUIRE(treeDEM.getRoot(i) != nullptr);
+    REQUIRE(treeIMG.getRoot(i) != nullptr);
+
+    for (int c = 0; c < 4; ++c) {
+      CHECK(treeDEM.getRoot(i)->getChild(c) != nullptr);
+      CHECK(treeIMG.getRoot(i)->getChild(c) != nullptr);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TileSourceProcedural [benchmark]") {
+  int const tiles = 20;
+
+  for (int octaves : {1, 4, 8}) {
+    TileSourceProcedural source(1);
+    source.setOctaves(octaves);
+
+    std::string const name = std::to_string(octaves) + " octaves";
+
+    benchmark(name.c_str(), tiles, "tile", [&]() {
+      for (int i = 0; i < tiles; ++i) {
+        load(source, 5, i * 541);
+      }
+    });
+  }
+
+  // Build a complete tree of level 2 with simulated network delays and failures.
+  TileSourceProcedural source(4);
+  source.setOctaves(4);
+  source.setLatency(20.0);
+  source.setFailureRate(0.1);
+
+  TileQuadTree    tree;
+  TestTileVisitor visitor(&tree);
+
+  double   time     = measureTime([&]() { buildTreeAsync(visitor, source); });
+  uint64_t failures = source.getFailedTileCount();
+  MESSAGE("Asynchronous tree of level 2: " << time << " ms, " << failures << " failed requests");
+
+  CHECK(source.getGeneratedTileCount() == 12 * (1 + 4 + 16));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
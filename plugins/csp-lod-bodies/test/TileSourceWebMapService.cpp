@@ -0,0 +1,586 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/FetchEngine.hpp"
+#include "../src/Tile.hpp"
+#include "../src/TileNode.hpp"
+#include "../src/TileSourceWebMapService.hpp"
+#include "Benchmark.hpp"
+
+#include "../../../src/cs-utils/ThreadPool.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A minimal HTTP/1.1 server which answers every request with a fake tile after a configurable
+// delay. Connections are kept alive. It counts the accepted connections and the handled requests.
+// If the layers parameter of a request is "error", a WMS exception document is returned instead. If
+// it is "busy", the server responds with status 503 and an HTML page.
+class MockWebMapService {
+ public:
+  explicit MockWebMapService(std::chrono::microseconds latency, size_t threads = 4)
+      : mAcceptor(mIOContext, boost::asio::ip::tcp::endpoint(
+                                  boost::asio::ip::address_v4::loopback(), 0))
+      , mLatency(latency)
+      , mTile(257 * 257 * 3, '\0') {
+
+    for (size_t i = 0; i < mTile.size(); ++i) {
+      mTile[i] = static_cast<char>(i * 7);
+    }
+
+    accept();
+
+    for (size_t i = 0; i < threads; ++i) {
+      mThreads.emplace_back([this] { mIOContext.run(); });
+    }
+  }
+
+  MockWebMapService(MockWebMapService const& other) = delete;
+  MockWebMapService(MockWebMapService&& other)      = delete;
+
+  MockWebMapService& operator=(MockWebMapService const& other) = delete;
+  MockWebMapService& operator=(MockWebMapService&& other) = delete;
+
+  ~MockWebMapService() {
+    mIOContext.stop();
+
+    for (auto& thread : mThreads) {
+      thread.join();
+    }
+  }
+
+  uint16_t getPort() const {
+    return mAcceptor.local_endpoint().port();
+  }
+
+  std::string getUrl() const {
+    return "http://127.0.0.1:" + std::to_string(getPort()) + "/wms?SERVICE=wms";
+  }
+
+  std::string const& getTile() const {
+    return mTile;
+  }
+
+  /// Changes the data which is sent for each request. This must not be called while requests are
+  /// being processed.
+  void setTile(std::string tile) {
+    mTile = std::move(tile);
+  }
+
+  uint32_t getConnectionCount() const {
+    return mConnections;
+  }
+
+  uint32_t getRequestCount() const {
+    return mRequests;
+  }
+
+  uint32_t getMaxConcurrentRequests() const {
+    return mMaxConcurrentRequests;
+  }
+
+ private:
+  struct Session : std::enable_shared_from_this<Session> {
+    Session(MockWebMapService& server, boost::asio::ip::tcp::socket socket)
+        : mServer(server)
+        , mSocket(std::move(socket))
+        , mTimer(server.mIOContext) {
+    }
+
+    void read() {
+      auto self = shared_from_this();
+      boost::asio::async_read_until(mSocket, mBuffer, "\r\n\r\n",
+          [self](boost::system::error_code error, size_t length) {
+            if (!error) {
+              self->respond(length);
+            }
+          });
+    }
+
+    void respond(size_t length) {
+      auto        begin = boost::asio::buffers_begin(mBuffer.data());
+      std::string request(begin, begin + static_cast<std::ptrdiff_t>(length));
+      mBuffer.consume(length);
+
+      // The request is counted before it is answered, so that the client never sees a response
+      // to a request which has not been counted yet.
+      ++mServer.mRequests;
+
+      uint32_t concurrent = ++mServer.mConcurrentRequests;
+      uint32_t maximum    = mServer.mMaxConcurrentRequests;
+      while (concurrent > maximum &&
+             !mServer.mMaxConcurrentRequests.compare_exchange_weak(maximum, concurrent)) {
+      }
+
+      bool        error  = request.find("layers=error&") != std::string::npos;
+      bool        busy   = request.find("layers=busy&") != std::string::npos;
+      std::string status = busy ? "503 Service Unavailable" : "200 OK";
+      std::string type   = error ? "application/vnd.ogc.se_xml" : busy ? "text/html" : "image/png";
+      mBody              = error  ? "<ServiceExceptionReport>Mock error</ServiceExceptionReport>"
+                           : busy ? "<html><body>Try again later</body></html>"
+                                  : mServer.mTile;
+
+      std::ostringstream header;
+      header << "HTTP/1.1 " << status << "\r\nContent-Type: " << type
+             << "\r\nContent-Length: " << mBody.size() << "\r\nConnection: keep-alive\r\n\r\n";
+      mHeader = header.str();
+
+      auto self = shared_from_this();
+      mTimer.expires_after(mServer.mLatency);
+      mTimer.async_wait([self](boost::system::error_code /*error*/) {
+        std::array<boost::asio::const_buffer, 2> buffers = {
+            boost::asio::buffer(self->mHeader), boost::asio::buffer(self->mBody)};
+
+        boost::asio::async_write(self->mSocket, buffers,
+            [self](boost::system::error_code error, size_t /*length*/) {
+              --self->mServer.mConcurrentRequests;
+
+              if (!error) {
+                self->read();
+              }
+            });
+      });
+    }
+
+    MockWebMapService&           mServer;
+    boost::asio::ip::tcp::socket mSocket;
+    boost::asio::steady_timer    mTimer;
+    boost::asio::streambuf       mBuffer;
+    std::string                  mHeader;
+    std::string                  mBody;
+  };
+
+  void accept() {
+    mAcceptor.async_accept(
+        [this](boost::system::error_code error, boost::asio::ip::tcp::socket socket) {
+          if (!error) {
+            ++mConnections;
+            std::make_shared<Session>(*this, std::move(socket))->read();
+            accept();
+          }
+        });
+  }
+
+  boost::asio::io_context        mIOContext;
+  boost::asio::ip::tcp::acceptor mAcceptor;
+  std::vector<std::thread>       mThreads;
+
+  std::chrono::microseconds mLatency;
+  std::string               mTile;
+
+  std::atomic<uint32_t> mConnections{0};
+  std::atomic<uint32_t> mRequests{0};
+  std::atomic<uint32_t> mConcurrentRequests{0};
+  std::atomic<uint32_t> mMaxConcurrentRequests{0};
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string getTileUrl(MockWebMapService const& server, int i) {
+  return server.getUrl() + "&request=GetMap&layers=test&bbox=" + std::to_string(i);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t writeCallback(char* data, size_t size, size_t count, void* userData) {
+  static_cast<std::string*>(userData)->append(data, size * count);
+  return size * count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct BenchmarkResult {
+  double   mTilesPerSecond = 0.0;
+  double   mMedianLatency  = 0.0; ///< in ms from the request until the tile is available
+  uint32_t mConnections    = 0;
+};
+
+// Downloads tileCount tiles with the given number of threads. This is how TileSourceWebMapService
+// used to work: Each thread creates a new curl handle - and therefore a new connection - per tile.
+BenchmarkResult runLegacyBenchmark(
+    size_t tileCount, size_t threads, std::chrono::microseconds latency) {
+  using Clock = std::chrono::steady_clock;
+
+  MockWebMapService     server(latency);
+  cs::utils::ThreadPool pool(threads);
+
+  std::vector<double>            latencies(tileCount);
+  std::vector<std::future<void>> futures;
+
+  double duration = measureTime<std::ratio<1>>([&]() {
+    for (size_t i = 0; i < tileCount; ++i) {
+      auto requested = Clock::now();
+      futures.push_back(pool.enqueue([&server, &latencies, requested, i]() {
+        std::string body;
+        std::string url = getTileUrl(server, static_cast<int>(i));
+
+        CURL* handle = curl_easy_init();
+        curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &writeCallback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &body);
+        curl_easy_perform(handle);
+        curl_easy_cleanup(handle);
+
+        latencies[i] = std::chrono::duration<double, std::milli>(Clock::now() - requested).count();
+      }));
+    }
+
+    for (auto& f : futures) {
+      f.get();
+    }
+  });
+
+  std::sort(latencies.begin(), latencies.end());
+
+  BenchmarkResult result;
+  result.mTilesPerSecond = static_cast<double>(tileCount) / duration;
+  result.mMedianLatency  = latencies[tileCount / 2];
+  result.mConnections    = server.getConnectionCount();
+  return result;
+}
+
+// Downloads tileCount tiles with a FetchEngine which runs up to maxRequests transfers in parallel.
+BenchmarkResult runEngineBenchmark(
+    size_t tileCount, uint32_t maxRequests, std::chrono::microseconds latency) {
+  using Clock = std::chrono::steady_clock;
+
+  MockWebMapService server(latency);
+  FetchEngine       engine(maxRequests);
+
+  std::vector<Clock::time_point>                  requested(tileCount);
+  std::vector<std::future<FetchEngine::Response>> futures;
+  std::vector<double>                             latencies(tileCount);
+
+  double duration = measureTime<std::ratio<1>>([&]() {
+    for (size_t i = 0; i < tileCount; ++i) {
+      requested[i] = Clock::now();
+      futures.push_back(engine.fetch(getTileUrl(server, static_cast<int>(i))));
+    }
+
+    // The futures are completed roughly in order, so waiting for them in order gives a good
+    // estimate of the latency.
+    for (size_t i = 0; i < tileCount; ++i) {
+      futures[i].get();
+      latencies[i] = std::chrono::duration<double, std::milli>(Clock::now() - requested[i]).count();
+    }
+  });
+
+  std::sort(latencies.begin(), latencies.end());
+
+  BenchmarkResult result;
+  result.mTilesPerSecond = static_cast<double>(tileCount) / duration;
+  result.mMedianLatency  = latencies[tileCount / 2];
+  result.mConnections    = server.getConnectionCount();
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Creates a PNG image with some smooth structures and some noise, the compression ratio is similar
+// to real imagery.
+std::string createPNGTile() {
+  std::vector<uint8_t> pixels(257 * 257 * 3);
+  uint32_t             random = 42;
+
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    random    = random * 1664525U + 1013904223U;
+    auto x    = static_cast<double>(i / 3 % 257);
+    auto y    = static_cast<double>(i / 3 / 257);
+    pixels[i] = static_cast<uint8_t>(
+        100.0 + 60.0 * std::sin(x * 0.05 + static_cast<double>(i % 3)) * std::cos(y * 0.07) +
+        static_cast<double>(random >> 28U));
+  }
+
+  std::string png;
+  stbi_write_png_to_func(
+      [](void* context, void* data, int size) {
+        static_cast<std::string*>(context)->append(static_cast<char*>(data), size);
+      },
+      &png, 257, 257, 3, pixels.data(), 257 * 3);
+
+  return png;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Loads the given number of level-three tiles twice and returns the average time in milliseconds
+// per tile of the second pass. The first pass downloads the tiles and fills the caches.
+double runDecodedCacheBenchmark(int tileCount, bool useDecodedCache) {
+  MockWebMapService server(std::chrono::microseconds(0));
+  server.setTile(createPNGTile());
+
+  auto cache = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+  double duration = 0.0;
+
+  {
+    TileSourceWebMapService source;
+    source.setUrl(server.getUrl());
+    source.setCacheDirectory(cache.string());
+    source.setLayers("benchmark");
+    source.setDataType(TileDataType::eU8Vec3);
+    source.setUseDecodedCache(useDecodedCache);
+
+    for (int i = 0; i < tileCount; ++i) {
+      delete source.loadTile(3, i); // NOLINT(cppcoreguidelines-owning-memory)
+    }
+
+    duration = measureTime([&]() {
+      for (int i = 0; i < tileCount; ++i) {
+        delete source.loadTile(3, i); // NOLINT(cppcoreguidelines-owning-memory)
+      }
+    });
+  }
+
+  boost::filesystem::remove_all(cache);
+
+  return duration / tileCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::FetchEngine::fetch") {
+  MockWebMapService server(std::chrono::microseconds(0));
+  FetchEngine       engine(4);
+
+  std::vector<std::future<FetchEngine::Response>> futures;
+
+  for (int i = 0; i < 100; ++i) {
+    futures.push_back(engine.fetch(getTileUrl(server, i)));
+  }
+
+  for (auto& f : futures) {
+    auto response = f.get();
+    CHECK_UNARY(response.mError.empty());
+    CHECK_EQ(response.mStatus, 200);
+    CHECK_EQ(response.mContentType, "image/png");
+    CHECK_UNARY(response.mBody == server.getTile());
+  }
+
+  CHECK_EQ(server.getRequestCount(), 100);
+  CHECK_EQ(engine.getPendingRequests(), 0);
+}
+
+TEST_CASE("csp::lodbodies::FetchEngine reuses connections") {
+  MockWebMapService server(std::chrono::microseconds(1000));
+  FetchEngine       engine(4);
+
+  std::vector<std::future<FetchEngine::Response>> futures;
+
+  for (int i = 0; i < 200; ++i) {
+    futures.push_back(engine.fetch(getTileUrl(server, i)));
+  }
+
+  for (auto& f : futures) {
+    CHECK_UNARY(f.get().mError.empty());
+  }
+
+  CHECK_EQ(server.getRequestCount(), 200);
+  CHECK_LE(server.getConnectionCount(), 4);
+  CHECK_LE(server.getMaxConcurrentRequests(), 4);
+}
+
+TEST_CASE("csp::lodbodies::FetchEngine reports errors") {
+  uint16_t port = 0;
+
+  // Get a port where nobody is listening.
+  {
+    MockWebMapService server(std::chrono::microseconds(0));
+    port = server.getPort();
+  }
+
+  FetchEngine engine(4);
+  auto        response = engine.fetch("http://127.0.0.1:" + std::to_string(port) + "/wms").get();
+
+  CHECK_FALSE(response.mError.empty());
+  CHECK_EQ(response.mStatus, 0);
+}
+
+TEST_CASE("csp::lodbodies::TileSourceWebMapService::loadData") {
+  MockWebMapService server(std::chrono::microseconds(0));
+
+  auto cache = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+  TileSourceWebMapService source;
+  source.setUrl(server.getUrl());
+  source.setCacheDirectory(cache.string());
+  source.setLayers("test");
+
+  SUBCASE("Tiles are downloaded and cached") {
+    CHECK_UNARY(source.loadData(2, 1, 3) == server.getTile());
+    CHECK_EQ(server.getRequestCount(), 1);
+
+    std::ifstream     in((cache / "test/2/1/3.png").string(), std::ifstream::binary);
+    std::stringstream content;
+    content << in.rdbuf();
+    CHECK_UNARY(content.str() == server.getTile());
+
+    CHECK_UNARY(source.loadData(2, 1, 3) == server.getTile());
+    CHECK_EQ(server.getRequestCount(), 1);
+
+    // No temporary files are left behind.
+    auto files = std::distance(boost::filesystem::directory_iterator(cache / "test/2/1"),
+        boost::filesystem::directory_iterator());
+    CHECK_EQ(files, 1);
+  }
+
+  SUBCASE("Cached tiles are reported") {
+    CHECK_FALSE(source.isCached(2, 1, 3));
+    source.loadData(2, 1, 3);
+    CHECK_UNARY(source.isCached(2, 1, 3));
+    CHECK_FALSE(source.isCached(2, 1, 4));
+
+    // Empty files are considered corrupt by loadData().
+    boost::filesystem::create_directories(cache / "test/2/1");
+    std::ofstream empty((cache / "test/2/1/4.png").string());
+    CHECK_FALSE(source.isCached(2, 1, 4));
+
+    source.setUseCachePack(true);
+    CHECK_FALSE(source.isCached(2, 1, 3));
+    source.loadData(2, 1, 3);
+    CHECK_UNARY(source.isCached(2, 1, 3));
+    CHECK_EQ(server.getRequestCount(), 2);
+
+    source.setUseCachePack(false);
+  }
+
+  SUBCASE("Tiles are downloaded and cached in a pack") {
+    source.setUseCachePack(true);
+
+    CHECK_UNARY(source.loadData(2, 1, 3) == server.getTile());
+    CHECK_EQ(server.getRequestCount(), 1);
+    CHECK_UNARY(boost::filesystem::exists(cache / "tiles.pack"));
+    CHECK_FALSE(boost::filesystem::exists(cache / "test"));
+
+    CHECK_UNARY(source.loadData(2, 1, 3) == server.getTile());
+    CHECK_EQ(server.getRequestCount(), 1);
+
+    // Close the pack so that it can be removed below.
+    source.setUseCachePack(false);
+  }
+
+  SUBCASE("The cache directory is used if the pack cannot be opened") {
+    // A directory cannot be opened as pack.
+    boost::filesystem::create_directories(cache / "tiles.pack");
+    source.setUseCachePack(true);
+
+    CHECK_UNARY(source.loadData(2, 1, 3) == server.getTile());
+    CHECK_FALSE(source.getUseCachePack());
+    CHECK_UNARY(boost::filesystem::exists(cache / "test/2/1/3.png"));
+  }
+
+  SUBCASE("Service exceptions are reported") {
+    source.setLayers("error");
+    CHECK_THROWS_AS(source.loadData(2, 1, 3), std::runtime_error);
+  }
+
+  SUBCASE("Error responses are reported and not cached") {
+    source.setLayers("busy");
+    CHECK_THROWS_AS(source.loadData(2, 1, 3), std::runtime_error);
+    CHECK_FALSE(source.isCached(2, 1, 3));
+
+    source.setUseCachePack(true);
+    CHECK_THROWS_AS(source.loadData(2, 1, 3), std::runtime_error);
+    CHECK_FALSE(source.isCached(2, 1, 3));
+    CHECK_EQ(server.getRequestCount(), 2);
+
+    source.setUseCachePack(false);
+  }
+
+  boost::filesystem::remove_all(cache);
+}
+
+TEST_CASE("csp::lodbodies::TileSourceWebMapService decoded tile cache") {
+  MockWebMapService server(std::chrono::microseconds(0));
+  server.setTile(createPNGTile());
+
+  auto cache = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+  {
+    TileSourceWebMapService source;
+    source.setUrl(server.getUrl());
+    source.setCacheDirectory(cache.string());
+    source.setLayers("test");
+    source.setDataType(TileDataType::eU8Vec3);
+
+    // This tile is decoded from the PNG file.
+    std::unique_ptr<TileNode> decoded(source.loadTile(2, 17));
+    REQUIRE_UNARY(decoded != nullptr);
+
+    // The first load stores the processed tile, the second load reads it from the cache.
+    source.setUseDecodedCache(true);
+    std::unique_ptr<TileNode> stored(source.loadTile(2, 17));
+    std::unique_ptr<TileNode> cached(source.loadTile(2, 17));
+    REQUIRE_UNARY(cached != nullptr);
+
+    CHECK_UNARY(boost::filesystem::exists(cache / "decoded.pack"));
+    CHECK_EQ(server.getRequestCount(), 1);
+
+    auto const* expected = static_cast<Tile<glm::u8vec3> const*>(decoded->getTile());
+    auto const* actual   = static_cast<Tile<glm::u8vec3> const*>(cached->getTile());
+    CHECK_UNARY(expected->data() == actual->data());
+
+    // Release the pack so that it can be removed below.
+    source.setUseDecodedCache(false);
+  }
+
+  boost::filesystem::remove_all(cache);
+}
+
+TEST_CASE("csp::lodbodies::DecodedTileCache [benchmark]") {
+  int const tileCount = 200;
+
+  double decoding = runDecodedCacheBenchmark(tileCount, false);
+  double cached   = runDecodedCacheBenchmark(tileCount, true);
+
+  MESSAGE("Loading " << tileCount << " cached RGB tiles");
+  MESSAGE("Decoding PNG files:  " << decoding << " ms per tile");
+  MESSAGE("DecodedTileCache:    " << cached << " ms per tile");
+}
+
+TEST_CASE("csp::lodbodies::FetchEngine [benchmark]") {
+  size_t const tileCount = 2000;
+  auto const   latency   = std::chrono::microseconds(2000);
+
+  auto legacy = runLegacyBenchmark(tileCount, 32, latency);
+  auto engine = runEngineBenchmark(tileCount, 32, latency);
+
+  MESSAGE("Tiles: " << tileCount << ", server latency: " << latency.count() << " µs");
+  MESSAGE("One connection per tile: " << legacy.mTilesPerSecond << " tiles/s, median latency "
+                                      << legacy.mMedianLatency << " ms, " << legacy.mConnections
+                                      << " connections");
+  MESSAGE("FetchEngine:             " << engine.mTilesPerSecond << " tiles/s, median latency "
+                                      << engine.mMedianLatency << " ms, " << engine.mConnections
+                                      << " connections");
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,474 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/utils.hpp"
+
+#include "../src/FrustumCulling.hpp"
+#include "../src/HEALPix.hpp"
+#include "../src/MinMaxPyramid.hpp"
+#include "../src/PlanetParameters.hpp"
+#include "../src/RenderDataDEM.hpp"
+#include "../src/Tile.hpp"
+#include "../src/TileNode.hpp"
+#include "../src/TreeManager.hpp"
+#include "Benchmark.hpp"
+#include "TestPositions.hpp"
+
+#include "../../../src/cs-utils/convert.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// An elevation tile tree where all roots are available, but only the roots 4 and 5 are refined.
+// By default, only the children 0 and 3 of each refined node exist. Hence some queries end in
+// leaves while others have to fall back to the data of a parent node. All nodes of the refined
+// trees claim that there are children down to the given depth. Each tile has a MinMaxPyramid and
+// RenderData with its bounds, as if it had been loaded by the TreeManager. The offset is added to
+// all heights, this allows to move the terrain below the ellipsoid.
+class SyntheticTreeManager : public TreeManager<RenderDataDEM> {
+ public:
+  SyntheticTreeManager(PlanetParameters const& params, int depth,
+      std::vector<int> children = {0, 3}, float offset = 0.F)
+      : TreeManager<RenderDataDEM>(params, nullptr)
+      , mChildren(std::move(children))
+      , mOffset(offset) {
+    for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+      int rootDepth = (i == 4 || i == 5) ? depth : 0;
+      addNode(new TileNode(createTile(0, i), rootDepth), rootDepth);
+    }
+  }
+
+ private:
+  Tile<float>* createTile(int level, glm::int64 patchIdx) const {
+    auto* tile = new Tile<float>(level, patchIdx);
+
+    for (int y = 0; y < TileBase::SizeY; ++y) {
+      for (int x = 0; x < TileBase::SizeX; ++x) {
+        tile->data()[y * TileBase::SizeX + x] =
+            mOffset + static_cast<float>(level * 1000 + patchIdx % 100) +
+            0.5F * static_cast<float>(x) - 0.25F * static_cast<float>(y) +
+            100.F * std::sin(0.1F * static_cast<float>(x)) * std::sin(0.1F * static_cast<float>(y));
+      }
+    }
+
+    tile->setMinMaxPyramid(std::make_unique<MinMaxPyramid>(tile));
+
+    return tile;
+  }
+
+  void addNode(TileNode* node, int depth) {
+    insertNode(&mTree, node);
+    mRdMap.emplace(node->getTileId(), allocateRenderData(node));
+
+    if (node->getLevel() < depth) {
+      for (int i : mChildren) {
+        TileId childId = HEALPix::getChildTileId(node->getTileId(), i);
+        addNode(new TileNode(createTile(childId.level(), childId.patchIdx()), depth), depth);
+      }
+    }
+  }
+
+  std::vector<int> mChildren;
+  float            mOffset;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Creates rays which start outside of the planet and point to random positions close to its
+// surface. Most of them hit the terrain, some pass it closely.
+void createRays(std::size_t count, double radius, std::vector<glm::dvec3>& origins,
+    std::vector<glm::dvec3>& directions) {
+  std::mt19937                           engine(42);
+  std::normal_distribution<double>       normal;
+  std::uniform_real_distribution<double> altitude(-0.02, 0.1);
+
+  auto randomDirection = [&]() {
+    return glm::normalize(glm::dvec3(normal(engine), normal(engine), normal(engine)));
+  };
+
+  origins.clear();
+  directions.clear();
+
+  for (std::size_t i = 0; i < count; ++i) {
+    glm::dvec3 origin = 3.0 * radius * randomDirection();
+    glm::dvec3 target = (1.0 + altitude(engine)) * radius * randomDirection();
+
+    origins.push_back(origin);
+    directions.push_back(glm::normalize(target - origin));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The former implementation of utils::intersectPlanet(). It samples the ray in each leaf tile in
+// steps of about one sample and is used as a reference for the accelerated implementation.
+bool intersectPlanetReference(TreeManagerBase* treeMgr, glm::dvec3 const& radii, double heightScale,
+    glm::dvec3 const& origin, glm::dvec3 const& direction, glm::dvec3& pos) {
+  auto intersectBounds = [&](TileNode* node, double& minDist, double& maxDist) {
+    BoundingBox<double> bounds = treeMgr->find<RenderDataDEM>(node->getTileId())->getBounds();
+    return bounds.GetIntersectionDistance(origin, direction, true, minDist, maxDist);
+  };
+
+  std::multimap<double, TileNode*> intersectedTiles;
+
+  for (int rootIndex = 0; rootIndex < TileQuadTree::sNumRoots; ++rootIndex) {
+    TileNode* root    = treeMgr->getTree()->getRoot(rootIndex);
+    double    minDist = 0.0;
+    double    maxDist = 0.0;
+
+    if (intersectBounds(root, minDist, maxDist)) {
+      intersectedTiles.emplace(minDist, root);
+    }
+  }
+
+  while (!intersectedTiles.empty()) {
+    TileNode* node = intersectedTiles.begin()->second;
+    intersectedTiles.erase(intersectedTiles.begin());
+
+    double minDist = 0.0;
+    double maxDist = 0.0;
+
+    if (isRefined(*node)) {
+      for (int childIndex = 0; childIndex < 4; ++childIndex) {
+        TileNode* child = node->getChild(childIndex);
+
+        if (intersectBounds(child, minDist, maxDist) && maxDist > 0.0) {
+          intersectedTiles.emplace(minDist, child);
+        }
+      }
+
+      continue;
+    }
+
+    intersectBounds(node, minDist, maxDist);
+    minDist = std::max(0.0, minDist);
+
+    glm::dvec3 entry     = origin + direction * minDist;
+    glm::dvec3 sampleDir = direction * (maxDist - minDist);
+
+    BoundingBox<double> bounds   = treeMgr->find<RenderDataDEM>(node->getTileId())->getBounds();
+    double const        maxSteps = 2.0 * 255.0 * std::sqrt(2.0);
+    double const        stepNr =
+        glm::length(sampleDir) / glm::length(bounds.getMax() - bounds.getMin()) * maxSteps;
+
+    int const        base       = HEALPix::getBasePatch(node->getTileId());
+    glm::dvec3 const scale      = HEALPix::getPatchOffsetScale(node->getTileId());
+    float const*     data       = node->getTile()->getTypedPtr<float>();
+    int const        sizeX      = TileBase::SizeX;
+    int const        sizeY      = TileBase::SizeY;
+    bool             first      = true;
+    double           height     = 0.0;
+    double           lastHeight = 0.0;
+    double           altitude   = 0.0;
+    glm::dvec3       sample{};
+    glm::dvec3       lastSample{};
+
+    for (int step = 0; step <= static_cast<int>(stepNr); ++step) {
+      double lastAltitude = altitude;
+      lastSample          = sample;
+      lastHeight          = height;
+
+      sample = entry + (step / stepNr) * sampleDir;
+
+      glm::dvec3 lngLatHeight = cs::utils::convert::cartesianToLngLatHeight(sample, radii);
+      glm::dvec2 relative =
+          (HEALPix::convertBaseLngLat2XY(base, glm::dvec2(lngLatHeight)) - glm::dvec2(scale)) /
+          scale.z;
+
+      altitude = lngLatHeight.z;
+
+      double u  = relative.y * (sizeX - 1);
+      double v  = relative.x * (sizeY - 1);
+      int    uB = static_cast<int>(std::floor(u));
+      int    vB = static_cast<int>(std::floor(v));
+
+      if (uB >= sizeX - 1 || uB < 0 || vB >= sizeY - 1 || vB < 0) {
+        continue;
+      }
+
+      double uP = u - uB;
+      double vP = v - vB;
+
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      double h00 = data[vB + sizeY * uB];
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      double h01 = data[vB + sizeY * (uB + 1)];
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      double h10 = data[vB + 1 + sizeY * uB];
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      double h11 = data[vB + 1 + sizeY * (uB + 1)];
+
+      height = heightScale *
+               ((1.0 - vP) * ((1.0 - uP) * h00 + uP * h01) + vP * ((1.0 - uP) * h10 + uP * h11));
+
+      if (altitude < height) {
+        if (first) {
+          break;
+        }
+
+        double lastWeight = lastAltitude - lastHeight;
+        double curWeight  = height - altitude;
+        double sum        = lastWeight + curWeight;
+
+        pos = lastSample * (1.0 - lastWeight / sum) + sample * (1.0 - curWeight / sum);
+        return true;
+      }
+
+      first = false;
+    }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::utils::getHeights matches getHeight") {
+  PlanetParameters     params;
+  SyntheticTreeManager treeMgr(params, 3);
+  auto const           lngLats = createLngLats(10000);
+
+  // All available implementations of the interpolation have to match the scalar one.
+  bool const useAVX2 = utils::getUseInterpolationAVX2();
+  CHECK_EQ(useAVX2, isCullingAVX2Supported());
+
+  std::vector<bool> implementations = {false};
+  if (isCullingAVX2Supported()) {
+    implementations.push_back(true);
+  }
+
+  for (bool avx2 : implementations) {
+    utils::setUseInterpolationAVX2(avx2);
+
+    for (auto precision : {HeightSamplePrecision::eCoarse, HeightSamplePrecision::eActual}) {
+      std::vector<double> heights;
+      utils::getHeights(&treeMgr, precision, lngLats, heights);
+
+      REQUIRE_EQ(heights.size(), lngLats.size());
+
+      bool equal = true;
+      for (std::size_t i = 0; i < lngLats.size(); ++i) {
+        equal = equal && heights[i] == utils::getHeight(&treeMgr, precision, lngLats[i]);
+      }
+
+      CHECK_MESSAGE(equal, utils::getInterpolationInstructionSet());
+    }
+  }
+
+  utils::setUseInterpolationAVX2(useAVX2);
+
+  // With eFine, the same heights are returned but the missing children are reported.
+  std::vector<double> actual;
+  std::vector<double> fine;
+  std::vector<TileId> missingTiles;
+  utils::getHeights(&treeMgr, HeightSamplePrecision::eActual, lngLats, actual);
+  utils::getHeights(treeMgr.getTree(), HeightSamplePrecision::eFine, lngLats, fine, missingTiles);
+
+  CHECK_UNARY(actual == fine);
+  CHECK_GT(missingTiles.size(), 0U);
+
+  for (auto const& tileId : missingTiles) {
+    int childIdx = HEALPix::getChildIdx(tileId);
+    CHECK_UNARY(childIdx == 1 || childIdx == 2);
+  }
+
+  // An empty batch must not do anything.
+  std::vector<double> heights(3, 1.0);
+  utils::getHeights(&treeMgr, HeightSamplePrecision::eActual, {}, heights);
+  CHECK_UNARY(heights.empty());
+}
+
+TEST_CASE("csp::lodbodies::utils::getHeights [benchmark]") {
+  PlanetParameters     params;
+  SyntheticTreeManager treeMgr(params, 6);
+  auto const           lngLats = createLngLats(100000);
+
+  std::vector<double> heights(lngLats.size());
+  double              sum = 0.0;
+
+  auto run = [&](char const* name, auto const& f) {
+    benchmark<std::nano>(name, lngLats.size(), "sample", f);
+
+    for (double height : heights) {
+      sum += height;
+    }
+  };
+
+  run("getHeight", [&]() {
+    for (std::size_t i = 0; i < lngLats.size(); ++i) {
+      heights[i] = utils::getHeight(&treeMgr, HeightSamplePrecision::eActual, lngLats[i]);
+    }
+  });
+
+  bool const useAVX2 = utils::getUseInterpolationAVX2();
+
+  std::vector<bool> implementations = {false};
+  if (isCullingAVX2Supported()) {
+    implementations.push_back(true);
+  }
+
+  for (bool avx2 : implementations) {
+    utils::setUseInterpolationAVX2(avx2);
+
+    std::string const name = std::string("getHeights (") +
+                             utils::getInterpolationInstructionSet() + ")";
+
+    run(name.c_str(), [&]() {
+      utils::getHeights(&treeMgr, HeightSamplePrecision::eActual, lngLats, heights);
+    });
+  }
+
+  utils::setUseInterpolationAVX2(useAVX2);
+
+  // prevent the compiler from optimizing everything away
+  CHECK_NE(sum, 0.0);
+}
+
+TEST_CASE("csp::lodbodies::utils::intersectPlanet matches the reference") {
+  PlanetParameters params;
+  params.mRadii = glm::dvec3(100000.0);
+
+  float offset = 0.F;
+
+  SUBCASE("Terrain above the ellipsoid") {
+  }
+
+  // The steps of the ray marching have to be based on the height above the ellipsoid, not on the
+  // altitude above the terrain. Else they would pass through terrain far below the ellipsoid.
+  SUBCASE("Terrain far below the ellipsoid") {
+    offset = -8000.F;
+  }
+
+  SyntheticTreeManager treeMgr(params, 3, {0, 1, 2, 3}, offset);
+
+  std::vector<glm::dvec3> origins;
+  std::vector<glm::dvec3> directions;
+  createRays(2000, params.mRadii.x, origins, directions);
+
+  std::vector<glm::dvec3> positions;
+  std::vector<bool>       hits;
+  utils::intersectPlanet(
+      &treeMgr, params.mRadii, params.mHeightScale, origins, directions, positions, hits);
+
+  REQUIRE_EQ(hits.size(), origins.size());
+
+  std::size_t hitCount   = 0;
+  std::size_t agreeCount = 0;
+  std::size_t closeCount = 0;
+
+  for (std::size_t i = 0; i < origins.size(); ++i) {
+    glm::dvec3 pos{};
+    bool       hit = utils::intersectPlanet(
+        &treeMgr, params.mRadii, params.mHeightScale, origins[i], directions[i], pos);
+
+    // The batched version has to return exactly the same results.
+    REQUIRE_EQ(hit, hits[i]);
+
+    if (hit) {
+      REQUIRE_EQ(pos, positions[i]);
+
+      // The intersection has to lie on the terrain.
+      glm::dvec3 lngLatHeight = cs::utils::convert::cartesianToLngLatHeight(pos, params.mRadii);
+      double     height =
+          utils::getHeight(&treeMgr, HeightSamplePrecision::eActual, glm::dvec2(lngLatHeight));
+      CHECK_LT(std::abs(lngLatHeight.z - params.mHeightScale * height), 0.01);
+    }
+
+    glm::dvec3 refPos{};
+    bool       refHit = intersectPlanetReference(
+        &treeMgr, params.mRadii, params.mHeightScale, origins[i], directions[i], refPos);
+
+    if (hit == refHit) {
+      ++agreeCount;
+    }
+
+    // The reference samples the ray in steps of about one sample and may be off by a step.
+    if (hit && refHit) {
+      ++hitCount;
+
+      if (glm::distance(pos, refPos) < 0.01 * glm::distance(origins[i], refPos)) {
+        ++closeCount;
+      }
+    }
+  }
+
+  // There are only minor differences where the reference misses small features of the terrain.
+  CHECK_GT(hitCount, origins.size() / 2);
+  CHECK_GE(agreeCount, origins.size() * 99 / 100);
+  CHECK_GE(closeCount, hitCount * 99 / 100);
+
+  // An empty batch must not do anything.
+  utils::intersectPlanet(&treeMgr, params.mRadii, params.mHeightScale, {}, {}, positions, hits);
+  CHECK_UNARY(positions.empty());
+  CHECK_UNARY(hits.empty());
+}
+
+TEST_CASE("csp::lodbodies::utils::intersectPlanet [benchmark]") {
+  PlanetParameters params;
+  params.mRadii = glm::dvec3(100000.0);
+
+  SyntheticTreeManager treeMgr(params, 3, {0, 1, 2, 3});
+
+  std::vector<glm::dvec3> origins;
+  std::vector<glm::dvec3> directions;
+  createRays(5000, params.mRadii.x, origins, directions);
+
+  std::vector<glm::dvec3> positions(origins.size());
+  std::vector<bool>       hits(origins.size());
+  glm::dvec3              sum(0.0);
+
+  auto run = [&](char const* name, auto const& f) {
+    benchmark<std::micro>(name, origins.size(), "ray", f);
+
+    for (auto const& position : positions) {
+      sum += position;
+    }
+  };
+
+  run("reference", [&]() {
+    for (std::size_t i = 0; i < origins.size(); ++i) {
+      hits[i] = intersectPlanetReference(&treeMgr, params.mRadii, params.mHeightScale, origins[i],
+          directions[i], positions[i]);
+    }
+  });
+
+  run("intersectPlanet", [&]() {
+    for (std::size_t i = 0; i < origins.size(); ++i) {
+      glm::dvec3 pos{};
+      hits[i]      = utils::intersectPlanet(
+          &treeMgr, params.mRadii, params.mHeightScale, origins[i], directions[i], pos);
+      positions[i] = pos;
+    }
+  });
+
+  run("intersectPlanet (batched)", [&]() {
+    utils::intersectPlanet(
+        &treeMgr, params.mRadii, params.mHeightScale, origins, directions, positions, hits);
+  });
+
+  // prevent the compiler from optimizing everything away
+  CHECK_NE(glm::length(sum), 0.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,553 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../../../src/cs-utils/CommandLine.hpp"
+#include "../src/LODPipeline.hpp"
+#include "../src/RenderDataDEM.hpp"
+#include "../src/TileBase.hpp"
+#include "../src/TileNode.hpp"
+#include "../src/TileSourceProcedural.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// This tool measures the CPU side of the level-of-detail pipeline of csp-lod-bodies: merging loaded
+// tiles into the tile trees, selecting the tiles to draw and to load and passing the requests to
+// the tile sources. This is what VistaPlanet does each frame before rendering. The tool neither
+// opens a window nor uses OpenGL, so it can run on build machines without a GPU. The tiles are
+// generated by a TileSourceProcedural with a configurable latency and failure rate, so the results
+// do not depend on a map server either.
+//
+// The observer follows either one of the built-in paths or a path read from a file. Afterwards it
+// stays at the last position until no more tiles are requested, the time this takes is reported
+// as the time to full resolution. The tool returns a non-zero exit code if the full resolution is
+// not reached or if the given frame time budget is exceeded, so it can be used as a regression
+// test.
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+using Clock = std::chrono::steady_clock;
+
+// The view of the observer, in body radii.
+struct Pose {
+  glm::dvec3 mEye;
+  glm::dvec3 mTarget;
+};
+
+// The results of a single frame.
+struct FrameStats {
+  double      mCPUTime        = 0.0;
+  std::size_t mDrawTiles      = 0;
+  std::size_t mRequestedTiles = 0;
+  std::size_t mNodes          = 0;
+  uint64_t    mCacheHits      = 0;
+  uint64_t    mCacheMisses    = 0;
+};
+
+// The properties of the simulated screen.
+glm::ivec4 const Viewport(0, 0, 1920, 1080);
+double const     FieldOfView = 60.0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the point on the unit sphere at the given longitude and latitude in radians.
+glm::dvec3 getSurfacePoint(double lng, double lat) {
+  return glm::dvec3(std::cos(lat) * std::sin(lng), std::sin(lat), std::cos(lat) * std::cos(lng));
+}
+
+// Interpolates logarithmically, this results in a constant apparent speed when approaching a
+// surface.
+double mixLog(double a, double b, double t) {
+  return std::exp(glm::mix(std::log(a), std::log(b), t));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Creates one of the built-in paths with the given number of frames.
+std::vector<Pose> createPath(std::string const& name, uint32_t frames) {
+  std::vector<Pose> path(frames);
+
+  for (uint32_t i = 0; i < frames; ++i) {
+    double t = frames > 1 ? static_cast<double>(i) / (frames - 1) : 0.0;
+
+    if (name == "approach") {
+      // From far away straight down to an altitude of 0.0002 radii, looking at the center.
+      double     altitude = mixLog(10.0, 0.0002, t);
+      glm::dvec3 normal   = getSurfacePoint(0.3, 0.5);
+      path[i]             = {normal * (1.0 + altitude), glm::dvec3(0.0)};
+    } else if (name == "orbit") {
+      // Once around the equator at an altitude of 0.05 radii, looking at the center.
+      double lng = 2.0 * glm::pi<double>() * t;
+      path[i]    = {getSurfacePoint(lng, 0.0) * 1.05, glm::dvec3(0.0)};
+    } else if (name == "descent") {
+      // A flight along a meridian which descends to an altitude of 0.0002 radii, looking towards
+      // the horizon.
+      double     altitude = mixLog(0.05, 0.0002, t);
+      double     lat      = glm::mix(-0.3, 0.3, t);
+      glm::dvec3 eye      = getSurfacePoint(0.0, lat) * (1.0 + altitude);
+      path[i]             = {eye, getSurfacePoint(0.0, lat + 0.05)};
+    } else {
+      throw std::runtime_error(
+          "Unknown path '" + name + "'! Only 'approach', 'orbit' or 'descent' are allowed.");
+    }
+  }
+
+  return path;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Reads a path from a text file. Each line contains the position of the observer and the point it
+// looks at, both in body radii: "eyeX eyeY eyeZ targetX targetY targetZ". Empty lines and lines
+// starting with a '#' are ignored.
+std::vector<Pose> readPath(std::string const& fileName) {
+  std::ifstream file(fileName);
+
+  if (!file) {
+    throw std::runtime_error("Failed to open '" + fileName + "'!");
+  }
+
+  std::vector<Pose> path;
+  std::string       line;
+  int               lineNumber = 0;
+
+  while (std::getline(file, line)) {
+    ++lineNumber;
+
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream stream(line);
+    Pose               pose{};
+
+    if (!(stream >> pose.mEye.x >> pose.mEye.y >> pose.mEye.z >> pose.mTarget.x >>
+            pose.mTarget.y >> pose.mTarget.z)) {
+      throw std::runtime_error(
+          "Invalid pose in line " + std::to_string(lineNumber) + " of '" + fileName + "'!");
+    }
+
+    path.push_back(pose);
+  }
+
+  if (path.empty()) {
+    throw std::runtime_error("The path '" + fileName + "' is empty!");
+  }
+
+  return path;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::dmat4 getModelview(Pose const& pose, double radius) {
+  glm::dvec3 eye       = pose.mEye * radius;
+  glm::dvec3 target    = pose.mTarget * radius;
+  glm::dvec3 direction = glm::normalize(target - eye);
+
+  // Keep the horizon level. When looking straight down, any up vector which is not parallel to the
+  // view direction will do.
+  glm::dvec3 up = glm::normalize(eye);
+  for (glm::dvec3 const& fallback : {glm::dvec3(0.0, 1.0, 0.0), glm::dvec3(0.0, 0.0, 1.0)}) {
+    if (std::abs(glm::dot(up, direction)) > 0.99) {
+      up = fallback;
+    }
+  }
+
+  return glm::lookAt(eye, target, up);
+}
+
+// The near clipping plane is moved closer to the observer when it approaches the surface.
+glm::fmat4x4 getProjection(Pose const& pose, double radius) {
+  double distance = glm::length(pose.mEye) * radius;
+  double nearClip = std::max(0.1 * (distance - radius), 1.0);
+  double farClip  = distance + radius;
+  double aspect   = static_cast<double>(Viewport.z) / Viewport.w;
+
+  return glm::fmat4x4(glm::perspective(glm::radians(FieldOfView), aspect, nearClip, farClip));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the number of bytes of all tiles and tile nodes which have been allocated at the same
+// time at most.
+std::size_t getPeakTileBytes() {
+  std::size_t bytes = 0;
+
+  for (auto type : {csp::lodbodies::TileDataType::eFloat32, csp::lodbodies::TileDataType::eUInt8,
+           csp::lodbodies::TileDataType::eU8Vec3}) {
+    auto stats = csp::lodbodies::TileBase::getPool(type).getStats();
+    bytes += stats.mPeakUsed * stats.mBlockSize;
+  }
+
+  auto stats = csp::lodbodies::TileNode::getPool().getStats();
+  bytes += stats.mPeakUsed * stats.mBlockSize;
+
+  return bytes;
+}
+
+// Returns the peak resident set size of this process in bytes. This is only available on Linux,
+// elsewhere zero is returned.
+std::size_t getPeakResidentBytes() {
+  std::ifstream status("/proc/self/status");
+  std::string   line;
+
+  while (std::getline(status, line)) {
+    if (line.rfind("VmHWM:", 0) == 0) {
+      // The value is given in kB.
+      return static_cast<std::size_t>(std::stoull(line.substr(6))) * 1024;
+    }
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the given percentile of the CPU times of all frames.
+double getPercentile(std::vector<FrameStats> const& frames, double percentile) {
+  if (frames.empty()) {
+    return 0.0;
+  }
+
+  std::vector<double> times;
+  times.reserve(frames.size());
+
+  for (auto const& frame : frames) {
+    times.push_back(frame.mCPUTime);
+  }
+
+  auto index = static_cast<std::size_t>(std::round(percentile * (times.size() - 1)));
+  std::nth_element(times.begin(), times.begin() + index, times.end());
+
+  return times[index];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  std::string pathName     = "descent";
+  std::string pathFile;
+  std::string csvFile;
+  std::string jsonFile;
+  uint32_t    frames       = 600;
+  uint32_t    settleFrames = 6000;
+  double      fps          = 60.0;
+  uint32_t    prefetch     = 0;
+  double      radius       = 6378137.0;
+  float       lodFactor    = 15.F;
+  uint32_t    maxLevel     = 15;
+  uint32_t    cacheSize    = 256;
+  uint32_t    threads      = 4;
+  int32_t     octaves      = 8;
+  double      latency      = 50.0;
+  double      failureRate  = 0.0;
+  uint32_t    seed         = 0;
+  double      budget       = 0.0;
+  bool        printHelp    = false;
+
+  cs::utils::CommandLine args(
+      "Measures the CPU time of the level-of-detail selection and tile loading of csp-lod-bodies "
+      "while the observer follows a path across a procedurally generated planet. No window and no "
+      "GPU are required. Here are the available options:");
+  args.addArgument({"-p", "--path"}, &pathName,
+      "The built-in path to follow: 'approach', 'orbit' or 'descent' (default: " + pathName + ")");
+  args.addArgument({"--path-file"}, &pathFile,
+      "A file with one pose per line: 'eyeX eyeY eyeZ targetX targetY targetZ' in body radii. If "
+      "given, --path and --frames are ignored.");
+  args.addArgument({"-f", "--frames"}, &frames,
+      "The number of frames of the built-in path (default: " + std::to_string(frames) + ")");
+  args.addArgument({"--settle-frames"}, &settleFrames,
+      "The maximum number of frames to wait for full resolution at the end of the path (default: " +
+          std::to_string(settleFrames) + ")");
+  args.addArgument({"--fps"}, &fps,
+      "The simulated frame rate, 0 runs the frames as fast as possible (default: 60)");
+  args.addArgument({"--prefetch"}, &prefetch,
+      "The number of frames to look ahead on the path for prefetching tiles, 0 disables "
+      "prefetching (default: 0)");
+  args.addArgument({"--radius"}, &radius, "The radius of the planet in meters (default: 6378137)");
+  args.addArgument({"--lod-factor"}, &lodFactor, "The level of detail factor (default: 15)");
+  args.addArgument({"--max-level"}, &maxLevel, "The deepest level of the tiles (default: 15)");
+  args.addArgument({"--cache-size"}, &cacheSize,
+      "The size of the cache of pruned tiles in MB for each tile tree (default: 256)");
+  args.addArgument({"-t", "--threads"}, &threads,
+      "The number of threads generating tiles for each tile source (default: 4)");
+  args.addArgument({"--octaves"}, &octaves,
+      "The number of noise octaves of the generated terrain (default: 8)");
+  args.addArgument({"-l", "--latency"}, &latency,
+      "The average time it takes to load a tile in milliseconds (default: 50)");
+  args.addArgument({"--failure-rate"}, &failureRate,
+      "The probability in [0, 1] that loading a tile fails (default: 0)");
+  args.addArgument({"--seed"}, &seed, "The seed of the terrain and of the latencies (default: 0)");
+  args.addArgument({"-b", "--budget"}, &budget,
+      "Fail if the 95th percentile of the CPU time per frame exceeds this number of milliseconds, "
+      "0 disables the check (default: 0)");
+  args.addArgument({"--csv"}, &csvFile, "Write the statistics of each frame to this CSV file.");
+  args.addArgument({"--json"}, &jsonFile, "Write the summary to this JSON file.");
+  args.addArgument({"-h", "--help"}, &printHelp, "Print this help.");
+
+  try {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    args.parse(arguments);
+  } catch (std::runtime_error const& e) {
+    std::cerr << "Failed to parse command line arguments: " << e.what() << std::endl;
+    return 1;
+  }
+
+  if (printHelp) {
+    args.printHelp();
+    return 0;
+  }
+
+  if (frames == 0 || threads == 0 || radius <= 0.0 || fps < 0.0) {
+    std::cerr << "Invalid frame count, thread count, radius or frame rate!" << std::endl;
+    return 1;
+  }
+
+  std::vector<Pose> path;
+
+  try {
+    path = pathFile.empty() ? createPath(pathName, frames) : readPath(pathFile);
+  } catch (std::runtime_error const& e) {
+    std::cerr << "Failed to create the path: " << e.what() << std::endl;
+    return 1;
+  }
+
+  // Set up the pipeline without GPU resources. ---------------------------------------------------
+
+  // The sources are declared first, as the pipeline still uses them while it is destroyed.
+  csp::lodbodies::TileSourceProcedural sourceDEM(threads);
+  csp::lodbodies::TileSourceProcedural sourceIMG(threads);
+
+  for (auto* source : {&sourceDEM, &sourceIMG}) {
+    source->setMaxLevel(maxLevel);
+    source->setOctaves(octaves);
+    source->setLatency(latency);
+    source->setFailureRate(failureRate);
+    source->setSeed(seed);
+  }
+
+  sourceIMG.setDataType(csp::lodbodies::TileDataType::eU8Vec3);
+
+  csp::lodbodies::LODPipeline pipeline(nullptr);
+  pipeline.setRadii(glm::dvec3(radius));
+  pipeline.setLODFactor(lodFactor);
+  pipeline.setTileCacheSize(static_cast<std::size_t>(cacheSize) * 1024 * 1024);
+  pipeline.setDEMSource(&sourceDEM);
+  pipeline.setIMGSource(&sourceIMG);
+
+  // Follow the path and wait for full resolution at its end. -------------------------------------
+
+  std::vector<FrameStats> stats;
+  Clock::duration         frameTime = Clock::duration::zero();
+
+  if (fps > 0.0) {
+    frameTime =
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+  }
+
+  auto   start         = Clock::now();
+  auto   pathEnd       = start;
+  auto   nextFrame     = start;
+  int    settledFrames = -1;
+  double settleTime    = 0.0;
+
+  for (uint32_t i = 0; i < path.size() + settleFrames; ++i) {
+    int         frameCount = static_cast<int>(i) + 1;
+    Pose const& pose       = path[std::min<std::size_t>(i, path.size() - 1)];
+
+    if (i == path.size()) {
+      pathEnd = Clock::now();
+    }
+
+    auto frameStart = Clock::now();
+
+    glm::dmat4   matVM = getModelview(pose, radius);
+    glm::fmat4x4 matP  = getProjection(pose, radius);
+
+    pipeline.updateTileBounds();
+    pipeline.updateTileTrees(frameCount);
+    pipeline.traverseTileTrees(frameCount, matVM, matP, Viewport);
+
+    if (prefetch > 0) {
+      Pose const& predicted = path[std::min<std::size_t>(i + prefetch, path.size() - 1)];
+      pipeline.prefetchTileTrees(frameCount, getModelview(predicted, radius),
+          getProjection(predicted, radius), Viewport);
+    }
+
+    pipeline.processLoadRequests();
+
+    // The TileRenderer resets the render data after drawing, this has to be done here instead.
+    auto const& lodVisitor = pipeline.getLODVisitor();
+
+    for (auto* rd : lodVisitor.getRenderDEM()) {
+      auto* rdDEM = static_cast<csp::lodbodies::RenderDataDEM*>(rd);
+      rdDEM->resetEdgeDeltas();
+      rdDEM->resetEdgeRData();
+      rdDEM->clearFlags();
+    }
+
+    auto frameEnd = Clock::now();
+
+    auto const& cacheDEM = pipeline.getTreeManagerDEM().getTileCache();
+    auto const& cacheIMG = pipeline.getTreeManagerIMG().getTileCache();
+
+    FrameStats frame;
+    frame.mCPUTime   = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+    frame.mDrawTiles = std::max(lodVisitor.getRenderDEM().size(), lodVisitor.getRenderIMG().size());
+    frame.mRequestedTiles = lodVisitor.getLoadDEM().size() + lodVisitor.getLoadIMG().size();
+    frame.mNodes =
+        pipeline.getTreeManagerDEM().getNodeCount() + pipeline.getTreeManagerIMG().getNodeCount();
+    frame.mCacheHits   = cacheDEM.getHitCount() + cacheIMG.getHitCount();
+    frame.mCacheMisses = cacheDEM.getMissCount() + cacheIMG.getMissCount();
+    stats.push_back(frame);
+
+    // Full resolution is reached once all tiles needed for the final view have been loaded.
+    if (i >= path.size() && frame.mRequestedTiles == 0) {
+      settledFrames = static_cast<int>(i - path.size());
+      settleTime    = std::chrono::duration<double, std::milli>(frameEnd - pathEnd).count();
+      break;
+    }
+
+    if (frameTime != Clock::duration::zero()) {
+      nextFrame = std::max(nextFrame + frameTime, frameEnd);
+      std::this_thread::sleep_until(nextFrame);
+    }
+  }
+
+  double totalTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+  // Cancel all outstanding requests and wait for them, they refer to the pipeline.
+  pipeline.setDEMSource(nullptr);
+  pipeline.setIMGSource(nullptr);
+
+  while (sourceDEM.getPendingRequests() > 0 || sourceIMG.getPendingRequests() > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // Report the results. --------------------------------------------------------------------------
+
+  std::size_t             pathFrames = std::min(stats.size(), path.size());
+  std::vector<FrameStats> pathStats(stats.begin(), stats.begin() + pathFrames);
+
+  double      sumTime       = 0.0;
+  double      maxTime       = 0.0;
+  std::size_t maxRequests   = 0;
+  std::size_t totalRequests = 0;
+
+  for (auto const& frame : stats) {
+    sumTime += frame.mCPUTime;
+    maxTime     = std::max(maxTime, frame.mCPUTime);
+    maxRequests = std::max(maxRequests, frame.mRequestedTiles);
+    totalRequests += frame.mRequestedTiles;
+  }
+
+  nlohmann::json summary = {
+      {"frames", stats.size()},
+      {"totalTime", totalTime},
+      {"cpuTime",
+          {
+              {"mean", sumTime / static_cast<double>(stats.size())},
+              {"median", getPercentile(stats, 0.5)},
+              {"p95", getPercentile(stats, 0.95)},
+              {"p99", getPercentile(stats, 0.99)},
+              {"max", maxTime},
+              {"pathP95", getPercentile(pathStats, 0.95)},
+          }},
+      {"requestedTiles", {{"total", totalRequests}, {"maxPerFrame", maxRequests}}},
+      {"generatedTiles", sourceDEM.getGeneratedTileCount() + sourceIMG.getGeneratedTileCount()},
+      {"failedTiles", sourceDEM.getFailedTileCount() + sourceIMG.getFailedTileCount()},
+      {"cacheHits", stats.back().mCacheHits},
+      {"cacheMisses", stats.back().mCacheMisses},
+      {"fullResolution",
+          {
+              {"reached", settledFrames >= 0},
+              {"frames", settledFrames},
+              {"time", settleTime},
+          }},
+      {"peakTileMemory", getPeakTileBytes()},
+      {"peakResidentMemory", getPeakResidentBytes()},
+  };
+
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "Frames:                  " << stats.size() << " (" << pathFrames << " on the path)"
+            << std::endl;
+  std::cout << "CPU time per frame [ms]: mean " << summary["cpuTime"]["mean"].get<double>()
+            << ", median " << summary["cpuTime"]["median"].get<double>() << ", p95 "
+            << summary["cpuTime"]["p95"].get<double>() << ", p99 "
+            << summary["cpuTime"]["p99"].get<double>() << ", max " << maxTime << std::endl;
+  std::cout << "Requested tiles:         " << totalRequests << " in total, at most " << maxRequests
+            << " per frame" << std::endl;
+  std::cout << "Generated tiles:         " << summary["generatedTiles"].get<uint64_t>() << " ("
+            << summary["failedTiles"].get<uint64_t>() << " failed)" << std::endl;
+  std::cout << "Tile cache hits/misses:  " << stats.back().mCacheHits << " / "
+            << stats.back().mCacheMisses << std::endl;
+
+  if (settledFrames >= 0) {
+    std::cout << "Time to full resolution: " << settleTime << " ms (" << settledFrames
+              << " frames)" << std::endl;
+  } else {
+    std::cout << "Time to full resolution: not reached within " << settleFrames << " frames"
+              << std::endl;
+  }
+
+  std::cout << "Peak tile memory:        " << getPeakTileBytes() / (1024 * 1024) << " MB"
+            << std::endl;
+
+  if (getPeakResidentBytes() > 0) {
+    std::cout << "Peak resident memory:    " << getPeakResidentBytes() / (1024 * 1024) << " MB"
+              << std::endl;
+  }
+
+  if (!csvFile.empty()) {
+    std::ofstream csv(csvFile);
+    csv << "frame,cpuTime,drawTiles,requestedTiles,nodes,cacheHits,cacheMisses" << std::endl;
+
+    for (std::size_t i = 0; i < stats.size(); ++i) {
+      auto const& frame = stats[i];
+      csv << i + 1 << "," << frame.mCPUTime << "," << frame.mDrawTiles << ","
+          << frame.mRequestedTiles << "," << frame.mNodes << "," << frame.mCacheHits << ","
+          << frame.mCacheMisses << std::endl;
+    }
+  }
+
+  if (!jsonFile.empty()) {
+    std::ofstream json(jsonFile);
+    json << std::setw(2) << summary << std::endl;
+  }
+
+  // Decide whether this run counts as a regression. ----------------------------------------------
+
+  if (settledFrames < 0) {
+    std::cerr << "Full resolution was not reached!" << std::endl;
+    return 2;
+  }
+
+  if (budget > 0.0 && summary["cpuTime"]["p95"].get<double>() > budget) {
+    std::cerr << "The frame time budget of " << budget << " ms was exceeded!" << std::endl;
+    return 2;
+  }
+
+  return 0;
+}
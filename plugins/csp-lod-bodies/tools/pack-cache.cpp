@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../../../src/cs-utils/CommandLine.hpp"
+#include "../src/TilePackCache.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// This tool converts a directory based map cache of csp-lod-bodies (one file per tile, stored as
+// <layer>/<level>/<x>/<y>.<png|tiff>) to a single tile pack which can be used when "packMapCache"
+// is enabled in the plugin settings. The original files are not modified.
+int main(int argc, char** argv) {
+  std::string input     = "map-cache";
+  std::string output    = "";
+  bool        printHelp = false;
+
+  cs::utils::CommandLine args("Converts a csp-lod-bodies map cache directory to a tile pack. Here "
+                              "are the available options:");
+  args.addArgument({"-i", "--input"}, &input, "The map cache directory (default: " + input + ")");
+  args.addArgument({"-o", "--output"}, &output,
+      "The tile pack to write to, it is created if it does not exist yet (default: "
+      "<input>/tiles.pack)");
+  args.addArgument({"-h", "--help"}, &printHelp, "Print this help.");
+
+  try {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    args.parse(arguments);
+  } catch (std::runtime_error const& e) {
+    std::cerr << "Failed to parse command line arguments: " << e.what() << std::endl;
+    return 1;
+  }
+
+  if (printHelp) {
+    args.printHelp();
+    return 0;
+  }
+
+  if (output.empty()) {
+    output = input + "/tiles.pack";
+  }
+
+  if (!boost::filesystem::is_directory(input)) {
+    std::cerr << "Input directory '" << input << "' does not exist!" << std::endl;
+    return 1;
+  }
+
+  try {
+    csp::lodbodies::TilePackCache pack(output);
+
+    uint64_t converted = 0;
+    uint64_t skipped   = 0;
+
+    for (auto const& entry : boost::filesystem::recursive_directory_iterator(input)) {
+      if (!boost::filesystem::is_regular_file(entry.path())) {
+        continue;
+      }
+
+      // We expect exactly four path components: layer, level, x and y.<extension>.
+      std::vector<std::string> parts;
+      for (auto const& part : boost::filesystem::relative(entry.path(), input)) {
+        parts.push_back(part.string());
+      }
+
+      auto extension = entry.path().extension().string();
+
+      if (parts.size() != 4 || (extension != ".png" && extension != ".tiff") ||
+          boost::filesystem::file_size(entry.path()) == 0) {
+        ++skipped;
+        continue;
+      }
+
+      int level{};
+      int x{};
+      int y{};
+
+      try {
+        level = std::stoi(parts[1]);
+        x     = std::stoi(parts[2]);
+        y     = std::stoi(entry.path().stem().string());
+      } catch (std::exception const&) {
+        ++skipped;
+        continue;
+      }
+
+      // This is the same key as used by TileSourceWebMapService.
+      std::string layer = parts[0] + "." + extension.substr(1);
+
+      if (pack.read(layer, level, x, y)) {
+        ++skipped;
+        continue;
+      }
+
+      std::ifstream in(entry.path().string(), std::ifstream::in | std::ifstream::binary);
+      pack.write(layer, level, x, y,
+          std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+
+      if (++converted % 10000 == 0) {
+        std::cout << "Converted " << converted << " tiles..." << std::endl;
+      }
+    }
+
+    std::cout << "Converted " << converted << " tiles, skipped " << skipped << " files. The pack '"
+              << output << "' now contains " << pack.getTileCount() << " tiles." << std::endl;
+  } catch (std::exception const& e) {
+    std::cerr << "Failed to convert map cache: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,458 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../../../src/cs-utils/CommandLine.hpp"
+#include "../src/HEALPix.hpp"
+#include "../src/TileSourceWebMapService.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// This tool downloads all tiles of one data set of csp-lod-bodies which cover a given region into
+// the map cache. This is meant for installations which should not depend on the map server while
+// they are running. The data set and the map cache are read from the settings file of CosmoScout
+// VR. Tiles which are already in the cache are skipped, so an interrupted run can be resumed by
+// simply starting the tool again with the same arguments.
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+using Clock = std::chrono::steady_clock;
+
+// The number of points per tile edge which are used to estimate the bounds of a tile.
+int const EdgeSamples = 8;
+
+// The estimated bounds of each tile are enlarged by this fraction of their size, as the edges of
+// the tiles are curved in geodetic coordinates.
+double const BoundsMargin = 0.1;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A region in geodetic coordinates in radians. If the region crosses the antimeridian, mMax.x is
+// larger than pi.
+struct Region {
+  glm::dvec2 mMin;
+  glm::dvec2 mMax;
+};
+
+// Returns true if the given tile may overlap the region. This returns true for some tiles close to
+// the region as well, but never false for a tile which actually overlaps the region.
+bool mayOverlap(csp::lodbodies::TileId const& tileId, Region const& region) {
+  glm::i64vec3 baseXY = csp::lodbodies::HEALPix::getBaseXY(tileId);
+  glm::int64   nSide  = csp::lodbodies::HEALPix::getNSide(tileId);
+  int          base   = static_cast<int>(baseXY[0]);
+  double       size   = 1.0 / static_cast<double>(nSide);
+  double       x      = static_cast<double>(baseXY[1]) * size;
+  double       y      = static_cast<double>(baseXY[2]) * size;
+
+  glm::dvec2 min(std::numeric_limits<double>::max());
+  glm::dvec2 max(std::numeric_limits<double>::lowest());
+  double     lastLng   = 0.0;
+  bool       first     = true;
+  bool       touchPole = false;
+
+  // Walk along the edges of the tile. The longitudes are unwrapped, so that tiles crossing the
+  // antimeridian get a continuous range.
+  for (int edge = 0; edge < 4; ++edge) {
+    for (int i = 0; i < EdgeSamples; ++i) {
+      double     t = size * i / EdgeSamples;
+      glm::dvec2 point;
+
+      if (edge == 0) {
+        point = glm::dvec2(x + t, y);
+      } else if (edge == 1) {
+        point = glm::dvec2(x + size, y + t);
+      } else if (edge == 2) {
+        point = glm::dvec2(x + size - t, y + size);
+      } else {
+        point = glm::dvec2(x, y + size - t);
+      }
+
+      glm::dvec2 lngLat = csp::lodbodies::HEALPix::convertBaseXY2LngLat(base, point.x, point.y);
+
+      if (std::abs(lngLat.y) > 0.5 * glm::pi<double>() - 1e-9) {
+        touchPole = true;
+      }
+
+      if (!first) {
+        lngLat.x = lastLng + std::remainder(lngLat.x - lastLng, 2.0 * glm::pi<double>());
+      }
+
+      lastLng = lngLat.x;
+      first   = false;
+      min     = glm::min(min, lngLat);
+      max     = glm::max(max, lngLat);
+    }
+  }
+
+  glm::dvec2 margin = (max - min) * BoundsMargin;
+  min -= margin;
+  max += margin;
+
+  if (max.y < region.mMin.y || min.y > region.mMax.y) {
+    return false;
+  }
+
+  // The longitude of a pole is undefined, so tiles touching a pole may extend in any direction.
+  if (touchPole || max.x - min.x >= 2.0 * glm::pi<double>()) {
+    return true;
+  }
+
+  for (int shift = -2; shift <= 2; ++shift) {
+    double offset = 2.0 * glm::pi<double>() * shift;
+    if (max.x + offset >= region.mMin.x && min.x + offset <= region.mMax.x) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Adds the web map service tiles of the given HEALPix tile and all its children down to maxLevel
+// which may overlap the region to the list of their level.
+void collectTiles(csp::lodbodies::TileId const& tileId, int minLevel, int maxLevel,
+    Region const& region, std::vector<std::vector<std::pair<int, int>>>& tiles) {
+  if (!mayOverlap(tileId, region)) {
+    return;
+  }
+
+  int level = tileId.level();
+
+  if (level >= minLevel) {
+    int  x{};
+    int  y{};
+    bool onDiag =
+        csp::lodbodies::TileSourceWebMapService::getXY(level, tileId.patchIdx(), x, y);
+
+    tiles[level].emplace_back(x, y);
+
+    // Tiles on the diagonal of base patch 4 are composed of two tiles of the map server.
+    if (onDiag) {
+      tiles[level].emplace_back(x + 4 * (1 << level), y - 4 * (1 << level));
+    }
+  }
+
+  if (level >= maxLevel) {
+    return;
+  }
+
+  glm::i64vec3 baseXY = csp::lodbodies::HEALPix::getBaseXY(tileId);
+  auto const&  child  = csp::lodbodies::HEALPix::getLevel(level + 1);
+
+  for (int i = 0; i < 4; ++i) {
+    glm::i64vec3 childXY(baseXY[0], 2 * baseXY[1] + i % 2, 2 * baseXY[2] + i / 2);
+    collectTiles(csp::lodbodies::TileId(level + 1, child.getPatchIdx(childXY)), minLevel, maxLevel,
+        region, tiles);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Spreads the calls to wait() of all threads evenly in time, so that the given number of calls per
+// second is not exceeded. A rate of zero disables the limit.
+class RateLimiter {
+ public:
+  explicit RateLimiter(double rate)
+      : mInterval(rate > 0.0 ? std::chrono::duration_cast<Clock::duration>(
+                                   std::chrono::duration<double>(1.0 / rate))
+                             : Clock::duration::zero()) {
+  }
+
+  void wait() {
+    if (mInterval == Clock::duration::zero()) {
+      return;
+    }
+
+    Clock::time_point slot;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mNext = std::max(mNext, Clock::now());
+      slot  = mNext;
+      mNext += mInterval;
+    }
+
+    std::this_thread::sleep_until(slot);
+  }
+
+ private:
+  Clock::duration const mInterval;
+  std::mutex            mMutex;
+  Clock::time_point     mNext;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+csp::lodbodies::TileDataType parseDataType(std::string const& format) {
+  if (format == "Float32") {
+    return csp::lodbodies::TileDataType::eFloat32;
+  }
+  if (format == "UInt8") {
+    return csp::lodbodies::TileDataType::eUInt8;
+  }
+  if (format == "U8Vec3") {
+    return csp::lodbodies::TileDataType::eU8Vec3;
+  }
+
+  throw std::runtime_error(
+      "Unknown format '" + format + "'! Only 'Float32', 'UInt8' or 'U8Vec3' are allowed.");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  std::string settingsFile = "../share/config/simple_desktop.json";
+  std::string body;
+  std::string dataset;
+  std::string mapCache;
+  double      minLng    = -180.0;
+  double      maxLng    = 180.0;
+  double      minLat    = -90.0;
+  double      maxLat    = 90.0;
+  int32_t     minLevel  = 0;
+  int32_t     maxLevel  = -1;
+  uint32_t    threads   = 16;
+  double      rate      = 20.0;
+  uint32_t    retries   = 3;
+  bool        dryRun    = false;
+  bool        printHelp = false;
+
+  cs::utils::CommandLine args(
+      "Downloads the tiles of a csp-lod-bodies data set into the map cache. Tiles which are "
+      "already cached are skipped, so an interrupted run can be resumed by starting it again. Here "
+      "are the available options:");
+  args.addArgument({"-s", "--settings"}, &settingsFile,
+      "The settings file of CosmoScout VR (default: " + settingsFile + ")");
+  args.addArgument({"-b", "--body"}, &body, "The anchor name of the body, e.g. Earth");
+  args.addArgument({"-d", "--dataset"}, &dataset, "The name of the image or elevation data set");
+  args.addArgument({"-c", "--map-cache"}, &mapCache,
+      "The map cache directory (default: mapCache of the settings file)");
+  args.addArgument(
+      {"--min-lng"}, &minLng, "Western border of the region in degrees (default: -180)");
+  args.addArgument(
+      {"--max-lng"}, &maxLng, "Eastern border of the region in degrees (default: 180)");
+  args.addArgument(
+      {"--min-lat"}, &minLat, "Southern border of the region in degrees (default: -90)");
+  args.addArgument(
+      {"--max-lat"}, &maxLat, "Northern border of the region in degrees (default: 90)");
+  args.addArgument({"--min-level"}, &minLevel, "The first level to download (default: 0)");
+  args.addArgument({"--max-level"}, &maxLevel,
+      "The last level to download (default: maxLevel of the data set)");
+  args.addArgument({"-t", "--threads"}, &threads,
+      "The number of tiles which are downloaded at the same time (default: 16)");
+  args.addArgument({"-r", "--rate"}, &rate,
+      "The maximum number of requests per second sent to the map server, 0 disables the limit "
+      "(default: 20)");
+  args.addArgument({"--retries"}, &retries,
+      "How often failed downloads are repeated before giving up (default: 3)");
+  args.addArgument({"-n", "--dry-run"}, &dryRun, "Only print the number of tiles per level.");
+  args.addArgument({"-h", "--help"}, &printHelp, "Print this help.");
+
+  try {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    args.parse(arguments);
+  } catch (std::runtime_error const& e) {
+    std::cerr << "Failed to parse command line arguments: " << e.what() << std::endl;
+    return 1;
+  }
+
+  if (printHelp) {
+    args.printHelp();
+    return 0;
+  }
+
+  if (body.empty() || dataset.empty()) {
+    std::cerr << "Both --body and --dataset have to be given!" << std::endl;
+    return 1;
+  }
+
+  // Read the data set from the settings file. ----------------------------------------------------
+
+  csp::lodbodies::TileSourceWebMapService source;
+
+  try {
+    std::ifstream  stream(settingsFile);
+    nlohmann::json settings;
+    stream >> settings;
+
+    auto const& plugin   = settings.at("plugins").at("csp-lod-bodies");
+    auto const& bodyJson = plugin.at("bodies").at(body);
+
+    nlohmann::json datasetJson;
+    for (auto const* group : {"imgDatasets", "demDatasets"}) {
+      if (bodyJson.contains(group) && bodyJson.at(group).contains(dataset)) {
+        datasetJson = bodyJson.at(group).at(dataset);
+      }
+    }
+
+    if (datasetJson.is_null()) {
+      throw std::runtime_error("There is no data set '" + dataset + "' for '" + body + "'!");
+    }
+
+    if (mapCache.empty()) {
+      mapCache = plugin.value("mapCache", "map-cache");
+    }
+
+    auto datasetMaxLevel = datasetJson.at("maxLevel").get<int32_t>();
+    maxLevel = maxLevel < 0 ? datasetMaxLevel : std::min(maxLevel, datasetMaxLevel);
+
+    source.setUrl(datasetJson.at("url").get<std::string>());
+    source.setLayers(datasetJson.at("layers").get<std::string>());
+    source.setDataType(parseDataType(datasetJson.at("format").get<std::string>()));
+    source.setMaxLevel(static_cast<uint32_t>(maxLevel));
+    source.setCacheDirectory(mapCache);
+    source.setUseCachePack(plugin.value("packMapCache", false));
+    source.setMaxConcurrentRequests(threads);
+  } catch (std::exception const& e) {
+    std::cerr << "Failed to read settings file '" << settingsFile << "': " << e.what()
+              << std::endl;
+    return 1;
+  }
+
+  if (minLevel < 0 || minLevel > maxLevel || minLat > maxLat || threads == 0) {
+    std::cerr << "Invalid level range, region or thread count!" << std::endl;
+    return 1;
+  }
+
+  // Collect all tiles in the region. -------------------------------------------------------------
+
+  Region region{glm::radians(glm::dvec2(minLng, minLat)), glm::radians(glm::dvec2(maxLng, maxLat))};
+
+  if (region.mMax.x < region.mMin.x) {
+    region.mMax.x += 2.0 * glm::pi<double>();
+  }
+
+  std::vector<std::vector<std::pair<int, int>>> tiles(maxLevel + 1);
+
+  for (int i = 0; i < 12; ++i) {
+    collectTiles(csp::lodbodies::TileId(0, i), minLevel, maxLevel, region, tiles);
+  }
+
+  size_t totalCount = 0;
+
+  for (int level = minLevel; level <= maxLevel; ++level) {
+    std::sort(tiles[level].begin(), tiles[level].end());
+    tiles[level].erase(std::unique(tiles[level].begin(), tiles[level].end()), tiles[level].end());
+    totalCount += tiles[level].size();
+
+    std::cout << "Level " << level << ": " << tiles[level].size() << " tiles" << std::endl;
+  }
+
+  std::cout << "Total: " << totalCount << " tiles of '" << source.getLayers() << "' to '"
+            << mapCache << "'" << std::endl;
+
+  if (dryRun) {
+    return 0;
+  }
+
+  // Download the tiles, level by level. ----------------------------------------------------------
+
+  RateLimiter         limiter(rate);
+  std::atomic<size_t> downloaded{0};
+  std::atomic<size_t> cached{0};
+  std::atomic<size_t> failed{0};
+  std::mutex          errorMutex;
+
+  auto start      = Clock::now();
+  auto lastOutput = start;
+
+  for (int level = minLevel; level <= maxLevel; ++level) {
+    auto const&         levelTiles = tiles[level];
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+
+    auto work = [&]() {
+      for (size_t i = next++; i < levelTiles.size(); i = next++) {
+        auto [x, y] = levelTiles[i];
+
+        for (uint32_t attempt = 0;; ++attempt) {
+          try {
+            if (source.isCached(level, x, y)) {
+              ++cached;
+              break;
+            }
+
+            limiter.wait();
+            source.loadData(level, x, y);
+            ++downloaded;
+            break;
+          } catch (std::exception const& e) {
+            if (attempt >= retries) {
+              std::lock_guard<std::mutex> lock(errorMutex);
+              std::cerr << "Failed to download tile " << level << "/" << x << "/" << y << ": "
+                        << e.what() << std::endl;
+              ++failed;
+              break;
+            }
+
+            // Give an overloaded server some time to recover.
+            std::this_thread::sleep_for(std::chrono::seconds(1U << attempt));
+          }
+        }
+
+        ++done;
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; ++i) {
+      workers.emplace_back(work);
+    }
+
+    // Print the progress while the workers are busy.
+    while (done < levelTiles.size()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      if (Clock::now() - lastOutput > std::chrono::seconds(5) || done == levelTiles.size()) {
+        lastOutput = Clock::now();
+
+        double seconds = std::chrono::duration<double>(lastOutput - start).count();
+
+        std::lock_guard<std::mutex> lock(errorMutex);
+        std::cout << "Level " << level << ": " << done << " / " << levelTiles.size()
+                  << " tiles, total: " << downloaded << " downloaded, " << cached << " cached, "
+                  << failed << " failed, " << static_cast<double>(downloaded) / seconds
+                  << " tiles/s" << std::endl;
+      }
+    }
+
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  std::cout << "Downloaded " << downloaded << " tiles, " << cached << " were already cached, "
+            << failed << " failed." << std::endl;
+
+  if (failed > 0) {
+    std::cerr << "Some tiles could not be downloaded. Start the tool again to retry them."
+              << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -269,18 +269,31 @@ void DipStrikeTool::calculateDipAndStrike() {
     averagePosition += mark->getAnchor()->getAnchorPosition() / static_cast<double>(mPoints.size());
   }
 
+  // LongLat coordinates of all points
+  std::vector<glm::dvec2> lngLats;
+  lngLats.reserve(mPoints.size());
+  for (auto const& mark : mPoints) {
+    lngLats.push_back(
+        cs::utils::convert::cartesianToLngLat(mark->getAnchor()->getAnchorPosition(), radii));
+  }
+
+  // Heights of all points, these are retrieved at once
+  std::vector<double> heights(lngLats.size(), 0.0);
+  if (body) {
+    heights = body->getHeights(lngLats);
+  }
+
+  // Cartesian coordinates with height
+  std::vector<glm::dvec3> positionsNorm;
+  positionsNorm.reserve(lngLats.size());
+  for (size_t i = 0; i < lngLats.size(); ++i) {
+    positionsNorm.push_back(cs::utils::convert::toCartesian(lngLats[i], radii, heights[i]));
+  }
+
   // corrected average position (works for every height scale)
   // average position of the coordinates without height exaggeration
   glm::dvec3 averagePositionNorm(0.0);
-  for (auto const& mark : mPoints) {
-    // LongLat coordinate
-    glm::dvec2 l =
-        cs::utils::convert::cartesianToLngLat(mark->getAnchor()->getAnchorPosition(), radii);
-    // Height of the point
-    double h = body ? body->getHeight(l) : 0.0;
-    // Cartesian coordinate with height
-    glm::dvec3 posNorm = cs::utils::convert::toCartesian(l, radii, h);
-
+  for (auto const& posNorm : positionsNorm) {
     averagePositionNorm += posNorm / static_cast<double>(mPoints.size());
   }
 
@@ -306,12 +319,7 @@ void DipStrikeTool::calculateDipAndStrike() {
   mSize                 = 0;
   mOffset               = 0.F;
 
-  for (auto const& p : mPoints) {
-    glm::dvec2 l =
-        cs::utils::convert::cartesianToLngLat(p->getAnchor()->getAnchorPosition(), radii);
-    double     h       = body ? body->getHeight(l) : 0.0;
-    glm::dvec3 posNorm = cs::utils::convert::toCartesian(l, radii, h);
-
+  for (auto const& posNorm : positionsNorm) {
     glm::dvec3 realtivePosition = posNorm - averagePositionNorm;
 
     mSize = std::max(mSize, glm::length(realtivePosition));
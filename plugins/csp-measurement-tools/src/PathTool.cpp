@@ -21,6 +21,8 @@
 #include <VistaKernel/VistaSystem.h>
 #include <VistaKernelOpenSGExt/VistaOpenSGMaterialTools.h>
 
+#include <chrono>
+
 namespace csp::measurementtools {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -144,6 +146,11 @@ PathTool::PathTool(std::shared_ptr<cs::core::InputManager> const& pInputManager,
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 PathTool::~PathTool() {
+  // No more terrain data has to be loaded for the pending query.
+  if (mPreciseHeightsToken) {
+    mPreciseHeightsToken->cancel();
+  }
+
   mSettings->mGraphics.pHeightScale.disconnect(mScaleConnection);
   mGuiItem->unregisterCallback("deleteMe");
   mGuiItem->unregisterCallback("setAddPointMode");
@@ -178,32 +185,27 @@ void PathTool::setNumSamples(int const& numSamples) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-glm::dvec4 PathTool::getInterpolatedPosBetweenTwoMarks(cs::core::tools::DeletableMark const& l0,
-    cs::core::tools::DeletableMark const& l1, double value, double const& scale) {
+std::vector<glm::dvec2> PathTool::getSamplesBetweenMarks(std::vector<glm::dvec2> const& lngLats,
+    std::vector<double> const& heights, double scale) const {
 
   glm::dvec3 radii = cs::core::SolarSystem::getRadii(getCenterName());
 
-  auto body = mSolarSystem->getBody(getCenterName());
-
-  if (!body) {
-    return glm::dvec4(0.0);
-  }
-
-  // Calculate the position for the new segment anchor
-  double h0 = body->getHeight(l0.pLngLat.get()) * scale;
-  double h1 = body->getHeight(l1.pLngLat.get()) * scale;
+  std::vector<glm::dvec2> samples;
+  samples.reserve(lngLats.size() * static_cast<size_t>(mNumSamples));
 
-  // Get cartesian coordinates for interpolation
-  glm::dvec3 p0              = cs::utils::convert::toCartesian(l0.pLngLat.get(), radii, h0);
-  glm::dvec3 p1              = cs::utils::convert::toCartesian(l1.pLngLat.get(), radii, h1);
-  glm::dvec3 interpolatedPos = p0 + (value * (p1 - p0));
+  for (size_t i = 1; i < lngLats.size(); ++i) {
+    // Get cartesian coordinates for interpolation
+    glm::dvec3 p0 = cs::utils::convert::toCartesian(lngLats[i - 1], radii, heights[i - 1] * scale);
+    glm::dvec3 p1 = cs::utils::convert::toCartesian(lngLats[i], radii, heights[i] * scale);
 
-  // Calc final position
-  glm::dvec2 ll     = cs::utils::convert::cartesianToLngLat(interpolatedPos, radii);
-  double     height = body->getHeight(ll) * scale;
-  glm::dvec3 pos    = cs::utils::convert::toCartesian(ll, radii, height);
+    for (int vertex_id = 0; vertex_id < mNumSamples; vertex_id++) {
+      double     value           = vertex_id / static_cast<double>(mNumSamples);
+      glm::dvec3 interpolatedPos = p0 + (value * (p1 - p0));
+      samples.push_back(cs::utils::convert::cartesianToLngLat(interpolatedPos, radii));
+    }
+  }
 
-  return glm::dvec4(pos, height);
+  return samples;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -231,9 +233,6 @@ void PathTool::updateLineVertices() {
     return;
   }
 
-  // Fill the vertex buffer with sampled data
-  mSampledPositions.clear();
-
   auto body = mSolarSystem->getBody(getCenterName());
 
   glm::dvec3 averagePosition(0.0);
@@ -257,42 +256,82 @@ void PathTool::updateLineVertices() {
                          mTimeControl->pSimulationTime.get(), *mGuiAnchor));
   }
 
-  auto lastMark = mPoints.begin();
-  auto currMark = ++mPoints.begin();
+  // The heights of all marks and of all samples are retrieved with one call each, this is much
+  // faster than sampling each position individually.
+  auto getHeights = [&body](std::vector<glm::dvec2> const& lngLats) {
+    return body ? body->getHeights(lngLats) : std::vector<double>(lngLats.size(), 0.0);
+  };
+
+  std::vector<glm::dvec2> markLngLats;
+  for (auto const& mark : mPoints) {
+    markLngLats.push_back(mark->pLngLat.get());
+  }
+
+  std::vector<double> markHeights = getHeights(markLngLats);
+
+  // generate X points for each line segment
+  mSamples     = getSamplesBetweenMarks(markLngLats, markHeights, h_scale);
+  mSampleCount = mSamples.size();
+
+  // coordinates normalized by height scale; to count distance correctly
+  if (h_scale != 1) {
+    auto samplesNorm = getSamplesBetweenMarks(markLngLats, markHeights, 1.0);
+    mSamples.insert(mSamples.end(), samplesNorm.begin(), samplesNorm.end());
+  }
+
+  // Show the heights of the currently loaded terrain right away and refine them once the precise
+  // heights are available, see update().
+  updateSampledPositions(getHeights(mSamples));
+
+  // Heights which are still pending belong to the previous samples and must not be applied to the
+  // new ones, so the previous query is cancelled. Without a body, there is nothing to refine.
+  if (mPreciseHeightsToken) {
+    mPreciseHeightsToken->cancel();
+    mPreciseHeightsToken.reset();
+  }
+
+  mPreciseHeights = {};
+
+  if (body) {
+    mPreciseHeightsToken = std::make_shared<cs::utils::CancellationToken>();
+    mPreciseHeights      = body->getPreciseHeights(mSamples, mPreciseHeightsToken);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PathTool::updateSampledPositions(std::vector<double> const& heights) {
+  mSampledPositions.clear();
+
+  double h_scale = mSettings->mGraphics.pHeightScale.get();
+  auto   radii   = cs::core::SolarSystem::getRadii(getCenterName());
 
   std::stringstream json;
   std::string       jsonSeperator;
   double            distance = -1;
   glm::dvec3        lastPos(0.0);
 
-  while (currMark != mPoints.end()) {
-    // generate X points for each line segment
-    for (int vertex_id = 0; vertex_id < mNumSamples; vertex_id++) {
-      glm::dvec4 pos = getInterpolatedPosBetweenTwoMarks(
-          **lastMark, **currMark, (vertex_id / static_cast<double>(mNumSamples)), h_scale);
-      mSampledPositions.push_back(pos.xyz());
-
-      // coordinate normalized by height scale; to count distance correctly
-      glm::dvec4 posNorm = pos;
-      if (h_scale != 1) {
-        posNorm = getInterpolatedPosBetweenTwoMarks(
-            **lastMark, **currMark, (vertex_id / static_cast<double>(mNumSamples)), 1);
-      }
-
-      if (distance < 0) {
-        distance = 0;
-      } else {
-        distance += glm::length(posNorm.xyz() - lastPos);
-      }
-
-      json << jsonSeperator << "[" << distance << "," << pos.w / h_scale << "]";
-      jsonSeperator = ",";
-
-      lastPos = posNorm.xyz();
+  for (std::size_t i = 0; i < mSampleCount; ++i) {
+    double     height = heights[i] * h_scale;
+    glm::dvec3 pos    = cs::utils::convert::toCartesian(mSamples[i], radii, height);
+    mSampledPositions.push_back(pos);
+
+    glm::dvec3 posNorm = pos;
+    if (mSamples.size() > mSampleCount) {
+      posNorm = cs::utils::convert::toCartesian(
+          mSamples[mSampleCount + i], radii, heights[mSampleCount + i]);
     }
 
-    lastMark = currMark;
-    ++currMark;
+    if (distance < 0) {
+      distance = 0;
+    } else {
+      distance += glm::length(posNorm - lastPos);
+    }
+
+    json << jsonSeperator << "[" << distance << "," << height / h_scale << "]";
+    jsonSeperator = ",";
+
+    lastPos = posNorm;
   }
 
   mGuiItem->callJavascript("setData", "[" + json.str() + "]");
@@ -318,6 +357,11 @@ void PathTool::update() {
     mVerticesDirty = false;
   }
 
+  if (mPreciseHeights.valid() &&
+      mPreciseHeights.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    updateSampledPositions(mPreciseHeights.get());
+  }
+
   double simulationTime(mTimeControl->pSimulationTime.get());
 
   cs::core::SolarSystem::scaleRelativeToObserver(*mGuiAnchor, mSolarSystem->getObserver(),
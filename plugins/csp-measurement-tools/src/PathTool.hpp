@@ -8,10 +8,13 @@
 #define CSP_MEASUREMENT_TOOLS_PATH_HPP
 
 #include "../../../src/cs-core/tools/MultiPointTool.hpp"
+#include "../../../src/cs-utils/CancellationToken.hpp"
 
 #include <VistaKernel/GraphicsManager/VistaOpenGLDraw.h>
 
+#include <future>
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>
 
 namespace cs::scene {
@@ -69,10 +72,15 @@ class PathTool : public IVistaOpenGLDraw, public cs::core::tools::MultiPointTool
  private:
   void updateLineVertices();
 
-  /// Returns the interpolated position in cartesian coordinates. The fourth component is height
-  /// above the surface.
-  glm::dvec4 getInterpolatedPosBetweenTwoMarks(cs::core::tools::DeletableMark const& l0,
-      cs::core::tools::DeletableMark const& l1, double value, double const& scale);
+  /// Computes mSampledPositions and the height profile from the given heights of mSamples and
+  /// uploads them.
+  void updateSampledPositions(std::vector<double> const& heights);
+
+  /// Returns the coordinates of mNumSamples points on each segment between two consecutive marks.
+  /// The samples are interpolated in cartesian space between the marks, which are lifted by their
+  /// heights times the given scale.
+  std::vector<glm::dvec2> getSamplesBetweenMarks(std::vector<glm::dvec2> const& lngLats,
+      std::vector<double> const& heights, double scale) const;
 
   /// These are called by the base class MultiPointTool.
   void onPointMoved() override;
@@ -95,6 +103,13 @@ class PathTool : public IVistaOpenGLDraw, public cs::core::tools::MultiPointTool
   size_t                  mIndexCount    = 0;
   bool                    mVerticesDirty = false;
 
+  /// The coordinates of the samples, followed by the same samples normalized by the height scale
+  /// if it is not one.
+  std::vector<glm::dvec2>                       mSamples;
+  std::size_t                                   mSampleCount = 0;
+  std::future<std::vector<double>>              mPreciseHeights;
+  std::shared_ptr<cs::utils::CancellationToken> mPreciseHeightsToken;
+
   int mScaleConnection = -1;
   int mTextConnection  = -1;
   int mNumSamples      = 256;
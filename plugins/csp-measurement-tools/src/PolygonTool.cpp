@@ -220,25 +220,37 @@ void PolygonTool::setSleekness(uint32_t degree) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-glm::dvec4 PolygonTool::getInterpolatedPosBetweenTwoMarks(cs::core::tools::DeletableMark const& l0,
-    cs::core::tools::DeletableMark const& l1, double value) {
+std::vector<glm::dvec2> PolygonTool::getSamplesBetweenMarks(
+    std::vector<glm::dvec2> const& lngLats, std::vector<double> const& heights) const {
   double     h_scale = mSettings->mGraphics.pHeightScale.get();
   glm::dvec3 radii   = mSolarSystem->getRadii(mGuiAnchor->getCenterName());
 
-  // Calculates the position for the new segment anchor
-  double h0 = mSolarSystem->pActiveBody.get()->getHeight(l0.pLngLat.get()) * h_scale;
-  double h1 = mSolarSystem->pActiveBody.get()->getHeight(l1.pLngLat.get()) * h_scale;
+  std::vector<glm::dvec2> samples;
+  samples.reserve(lngLats.size() * static_cast<size_t>(NUM_SAMPLES));
 
-  // Gets cartesian coordinates for interpolation
-  glm::dvec3 p0              = cs::utils::convert::toCartesian(l0.pLngLat.get(), radii, h0);
-  glm::dvec3 p1              = cs::utils::convert::toCartesian(l1.pLngLat.get(), radii, h1);
-  glm::dvec3 interpolatedPos = p0 + (value * (p1 - p0));
+  // The last edge connects the last and the first mark to draw a polygon instead of a path
+  for (size_t i = 0; i < lngLats.size(); ++i) {
+    size_t j = (i + 1) % lngLats.size();
 
-  // Calculates final position
-  glm::dvec2 ll     = cs::utils::convert::cartesianToLngLat(interpolatedPos, radii);
-  double     height = mSolarSystem->pActiveBody.get()->getHeight(ll) * h_scale;
-  glm::dvec3 pos    = cs::utils::convert::toCartesian(ll, radii, height);
-  return glm::dvec4(pos, height);
+    // Gets cartesian coordinates for interpolation
+    glm::dvec3 p0 = cs::utils::convert::toCartesian(lngLats[i], radii, heights[i] * h_scale);
+    glm::dvec3 p1 = cs::utils::convert::toCartesian(lngLats[j], radii, heights[j] * h_scale);
+
+    for (int vertex_id = 0; vertex_id < NUM_SAMPLES; vertex_id++) {
+      double     value           = vertex_id / static_cast<double>(NUM_SAMPLES);
+      glm::dvec3 interpolatedPos = p0 + (value * (p1 - p0));
+      samples.push_back(cs::utils::convert::cartesianToLngLat(interpolatedPos, radii));
+    }
+  }
+
+  return samples;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::dvec3 PolygonTool::getSurfacePoint(double x, double y, double mdist, glm::dvec3 const& e,
+    glm::dvec3 const& n, glm::dvec3 const& radii) const {
+  return glm::normalize(mMiddlePoint + mdist * x * e + mdist * y * n) * radii[0];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -663,80 +675,102 @@ bool PolygonTool::checkSleekness(int count) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void PolygonTool::displayMesh(Edge2 const& edge, double mdist, glm::dvec3 const& e,
-    glm::dvec3 const& n, glm::dvec3 const& radii, double scale, double& h1, double& h2) {
-  // Cartesian coordinates without height
-  glm::dvec3 p1 =
-      glm::normalize(mMiddlePoint + mdist * edge.first.mX * e + mdist * edge.first.mY * n) *
-      radii[0];
-  glm::dvec3 p2 =
-      glm::normalize(mMiddlePoint + mdist * edge.second.mX * e + mdist * edge.second.mY * n) *
-      radii[0];
+void PolygonTool::displayMesh(std::vector<Edge2> const& edges, double mdist, glm::dvec3 const& e,
+    glm::dvec3 const& n, glm::dvec3 const& radii, double scale, std::vector<double>& heights) {
+  // LongLat coordinates of both end points of all edges
+  std::vector<glm::dvec2> lngLats;
+  lngLats.reserve(2 * edges.size());
 
-  // LongLat coordinates
-  glm::dvec2 l1 = cs::utils::convert::cartesianToLngLat(p1, radii);
-  glm::dvec2 l2 = cs::utils::convert::cartesianToLngLat(p2, radii);
+  for (auto const& edge : edges) {
+    // Cartesian coordinates without height
+    glm::dvec3 p1 = getSurfacePoint(edge.first.mX, edge.first.mY, mdist, e, n, radii);
+    glm::dvec3 p2 = getSurfacePoint(edge.second.mX, edge.second.mY, mdist, e, n, radii);
 
-  // Heights of the points
-  h1 = mSolarSystem->pActiveBody.get()->getHeight(l1.xy());
-  h2 = mSolarSystem->pActiveBody.get()->getHeight(l2.xy());
+    lngLats.push_back(cs::utils::convert::cartesianToLngLat(p1, radii));
+    lngLats.push_back(cs::utils::convert::cartesianToLngLat(p2, radii));
+  }
 
-  // Cartesian coordinates with height
-  glm::dvec3 r1 = cs::utils::convert::toCartesian(l1, radii, h1 * scale);
-  glm::dvec3 r2 = cs::utils::convert::toCartesian(l2, radii, h2 * scale);
+  // Heights of the points
+  heights = mSolarSystem->pActiveBody.get()->getHeights(lngLats);
 
   // Emplaces back points in Cartesian (on planet surface) for display
-  mTriangulation.emplace_back(r1);
-  mTriangulation.emplace_back(r2);
+  for (size_t i = 0; i < lngLats.size(); ++i) {
+    mTriangulation.emplace_back(
+        cs::utils::convert::toCartesian(lngLats[i], radii, heights[i] * scale));
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void PolygonTool::refineMesh(Edge2 const& edge, double mdist, glm::dvec3 const& e,
-    glm::dvec3 const& n, glm::dvec3 const& radii, int count, double h1, double h2, bool& fine) {
+void PolygonTool::refineMesh(std::vector<Edge2> const& edges, double mdist, glm::dvec3 const& e,
+    glm::dvec3 const& n, glm::dvec3 const& radii, int count, std::vector<double> const& heights,
+    bool& fine) {
 
-  // Middle point of the edge on voronoi plane
-  glm::dvec2 avgPoint2 =
-      glm::dvec2((edge.first.mX + edge.second.mX) / 2, (edge.first.mY + edge.second.mY) / 2);
-  // Middle point on planet´s surface
-  glm::dvec3 pAvg =
-      glm::normalize(mMiddlePoint + mdist * avgPoint2.x * e + mdist * avgPoint2.y * n) * radii[0];
+  // The middle point and the trisecting, quadrisecting and quinquesecting points of each edge on
+  // the voronoi plane. The heights of all of them are retrieved at once
+  int const               pointsPerEdge = 10;
+  std::vector<glm::dvec2> points;
+  std::vector<glm::dvec2> lngLats;
+  points.reserve(pointsPerEdge * edges.size());
+  lngLats.reserve(pointsPerEdge * edges.size());
+
+  for (auto const& edge : edges) {
+    points.emplace_back((edge.first.mX + edge.second.mX) / 2, (edge.first.mY + edge.second.mY) / 2);
 
-  // Heights of the points over see level
-  double hAvg = mSolarSystem->pActiveBody.get()->getHeight(
-      cs::utils::convert::cartesianToLngLat(pAvg, radii));
-
-  // Checks height of the middle point
-  if ((hAvg / ((h1 + h2) / 2) > mHeightDiff) || (((h1 + h2) / 2) / hAvg > mHeightDiff)) {
-    mCornersFine[count].emplace_back(
-        avgPoint2.x, avgPoint2.y, static_cast<uint16_t>(mCornersFine[count].size()));
-    fine = false;
-  }
-  // Checks height of other points between the two Sites
-  else {
-    // Trisecting points, etc.
     for (int j = 3; j < 6; j++) {
-      // Checks "level" only if no points were emplaced back form the previous cycle
-      if (fine) {
-        for (int i = 1; i < j; i++) {
-          // Point
-          glm::dvec2 avgPoint3 = glm::dvec2((i * edge.first.mX + (j - i) * edge.second.mX) / j,
-              (i * edge.first.mY + (j - i) * edge.second.mY) / j);
-          // Cartesian coordinate of the point
-          glm::dvec3 cAvg3 =
-              glm::normalize(mMiddlePoint + mdist * avgPoint3.x * e + mdist * avgPoint3.y * n) *
-              radii[0];
-          // Height of the point
-          double heAvg3 = mSolarSystem->pActiveBody.get()->getHeight(
-              cs::utils::convert::cartesianToLngLat(cAvg3, radii));
-
-          if ((heAvg3 / ((i * h1 + (j - i) * h2) / j) > mHeightDiff) ||
-              (((i * h1 + (j - i) * h2) / j) / heAvg3 > mHeightDiff)) {
-            mCornersFine[count].emplace_back(
-                avgPoint3.x, avgPoint3.y, static_cast<uint16_t>(mCornersFine[count].size()));
-            fine = false;
+      for (int i = 1; i < j; i++) {
+        points.emplace_back((i * edge.first.mX + (j - i) * edge.second.mX) / j,
+            (i * edge.first.mY + (j - i) * edge.second.mY) / j);
+      }
+    }
+  }
+
+  for (auto const& point : points) {
+    glm::dvec3 p = getSurfacePoint(point.x, point.y, mdist, e, n, radii);
+    lngLats.push_back(cs::utils::convert::cartesianToLngLat(p, radii));
+  }
+
+  // Heights of the points over see level
+  std::vector<double> pointHeights = mSolarSystem->pActiveBody.get()->getHeights(lngLats);
+
+  for (size_t k = 0; k < edges.size(); ++k) {
+    double const h1     = heights[2 * k];
+    double const h2     = heights[2 * k + 1];
+    size_t       offset = pointsPerEdge * k;
+
+    // Middle point of the edge on voronoi plane
+    glm::dvec2 avgPoint2 = points[offset];
+    double     hAvg      = pointHeights[offset];
+
+    // Checks height of the middle point
+    if ((hAvg / ((h1 + h2) / 2) > mHeightDiff) || (((h1 + h2) / 2) / hAvg > mHeightDiff)) {
+      mCornersFine[count].emplace_back(
+          avgPoint2.x, avgPoint2.y, static_cast<uint16_t>(mCornersFine[count].size()));
+      fine = false;
+    }
+    // Checks height of other points between the two Sites
+    else {
+      ++offset;
+
+      // Trisecting points, etc.
+      for (int j = 3; j < 6; j++) {
+        // Checks "level" only if no points were emplaced back form the previous cycle
+        if (fine) {
+          for (int i = 1; i < j; i++) {
+            // Point and its height
+            glm::dvec2 avgPoint3 = points[offset + i - 1];
+            double     heAvg3    = pointHeights[offset + i - 1];
+
+            if ((heAvg3 / ((i * h1 + (j - i) * h2) / j) > mHeightDiff) ||
+                (((i * h1 + (j - i) * h2) / j) / heAvg3 > mHeightDiff)) {
+              mCornersFine[count].emplace_back(
+                  avgPoint3.x, avgPoint3.y, static_cast<uint16_t>(mCornersFine[count].size()));
+              fine = false;
+            }
           }
         }
+
+        offset += j - 1;
       }
     }
   }
@@ -747,36 +781,90 @@ void PolygonTool::refineMesh(Edge2 const& edge, double mdist, glm::dvec3 const&
 void PolygonTool::calculateAreaAndVolume(std::vector<Triangle> const& triangles, double mdist,
     glm::dvec3 const& e, glm::dvec3 const& n, glm::dvec3 const& radii, double& area, double& pvol,
     double& nvol) {
-  // Counts area and volume in every triangle
+  auto body = mSolarSystem->pActiveBody.get();
+
+  // Cartesian coordinates without height and LongLat coordinates of all corners
+  std::vector<glm::dvec3> corners;
+  std::vector<glm::dvec2> cornerLngLats;
+  corners.reserve(3 * triangles.size());
+  cornerLngLats.reserve(3 * triangles.size());
+
   for (const auto& triangle : triangles) {
+    for (Site const& si : {std::get<0>(triangle), std::get<1>(triangle), std::get<2>(triangle)}) {
+      corners.push_back(getSurfacePoint(si.mX, si.mY, mdist, e, n, radii));
+      cornerLngLats.push_back(cs::utils::convert::cartesianToLngLat(corners.back(), radii));
+    }
+  }
+
+  // Heights of all corners
+  std::vector<double> cornerHeights = body->getHeights(cornerLngLats);
+
+  // Resolution of edge sampling
+  int const res = 32;
+
+  // Samples the edge between a and b to find the intersection point between edge and plane
+  // (Does not consider multiple intersection points (f.eg.: mountains in triangle)
+  // They have been mostly eliminated with triangulation
+  // hlA is the height of a over the least square plane
+  auto findIntersection = [&](glm::dvec3 const& a, glm::dvec3 const& b, double hlA,
+                              glm::dvec3& intersection) {
+    std::vector<glm::dvec3> points;
+    std::vector<glm::dvec2> lngLats;
+
+    for (int i = 0; i < res; i++) {
+      double frac = static_cast<double>(i) / res;
+      // Point coordinate without height
+      points.push_back(glm::normalize((1 - frac) * a + frac * b) * radii[0]);
+      // LongLat
+      lngLats.push_back(cs::utils::convert::cartesianToLngLat(points.back(), radii));
+    }
+
+    // Heights of all sample points
+    std::vector<double> heights = body->getHeights(lngLats);
+
+    auto   pMOld  = glm::dvec3(0.0);
+    double hlMOld = 0;
+
+    for (int i = 0; i < res; i++) {
+      glm::dvec3 const& pM = points[i];
+
+      // Height over least square plane
+      double hlM = heights[i] - (glm::dot(mNormal2, mMiddlePoint2) / glm::dot(mNormal2, pM) - 1) *
+                                    glm::length(mMiddlePoint2);
+
+      // If intersection is between this and previous sample point
+      // Interpolate between this and previous point
+      if ((hlA > 0) != (hlM > 0)) {
+        intersection = pMOld - (pM - pMOld) * hlMOld / (hlM - hlMOld);
+        return true;
+      }
+
+      // Save values for the next cycle
+      pMOld  = pM;
+      hlMOld = hlM;
+    }
+
+    return false;
+  };
+
+  // Counts area and volume in every triangle
+  for (size_t t = 0; t < triangles.size(); ++t) {
     // ------------------------------------------ AREA ------------------------------------------
-    Site si1(0, 0, 0);
-    Site si2(0, 0, 0);
-    Site si3(0, 0, 0);
-    std::tie(si1, si2, si3) = triangle;
 
     // Cartesian coordinates without height
-    glm::dvec3 p1 =
-        glm::normalize(mMiddlePoint + mdist * si1.mX * e + mdist * si1.mY * n) * radii[0];
-    glm::dvec3 p2 =
-        glm::normalize(mMiddlePoint + mdist * si2.mX * e + mdist * si2.mY * n) * radii[0];
-    glm::dvec3 p3 =
-        glm::normalize(mMiddlePoint + mdist * si3.mX * e + mdist * si3.mY * n) * radii[0];
-
-    // LongLat coordinates
-    glm::dvec2 l1 = cs::utils::convert::cartesianToLngLat(p1, radii);
-    glm::dvec2 l2 = cs::utils::convert::cartesianToLngLat(p2, radii);
-    glm::dvec2 l3 = cs::utils::convert::cartesianToLngLat(p3, radii);
+    glm::dvec3 const& p1 = corners[3 * t];
+    glm::dvec3 const& p2 = corners[3 * t + 1];
+    glm::dvec3 const& p3 = corners[3 * t + 2];
 
     // Heights of the points
-    double h1 = mSolarSystem->pActiveBody.get()->getHeight(l1);
-    double h2 = mSolarSystem->pActiveBody.get()->getHeight(l2);
-    double h3 = mSolarSystem->pActiveBody.get()->getHeight(l3);
+    double h1 = cornerHeights[3 * t];
+    double h2 = cornerHeights[3 * t + 1];
+    double h3 = cornerHeights[3 * t + 2];
 
     // Cartesian coordinates with height
-    glm::dvec3 r1 = cs::utils::convert::toCartesian(l1, radii, h1);
-    glm::dvec3 r2 = cs::utils::convert::toCartesian(l2, radii, h2);
-    glm::dvec3 r3 = cs::utils::convert::toCartesian(l3, radii, h3);
+    glm::dvec3 r1 = cs::utils::convert::toCartesian(cornerLngLats[3 * t], radii, h1);
+    glm::dvec3 r2 = cs::utils::convert::toCartesian(cornerLngLats[3 * t + 1], radii, h2);
+    glm::dvec3 r3 = cs::utils::convert::toCartesian(cornerLngLats[3 * t + 2], radii, h3);
 
     // Area is the half of the cross product of two edges in triangle
     area += glm::length(glm::cross(r2 - r1, r3 - r1)) / 2;
@@ -813,91 +901,24 @@ void PolygonTool::calculateAreaAndVolume(std::vector<Triangle> const& triangles,
     // If 2 intersection points are found:
     // Split the triangle into a smaller triangle and a quadrilateral
     else {
-      auto   pM1    = glm::dvec3(0.0);
-      auto   pM2    = glm::dvec3(0.0);
-      auto   pM3    = glm::dvec3(0.0);
-      auto   pM     = glm::dvec3(0.0);
-      auto   pMOld  = glm::dvec3(0.0);
-      auto   lM     = glm::dvec2(0.0);
-      double hM     = 0;
-      double hlM    = 0;
-      double hlMOld = 0;
-      bool   b1     = false;
-      bool   b2     = false;
-      bool   b3     = false;
-
-      // Resolution of edge sampling
-      int    res  = 32;
-      double frac = 0;
+      auto pM1 = glm::dvec3(0.0);
+      auto pM2 = glm::dvec3(0.0);
+      auto pM3 = glm::dvec3(0.0);
+      bool b1  = false;
+      bool b2  = false;
+      bool b3  = false;
 
       // If the two points are on the other side of the plane
       if ((hl1 > 0) != (hl2 > 0)) {
-        // Samples of edge to find the intersection point between edge and plane
-        // (Does not consider multiple intersection points (f.eg.: mountains in triangle)
-        // They have been mostly eliminated with triangulation
-        for (int i = 0; i < res; i++) {
-          frac = static_cast<double>(i) / res;
-          // Point coordinate without height
-          pM = glm::normalize((1 - frac) * p1 + frac * p2) * radii[0];
-
-          // LongLat
-          lM = cs::utils::convert::cartesianToLngLat(pM, radii);
-          // Height
-          hM = mSolarSystem->pActiveBody.get()->getHeight(lM);
-          // Height over least square plane
-          hlM = hM - (glm::dot(mNormal2, mMiddlePoint2) / glm::dot(mNormal2, pM) - 1) *
-                         glm::length(mMiddlePoint2);
-          // If intersection is between this and previous sample point
-          // Interpolate between this and previous point and end loop
-          if ((hl1 > 0) != (hlM > 0)) {
-            pM1 = pMOld - (pM - pMOld) * hlMOld / (hlM - hlMOld);
-            // To quit loop
-            i  = res;
-            b1 = true;
-          } else {
-            // Save values for the next cycle
-            pMOld  = pM;
-            hlMOld = hlM;
-          }
-        }
+        b1 = findIntersection(p1, p2, hl1, pM1);
       }
 
       if ((hl1 > 0) != (hl3 > 0)) {
-        for (int i = 0; i < res; i++) {
-          frac = static_cast<double>(i) / res;
-          pM   = glm::normalize((1 - frac) * p1 + frac * p3) * radii[0];
-          lM   = cs::utils::convert::cartesianToLngLat(pM, radii);
-          hM   = mSolarSystem->pActiveBody.get()->getHeight(lM);
-          hlM  = hM - (glm::dot(mNormal2, mMiddlePoint2) / glm::dot(mNormal2, pM) - 1) *
-                         glm::length(mMiddlePoint2);
-          if ((hl1 > 0) != (hlM > 0)) {
-            pM2 = pMOld - (pM - pMOld) * hlMOld / (hlM - hlMOld);
-            i   = res;
-            b2  = true;
-          } else {
-            pMOld  = pM;
-            hlMOld = hlM;
-          }
-        }
+        b2 = findIntersection(p1, p3, hl1, pM2);
       }
 
       if ((hl2 > 0) != (hl3 > 0)) {
-        for (int i = 0; i < res; i++) {
-          frac = static_cast<double>(i) / res;
-          pM   = glm::normalize((1 - frac) * p2 + frac * p3) * radii[0];
-          lM   = cs::utils::convert::cartesianToLngLat(pM, radii);
-          hM   = mSolarSystem->pActiveBody.get()->getHeight(lM);
-          hlM  = hM - (glm::dot(mNormal2, mMiddlePoint2) / glm::dot(mNormal2, pM) - 1) *
-                         glm::length(mMiddlePoint2);
-          if ((hl2 > 0) != (hlM > 0)) {
-            pM3 = pMOld - (pM - pMOld) * hlMOld / (hlM - hlMOld);
-            i   = res;
-            b3  = true;
-          } else {
-            pMOld  = pM;
-            hlMOld = hlM;
-          }
-        }
+        b3 = findIntersection(p2, p3, hl2, pM3);
       }
 
       // If the first two edges have an intersection point with the plane
@@ -1031,6 +1052,24 @@ void PolygonTool::updateLineVertices() {
                          mTimeControl->pSimulationTime.get(), *mGuiAnchor));
   }
 
+  // The heights of all marks and of all samples are retrieved with one call each, this is much
+  // faster than sampling each position individually
+  std::vector<glm::dvec2> markLngLats;
+  for (auto const& mark : mPoints) {
+    markLngLats.push_back(mark->pLngLat.get());
+  }
+
+  std::vector<double> markHeights = mSolarSystem->pActiveBody.get()->getHeights(markLngLats);
+
+  // Generates X points for each line segment
+  std::vector<glm::dvec2> samples = getSamplesBetweenMarks(markLngLats, markHeights);
+  std::vector<double>     heights = mSolarSystem->pActiveBody.get()->getHeights(samples);
+
+  for (size_t i = 0; i < samples.size(); ++i) {
+    double h = heights[i] * mSettings->mGraphics.pHeightScale.get();
+    mSampledPositions.push_back(cs::utils::convert::toCartesian(samples[i], radii, h));
+  }
+
   auto lastMark = mPoints.begin();
   auto currMark = ++mPoints.begin();
 
@@ -1038,13 +1077,6 @@ void PolygonTool::updateLineVertices() {
   auto boundingBox = glm::dvec4(0.0);
 
   while (currMark != mPoints.end()) {
-    // Generates X points for each line segment
-    for (int vertex_id = 0; vertex_id < NUM_SAMPLES; vertex_id++) {
-      glm::dvec4 pos = getInterpolatedPosBetweenTwoMarks(
-          **lastMark, **currMark, (vertex_id / static_cast<double>(NUM_SAMPLES)));
-      mSampledPositions.push_back(pos.xyz());
-    }
-
     // Saves the point coordinates to vector (normalized by the radius)
     glm::dvec2 lngLat0 = (*lastMark)->pLngLat.get();
     glm::dvec2 lngLat1 = (*currMark)->pLngLat.get();
@@ -1068,14 +1100,6 @@ void PolygonTool::updateLineVertices() {
 
   mBoundingBox = boundingBox;
 
-  // Last line to draw a polygon instead of a path
-  currMark = mPoints.begin();
-  for (int vertex_id = 0; vertex_id < NUM_SAMPLES; vertex_id++) {
-    glm::dvec4 pos = getInterpolatedPosBetweenTwoMarks(
-        **lastMark, **currMark, (vertex_id / static_cast<double>(NUM_SAMPLES)));
-    mSampledPositions.push_back(pos.xyz());
-  }
-
   // Variables for display on tool
   double minLng = cs::utils::convert::toDegrees(mBoundingBox.x);
   double maxLng = cs::utils::convert::toDegrees(mBoundingBox.y);
@@ -1119,17 +1143,25 @@ void PolygonTool::updateCalculation() {
     averagePosition += mark->getAnchor()->getAnchorPosition() / static_cast<double>(mPoints.size());
   }
 
-  // Corrected average position (works for every height scale)
-  glm::dvec3 averagePositionNorm(0.0);
+  // LongLat coordinates of all points
+  std::vector<glm::dvec2> lngLats;
   for (auto const& mark : mPoints) {
     glm::dvec3 pos = glm::normalize(mark->getAnchor()->getAnchorPosition()) * radii[0];
-    // LongLat coordinate
-    glm::dvec2 l = cs::utils::convert::cartesianToLngLat(pos, radii);
-    // Height of the point
-    double h = mSolarSystem->pActiveBody.get()->getHeight(l);
-    // Cartesian coordinate with height
-    glm::dvec3 posNorm = cs::utils::convert::toCartesian(l, radii, h);
+    lngLats.push_back(cs::utils::convert::cartesianToLngLat(pos, radii));
+  }
 
+  // Heights of all points
+  std::vector<double> heights = mSolarSystem->pActiveBody.get()->getHeights(lngLats);
+
+  // Cartesian coordinates with height
+  std::vector<glm::dvec3> positionsNorm;
+  for (size_t i = 0; i < lngLats.size(); ++i) {
+    positionsNorm.push_back(cs::utils::convert::toCartesian(lngLats[i], radii, heights[i]));
+  }
+
+  // Corrected average position (works for every height scale)
+  glm::dvec3 averagePositionNorm(0.0);
+  for (auto const& posNorm : positionsNorm) {
     averagePositionNorm += posNorm / static_cast<double>(mPoints.size());
   }
 
@@ -1185,12 +1217,7 @@ void PolygonTool::updateCalculation() {
   mNormal2 = glm::normalize(averagePositionNorm);
   mOffset  = 0.F;
 
-  for (auto const& p : mPoints) {
-    glm::dvec3 pos     = glm::normalize(p->getAnchor()->getAnchorPosition()) * radii[0];
-    glm::dvec2 l       = cs::utils::convert::cartesianToLngLat(pos, radii);
-    double     h       = mSolarSystem->pActiveBody.get()->getHeight(l);
-    glm::dvec3 posNorm = cs::utils::convert::toCartesian(l, radii, h);
-
+  for (auto const& posNorm : positionsNorm) {
     glm::dvec3 realtivePosition = posNorm - averagePositionNorm;
 
     mat[0][0] += realtivePosition.x * realtivePosition.x;
@@ -1311,19 +1338,17 @@ void PolygonTool::updateCalculation() {
         voronoiRefine.parse(mCornersFine[triangleCount]);
 
         // No need for checkPoint, all of the edges are inside the triangle and the polygon
-        for (auto const& s : voronoiRefine.getTriangulation()) {
-          double h1{};
-          double h2{};
-
-          // Calculates mesh coordinates on planet's surface and saves these coordinates for display
-          displayMesh(s, maxDist, east, north, radii, h_scale, h1, h2);
-
-          // If not too many points are addded in checkSleekness and it is not the the last attempt
-          // than refines the mesh based on edge length and height differences
-          if ((!refine) && (pointCount < mMaxPoints) && (attempt < mMaxAttempt)) {
-            refineMesh(
-                s, maxDist, east, north, radii, static_cast<int32_t>(triangleCount), h1, h2, fine);
-          }
+        auto const&         edges = voronoiRefine.getTriangulation();
+        std::vector<double> edgeHeights;
+
+        // Calculates mesh coordinates on planet's surface and saves these coordinates for display
+        displayMesh(edges, maxDist, east, north, radii, h_scale, edgeHeights);
+
+        // If not too many points are addded in checkSleekness and it is not the the last attempt
+        // than refines the mesh based on edge length and height differences
+        if ((!refine) && (pointCount < mMaxPoints) && (attempt < mMaxAttempt)) {
+          refineMesh(edges, maxDist, east, north, radii, static_cast<int32_t>(triangleCount),
+              edgeHeights, fine);
         }
 
         std::vector<Triangle> trianglesRefined = voronoiRefine.getTriangles();
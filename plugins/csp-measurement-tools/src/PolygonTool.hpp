@@ -76,10 +76,15 @@ class PolygonTool : public IVistaOpenGLDraw, public cs::core::tools::MultiPointT
   void updateLineVertices();
   void updateCalculation();
 
-  /// Returns the interpolated position in cartesian coordinates. The fourth component is
-  /// height above the surface
-  glm::dvec4 getInterpolatedPosBetweenTwoMarks(cs::core::tools::DeletableMark const& l0,
-      cs::core::tools::DeletableMark const& l1, double value);
+  /// Returns the coordinates of NUM_SAMPLES points on each edge of the polygon. The samples are
+  /// interpolated in cartesian space between the marks, which are lifted by their heights
+  std::vector<glm::dvec2> getSamplesBetweenMarks(
+      std::vector<glm::dvec2> const& lngLats, std::vector<double> const& heights) const;
+
+  /// Returns the point on the planet's surface (without height) for the given coordinates on the
+  /// Voronoi plane
+  glm::dvec3 getSurfacePoint(double x, double y, double mdist, glm::dvec3 const& e,
+      glm::dvec3 const& n, glm::dvec3 const& r) const;
 
   /// Finds the intersection point between two sites
   static bool findIntersection(Site const& s1, Site const& s2, Site const& s3, Site const& s4,
@@ -93,11 +98,13 @@ class PolygonTool : public IVistaOpenGLDraw, public cs::core::tools::MultiPointT
   /// Returns true if a lot of new points are added
   bool checkSleekness(int count);
   /// Draws the Delaunay-mesh on the planet's surface
-  void displayMesh(Edge2 const& edge, double mdist, glm::dvec3 const& e, glm::dvec3 const& n,
-      glm::dvec3 const& r, double scale, double& h1, double& h2);
+  /// Returns the heights of both end points of each edge
+  void displayMesh(std::vector<Edge2> const& edges, double mdist, glm::dvec3 const& e,
+      glm::dvec3 const& n, glm::dvec3 const& r, double scale, std::vector<double>& heights);
   /// Refines mesh based on edge length and terrain
-  void refineMesh(Edge2 const& edge, double mdist, glm::dvec3 const& e, glm::dvec3 const& n,
-      glm::dvec3 const& r, int count, double h1, double h2, bool& fine);
+  void refineMesh(std::vector<Edge2> const& edges, double mdist, glm::dvec3 const& e,
+      glm::dvec3 const& n, glm::dvec3 const& r, int count, std::vector<double> const& heights,
+      bool& fine);
   /// Calculates triangle areas and prism volumes
   void calculateAreaAndVolume(std::vector<Triangle> const& triangles, double mdist,
       glm::dvec3 const& e, glm::dvec3 const& n, glm::dvec3 const& r, double& area, double& pvol,
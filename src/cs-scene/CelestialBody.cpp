@@ -17,4 +17,27 @@ CelestialBody::CelestialBody(std::string const& sCenterName, std::string const&
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+std::vector<double> CelestialBody::getHeights(std::vector<glm::dvec2> const& lngLats) const {
+  std::vector<double> heights;
+  heights.reserve(lngLats.size());
+
+  for (auto const& lngLat : lngLats) {
+    heights.push_back(getHeight(lngLat));
+  }
+
+  return heights;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::future<std::vector<double>> CelestialBody::getPreciseHeights(
+    std::vector<glm::dvec2> const& lngLats,
+    std::shared_ptr<utils::CancellationToken> /*token*/) const {
+  std::promise<std::vector<double>> heights;
+  heights.set_value(getHeights(lngLats));
+  return heights.get_future();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace cs::scene
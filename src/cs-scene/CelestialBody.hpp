@@ -7,9 +7,14 @@
 #ifndef CS_SCENE_CELESTIAL_BODY_HPP
 #define CS_SCENE_CELESTIAL_BODY_HPP
 
+#include "../cs-utils/CancellationToken.hpp"
 #include "../cs-utils/IntersectableObject.hpp"
 #include "CelestialObject.hpp"
 
+#include <future>
+#include <memory>
+#include <vector>
+
 namespace cs::scene {
 
 /// CelestialBody objects extend the CelestialObject by being intersectable. Every implementation
@@ -24,6 +29,27 @@ class CS_SCENE_EXPORT CelestialBody : public CelestialObject, public utils::Inte
   /// @param lngLat The coordinates on the surface in the Geographic Coordinate System format.
   virtual double getHeight(glm::dvec2 lngLat) const = 0;
 
+  /// The elevations at many points on the surface. The default implementation calls getHeight()
+  /// for each point, bodies with a complex surface may provide a faster implementation.
+  ///
+  /// @param lngLats The coordinates on the surface in the Geographic Coordinate System format.
+  /// @return        One elevation for each of the given coordinates.
+  virtual std::vector<double> getHeights(std::vector<glm::dvec2> const& lngLats) const;
+
+  /// The elevations at many points on the surface with the highest available precision. Computing
+  /// them may take a while, for example if terrain data has to be loaded. Hence callers should
+  /// show the results of getHeights() until the returned future is ready. Callers which are no
+  /// longer interested in the result, for example because they issue a new query, should cancel
+  /// the token, so that no more data is loaded for it. The default implementation returns the
+  /// results of getHeights() right away.
+  ///
+  /// @param lngLats The coordinates on the surface in the Geographic Coordinate System format.
+  /// @param token   May be nullptr. If it is cancelled, the future becomes ready early and
+  ///                contains the elevations which could be computed until then.
+  /// @return        One elevation for each of the given coordinates, once they are available.
+  virtual std::future<std::vector<double>> getPreciseHeights(std::vector<glm::dvec2> const& lngLats,
+      std::shared_ptr<utils::CancellationToken> token) const;
+
   /// The radii of the Body in meters.
   virtual glm::dvec3 getRadii() const = 0;
 };
@@ -113,4 +113,21 @@ bool CelestialObserver::isAnimationInProgress() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+CelestialAnchor CelestialObserver::getAnimationTarget() const {
+  CelestialAnchor target(getCenterName(), getFrameName());
+  target.setAnchorScale(getAnchorScale());
+
+  if (mAnimationInProgress) {
+    target.setAnchorPosition(mAnimatedPosition.mEndValue);
+    target.setAnchorRotation(mAnimatedRotation.mEndValue);
+  } else {
+    target.setAnchorPosition(getAnchorPosition());
+    target.setAnchorRotation(getAnchorRotation());
+  }
+
+  return target;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace cs::scene
@@ -50,6 +50,10 @@ class CS_SCENE_EXPORT CelestialObserver : public CelestialAnchor {
   /// @return true, if the observer is currently being moved.
   bool isAnimationInProgress() const;
 
+  /// @return An anchor located where the observer will be at the end of the current animation. If
+  ///         no animation is in progress, this is located at the observer's current position.
+  CelestialAnchor getAnimationTarget() const;
+
  protected:
   utils::AnimatedValue<glm::dvec3> mAnimatedPosition;
   utils::AnimatedValue<glm::dquat> mAnimatedRotation;
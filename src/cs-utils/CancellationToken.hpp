@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CS_UTILS_CANCELLATION_TOKEN_HPP
+#define CS_UTILS_CANCELLATION_TOKEN_HPP
+
+#include <atomic>
+
+namespace cs::utils {
+
+/// A CancellationToken is shared between the code which started an asynchronous job and the job
+/// itself. The former may call cancel() at any time, the latter should call isCancelled() before
+/// and at reasonable points during its execution and stop its work early if it returns true. The
+/// token is usually passed around as a std::shared_ptr so that it outlives both parties.
+class CancellationToken {
+ public:
+  CancellationToken() = default;
+
+  CancellationToken(CancellationToken const& other) = delete;
+  CancellationToken(CancellationToken&& other)      = delete;
+
+  CancellationToken& operator=(CancellationToken const& other) = delete;
+  CancellationToken& operator=(CancellationToken&& other) = delete;
+
+  ~CancellationToken() = default;
+
+  /// Requests the cancellation of the associated job. This can be called from any thread.
+  void cancel() {
+    mCancelled.store(true, std::memory_order_relaxed);
+  }
+
+  /// Returns true if cancel() has been called. This can be called from any thread.
+  bool isCancelled() const {
+    return mCancelled.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<bool> mCancelled{false};
+};
+
+} // namespace cs::utils
+
+#endif // CS_UTILS_CANCELLATION_TOKEN_HPP
@@ -6,38 +6,33 @@
 
 #include "ThreadPool.hpp"
 
-#include <iostream>
-
 namespace cs::utils {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-ThreadPool::ThreadPool(size_t threads)
-    : mStop(false) {
-  for (size_t i = 0; i < threads; ++i) {
-    mWorkers.emplace_back([this] {
-      while (true) {
-        std::function<void()> task;
-        {
-          std::unique_lock<std::mutex> lock(mMutex);
+namespace {
 
-          mCondition.wait(lock, [this] { return mStop || !mTasks.empty(); });
+// The pool and the queue index of the calling thread. These are only set for worker threads. They
+// are used to push tasks which are enqueued by a worker to the worker's own queue.
+thread_local ThreadPool const* tCurrentPool  = nullptr;
+thread_local size_t            tCurrentQueue = 0;
 
-          if (mStop && mTasks.empty()) {
-            return;
-          }
+} // namespace
 
-          task = std::move(mTasks.top());
-          mTasks.pop();
-          ++mRunningTasks;
-        }
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-        task();
+ThreadPool::ThreadPool(size_t threads) {
+  // We need at least one queue, even if no worker is created, so that enqueue() can store tasks.
+  size_t queueCount = std::max<size_t>(threads, 1);
 
-        std::unique_lock<std::mutex> lock(mMutex);
-        --mRunningTasks;
-      }
-    });
+  mQueues.reserve(queueCount);
+  for (size_t i = 0; i < queueCount; ++i) {
+    mQueues.push_back(std::make_unique<WorkQueue>());
+  }
+
+  mWorkers.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    mWorkers.emplace_back([this, i] { work(i); });
   }
 }
 
@@ -45,7 +40,7 @@ ThreadPool::ThreadPool(size_t threads)
 
 ThreadPool::~ThreadPool() {
   {
-    std::unique_lock<std::mutex> lock(mMutex);
+    std::unique_lock<std::mutex> lock(mSleepMutex);
     mStop = true;
   }
 
@@ -58,4 +53,107 @@ ThreadPool::~ThreadPool() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+uint32_t ThreadPool::getPendingTaskCount() const {
+  return static_cast<uint32_t>(std::max<int64_t>(mPendingTasks.load(), 0));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t ThreadPool::getRunningTaskCount() const {
+  return mRunningTasks.load();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::push(std::function<void()>&& task, Priority priority) {
+  {
+    std::unique_lock<std::mutex> lock(mSleepMutex);
+
+    if (mStop) {
+      throw std::runtime_error("enqueue on stopped ThreadPool");
+    }
+  }
+
+  // Workers push to their own queue, all other threads distribute their tasks evenly.
+  size_t queue = tCurrentPool == this ? tCurrentQueue : mNextQueue++ % mQueues.size();
+
+  {
+    std::unique_lock<std::mutex> lock(mQueues[queue]->mMutex);
+    mQueues[queue]->mTasks.at(static_cast<size_t>(priority)).push_back(std::move(task));
+  }
+
+  ++mPendingTasks;
+
+  // Acquiring the mutex ensures that no worker is between checking its wait predicate and going to
+  // sleep. Else the notification could get lost.
+  { std::unique_lock<std::mutex> lock(mSleepMutex); }
+
+  mCondition.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ThreadPool::pop(size_t worker, std::function<void()>& task) {
+  size_t queueCount = mQueues.size();
+
+  for (size_t p = sPriorityCount; p-- > 0;) {
+
+    // First look at the back of our own queue, then steal from the front of the other queues.
+    for (size_t i = 0; i < queueCount; ++i) {
+      auto& queue = *mQueues[(worker + i) % queueCount];
+      bool  own   = i == 0;
+
+      std::unique_lock<std::mutex> lock(queue.mMutex);
+      auto&                        tasks = queue.mTasks.at(p);
+
+      if (tasks.empty()) {
+        continue;
+      }
+
+      if (own) {
+        task = std::move(tasks.back());
+        tasks.pop_back();
+      } else {
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+
+      // Increment the running count first so that hasFinished() never sees zero in between.
+      ++mRunningTasks;
+      --mPendingTasks;
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::work(size_t worker) {
+  tCurrentPool  = this;
+  tCurrentQueue = worker;
+
+  while (true) {
+    std::function<void()> task;
+
+    if (pop(worker, task)) {
+      task();
+      --mRunningTasks;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mSleepMutex);
+
+    if (mStop && mPendingTasks.load() <= 0) {
+      return;
+    }
+
+    mCondition.wait(lock, [this] { return mStop || mPendingTasks.load() > 0; });
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace cs::utils
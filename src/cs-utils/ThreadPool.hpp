@@ -9,21 +9,36 @@
 
 #include "cs_utils_export.hpp"
 
+#include "CancellationToken.hpp"
+
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
-#include <stack>
 #include <stdexcept>
 #include <thread>
 #include <vector>
 
 namespace cs::utils {
 
-/// This is based on https://github.com/progschj/ThreadPool
+/// A thread pool with one task queue per worker thread. Tasks which are enqueued from a worker
+/// thread are pushed to the queue of this worker, tasks from other threads are distributed in a
+/// round-robin fashion. Idle workers steal tasks from the queues of other workers.
+///
+/// Each task has a priority. Workers will always execute the most urgent task they can find in any
+/// queue. Amongst tasks of the same priority, a worker will first process the tasks of its own
+/// queue in last-in-first-out order. Stolen tasks are taken in first-in-first-out order.
+///
+/// The interface is based on https://github.com/progschj/ThreadPool
 class CS_UTILS_EXPORT ThreadPool {
  public:
+  /// Tasks with a higher priority will be executed before any task with a lower priority.
+  enum class Priority { eLow = 0, eNormal = 1, eHigh = 2 };
+
   /// Creates a new ThreadPool with the specified amount of threads.
   explicit ThreadPool(size_t threads);
 
@@ -35,39 +50,53 @@ class CS_UTILS_EXPORT ThreadPool {
 
   virtual ~ThreadPool();
 
-  /// Adds a new work item to the pool.
+  /// Adds a new work item with Priority::eNormal to the pool.
   template <class F>
   auto enqueue(F&& f) -> std::future<typename std::invoke_result<F>::type> {
+    return enqueue(std::forward<F>(f), Priority::eNormal);
+  }
+
+  /// Adds a new work item with the given priority to the pool.
+  template <class F>
+  auto enqueue(F&& f, Priority priority) -> std::future<typename std::invoke_result<F>::type> {
     using return_type = typename std::invoke_result<F>::type;
 
     auto task = std::make_shared<std::packaged_task<return_type()>>(
         [Func = std::forward<F>(f)] { return Func(); });
 
     std::future<return_type> res = task->get_future();
-    {
-      std::unique_lock<std::mutex> lock(mMutex);
+    push([task]() { (*task)(); }, priority);
+    return res;
+  }
 
-      if (mStop) {
-        throw std::runtime_error("enqueue on stopped ThreadPool");
-      }
+  /// Adds a new work item with the given priority to the pool. If the given token is cancelled
+  /// before the task is started, the task will be skipped. In this case, calling get() on the
+  /// returned future will throw a std::future_error. The task may capture the token as well in
+  /// order to check it while it is running.
+  template <class F>
+  auto enqueue(F&& f, Priority priority, std::shared_ptr<CancellationToken> token)
+      -> std::future<typename std::invoke_result<F>::type> {
+    using return_type = typename std::invoke_result<F>::type;
+
+    auto task = std::make_shared<std::packaged_task<return_type()>>(
+        [Func = std::forward<F>(f)] { return Func(); });
 
-      mTasks.emplace([task]() { (*task)(); });
-    }
-    mCondition.notify_one();
+    std::future<return_type> res = task->get_future();
+    push(
+        [task, token = std::move(token)]() {
+          if (!token || !token->isCancelled()) {
+            (*task)();
+          }
+        },
+        priority);
     return res;
   }
 
   /// Returns the amount of tasks that await execution.
-  uint32_t getPendingTaskCount() const {
-    std::unique_lock<std::mutex> lock(mMutex);
-    return static_cast<uint32_t>(mTasks.size());
-  }
+  uint32_t getPendingTaskCount() const;
 
   /// Returns the number of tasks that currently are being executed.
-  uint32_t getRunningTaskCount() const {
-    std::unique_lock<std::mutex> lock(mMutex);
-    return mRunningTasks;
-  }
+  uint32_t getRunningTaskCount() const;
 
   /// Retruns true when there are no more tasks running or pending.
   bool hasFinished() const {
@@ -75,12 +104,36 @@ class CS_UTILS_EXPORT ThreadPool {
   }
 
  private:
-  std::vector<std::thread>          mWorkers;
-  std::stack<std::function<void()>> mTasks;
-  mutable std::mutex                mMutex;
-  std::condition_variable           mCondition;
-  bool                              mStop;
-  uint32_t                          mRunningTasks = 0;
+  static size_t const sPriorityCount = 3;
+
+  /// The tasks of one worker, one deque for each priority.
+  struct WorkQueue {
+    std::mutex                                                   mMutex;
+    std::array<std::deque<std::function<void()>>, sPriorityCount> mTasks;
+  };
+
+  /// Stores the task in the queue of the calling worker or, if called from another thread, in the
+  /// queue of the next worker. Throws a std::runtime_error if the pool is already stopped.
+  void push(std::function<void()>&& task, Priority priority);
+
+  /// Searches all queues for the most urgent task. The own queue of the given worker is searched
+  /// first. Returns false if no task could be found.
+  bool pop(size_t worker, std::function<void()>& task);
+
+  void work(size_t worker);
+
+  std::vector<std::unique_ptr<WorkQueue>> mQueues;
+  std::vector<std::thread>                mWorkers;
+
+  std::mutex              mSleepMutex;
+  std::condition_variable mCondition;
+  bool                    mStop = false;
+
+  // This may become negative for a short moment if a task is stolen before the enqueueing thread
+  // incremented the counter.
+  std::atomic<int64_t>  mPendingTasks{0};
+  std::atomic<uint32_t> mRunningTasks{0};
+  std::atomic<size_t>   mNextQueue{0};
 };
 
 } // namespace cs::utils
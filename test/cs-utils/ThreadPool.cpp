@@ -0,0 +1,265 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../../src/cs-utils/ThreadPool.hpp"
+#include "../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stack>
+
+namespace cs::utils {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// This is the single-queue LIFO ThreadPool which was used before the work-stealing implementation.
+// It is only kept here as a baseline for the benchmark below.
+class LegacyThreadPool {
+ public:
+  explicit LegacyThreadPool(size_t threads) {
+    for (size_t i = 0; i < threads; ++i) {
+      mWorkers.emplace_back([this] {
+        while (true) {
+          std::function<void()> task;
+          {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mStop || !mTasks.empty(); });
+
+            if (mStop && mTasks.empty()) {
+              return;
+            }
+
+            task = std::move(mTasks.top());
+            mTasks.pop();
+          }
+
+          task();
+        }
+      });
+    }
+  }
+
+  LegacyThreadPool(LegacyThreadPool const& other) = delete;
+  LegacyThreadPool(LegacyThreadPool&& other)      = delete;
+
+  LegacyThreadPool& operator=(LegacyThreadPool const& other) = delete;
+  LegacyThreadPool& operator=(LegacyThreadPool&& other) = delete;
+
+  ~LegacyThreadPool() {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+
+    mCondition.notify_all();
+
+    for (std::thread& worker : mWorkers) {
+      worker.join();
+    }
+  }
+
+  template <class F>
+  auto enqueue(F&& f) -> std::future<typename std::invoke_result<F>::type> {
+    using return_type = typename std::invoke_result<F>::type;
+
+    auto task = std::make_shared<std::packaged_task<return_type()>>(
+        [Func = std::forward<F>(f)] { return Func(); });
+
+    std::future<return_type> res = task->get_future();
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mTasks.emplace([task]() { (*task)(); });
+    }
+    mCondition.notify_one();
+    return res;
+  }
+
+ private:
+  std::vector<std::thread>          mWorkers;
+  std::stack<std::function<void()>> mTasks;
+  std::mutex                        mMutex;
+  std::condition_variable           mCondition;
+  bool                              mStop = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct BenchmarkResult {
+  double mTasksPerMillisecond = 0.0;
+  double mMedianLatency       = 0.0; ///< in µs from enqueue() until the task starts
+  double mP99Latency          = 0.0; ///< in µs from enqueue() until the task starts
+};
+
+// Enqueues taskCount small tasks from the calling thread and measures the overall throughput as
+// well as the latency between enqueueing a task and the start of its execution.
+template <typename Pool>
+BenchmarkResult runBenchmark(Pool& pool, size_t taskCount) {
+  using Clock = std::chrono::high_resolution_clock;
+
+  std::vector<double>            latencies(taskCount);
+  std::vector<std::future<void>> futures;
+  futures.reserve(taskCount);
+
+  auto start = Clock::now();
+
+  for (size_t i = 0; i < taskCount; ++i) {
+    auto enqueued = Clock::now();
+    futures.push_back(pool.enqueue([&latencies, enqueued, i]() {
+      latencies[i] = std::chrono::duration<double, std::micro>(Clock::now() - enqueued).count();
+
+      // Simulate a tiny bit of work.
+      volatile double sum = 0.0;
+      for (int j = 0; j < 200; ++j) {
+        sum = sum + std::sqrt(static_cast<double>(j));
+      }
+    }));
+  }
+
+  for (auto& f : futures) {
+    f.get();
+  }
+
+  double duration = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::sort(latencies.begin(), latencies.end());
+
+  BenchmarkResult result;
+  result.mTasksPerMillisecond = static_cast<double>(taskCount) / duration;
+  result.mMedianLatency       = latencies[taskCount / 2];
+  result.mP99Latency          = latencies[taskCount * 99 / 100];
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("cs::utils::ThreadPool::enqueue") {
+  ThreadPool pool(4);
+
+  std::vector<std::future<int>> futures;
+  futures.reserve(1000);
+
+  for (int i = 0; i < 1000; ++i) {
+    futures.push_back(pool.enqueue([i]() { return i; }, static_cast<ThreadPool::Priority>(i % 3)));
+  }
+
+  int sum = 0;
+  for (auto& f : futures) {
+    sum += f.get();
+  }
+
+  CHECK_EQ(sum, 999 * 1000 / 2);
+  CHECK_UNARY(pool.hasFinished());
+}
+
+TEST_CASE("cs::utils::ThreadPool::enqueue from worker threads") {
+  ThreadPool pool(2);
+
+  auto outer = pool.enqueue([&pool]() {
+    std::vector<std::future<int>> inner;
+    for (int i = 0; i < 100; ++i) {
+      inner.push_back(pool.enqueue([i]() { return i; }));
+    }
+
+    int sum = 0;
+    for (auto& f : inner) {
+      sum += f.get();
+    }
+    return sum;
+  });
+
+  CHECK_EQ(outer.get(), 99 * 100 / 2);
+}
+
+TEST_CASE("cs::utils::ThreadPool priorities") {
+  ThreadPool pool(1);
+
+  // Block the only worker until all tasks are enqueued.
+  std::promise<void> release;
+  auto               blocker = pool.enqueue([future = release.get_future().share()]() {
+    future.wait();
+  });
+
+  std::mutex       mutex;
+  std::vector<int> order;
+
+  auto log = [&mutex, &order](int value) {
+    return [&mutex, &order, value]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      order.push_back(value);
+    };
+  };
+
+  auto low    = pool.enqueue(log(0), ThreadPool::Priority::eLow);
+  auto normal = pool.enqueue(log(1), ThreadPool::Priority::eNormal);
+  auto high   = pool.enqueue(log(2), ThreadPool::Priority::eHigh);
+
+  release.set_value();
+
+  blocker.get();
+  low.get();
+  normal.get();
+  high.get();
+
+  std::vector<int> expected{2, 1, 0};
+  CHECK_EQ(order, expected);
+}
+
+TEST_CASE("cs::utils::ThreadPool cancellation") {
+  ThreadPool pool(1);
+
+  // Block the only worker until the token has been cancelled.
+  std::promise<void> release;
+  auto               blocker = pool.enqueue([future = release.get_future().share()]() {
+    future.wait();
+  });
+
+  auto token     = std::make_shared<CancellationToken>();
+  auto cancelled = pool.enqueue([]() { return 1; }, ThreadPool::Priority::eNormal, token);
+  auto executed  = pool.enqueue([]() { return 2; }, ThreadPool::Priority::eNormal,
+      std::make_shared<CancellationToken>());
+
+  token->cancel();
+  release.set_value();
+
+  blocker.get();
+  CHECK_THROWS(cancelled.get());
+  CHECK_EQ(executed.get(), 2);
+}
+
+TEST_CASE("cs::utils::ThreadPool [benchmark]") {
+  size_t const taskCount   = 200000;
+  size_t const threadCount = std::max(std::thread::hardware_concurrency(), 2U);
+
+  BenchmarkResult legacy;
+  BenchmarkResult stealing;
+
+  {
+    LegacyThreadPool pool(threadCount);
+    legacy = runBenchmark(pool, taskCount);
+  }
+
+  {
+    ThreadPool pool(threadCount);
+    stealing = runBenchmark(pool, taskCount);
+  }
+
+  MESSAGE("Threads: " << threadCount << ", Tasks: " << taskCount);
+  MESSAGE("Legacy pool:        " << legacy.mTasksPerMillisecond << " tasks/ms, median latency "
+                                 << legacy.mMedianLatency << " µs, p99 latency "
+                                 << legacy.mP99Latency << " µs");
+  MESSAGE("Work-stealing pool: " << stealing.mTasksPerMillisecond << " tasks/ms, median latency "
+                                 << stealing.mMedianLatency << " µs, p99 latency "
+                                 << stealing.mP99Latency << " µs");
+}
+
+} // namespace cs::utils